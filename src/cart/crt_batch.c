@@ -0,0 +1,645 @@
+/* Copyright (C) 2018 Intel Corporation
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted for any purpose (including commercial purposes)
+ * provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions, and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions, and the following disclaimer in the
+ *    documentation and/or materials provided with the distribution.
+ *
+ * 3. In addition, redistributions of modified forms of the source or binary
+ *    code must carry prominent notices stating that the original code was
+ *    changed and the date of the change.
+ *
+ *  4. All publications or advertising materials mentioning features or use of
+ *     this software are asked, but not required, to acknowledge that it was
+ *     developed by Intel Corporation and credit the contributors.
+ *
+ * 5. Neither the name of Intel Corporation, nor the name of any Contributor
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+/**
+ * This file is part of CaRT. It implements the packing of small RPCs queued
+ * to the same endpoint into one CRT_OPC_BATCH request, and their unpacking
+ * and dispatching on the server side.
+ *
+ * Each packed request is encoded as its common header followed by its input,
+ * prefixed by its length as an uint32_t. The replies are packed back in the
+ * same order as the common header followed by the output, prefixed by a
+ * struct crt_batch_reply_hdr, which carries the error if the reply could not
+ * be encoded. The client can then still find the replies which follow.
+ */
+
+#include "crt_internal.h"
+
+struct crt_batch_reply_hdr {
+	/* length of the encoded reply which follows, 0 if brh_rc != 0 */
+	uint32_t	brh_len;
+	int32_t		brh_rc;
+};
+
+/* if @rpc_priv can be packed into the same batch as @head */
+static inline bool
+crt_batch_packable(struct crt_rpc_priv *rpc_priv, struct crt_rpc_priv *head)
+{
+	crt_rpc_t	*rpc_pub = &rpc_priv->crp_pub;
+
+	return rpc_priv->crp_state == RPC_STATE_QUEUED &&
+	       !rpc_priv->crp_coll &&
+	       !rpc_priv->crp_opc_info->coi_no_reply &&
+	       rpc_pub->cr_opc != CRT_OPC_BATCH &&
+	       rpc_pub->cr_ep.ep_tag == head->crp_pub.cr_ep.ep_tag &&
+	       rpc_pub->cr_ep.ep_grp == head->crp_pub.cr_ep.ep_grp;
+}
+
+/*
+ * Encode the common header and the input (client side) or output (server
+ * side) of @rpc_priv into a buffer allocated in @iov.
+ * Returns -DER_OVERFLOW if it takes more than @max_size bytes.
+ */
+static int
+crt_batch_encode(struct crt_rpc_priv *rpc_priv, bool input, size_t max_size,
+		 d_iov_t *iov)
+{
+	struct crt_context	*crt_ctx = rpc_priv->crp_pub.cr_ctx;
+	hg_proc_t		 proc;
+	hg_return_t		 hg_ret;
+	hg_size_t		 used;
+	size_t			 size;
+	void			*buf;
+	int			 rc;
+
+	size = min(max_size, (size_t)CRT_BATCH_REQ_SIZE);
+again:
+	D_ALLOC(buf, size);
+	if (buf == NULL)
+		return -DER_NOMEM;
+
+	hg_ret = hg_proc_create_set(crt_ctx->cc_hg_ctx.chc_hgcla, buf, size,
+				    HG_ENCODE, HG_NOHASH, &proc);
+	if (hg_ret != HG_SUCCESS) {
+		RPC_ERROR(rpc_priv, "hg_proc_create_set failed, hg_ret: %d\n",
+			  hg_ret);
+		D_FREE(buf);
+		return -DER_HG;
+	}
+
+	if (input)
+		rc = crt_proc_in_common(proc, &rpc_priv->crp_pub.cr_input);
+	else
+		rc = crt_proc_out_common(proc, &rpc_priv->crp_pub.cr_output);
+	used = hg_proc_get_size_used(proc);
+	hg_proc_free(proc);
+
+	if (rc != 0) {
+		D_FREE(buf);
+		return rc;
+	}
+
+	if (used > size) {
+		/* spilled out of buf, retry with a large enough one */
+		D_FREE(buf);
+		if (used > max_size)
+			return -DER_OVERFLOW;
+		size = used;
+		goto again;
+	}
+
+	d_iov_set(iov, buf, used);
+	return 0;
+}
+
+/* decode the reply of a packed request on the client side */
+static int
+crt_batch_decode_reply(struct crt_rpc_priv *rpc_priv, void *buf, size_t len)
+{
+	struct crt_context	*crt_ctx = rpc_priv->crp_pub.cr_ctx;
+	hg_proc_t		 proc;
+	hg_return_t		 hg_ret;
+	int			 rc;
+
+	hg_ret = hg_proc_create_set(crt_ctx->cc_hg_ctx.chc_hgcla, buf, len,
+				    HG_DECODE, HG_NOHASH, &proc);
+	if (hg_ret != HG_SUCCESS) {
+		RPC_ERROR(rpc_priv, "hg_proc_create_set failed, hg_ret: %d\n",
+			  hg_ret);
+		return -DER_HG;
+	}
+
+	/* freed in crt_batch_req_fini */
+	rc = crt_proc_out_common(proc, &rpc_priv->crp_pub.cr_output);
+	if (rc == 0)
+		rpc_priv->crp_output_got = 1;
+	else
+		RPC_ERROR(rpc_priv, "unpack reply failed, rc: %d\n", rc);
+	hg_proc_free(proc);
+
+	return rc;
+}
+
+/*
+ * Decode the next reply in the @left bytes of @buf for @rpc_priv into @rc,
+ * and move past it. Returns false if the replies cannot be parsed anymore.
+ */
+static bool
+crt_batch_reply_next(struct crt_rpc_priv *rpc_priv, char **buf, size_t *left,
+		     int *rc)
+{
+	struct crt_batch_reply_hdr	hdr;
+
+	if (*left < sizeof(hdr))
+		return false;
+	memcpy(&hdr, *buf, sizeof(hdr));
+	if (hdr.brh_len > *left - sizeof(hdr) ||
+	    (hdr.brh_len == 0 && hdr.brh_rc == 0))
+		return false;
+
+	if (hdr.brh_rc != 0)
+		*rc = hdr.brh_rc;
+	else
+		*rc = crt_batch_decode_reply(rpc_priv, *buf + sizeof(hdr),
+					     hdr.brh_len);
+	*buf += sizeof(hdr) + hdr.brh_len;
+	*left -= sizeof(hdr) + hdr.brh_len;
+
+	return true;
+}
+
+/* completion callback of the CRT_OPC_BATCH request, completes packed reqs */
+static void
+crt_batch_complete_cb(const struct crt_cb_info *cb_info)
+{
+	struct crt_batch	*batch = cb_info->cci_arg;
+	struct crt_batch_in	*in;
+	struct crt_batch_out	*out;
+	struct crt_rpc_priv	*rpc_priv;
+	char			*buf = NULL;
+	size_t			 left = 0;
+	uint32_t		 i;
+	int			 rc = cb_info->cci_rc;
+	int			 rpc_rc;
+
+	in = crt_req_get(cb_info->cci_rpc);
+	out = crt_reply_get(cb_info->cci_rpc);
+	if (rc == 0)
+		rc = out->bo_rc;
+	if (rc == 0 && out->bo_num != batch->cb_num) {
+		D_ERROR("got %u replies for %u reqs.\n", out->bo_num,
+			batch->cb_num);
+		rc = -DER_PROTO;
+	}
+	if (rc == 0) {
+		buf = out->bo_replies.iov_buf;
+		left = out->bo_replies.iov_len;
+	}
+
+	for (i = 0; i < batch->cb_num; i++) {
+		rpc_priv = batch->cb_reqs[i].cbr_rpc;
+		rpc_rc = rc;
+		if (rpc_rc == 0 &&
+		    !crt_batch_reply_next(rpc_priv, &buf, &left, &rpc_rc)) {
+			D_ERROR("bad reply %u/%u.\n", i, batch->cb_num);
+			/* the remaining ones are lost too */
+			rc = rpc_rc = -DER_PROTO;
+		}
+
+		rpc_priv->crp_batch = NULL;
+		crt_rpc_complete(rpc_priv, rpc_rc);
+		crt_context_req_untrack(rpc_priv);
+		/* corresponding to the refcount taken in crt_rpc_priv_init */
+		RPC_DECREF(rpc_priv);
+	}
+
+	D_FREE(in->bi_reqs.iov_buf);
+	D_FREE(batch);
+}
+
+/*
+ * Called with epi_mutex held. Packs @head and the following reqs in the waitq
+ * of @epi for the same endpoint into a new CRT_OPC_BATCH request, at most
+ * crt_gdata.cg_batch_max of them. The packed reqs are removed from the waitq,
+ * the caller tracks the returned request in their place.
+ * Returns NULL if there are not at least two reqs to pack.
+ */
+struct crt_rpc_priv *
+crt_batch_pack(struct crt_ep_inflight *epi, struct crt_rpc_priv *head)
+{
+	struct crt_batch	*batch;
+	struct crt_batch_req	*req;
+	struct crt_batch_in	*in;
+	struct crt_rpc_priv	*rpc_priv;
+	struct crt_rpc_priv	*batch_rpc = NULL;
+	crt_rpc_t		*batch_pub;
+	uint32_t		 timeout_sec = 0;
+	uint32_t		 len;
+	size_t			 size = 0;
+	char			*buf;
+	uint32_t		 i;
+	int			 rc;
+
+	if (epi->epi_req_wait_num < 2 || !crt_batch_packable(head, head))
+		return NULL;
+
+	D_ALLOC(batch, sizeof(*batch) +
+		       crt_gdata.cg_batch_max * sizeof(batch->cb_reqs[0]));
+	if (batch == NULL)
+		return NULL;
+
+	d_list_for_each_entry(rpc_priv, &epi->epi_req_waitq, crp_epi_link) {
+		if (batch->cb_num == crt_gdata.cg_batch_max)
+			break;
+		if (!crt_batch_packable(rpc_priv, head))
+			continue;
+
+		req = &batch->cb_reqs[batch->cb_num];
+		/* too large ones are sent on their own */
+		rc = crt_batch_encode(rpc_priv, true, CRT_BATCH_REQ_SIZE,
+				      &req->cbr_buf);
+		if (rc != 0)
+			continue;
+
+		req->cbr_rpc = rpc_priv;
+		size += sizeof(len) + req->cbr_buf.iov_len;
+		batch->cb_num++;
+	}
+	if (batch->cb_num < 2)
+		D_GOTO(out, 0);
+
+	rc = crt_req_create(epi->epi_ctx, &head->crp_pub.cr_ep, CRT_OPC_BATCH,
+			    &batch_pub);
+	if (rc != 0) {
+		D_ERROR("crt_req_create failed, rc: %d.\n", rc);
+		D_GOTO(out, 0);
+	}
+	batch_rpc = container_of(batch_pub, struct crt_rpc_priv, crp_pub);
+
+	in = crt_req_get(batch_pub);
+	D_ALLOC(buf, size);
+	if (buf == NULL) {
+		/* corresponding to the refcount taken in crt_rpc_priv_init */
+		RPC_DECREF(batch_rpc);
+		batch_rpc = NULL;
+		D_GOTO(out, 0);
+	}
+	d_iov_set(&in->bi_reqs, buf, size);
+	in->bi_num = batch->cb_num;
+
+	for (i = 0; i < batch->cb_num; i++) {
+		req = &batch->cb_reqs[i];
+		len = req->cbr_buf.iov_len;
+		memcpy(buf, &len, sizeof(len));
+		buf += sizeof(len);
+		memcpy(buf, req->cbr_buf.iov_buf, len);
+		buf += len;
+
+		rpc_priv = req->cbr_rpc;
+		timeout_sec = max(timeout_sec, rpc_priv->crp_timeout_sec);
+
+		/* the ref taken by crt_context_req_track goes with it */
+		d_list_del_init(&rpc_priv->crp_epi_link);
+		epi->epi_req_wait_num--;
+		rpc_priv->crp_state = RPC_STATE_REQ_SENT;
+		rpc_priv->crp_batched = 1;
+		rpc_priv->crp_batch = batch;
+		rpc_priv->crp_batch_idx = i;
+	}
+
+	batch->cb_rpc = batch_rpc;
+	batch_rpc->crp_timeout_sec = timeout_sec;
+	batch_rpc->crp_complete_cb = crt_batch_complete_cb;
+	batch_rpc->crp_arg = batch;
+
+	RPC_TRACE(DB_NET, batch_rpc, "packed %u reqs (%zu bytes) to rank %d "
+		  "tag %d.\n", batch->cb_num, size, epi->epi_ep.ep_rank,
+		  head->crp_pub.cr_ep.ep_tag);
+
+out:
+	for (i = 0; i < batch->cb_num; i++)
+		D_FREE(batch->cb_reqs[i].cbr_buf.iov_buf);
+	if (batch_rpc == NULL)
+		D_FREE(batch);
+	return batch_rpc;
+}
+
+/*
+ * Server side, drop one pending reply of @batch. The last one sends the
+ * packed replies back and releases the batch.
+ */
+static void
+crt_batch_reply_put(struct crt_batch *batch)
+{
+	struct crt_rpc_priv	*batch_rpc = batch->cb_rpc;
+	struct crt_batch_out	*out;
+	struct crt_batch_reply_hdr hdr;
+	d_iov_t			*iov;
+	size_t			 size = 0;
+	char			*buf;
+	uint32_t		 i;
+	int			 rc;
+
+	if (__atomic_sub_fetch(&batch->cb_pending, 1, __ATOMIC_ACQ_REL) != 0)
+		return;
+
+	out = crt_reply_get(&batch_rpc->crp_pub);
+	for (i = 0; i < batch->cb_num; i++)
+		size += sizeof(hdr) + batch->cb_reqs[i].cbr_buf.iov_len;
+
+	D_ALLOC(buf, size);
+	if (buf == NULL) {
+		out->bo_rc = -DER_NOMEM;
+	} else {
+		d_iov_set(&out->bo_replies, buf, size);
+		out->bo_num = batch->cb_num;
+		for (i = 0; i < batch->cb_num; i++) {
+			iov = &batch->cb_reqs[i].cbr_buf;
+			hdr.brh_len = iov->iov_len;
+			hdr.brh_rc = batch->cb_reqs[i].cbr_rc;
+			memcpy(buf, &hdr, sizeof(hdr));
+			buf += sizeof(hdr);
+			if (hdr.brh_len > 0)
+				memcpy(buf, iov->iov_buf, hdr.brh_len);
+			buf += hdr.brh_len;
+		}
+	}
+
+	rc = crt_reply_send(&batch_rpc->crp_pub);
+	if (rc != 0)
+		RPC_ERROR(batch_rpc, "crt_reply_send failed, rc: %d\n", rc);
+
+	/* the output is encoded by crt_reply_send already */
+	D_FREE(out->bo_replies.iov_buf);
+	d_iov_set(&out->bo_replies, NULL, 0);
+	for (i = 0; i < batch->cb_num; i++)
+		D_FREE(batch->cb_reqs[i].cbr_buf.iov_buf);
+	D_FREE(batch);
+
+	/* corresponding to addref in crt_hdlr_batch */
+	RPC_DECREF(batch_rpc);
+}
+
+/* server side, pack the reply of @rpc_priv as the @idx one of @batch */
+static void
+crt_batch_reply_set(struct crt_batch *batch, uint32_t idx,
+		    struct crt_rpc_priv *rpc_priv)
+{
+	struct crt_batch_req	*req = &batch->cb_reqs[idx];
+	int			 rc;
+
+	rc = crt_batch_encode(rpc_priv, false, SIZE_MAX, &req->cbr_buf);
+	if (rc != 0) {
+		RPC_ERROR(rpc_priv, "pack reply failed, rc: %d\n", rc);
+		/* the client gets it from the reply header */
+		d_iov_set(&req->cbr_buf, NULL, 0);
+		req->cbr_rc = rc;
+	}
+
+	crt_batch_reply_put(batch);
+}
+
+static void
+crt_batch_reply_error(struct crt_batch *batch, uint32_t idx, int error_code)
+{
+	batch->cb_reqs[idx].cbr_rc = error_code;
+	crt_batch_reply_put(batch);
+}
+
+/* called by crt_hg_reply_send and crt_hg_reply_error_send */
+int
+crt_batch_reply(struct crt_rpc_priv *rpc_priv)
+{
+	struct crt_batch	*batch = rpc_priv->crp_batch;
+
+	D_ASSERT(rpc_priv->crp_batched && rpc_priv->crp_srv);
+	if (batch == NULL) {
+		RPC_ERROR(rpc_priv, "reply already sent.\n");
+		return -DER_ALREADY;
+	}
+
+	rpc_priv->crp_batch = NULL;
+	crt_batch_reply_set(batch, rpc_priv->crp_batch_idx, rpc_priv);
+
+	return 0;
+}
+
+/*
+ * Server side, unpack the @idx request of @batch from @buf and invoke its
+ * handler, the same way as crt_rpc_handler_common does for a request with its
+ * own HG handle.
+ */
+static void
+crt_batch_req_dispatch(struct crt_batch *batch, uint32_t idx, void *buf,
+		       size_t len)
+{
+	struct crt_rpc_priv	*batch_rpc = batch->cb_rpc;
+	struct crt_context	*crt_ctx = batch_rpc->crp_pub.cr_ctx;
+	struct crt_rpc_priv	*rpc_priv;
+	struct crt_opc_info	*opc_info;
+	struct crt_common_hdr	 hdr = {0};
+	hg_proc_t		 proc = HG_PROC_NULL;
+	hg_return_t		 hg_ret;
+	crt_opcode_t		 opc;
+	int			 rc;
+
+	hg_ret = hg_proc_create_set(crt_ctx->cc_hg_ctx.chc_hgcla, buf, len,
+				    HG_DECODE, HG_NOHASH, &proc);
+	if (hg_ret != HG_SUCCESS) {
+		D_ERROR("hg_proc_create_set failed, hg_ret: %d.\n", hg_ret);
+		crt_batch_reply_error(batch, idx, -DER_HG);
+		return;
+	}
+
+	rc = crt_proc_common_hdr(proc, &hdr);
+	if (rc != 0) {
+		D_ERROR("crt_proc_common_hdr failed, rc: %d.\n", rc);
+		crt_hg_unpack_cleanup(proc);
+		crt_batch_reply_error(batch, idx, -DER_MISC);
+		return;
+	}
+	opc = hdr.cch_opc;
+
+	opc_info = crt_opc_lookup(crt_gdata.cg_opc_map, opc, CRT_UNLOCK);
+	if (opc_info == NULL)
+		opc_info = crt_opc_lookup_legacy(crt_gdata.cg_opc_map_legacy,
+						 opc, CRT_UNLOCK);
+	if (opc_info == NULL) {
+		D_ERROR("opc: %#x, lookup failed.\n", opc);
+		crt_hg_unpack_cleanup(proc);
+		crt_batch_reply_error(batch, idx, -DER_UNREG);
+		return;
+	}
+	if (opc == CRT_OPC_BATCH || opc_info->coi_no_reply ||
+	    (hdr.cch_flags & CRT_RPC_FLAG_COLL)) {
+		D_ERROR("opc: %#x, cannot be packed.\n", opc);
+		crt_hg_unpack_cleanup(proc);
+		crt_batch_reply_error(batch, idx, -DER_PROTO);
+		return;
+	}
+
+	rpc_priv = crt_rpc_cache_get(crt_ctx->cc_rpc_cache,
+				     opc_info->coi_rpc_size);
+	if (rpc_priv == NULL) {
+		crt_hg_unpack_cleanup(proc);
+		crt_batch_reply_error(batch, idx, -DER_DOS);
+		return;
+	}
+	/* share the HG handle of the batch, e.g. for bulk transfers */
+	rpc_priv->crp_hg_addr = batch_rpc->crp_hg_addr;
+	rpc_priv->crp_hg_hdl = batch_rpc->crp_hg_hdl;
+	rpc_priv->crp_pub.cr_ctx = crt_ctx;
+	rpc_priv->crp_flags = hdr.cch_flags;
+	rpc_priv->crp_req_hdr = hdr;
+	rpc_priv->crp_opc_info = opc_info;
+
+	rc = crt_rpc_priv_init(rpc_priv, crt_ctx, true /* srv_flag */);
+	if (rc != 0) {
+		D_ERROR("crt_rpc_priv_init rc=%d, opc=%#x\n", rc, opc);
+		crt_hg_unpack_cleanup(proc);
+		crt_rpc_priv_free(rpc_priv);
+		crt_batch_reply_error(batch, idx, -DER_MISC);
+		return;
+	}
+	/* the reply is packed by crt_batch_reply */
+	rpc_priv->crp_batched = 1;
+	rpc_priv->crp_batch = batch;
+	rpc_priv->crp_batch_idx = idx;
+	rpc_priv->crp_pub.cr_ep.ep_rank = hdr.cch_rank;
+	rpc_priv->crp_pub.cr_ep.ep_grp = NULL;
+
+	RPC_TRACE(DB_TRACE, rpc_priv, "unpacked from batch %p, index %u.\n",
+		  batch, idx);
+
+	if (rpc_priv->crp_pub.cr_input_size > 0) {
+		/* corresponding to the free in crt_batch_req_fini */
+		rc = crt_hg_unpack_body(rpc_priv, proc);
+		if (rc != 0) {
+			RPC_ERROR(rpc_priv, "unpack input failed, rc: %d\n",
+				  rc);
+			crt_hg_reply_error_send(rpc_priv, -DER_MISC);
+			D_GOTO(decref, rc);
+		}
+		rpc_priv->crp_input_got = 1;
+	} else {
+		crt_hg_unpack_cleanup(proc);
+	}
+
+	/* same as for a request received on its own */
+	crt_rpc_handler_invoke(rpc_priv);
+	return;
+
+decref:
+	RPC_DECREF(rpc_priv);
+}
+
+void
+crt_hdlr_batch(crt_rpc_t *rpc_req)
+{
+	struct crt_rpc_priv	*batch_rpc;
+	struct crt_batch_in	*in;
+	struct crt_batch_out	*out;
+	struct crt_batch	*batch;
+	char			*buf;
+	size_t			 left;
+	uint32_t		 len;
+	uint32_t		 i;
+	int			 rc = 0;
+
+	batch_rpc = container_of(rpc_req, struct crt_rpc_priv, crp_pub);
+	in = crt_req_get(rpc_req);
+	out = crt_reply_get(rpc_req);
+
+	if (in->bi_num == 0 || in->bi_num > CRT_BATCH_MAX_NUM) {
+		D_ERROR("invalid number of packed reqs: %u.\n", in->bi_num);
+		D_GOTO(out, rc = -DER_INVAL);
+	}
+
+	D_ALLOC(batch, sizeof(*batch) + in->bi_num * sizeof(batch->cb_reqs[0]));
+	if (batch == NULL)
+		D_GOTO(out, rc = -DER_NOMEM);
+
+	/* released in crt_batch_reply_put once all the reqs replied */
+	RPC_ADDREF(batch_rpc);
+	batch->cb_rpc = batch_rpc;
+	batch->cb_num = in->bi_num;
+	/* hold one more until all the reqs are dispatched */
+	batch->cb_pending = batch->cb_num + 1;
+
+	buf = in->bi_reqs.iov_buf;
+	left = in->bi_reqs.iov_len;
+	for (i = 0; i < batch->cb_num; i++) {
+		len = 0;
+		if (left >= sizeof(len)) {
+			memcpy(&len, buf, sizeof(len));
+			buf += sizeof(len);
+			left -= sizeof(len);
+		}
+		if (len == 0 || len > left) {
+			D_ERROR("bad req %u/%u, len %u.\n", i, batch->cb_num,
+				len);
+			/* the remaining ones are lost too */
+			left = 0;
+			crt_batch_reply_error(batch, i, -DER_PROTO);
+			continue;
+		}
+
+		crt_batch_req_dispatch(batch, i, buf, len);
+		buf += len;
+		left -= len;
+	}
+
+	crt_batch_reply_put(batch);
+	return;
+
+out:
+	out->bo_rc = rc;
+	rc = crt_reply_send(rpc_req);
+	if (rc != 0)
+		D_ERROR("crt_reply_send failed, rc: %d.\n", rc);
+}
+
+/* free the input or output decoded by crt_batch.c, see crt_hg_req_destroy */
+void
+crt_batch_req_fini(struct crt_rpc_priv *rpc_priv)
+{
+	struct crt_context	*crt_ctx = rpc_priv->crp_pub.cr_ctx;
+	hg_proc_t		 proc;
+	hg_return_t		 hg_ret;
+
+	D_ASSERT(rpc_priv->crp_batched);
+	if (rpc_priv->crp_output_got || rpc_priv->crp_input_got) {
+		hg_ret = hg_proc_create_set(crt_ctx->cc_hg_ctx.chc_hgcla,
+					    NULL, 0, HG_FREE, HG_NOHASH,
+					    &proc);
+		if (hg_ret == HG_SUCCESS) {
+			if (rpc_priv->crp_output_got)
+				crt_proc_out_common(proc,
+						&rpc_priv->crp_pub.cr_output);
+			if (rpc_priv->crp_input_got)
+				crt_proc_in_common(proc,
+						&rpc_priv->crp_pub.cr_input);
+			hg_proc_free(proc);
+		} else {
+			RPC_ERROR(rpc_priv,
+				  "hg_proc_create_set failed, hg_ret: %d\n",
+				  hg_ret);
+		}
+	}
+
+	crt_rpc_priv_fini(rpc_priv);
+}
@@ -271,3 +271,148 @@ crt_bulk_abort(crt_context_t crt_ctx, crt_bulk_opid_t opid)
 {
 	return crt_hg_bulk_cancel(opid);
 }
+
+/*
+ * crt_iov_auto_t fields, see crt_proc_crt_iov_auto_t(). On the client side
+ * crp_iov_auto records the fields a bulk handle was created for, on the server
+ * side the fields whose payload has to be pulled before invoking the handler.
+ */
+int
+crt_iov_auto_track(struct crt_rpc_priv *rpc_priv, crt_iov_auto_t *field)
+{
+	crt_iov_auto_t	**fields;
+
+	D_REALLOC_ARRAY(fields, rpc_priv->crp_iov_auto,
+			(rpc_priv->crp_iov_auto_num + 1));
+	if (fields == NULL)
+		return -DER_NOMEM;
+
+	fields[rpc_priv->crp_iov_auto_num++] = field;
+	rpc_priv->crp_iov_auto = fields;
+
+	return 0;
+}
+
+void
+crt_iov_auto_fini(struct crt_rpc_priv *rpc_priv)
+{
+	crt_iov_auto_t	*field;
+	int		 i;
+
+	if (rpc_priv->crp_iov_auto == NULL)
+		return;
+
+	/* server side the remote handles are freed with the input */
+	for (i = 0; !rpc_priv->crp_srv && i < rpc_priv->crp_iov_auto_num;
+	     i++) {
+		field = rpc_priv->crp_iov_auto[i];
+		crt_bulk_free(field->ia_bulk);
+		field->ia_bulk = CRT_BULK_NULL;
+	}
+
+	D_FREE(rpc_priv->crp_iov_auto);
+	rpc_priv->crp_iov_auto_num = 0;
+}
+
+/* account for \a num finished pulls, invoke the handler after the last one */
+static void
+crt_iov_auto_pull_done(struct crt_rpc_priv *rpc_priv, int rc, uint32_t num)
+{
+	if (rc != 0) {
+		D_SPIN_LOCK(&rpc_priv->crp_lock);
+		if (rpc_priv->crp_iov_auto_rc == 0)
+			rpc_priv->crp_iov_auto_rc = rc;
+		D_SPIN_UNLOCK(&rpc_priv->crp_lock);
+	}
+
+	if (__atomic_sub_fetch(&rpc_priv->crp_iov_auto_pending, num,
+			       __ATOMIC_ACQ_REL) != 0)
+		return;
+
+	rc = rpc_priv->crp_iov_auto_rc;
+	if (rc == 0) {
+		crt_rpc_handler_call(rpc_priv);
+		return;
+	}
+
+	RPC_ERROR(rpc_priv, "failed to pull crt_iov_auto_t input, rc: %d\n",
+		  rc);
+	crt_hg_reply_error_send(rpc_priv, rc);
+	RPC_DECREF(rpc_priv);
+}
+
+static int
+crt_iov_auto_pull_cb(const struct crt_bulk_cb_info *cb_info)
+{
+	struct crt_rpc_priv	*rpc_priv = cb_info->bci_arg;
+
+	crt_bulk_free(cb_info->bci_bulk_desc->bd_local_hdl);
+	crt_iov_auto_pull_done(rpc_priv, cb_info->bci_rc, 1);
+
+	return 0;
+}
+
+/*
+ * Pull the payload of all crt_iov_auto_t input fields sent by bulk, the RPC
+ * handler is invoked by crt_rpc_handler_call() once all of them arrived. The
+ * reference taken when the request was received is held until then.
+ */
+void
+crt_iov_auto_pull(struct crt_rpc_priv *rpc_priv)
+{
+	crt_iov_auto_t		*field;
+	struct crt_bulk_desc	 bulk_desc;
+	d_sg_list_t		 sgl;
+	crt_bulk_t		 local_bulk;
+	uint32_t		 num = rpc_priv->crp_iov_auto_num;
+	uint32_t		 i;
+	int			 rc = 0;
+
+	D_ASSERT(rpc_priv->crp_srv && num > 0);
+
+	rpc_priv->crp_iov_auto_rc = 0;
+	/* one extra count so no completion can finish the pull early */
+	rpc_priv->crp_iov_auto_pending = num + 1;
+
+	for (i = 0; i < num; i++) {
+		field = rpc_priv->crp_iov_auto[i];
+		if (field->ia_iov.iov_len == 0) {
+			crt_iov_auto_pull_done(rpc_priv, 0, 1);
+			continue;
+		}
+
+		sgl.sg_nr = 1;
+		sgl.sg_nr_out = 0;
+		sgl.sg_iovs = &field->ia_iov;
+		rc = crt_bulk_create(rpc_priv->crp_pub.cr_ctx, &sgl,
+				     CRT_BULK_RW, &local_bulk);
+		if (rc != 0) {
+			RPC_ERROR(rpc_priv, "crt_bulk_create failed, rc: %d\n",
+				  rc);
+			break;
+		}
+
+		bulk_desc.bd_rpc = &rpc_priv->crp_pub;
+		bulk_desc.bd_bulk_op = CRT_BULK_GET;
+		bulk_desc.bd_remote_hdl = field->ia_bulk;
+		bulk_desc.bd_remote_off = 0;
+		bulk_desc.bd_local_hdl = local_bulk;
+		bulk_desc.bd_local_off = 0;
+		bulk_desc.bd_len = field->ia_iov.iov_len;
+		/* the handle is bound to the sender, which for a forwarded
+		 * corpc is not necessarily the peer of this RPC
+		 */
+		rc = crt_bulk_bind_transfer(&bulk_desc, crt_iov_auto_pull_cb,
+					    rpc_priv, NULL);
+		if (rc != 0) {
+			RPC_ERROR(rpc_priv,
+				  "crt_bulk_bind_transfer failed, rc: %d\n",
+				  rc);
+			crt_bulk_free(local_bulk);
+			break;
+		}
+	}
+
+	/* drop the extra count and the ones of the pulls never started */
+	crt_iov_auto_pull_done(rpc_priv, rc, num - i + 1);
+}
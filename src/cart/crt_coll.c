@@ -0,0 +1,1205 @@
+/* Copyright (C) 2018 Intel Corporation
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted for any purpose (including commercial purposes)
+ * provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions, and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions, and the following disclaimer in the
+ *    documentation and/or materials provided with the distribution.
+ *
+ * 3. In addition, redistributions of modified forms of the source or binary
+ *    code must carry prominent notices stating that the original code was
+ *    changed and the date of the change.
+ *
+ *  4. All publications or advertising materials mentioning features or use of
+ *     this software are asked, but not required, to acknowledge that it was
+ *     developed by Intel Corporation and credit the contributors.
+ *
+ * 5. Neither the name of Intel Corporation, nor the name of any Contributor
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+/**
+ * This file is part of CaRT. It implements the data movement collectives,
+ * crt_allgather(), crt_allreduce() and crt_reduce_scatter().
+ *
+ * A collective runs as a sequence of steps on each rank. In each step a rank
+ * sends a range of its working buffer to zero or more peers by
+ * CRT_OPC_COLL_XFER, and copies or reduces the payloads it receives from
+ * zero or more peers into another range. Payloads larger than the eager
+ * message are pulled by bulk (see crt_iov_auto_t).
+ *
+ * The target of a CRT_OPC_COLL_XFER copies the payload and replies at once,
+ * so a rank never waits on a peer to be in the same step to make progress on
+ * its own sends. The copy is queued on the group, tagged with the sequence
+ * number of the collective and the step it is for, until that step consumes
+ * it. All ranks start the collectives of a group in the same order, so they
+ * agree on the sequence numbers.
+ *
+ * Group ranks can be sparse (see crt_group_node_add()), so the algorithms
+ * work on the index of each rank in the sorted list of the live ranks, taken
+ * when the collective starts. Blocks and peers are indexes in that list.
+ *
+ * A rank waits for the payloads of its peers without any RPC of its own in
+ * flight, so each step has a deadline of crt_gdata.cg_timeout on ci_tw,
+ * checked by the progress of context 0. A collective fails with
+ * -DER_TIMEDOUT when a step passes its deadline, and with -DER_EVICTED when
+ * one of its ranks is evicted, as that rank may never send its payloads.
+ */
+#define D_LOGFAC	DD_FAC(grp)
+
+#include "crt_internal.h"
+
+/* total payload below which CRT_COLL_AUTO prefers latency to bandwidth */
+#define CRT_COLL_SMALL		(8192)
+
+enum crt_coll_kind {
+	CRT_COLL_ALLGATHER,
+	CRT_COLL_ALLREDUCE,
+	CRT_COLL_REDUCE_SCATTER,
+};
+
+enum crt_coll_recv_op {
+	CRT_COLL_COPY,
+	CRT_COLL_REDUCE,
+	/* allgather tree, a list of indexes followed by their blocks */
+	CRT_COLL_GATHER,
+};
+
+/* what one rank does in one step */
+struct crt_coll_plan {
+	d_rank_t		*pl_send;	/* indexes sent to */
+	uint32_t		 pl_send_nr;
+	d_rank_t		 pl_peer;	/* storage for one index */
+	uint32_t		 pl_tag;	/* step of the targets */
+	void			*pl_send_buf;
+	size_t			 pl_send_len;
+	uint32_t		 pl_recv_nr;	/* payloads received */
+	enum crt_coll_recv_op	 pl_recv_op;
+	size_t			 pl_recv_off;	/* in the working buffer */
+	size_t			 pl_recv_len;
+	/* the received range overlaps the sent one */
+	bool			 pl_overlap;
+};
+
+struct crt_coll {
+	d_list_t		 cl_link;	/* crt_coll_info::ci_colls */
+	struct crt_grp_priv	*cl_grp;
+	uint64_t		 cl_seq;
+	enum crt_coll_kind	 cl_kind;
+	enum crt_coll_alg	 cl_alg;
+	enum crt_reduce_op	 cl_op;
+	enum crt_reduce_type	 cl_type;
+	size_t			 cl_esize;	/* element size */
+	size_t			 cl_nr;		/* elements of cl_buf */
+	size_t			 cl_blk_size;	/* bytes of a block */
+	/* sorted live ranks, cl_self and the peers are indexes in it */
+	d_rank_list_t		*cl_membs;
+	uint32_t		 cl_self;
+	uint32_t		 cl_size;
+	uint32_t		 cl_log;	/* log2(cl_size) for RD */
+	/* RD allreduce, recursive halving then doubling */
+	bool			 cl_halving;
+	/*
+	 * working buffer of cl_size blocks, the receive buffer for allgather
+	 * and allreduce, a copy of the send buffer for reduce-scatter
+	 */
+	char			*cl_buf;
+	void			*cl_recvbuf;
+	/* tree, the parent and the children as indexes in cl_membs */
+	uint32_t		 cl_parent;
+	bool			 cl_root;
+	d_rank_list_t		*cl_children;
+	/* allgather tree, the indexes of the blocks gathered in cl_buf */
+	d_rank_t		*cl_gather;
+	uint32_t		 cl_gather_nr;
+	void			*cl_pack;
+	/* current step */
+	uint32_t		 cl_step;
+	uint32_t		 cl_nsteps;
+	struct crt_coll_plan	 cl_plan;
+	uint32_t		 cl_send_pending;
+	uint32_t		 cl_recv_nr;
+	bool			 cl_sent;
+	/* a thread is running crt_coll_progress_locked() on it */
+	bool			 cl_busy;
+	/* and has to check again before it leaves */
+	bool			 cl_again;
+	/* failed from outside its progress, see crt_coll_kick() */
+	bool			 cl_kick;
+	/* deadline of the current step, in crt_coll_info::ci_tw */
+	struct d_tw_node	 cl_tw_node;
+	bool			 cl_armed;
+	int			 cl_rc;
+	crt_coll_cb_t		 cl_complete_cb;
+	void			*cl_arg;
+};
+
+/* a received payload */
+struct crt_coll_msg {
+	d_list_t		 cm_link;	/* crt_coll_info::ci_msgs */
+	uint64_t		 cm_seq;
+	uint32_t		 cm_tag;
+	size_t			 cm_len;
+	char			 cm_data[];
+};
+
+int
+crt_coll_info_init(struct crt_grp_priv *grp_priv)
+{
+	struct crt_coll_info	*info = &grp_priv->gp_coll_info;
+	int			 rc;
+
+	rc = D_MUTEX_INIT(&info->ci_lock, NULL);
+	if (rc != 0)
+		return rc;
+
+	rc = d_timewheel_create_inplace(CRT_TIMEOUT_TICK_US,
+					d_timeus_secdiff(0), &info->ci_tw);
+	if (rc != 0) {
+		D_MUTEX_DESTROY(&info->ci_lock);
+		return rc;
+	}
+
+	D_INIT_LIST_HEAD(&info->ci_colls);
+	D_INIT_LIST_HEAD(&info->ci_msgs);
+	info->ci_seq = 0;
+
+	return 0;
+}
+
+static void crt_coll_fail_locked(struct crt_coll *coll, int rc);
+static void crt_coll_kick(struct crt_coll_info *info);
+
+void
+crt_coll_info_destroy(struct crt_grp_priv *grp_priv)
+{
+	struct crt_coll_info	*info = &grp_priv->gp_coll_info;
+	struct crt_coll_msg	*msg, *next;
+	struct crt_coll		*coll;
+
+	/* the contexts are gone, so no transfer is in flight anymore */
+	D_MUTEX_LOCK(&info->ci_lock);
+	d_list_for_each_entry(coll, &info->ci_colls, cl_link)
+		crt_coll_fail_locked(coll, -DER_CANCELED);
+	D_MUTEX_UNLOCK(&info->ci_lock);
+	crt_coll_kick(info);
+	if (!d_list_empty(&info->ci_colls))
+		D_ERROR("collectives with transfers in flight left.\n");
+
+	d_list_for_each_entry_safe(msg, next, &info->ci_msgs, cm_link) {
+		d_list_del(&msg->cm_link);
+		D_FREE(msg);
+	}
+	d_timewheel_destroy_inplace(&info->ci_tw);
+	D_MUTEX_DESTROY(&info->ci_lock);
+}
+
+static struct crt_coll *
+crt_coll_find_locked(struct crt_coll_info *info, uint64_t seq)
+{
+	struct crt_coll	*coll;
+
+	d_list_for_each_entry(coll, &info->ci_colls, cl_link) {
+		if (coll->cl_seq == seq)
+			return coll;
+	}
+
+	return NULL;
+}
+
+static struct crt_coll_msg *
+crt_coll_msg_find_locked(struct crt_coll_info *info, uint64_t seq,
+			 uint32_t tag)
+{
+	struct crt_coll_msg	*msg;
+
+	d_list_for_each_entry(msg, &info->ci_msgs, cm_link) {
+		if (msg->cm_seq == seq && msg->cm_tag == tag)
+			return msg;
+	}
+
+	return NULL;
+}
+
+/* byte offset of block @i of the working buffer, @i in [0, cl_size] */
+static size_t
+crt_coll_blk_off(struct crt_coll *coll, uint32_t i)
+{
+	size_t	q, m;
+
+	if (coll->cl_kind != CRT_COLL_ALLREDUCE)
+		return i * coll->cl_blk_size;
+
+	/* the first nr % size blocks have one element more */
+	q = coll->cl_nr / coll->cl_size;
+	m = coll->cl_nr % coll->cl_size;
+	return (i * q + min(i, m)) * coll->cl_esize;
+}
+
+/*
+ * Send the blocks [@send, @send + @send_nr) and receive the blocks
+ * [@recv, @recv + @recv_nr) of the working buffer.
+ */
+static void
+crt_coll_plan_blks(struct crt_coll *coll, uint32_t send, uint32_t send_nr,
+		   uint32_t recv, uint32_t recv_nr, enum crt_coll_recv_op op)
+{
+	struct crt_coll_plan	*plan = &coll->cl_plan;
+	size_t			 off;
+
+	off = crt_coll_blk_off(coll, send);
+	plan->pl_send_buf = coll->cl_buf + off;
+	plan->pl_send_len = crt_coll_blk_off(coll, send + send_nr) - off;
+	plan->pl_recv_off = crt_coll_blk_off(coll, recv);
+	plan->pl_recv_len = crt_coll_blk_off(coll, recv + recv_nr) -
+			    plan->pl_recv_off;
+	plan->pl_recv_op = op;
+}
+
+/* pack the blocks gathered so far for the parent, see crt_coll_unpack() */
+static int
+crt_coll_pack(struct crt_coll *coll)
+{
+	struct crt_coll_plan	*plan = &coll->cl_plan;
+	size_t			 blk = coll->cl_blk_size;
+	uint32_t		 n = coll->cl_gather_nr;
+	d_rank_t		*ranks;
+	char			*blks;
+	uint32_t		 i;
+
+	D_ALLOC(coll->cl_pack, n * (sizeof(d_rank_t) + blk));
+	if (coll->cl_pack == NULL)
+		return -DER_NOMEM;
+
+	ranks = coll->cl_pack;
+	blks = (char *)(ranks + n);
+	for (i = 0; i < n; i++) {
+		ranks[i] = coll->cl_gather[i];
+		memcpy(blks + i * blk, coll->cl_buf + ranks[i] * blk, blk);
+	}
+
+	plan->pl_send_buf = coll->cl_pack;
+	plan->pl_send_len = n * (sizeof(d_rank_t) + blk);
+	return 0;
+}
+
+static int
+crt_coll_unpack(struct crt_coll *coll, struct crt_coll_msg *msg)
+{
+	size_t		 blk = coll->cl_blk_size;
+	d_rank_t	*ranks;
+	char		*blks;
+	uint32_t	 n, i;
+
+	n = msg->cm_len / (sizeof(d_rank_t) + blk);
+	if (msg->cm_len % (sizeof(d_rank_t) + blk) != 0 ||
+	    n > coll->cl_size - coll->cl_gather_nr) {
+		D_ERROR("collective "DF_U64" step %u, bad gather payload "
+			"(%zu bytes).\n", coll->cl_seq, coll->cl_step,
+			msg->cm_len);
+		return -DER_PROTO;
+	}
+
+	ranks = (d_rank_t *)msg->cm_data;
+	blks = (char *)(ranks + n);
+	for (i = 0; i < n; i++) {
+		if (ranks[i] >= coll->cl_size) {
+			D_ERROR("collective "DF_U64" step %u, bad index %u.\n",
+				coll->cl_seq, coll->cl_step, ranks[i]);
+			return -DER_PROTO;
+		}
+		memcpy(coll->cl_buf + ranks[i] * blk, blks + i * blk, blk);
+		coll->cl_gather[coll->cl_gather_nr++] = ranks[i];
+	}
+
+	return 0;
+}
+
+static void
+crt_coll_plan_ring(struct crt_coll *coll)
+{
+	struct crt_coll_plan	*plan = &coll->cl_plan;
+	uint32_t		 p = coll->cl_size;
+	uint32_t		 r = coll->cl_self;
+	uint32_t		 k = coll->cl_step;
+
+	plan->pl_peer = (r + 1) % p;
+
+	/*
+	 * Reduce-scatter in p - 1 steps, rank r ends up with the block r
+	 * reduced, then allgather in p - 1 steps. Allreduce does both.
+	 */
+	if (coll->cl_kind == CRT_COLL_ALLGATHER) {
+		crt_coll_plan_blks(coll, (r + p - k) % p, 1,
+				   (r + 2 * p - k - 1) % p, 1, CRT_COLL_COPY);
+	} else if (k < p - 1) {
+		crt_coll_plan_blks(coll, (r + 2 * p - k - 1) % p, 1,
+				   (r + 2 * p - k - 2) % p, 1, CRT_COLL_REDUCE);
+	} else {
+		k -= p - 1;
+		crt_coll_plan_blks(coll, (r + p - k) % p, 1,
+				   (r + 2 * p - k - 1) % p, 1, CRT_COLL_COPY);
+	}
+}
+
+static void
+crt_coll_plan_rd(struct crt_coll *coll)
+{
+	struct crt_coll_plan	*plan = &coll->cl_plan;
+	uint32_t		 p = coll->cl_size;
+	uint32_t		 r = coll->cl_self;
+	uint32_t		 k = coll->cl_step;
+	uint32_t		 d, base;
+
+	if (coll->cl_kind == CRT_COLL_ALLREDUCE && !coll->cl_halving) {
+		/* exchange and reduce the whole array */
+		plan->pl_peer = r ^ (1U << k);
+		crt_coll_plan_blks(coll, 0, p, 0, p, CRT_COLL_REDUCE);
+		plan->pl_overlap = true;
+	} else if (coll->cl_kind == CRT_COLL_REDUCE_SCATTER ||
+		   (coll->cl_kind == CRT_COLL_ALLREDUCE && k < coll->cl_log)) {
+		/*
+		 * Recursive halving, keep the half of the current range of
+		 * blocks on the side of r and send the other half to the
+		 * partner. Rank r ends up with the block r reduced.
+		 */
+		d = p >> (k + 1);
+		base = r & ~(2 * d - 1);
+		plan->pl_peer = r ^ d;
+		if (r & d)
+			crt_coll_plan_blks(coll, base, d, base + d, d,
+					   CRT_COLL_REDUCE);
+		else
+			crt_coll_plan_blks(coll, base + d, d, base, d,
+					   CRT_COLL_REDUCE);
+	} else {
+		/* recursive doubling of the range of blocks of r */
+		if (coll->cl_kind == CRT_COLL_ALLREDUCE)
+			k -= coll->cl_log;
+		d = 1U << k;
+		plan->pl_peer = r ^ d;
+		crt_coll_plan_blks(coll, r & ~(d - 1), d,
+				   plan->pl_peer & ~(d - 1), d, CRT_COLL_COPY);
+	}
+}
+
+static int
+crt_coll_plan_tree(struct crt_coll *coll)
+{
+	struct crt_coll_plan	*plan = &coll->cl_plan;
+	uint32_t		 nchildren = 0;
+
+	if (coll->cl_children != NULL)
+		nchildren = coll->cl_children->rl_nr;
+
+	/* up the tree in steps 0 and 1, down in steps 2 and 3 */
+	crt_coll_plan_blks(coll, 0, coll->cl_size, 0, coll->cl_size,
+			   CRT_COLL_COPY);
+	switch (coll->cl_step) {
+	case 0:
+		plan->pl_send_nr = 0;
+		plan->pl_recv_nr = nchildren;
+		plan->pl_recv_op = coll->cl_kind == CRT_COLL_ALLGATHER ?
+				   CRT_COLL_GATHER : CRT_COLL_REDUCE;
+		break;
+	case 1:
+		plan->pl_send_nr = coll->cl_root ? 0 : 1;
+		plan->pl_peer = coll->cl_parent;
+		plan->pl_tag = 0;
+		plan->pl_recv_nr = 0;
+		if (plan->pl_send_nr != 0 &&
+		    coll->cl_kind == CRT_COLL_ALLGATHER)
+			return crt_coll_pack(coll);
+		break;
+	case 2:
+		plan->pl_send_nr = 0;
+		plan->pl_recv_nr = coll->cl_root ? 0 : 1;
+		break;
+	case 3:
+		plan->pl_send_nr = nchildren;
+		if (nchildren != 0)
+			plan->pl_send = coll->cl_children->rl_ranks;
+		plan->pl_tag = 2;
+		plan->pl_recv_nr = 0;
+		break;
+	}
+
+	return 0;
+}
+
+/* plan the current step of @coll */
+static int
+crt_coll_plan(struct crt_coll *coll)
+{
+	struct crt_coll_plan	*plan = &coll->cl_plan;
+
+	memset(plan, 0, sizeof(*plan));
+	plan->pl_send = &plan->pl_peer;
+	plan->pl_send_nr = 1;
+	plan->pl_recv_nr = 1;
+	plan->pl_tag = coll->cl_step;
+
+	switch (coll->cl_alg) {
+	case CRT_COLL_RING:
+		crt_coll_plan_ring(coll);
+		break;
+	case CRT_COLL_RD:
+		crt_coll_plan_rd(coll);
+		break;
+	default:
+		return crt_coll_plan_tree(coll);
+	}
+
+	return 0;
+}
+
+static int
+crt_coll_consume(struct crt_coll *coll, struct crt_coll_msg *msg)
+{
+	struct crt_coll_plan	*plan = &coll->cl_plan;
+	char			*dst;
+
+	if (plan->pl_recv_op == CRT_COLL_GATHER)
+		return crt_coll_unpack(coll, msg);
+
+	if (msg->cm_len != plan->pl_recv_len) {
+		D_ERROR("collective "DF_U64" step %u, got %zu bytes, expected "
+			"%zu.\n", coll->cl_seq, coll->cl_step, msg->cm_len,
+			plan->pl_recv_len);
+		return -DER_PROTO;
+	}
+
+	dst = coll->cl_buf + plan->pl_recv_off;
+	if (plan->pl_recv_op == CRT_COLL_COPY) {
+		memcpy(dst, msg->cm_data, msg->cm_len);
+		return 0;
+	}
+
+	return crt_reduce(coll->cl_op, coll->cl_type, dst, msg->cm_data,
+			  msg->cm_len / coll->cl_esize);
+}
+
+static void
+crt_coll_free(struct crt_coll *coll)
+{
+	if (coll->cl_buf != coll->cl_recvbuf)
+		D_FREE(coll->cl_buf);
+	d_rank_list_free(coll->cl_membs);
+	d_rank_list_free(coll->cl_children);
+	D_FREE(coll->cl_gather);
+	D_FREE(coll->cl_pack);
+	D_FREE_PTR(coll);
+}
+
+static void
+crt_coll_complete(struct crt_coll *coll)
+{
+	struct crt_coll_cb_info	 cb_info;
+
+	if (coll->cl_rc == 0 && coll->cl_kind == CRT_COLL_REDUCE_SCATTER)
+		memcpy(coll->cl_recvbuf,
+		       coll->cl_buf + crt_coll_blk_off(coll, coll->cl_self),
+		       coll->cl_blk_size);
+
+	D_DEBUG(DB_TRACE, "collective "DF_U64" complete, rc: %d.\n",
+		coll->cl_seq, coll->cl_rc);
+
+	cb_info.ccb_arg = coll->cl_arg;
+	cb_info.ccb_rc = coll->cl_rc;
+	coll->cl_complete_cb(&cb_info);
+
+	crt_coll_free(coll);
+}
+
+static void crt_coll_progress_locked(struct crt_coll *coll);
+
+/* (re)arm the deadline of the current step of @coll, ci_lock held */
+static void
+crt_coll_arm_locked(struct crt_coll *coll)
+{
+	struct crt_coll_info	*info = &coll->cl_grp->gp_coll_info;
+
+	if (coll->cl_armed)
+		d_timewheel_remove(&info->ci_tw, &coll->cl_tw_node);
+	d_timewheel_insert(&info->ci_tw, &coll->cl_tw_node,
+			   d_timeus_secdiff(crt_gdata.cg_timeout));
+	coll->cl_armed = true;
+}
+
+static void
+crt_coll_send_done(struct crt_coll *coll, int rc)
+{
+	struct crt_coll_info	*info = &coll->cl_grp->gp_coll_info;
+
+	D_MUTEX_LOCK(&info->ci_lock);
+	if (rc != 0 && coll->cl_rc == 0)
+		coll->cl_rc = rc;
+	D_ASSERT(coll->cl_send_pending > 0);
+	coll->cl_send_pending--;
+	crt_coll_progress_locked(coll);
+}
+
+static void
+crt_coll_send_cb(const struct crt_cb_info *cb_info)
+{
+	struct crt_coll_xfer_out	*out;
+	int				 rc = cb_info->cci_rc;
+
+	if (rc == 0) {
+		out = crt_reply_get(cb_info->cci_rpc);
+		rc = out->cx_rc;
+	}
+	if (rc != 0)
+		D_ERROR("collective transfer to rank %u failed, rc: %d.\n",
+			cb_info->cci_rpc->cr_ep.ep_rank, rc);
+
+	crt_coll_send_done(cb_info->cci_arg, rc);
+}
+
+static void
+crt_coll_send(struct crt_coll *coll, uint32_t idx)
+{
+	struct crt_coll_plan		*plan = &coll->cl_plan;
+	struct crt_coll_xfer_in		*in;
+	crt_context_t			 crt_ctx;
+	crt_endpoint_t			 tgt_ep = {0};
+	crt_rpc_t			*rpc_req;
+	int				 rc;
+
+	/* checked in crt_coll_start() */
+	crt_ctx = crt_context_lookup(0);
+	D_ASSERT(crt_ctx != CRT_CONTEXT_NULL);
+
+	tgt_ep.ep_grp = &coll->cl_grp->gp_pub;
+	tgt_ep.ep_rank = coll->cl_membs->rl_ranks[idx];
+	rc = crt_req_create(crt_ctx, &tgt_ep, CRT_OPC_COLL_XFER, &rpc_req);
+	if (rc != 0) {
+		D_ERROR("crt_req_create(CRT_OPC_COLL_XFER) failed, rc: %d.\n",
+			rc);
+		crt_coll_send_done(coll, rc);
+		return;
+	}
+
+	in = crt_req_get(rpc_req);
+	in->cx_seq = coll->cl_seq;
+	in->cx_tag = plan->pl_tag;
+	d_iov_set(&in->cx_data.ia_iov, plan->pl_send_buf, plan->pl_send_len);
+
+	/* the completion callback is called on failure too */
+	crt_req_send(rpc_req, crt_coll_send_cb, coll);
+}
+
+/*
+ * Run @coll as far as it can go. Called with ci_lock held, which it drops.
+ *
+ * Only one thread at a time runs it on a collective, the others flag it to
+ * check again for what they changed (a send completed or a payload arrived)
+ * and leave. That thread drops the lock to send and to consume payloads, and
+ * completes the collective once it is done with all its sends.
+ */
+static void
+crt_coll_progress_locked(struct crt_coll *coll)
+{
+	struct crt_coll_info	*info = &coll->cl_grp->gp_coll_info;
+	struct crt_coll_plan	*plan = &coll->cl_plan;
+	struct crt_coll_msg	*msg, *next;
+	uint32_t		 i;
+	int			 rc;
+
+	if (coll->cl_busy) {
+		coll->cl_again = true;
+		D_MUTEX_UNLOCK(&info->ci_lock);
+		return;
+	}
+	coll->cl_busy = true;
+
+	for (;;) {
+		coll->cl_again = false;
+
+		if (coll->cl_rc != 0 || coll->cl_step == coll->cl_nsteps) {
+			if (coll->cl_send_pending == 0)
+				break;
+		} else if (!coll->cl_sent) {
+			coll->cl_sent = true;
+			crt_coll_arm_locked(coll);
+			D_MUTEX_UNLOCK(&info->ci_lock);
+			rc = crt_coll_plan(coll);
+			D_MUTEX_LOCK(&info->ci_lock);
+			if (rc != 0) {
+				coll->cl_rc = rc;
+				continue;
+			}
+
+			coll->cl_send_pending = plan->pl_send_nr;
+			D_MUTEX_UNLOCK(&info->ci_lock);
+			for (i = 0; i < plan->pl_send_nr; i++)
+				crt_coll_send(coll, plan->pl_send[i]);
+			D_MUTEX_LOCK(&info->ci_lock);
+			continue;
+		} else if (coll->cl_recv_nr < plan->pl_recv_nr) {
+			/* don't overwrite what a target may still pull */
+			msg = NULL;
+			if (!plan->pl_overlap || coll->cl_send_pending == 0)
+				msg = crt_coll_msg_find_locked(info,
+							       coll->cl_seq,
+							       coll->cl_step);
+			if (msg != NULL) {
+				d_list_del(&msg->cm_link);
+				D_MUTEX_UNLOCK(&info->ci_lock);
+				rc = crt_coll_consume(coll, msg);
+				D_FREE(msg);
+				D_MUTEX_LOCK(&info->ci_lock);
+				coll->cl_recv_nr++;
+				if (rc != 0 && coll->cl_rc == 0)
+					coll->cl_rc = rc;
+				continue;
+			}
+		} else if (coll->cl_send_pending == 0) {
+			coll->cl_step++;
+			coll->cl_sent = false;
+			coll->cl_recv_nr = 0;
+			D_FREE(coll->cl_pack);
+			continue;
+		}
+
+		if (!coll->cl_again) {
+			coll->cl_busy = false;
+			D_MUTEX_UNLOCK(&info->ci_lock);
+			return;
+		}
+	}
+
+	if (coll->cl_armed)
+		d_timewheel_remove(&info->ci_tw, &coll->cl_tw_node);
+	coll->cl_armed = false;
+
+	/* drop the payloads left over by a failure */
+	d_list_del(&coll->cl_link);
+	d_list_for_each_entry_safe(msg, next, &info->ci_msgs, cm_link) {
+		if (msg->cm_seq != coll->cl_seq)
+			continue;
+		d_list_del(&msg->cm_link);
+		D_FREE(msg);
+	}
+	D_MUTEX_UNLOCK(&info->ci_lock);
+
+	crt_coll_complete(coll);
+}
+
+/* fail @coll from outside its progress, ci_lock held */
+static void
+crt_coll_fail_locked(struct crt_coll *coll, int rc)
+{
+	if (coll->cl_rc == 0)
+		coll->cl_rc = rc;
+	coll->cl_kick = true;
+}
+
+/* progress the collectives failed by crt_coll_fail_locked() to completion */
+static void
+crt_coll_kick(struct crt_coll_info *info)
+{
+	struct crt_coll	*coll;
+	bool		 found;
+
+	for (;;) {
+		found = false;
+		D_MUTEX_LOCK(&info->ci_lock);
+		d_list_for_each_entry(coll, &info->ci_colls, cl_link) {
+			if (coll->cl_kick) {
+				found = true;
+				break;
+			}
+		}
+		if (!found) {
+			D_MUTEX_UNLOCK(&info->ci_lock);
+			return;
+		}
+
+		/* completes it unless a send is still in flight */
+		coll->cl_kick = false;
+		crt_coll_progress_locked(coll);
+	}
+}
+
+/* fail the collectives whose current step passed its deadline */
+void
+crt_coll_timeout_check(struct crt_grp_priv *grp_priv)
+{
+	struct crt_coll_info	*info = &grp_priv->gp_coll_info;
+	struct crt_coll		*coll;
+	struct d_tw_node	*tw_node;
+	d_list_t		 expired_list;
+	uint64_t		 ts_now;
+
+	/* lockless checks, called on every progress of context 0 */
+	if (d_timewheel_size(&info->ci_tw) == 0)
+		return;
+	ts_now = d_timeus_secdiff(0);
+	if (!d_timewheel_pending(&info->ci_tw, ts_now))
+		return;
+
+	D_INIT_LIST_HEAD(&expired_list);
+	D_MUTEX_LOCK(&info->ci_lock);
+	d_timewheel_expire(&info->ci_tw, ts_now, &expired_list);
+	while ((tw_node = d_list_pop_entry(&expired_list, struct d_tw_node,
+					   tn_link))) {
+		coll = container_of(tw_node, struct crt_coll, cl_tw_node);
+		coll->cl_armed = false;
+		D_ERROR("collective "DF_U64" timed out in step %u.\n",
+			coll->cl_seq, coll->cl_step);
+		crt_coll_fail_locked(coll, -DER_TIMEDOUT);
+	}
+	D_MUTEX_UNLOCK(&info->ci_lock);
+
+	crt_coll_kick(info);
+}
+
+/* micro-seconds until the next step deadline, -1 if none */
+int64_t
+crt_coll_next_timeout(struct crt_grp_priv *grp_priv)
+{
+	struct crt_coll_info	*info = &grp_priv->gp_coll_info;
+	uint64_t		 next;
+	uint64_t		 now;
+
+	if (d_timewheel_size(&info->ci_tw) == 0)
+		return -1;
+
+	D_MUTEX_LOCK(&info->ci_lock);
+	next = d_timewheel_next(&info->ci_tw);
+	D_MUTEX_UNLOCK(&info->ci_lock);
+	if (next == UINT64_MAX)
+		return -1;
+
+	now = d_timeus_secdiff(0);
+	return next > now ? next - now : 0;
+}
+
+/* fail the collectives @rank is a member of, it may never send its payloads */
+void
+crt_coll_handle_eviction(struct crt_grp_priv *grp_priv, d_rank_t rank)
+{
+	struct crt_coll_info	*info = &grp_priv->gp_coll_info;
+	struct crt_coll		*coll;
+
+	D_MUTEX_LOCK(&info->ci_lock);
+	d_list_for_each_entry(coll, &info->ci_colls, cl_link) {
+		if (!d_rank_list_find(coll->cl_membs, rank, NULL))
+			continue;
+		D_ERROR("collective "DF_U64" failed, rank %u evicted.\n",
+			coll->cl_seq, rank);
+		crt_coll_fail_locked(coll, -DER_EVICTED);
+	}
+	D_MUTEX_UNLOCK(&info->ci_lock);
+
+	crt_coll_kick(info);
+}
+
+void
+crt_hdlr_coll_xfer(crt_rpc_t *rpc_req)
+{
+	struct crt_coll_xfer_in		*in;
+	struct crt_coll_xfer_out	*out;
+	struct crt_coll_info		*info;
+	struct crt_grp_priv		*grp_priv;
+	struct crt_coll_msg		*msg = NULL;
+	struct crt_coll			*coll = NULL;
+	d_iov_t				*data;
+	int				 rc = 0;
+
+	in = crt_req_get(rpc_req);
+	out = crt_reply_get(rpc_req);
+	D_ASSERT(in != NULL && out != NULL);
+
+	grp_priv = crt_grp_pub2priv(rpc_req->cr_ep.ep_grp);
+	if (grp_priv == NULL) {
+		D_ERROR("crt_hdlr_coll_xfer failed, no group\n");
+		D_GOTO(send_reply, rc = -DER_NONEXIST);
+	}
+	info = &grp_priv->gp_coll_info;
+
+	data = &in->cx_data.ia_iov;
+	D_ALLOC(msg, sizeof(*msg) + data->iov_len);
+	if (msg == NULL)
+		D_GOTO(send_reply, rc = -DER_NOMEM);
+	msg->cm_seq = in->cx_seq;
+	msg->cm_tag = in->cx_tag;
+	msg->cm_len = data->iov_len;
+	if (data->iov_len > 0)
+		memcpy(msg->cm_data, data->iov_buf, data->iov_len);
+
+	D_MUTEX_LOCK(&info->ci_lock);
+	if (in->cx_seq < info->ci_seq) {
+		coll = crt_coll_find_locked(info, in->cx_seq);
+		if (coll == NULL) {
+			/* the local collective already failed */
+			D_MUTEX_UNLOCK(&info->ci_lock);
+			D_DEBUG(DB_TRACE, "dropping payload of collective "
+				DF_U64" step %u.\n", in->cx_seq, in->cx_tag);
+			D_FREE(msg);
+			D_GOTO(send_reply, rc = 0);
+		}
+	}
+	d_list_add_tail(&msg->cm_link, &info->ci_msgs);
+	if (coll != NULL)
+		crt_coll_progress_locked(coll);
+	else
+		D_MUTEX_UNLOCK(&info->ci_lock);
+
+send_reply:
+	out->cx_rc = rc;
+	rc = crt_reply_send(rpc_req);
+	if (rc != 0)
+		D_ERROR("crt_reply_send failed, rc: %d, opc: %#x.\n",
+			rc, rpc_req->cr_opc);
+}
+
+static inline bool
+crt_coll_pow2(uint32_t n)
+{
+	return (n & (n - 1)) == 0;
+}
+
+/* allocate a collective of @kind on @grp, checking the common arguments */
+static int
+crt_coll_create(crt_group_t *grp, enum crt_coll_kind kind,
+		enum crt_coll_alg alg, crt_coll_cb_t complete_cb, void *cb_arg,
+		struct crt_coll **collp)
+{
+	struct crt_grp_priv	*grp_priv;
+	struct crt_coll		*coll;
+	d_rank_list_t		*membs = NULL;
+	int			 idx;
+	int			 rc;
+
+	if (!crt_initialized()) {
+		D_ERROR("CRT not initialized.\n");
+		return -DER_UNINIT;
+	}
+
+	if (!crt_is_service()) {
+		D_ERROR("Collectives not supported in client group\n");
+		return -DER_NO_PERM;
+	}
+
+	if (crt_context_lookup(0) == CRT_CONTEXT_NULL) {
+		D_ERROR("No context available for collectives\n");
+		return -DER_UNINIT;
+	}
+
+	if (complete_cb == NULL || (int)alg < CRT_COLL_AUTO ||
+	    alg > CRT_COLL_RING) {
+		D_ERROR("Invalid argument(s)\n");
+		return -DER_INVAL;
+	}
+
+	if (grp == NULL)
+		grp = crt_group_lookup(NULL);
+
+	if (grp == NULL) {
+		D_ERROR("Could not find primary group\n");
+		return -DER_UNINIT;
+	}
+
+	grp_priv = container_of(grp, struct crt_grp_priv, gp_pub);
+
+	if (grp_priv->gp_primary != 1) {
+		D_ERROR("Collectives not supported on secondary groups.\n");
+		return -DER_OOG;
+	}
+
+	if (grp_priv->gp_local == 0) {
+		D_ERROR("Collectives not supported on remote group.\n");
+		return -DER_OOG;
+	}
+
+	/* the same list the tree topologies are built from */
+	D_RWLOCK_RDLOCK(grp_priv->gp_rwlock_ft);
+	rc = d_rank_list_dup_sort_uniq(&membs,
+				       grp_priv_get_live_ranks(grp_priv));
+	D_RWLOCK_UNLOCK(grp_priv->gp_rwlock_ft);
+	if (rc != 0)
+		return rc;
+
+	if (membs == NULL ||
+	    !d_rank_list_find(membs, grp_priv->gp_self, &idx)) {
+		D_ERROR("Rank %u is not a live member of the group.\n",
+			grp_priv->gp_self);
+		D_GOTO(out, rc = -DER_OOG);
+	}
+
+	if (alg == CRT_COLL_RD && !crt_coll_pow2(membs->rl_nr)) {
+		D_ERROR("Recursive doubling needs a power of two group size, "
+			"not %u.\n", membs->rl_nr);
+		D_GOTO(out, rc = -DER_INVAL);
+	}
+
+	D_ALLOC_PTR(coll);
+	if (coll == NULL)
+		D_GOTO(out, rc = -DER_NOMEM);
+
+	coll->cl_grp = grp_priv;
+	coll->cl_kind = kind;
+	coll->cl_alg = alg;
+	coll->cl_membs = membs;
+	coll->cl_self = idx;
+	coll->cl_size = membs->rl_nr;
+	while ((1U << coll->cl_log) < coll->cl_size)
+		coll->cl_log++;
+	coll->cl_complete_cb = complete_cb;
+	coll->cl_arg = cb_arg;
+
+	*collp = coll;
+out:
+	if (rc != 0)
+		d_rank_list_free(membs);
+	return rc;
+}
+
+/* pick the algorithm for CRT_COLL_AUTO and the number of steps */
+static void
+crt_coll_setup(struct crt_coll *coll)
+{
+	size_t	bytes = crt_coll_blk_off(coll, coll->cl_size);
+	bool	pow2 = crt_coll_pow2(coll->cl_size);
+
+	if (coll->cl_alg == CRT_COLL_AUTO) {
+		if (pow2)
+			coll->cl_alg = CRT_COLL_RD;
+		else if (bytes <= CRT_COLL_SMALL)
+			coll->cl_alg = CRT_COLL_TREE;
+		else
+			coll->cl_alg = CRT_COLL_RING;
+	}
+
+	switch (coll->cl_alg) {
+	case CRT_COLL_RING:
+		coll->cl_nsteps = coll->cl_size - 1;
+		if (coll->cl_kind == CRT_COLL_ALLREDUCE)
+			coll->cl_nsteps *= 2;
+		break;
+	case CRT_COLL_RD:
+		coll->cl_nsteps = coll->cl_log;
+		/* halve large arrays rather than exchanging them whole */
+		if (coll->cl_kind == CRT_COLL_ALLREDUCE &&
+		    bytes > CRT_COLL_SMALL && coll->cl_nr >= coll->cl_size) {
+			coll->cl_halving = true;
+			coll->cl_nsteps *= 2;
+		}
+		break;
+	default:
+		coll->cl_nsteps = 4;
+		break;
+	}
+}
+
+/* index of group rank @rank in cl_membs */
+static int
+crt_coll_rank2idx(struct crt_coll *coll, d_rank_t rank, uint32_t *idx)
+{
+	int	i;
+
+	if (!d_rank_list_find(coll->cl_membs, rank, &i)) {
+		D_ERROR("rank %u not in the members of collective "DF_U64".\n",
+			rank, coll->cl_seq);
+		return -DER_OOG;
+	}
+
+	*idx = i;
+	return 0;
+}
+
+/*
+ * Look up the place of the caller in the tree rooted at the lowest live rank,
+ * and turn its parent and children ranks to indexes.
+ */
+static int
+crt_coll_tree_init(struct crt_coll *coll)
+{
+	struct crt_grp_priv	*grp_priv = coll->cl_grp;
+	d_rank_t		 root = coll->cl_membs->rl_ranks[0];
+	d_rank_t		 self = coll->cl_membs->rl_ranks[coll->cl_self];
+	d_rank_t		 parent;
+	uint32_t		 i;
+	int			 topo;
+	int			 rc;
+
+	topo = crt_tree_topo(CRT_TREE_KNOMIAL, 4);
+	rc = crt_tree_get_children(grp_priv, grp_priv->gp_membs_ver, NULL,
+				   topo, root, self, &coll->cl_children, NULL);
+	if (rc != 0) {
+		D_ERROR("crt_tree_get_children failed, rc: %d.\n", rc);
+		return rc;
+	}
+
+	for (i = 0; coll->cl_children != NULL &&
+		    i < coll->cl_children->rl_nr; i++) {
+		rc = crt_coll_rank2idx(coll, coll->cl_children->rl_ranks[i],
+				       &coll->cl_children->rl_ranks[i]);
+		if (rc != 0)
+			return rc;
+	}
+
+	coll->cl_root = self == root;
+	if (coll->cl_root)
+		return 0;
+
+	rc = crt_tree_get_parent(grp_priv, grp_priv->gp_membs_ver, NULL, topo,
+				 root, self, &parent);
+	if (rc != 0) {
+		D_ERROR("crt_tree_get_parent failed, rc: %d.\n", rc);
+		return rc;
+	}
+
+	return crt_coll_rank2idx(coll, parent, &coll->cl_parent);
+}
+
+static int
+crt_coll_start(struct crt_coll *coll)
+{
+	struct crt_coll_info	*info = &coll->cl_grp->gp_coll_info;
+	int			 rc = 0;
+
+	crt_coll_setup(coll);
+
+	if (coll->cl_alg == CRT_COLL_TREE) {
+		rc = crt_coll_tree_init(coll);
+		if (rc != 0)
+			D_GOTO(out, rc);
+	}
+
+	if (coll->cl_alg == CRT_COLL_TREE &&
+	    coll->cl_kind == CRT_COLL_ALLGATHER) {
+		D_ALLOC_ARRAY(coll->cl_gather, coll->cl_size);
+		if (coll->cl_gather == NULL)
+			D_GOTO(out, rc = -DER_NOMEM);
+		coll->cl_gather[coll->cl_gather_nr++] = coll->cl_self;
+	}
+
+	D_MUTEX_LOCK(&info->ci_lock);
+	coll->cl_seq = info->ci_seq++;
+	d_list_add_tail(&coll->cl_link, &info->ci_colls);
+	D_DEBUG(DB_TRACE, "collective "DF_U64" kind %d alg %d, %u steps.\n",
+		coll->cl_seq, coll->cl_kind, coll->cl_alg, coll->cl_nsteps);
+	crt_coll_progress_locked(coll);
+
+out:
+	if (rc != 0)
+		crt_coll_free(coll);
+	return rc;
+}
+
+int
+crt_allgather(crt_group_t *grp, enum crt_coll_alg alg, const void *sendbuf,
+	      void *recvbuf, size_t size, crt_coll_cb_t complete_cb,
+	      void *cb_arg)
+{
+	struct crt_coll	*coll;
+	int		 rc;
+
+	if (sendbuf == NULL || recvbuf == NULL || size == 0) {
+		D_ERROR("Invalid argument(s)\n");
+		return -DER_INVAL;
+	}
+
+	rc = crt_coll_create(grp, CRT_COLL_ALLGATHER, alg, complete_cb,
+			     cb_arg, &coll);
+	if (rc != 0)
+		return rc;
+
+	coll->cl_esize = 1;
+	coll->cl_nr = size * coll->cl_size;
+	coll->cl_blk_size = size;
+	coll->cl_buf = recvbuf;
+	coll->cl_recvbuf = recvbuf;
+	memmove(coll->cl_buf + coll->cl_self * size, sendbuf, size);
+
+	return crt_coll_start(coll);
+}
+
+int
+crt_allreduce(crt_group_t *grp, enum crt_coll_alg alg, enum crt_reduce_op op,
+	      enum crt_reduce_type type, const void *sendbuf, void *recvbuf,
+	      size_t nr, crt_coll_cb_t complete_cb, void *cb_arg)
+{
+	struct crt_coll	*coll;
+	size_t		 esize;
+	int		 rc;
+
+	esize = crt_reduce_size(op, type);
+	if (sendbuf == NULL || recvbuf == NULL || nr == 0 || esize == 0) {
+		D_ERROR("Invalid argument(s)\n");
+		return -DER_INVAL;
+	}
+
+	rc = crt_coll_create(grp, CRT_COLL_ALLREDUCE, alg, complete_cb,
+			     cb_arg, &coll);
+	if (rc != 0)
+		return rc;
+
+	coll->cl_op = op;
+	coll->cl_type = type;
+	coll->cl_esize = esize;
+	coll->cl_nr = nr;
+	coll->cl_buf = recvbuf;
+	coll->cl_recvbuf = recvbuf;
+	if (recvbuf != sendbuf)
+		memcpy(recvbuf, sendbuf, nr * esize);
+
+	return crt_coll_start(coll);
+}
+
+int
+crt_reduce_scatter(crt_group_t *grp, enum crt_coll_alg alg,
+		   enum crt_reduce_op op, enum crt_reduce_type type,
+		   const void *sendbuf, void *recvbuf, size_t nr,
+		   crt_coll_cb_t complete_cb, void *cb_arg)
+{
+	struct crt_coll	*coll;
+	size_t		 esize;
+	int		 rc;
+
+	esize = crt_reduce_size(op, type);
+	if (sendbuf == NULL || recvbuf == NULL || nr == 0 || esize == 0) {
+		D_ERROR("Invalid argument(s)\n");
+		return -DER_INVAL;
+	}
+
+	rc = crt_coll_create(grp, CRT_COLL_REDUCE_SCATTER, alg, complete_cb,
+			     cb_arg, &coll);
+	if (rc != 0)
+		return rc;
+
+	coll->cl_op = op;
+	coll->cl_type = type;
+	coll->cl_esize = esize;
+	coll->cl_nr = nr * coll->cl_size;
+	coll->cl_blk_size = nr * esize;
+	coll->cl_recvbuf = recvbuf;
+	D_ALLOC(coll->cl_buf, coll->cl_nr * esize);
+	if (coll->cl_buf == NULL) {
+		crt_coll_free(coll);
+		return -DER_NOMEM;
+	}
+	memcpy(coll->cl_buf, sendbuf, coll->cl_nr * esize);
+
+	return crt_coll_start(coll);
+}
@@ -0,0 +1,61 @@
+/* Copyright (C) 2018 Intel Corporation
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted for any purpose (including commercial purposes)
+ * provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions, and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions, and the following disclaimer in the
+ *    documentation and/or materials provided with the distribution.
+ *
+ * 3. In addition, redistributions of modified forms of the source or binary
+ *    code must carry prominent notices stating that the original code was
+ *    changed and the date of the change.
+ *
+ *  4. All publications or advertising materials mentioning features or use of
+ *     this software are asked, but not required, to acknowledge that it was
+ *     developed by Intel Corporation and credit the contributors.
+ *
+ * 5. Neither the name of Intel Corporation, nor the name of any Contributor
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+/**
+ * This file is part of CaRT. It is the internal interface of the data
+ * movement collectives.
+ */
+
+#ifndef __CRT_COLL_H__
+#define __CRT_COLL_H__
+
+struct crt_coll_info {
+	pthread_mutex_t		 ci_lock;  /* lock for the lists and colls */
+	d_list_t		 ci_colls; /* in-flight collectives */
+	d_list_t		 ci_msgs;  /* payloads not consumed yet */
+	uint64_t		 ci_seq;   /* sequence number of the next one */
+	struct d_timewheel	 ci_tw;	   /* step deadlines of ci_colls */
+};
+
+int crt_coll_info_init(struct crt_grp_priv *grp_priv);
+void crt_coll_info_destroy(struct crt_grp_priv *grp_priv);
+void crt_coll_timeout_check(struct crt_grp_priv *grp_priv);
+int64_t crt_coll_next_timeout(struct crt_grp_priv *grp_priv);
+void crt_coll_handle_eviction(struct crt_grp_priv *grp_priv, d_rank_t rank);
+void crt_hdlr_coll_xfer(crt_rpc_t *rpc_req);
+
+#endif /* __CRT_COLL_H__ */
@@ -40,6 +40,9 @@
  */
 #define D_LOGFAC	DD_FAC(rpc)
 
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+
 #include "crt_internal.h"
 
 static void crt_epi_destroy(struct crt_ep_inflight *epi);
@@ -127,12 +130,137 @@ crt_epi_destroy(struct crt_ep_inflight *epi)
 	D_ASSERT(d_list_empty(&epi->epi_req_q));
 	D_ASSERT(epi->epi_req_num >= epi->epi_reply_num);
 
+	if (crt_gdata.cg_credit_ep_ctx != 0)
+		D_DEBUG(DB_TRACE, "ep rank %d, credits %u (+"DF_U64"/-"DF_U64
+			"), max inflight "DF_U64", max waitq depth "DF_U64
+			".\n", epi->epi_ep.ep_rank, epi->epi_credits,
+			epi->epi_credit_inc_num, epi->epi_credit_dec_num,
+			(uint64_t)epi->epi_inflight_hwm,
+			(uint64_t)epi->epi_req_wait_hwm);
+
 	/* crt_list_del_init(&epi->epi_link); */
 	D_MUTEX_DESTROY(&epi->epi_mutex);
 
 	D_FREE_PTR(epi);
 }
 
+static struct crt_ep_lookup *
+el_link2ptr(d_list_t *rlink)
+{
+	D_ASSERT(rlink != NULL);
+	return container_of(rlink, struct crt_ep_lookup, el_link);
+}
+
+static int
+el_op_key_get(struct d_hash_table *hhtab, d_list_t *rlink, void **key_pp)
+{
+	struct crt_ep_lookup *el = el_link2ptr(rlink);
+
+	*key_pp = (void *)&el->el_key;
+	return sizeof(el->el_key);
+}
+
+static uint32_t
+el_op_key_hash(struct d_hash_table *hhtab, const void *key,
+	       unsigned int ksize)
+{
+	const struct crt_ep_lookup_key *elk = key;
+
+	D_ASSERT(ksize == sizeof(*elk));
+
+	return (elk->elk_rank * CRT_SRV_CONTEXT_NUM + elk->elk_tag) %
+	       (1U << CRT_LOOKUP_TABLE_BITS);
+}
+
+static bool
+el_op_key_cmp(struct d_hash_table *hhtab, d_list_t *rlink,
+	      const void *key, unsigned int ksize)
+{
+	struct crt_ep_lookup		*el = el_link2ptr(rlink);
+	const struct crt_ep_lookup_key	*elk = key;
+
+	D_ASSERT(ksize == sizeof(*elk));
+
+	return el->el_key.elk_grp_priv == elk->elk_grp_priv &&
+	       el->el_key.elk_rank == elk->elk_rank &&
+	       el->el_key.elk_tag == elk->elk_tag;
+}
+
+/* records are freed by their users, the table holds no reference */
+static d_hash_table_ops_t el_table_ops = {
+	.hop_key_get		= el_op_key_get,
+	.hop_key_hash		= el_op_key_hash,
+	.hop_key_cmp		= el_op_key_cmp,
+};
+
+static int
+crt_context_lookup_init(struct crt_context *ctx)
+{
+	int	rc;
+
+	rc = D_MUTEX_INIT(&ctx->cc_lookup_mutex, NULL);
+	if (rc != 0)
+		return rc;
+
+	rc = d_hash_table_create_inplace(D_HASH_FT_NOLOCK |
+					 D_HASH_FT_EPHEMERAL,
+					 CRT_LOOKUP_TABLE_BITS, NULL,
+					 &el_table_ops, &ctx->cc_lookup_table);
+	if (rc != 0) {
+		D_ERROR("d_hash_table_create_inplace failed, rc: %d.\n", rc);
+		D_MUTEX_DESTROY(&ctx->cc_lookup_mutex);
+	}
+
+	return rc;
+}
+
+static void
+crt_context_lookup_fini(struct crt_context *ctx)
+{
+	struct crt_ep_lookup	*el;
+	struct crt_rpc_priv	*waiter;
+	struct crt_rpc_priv	*waiter_next;
+	d_list_t		*rlink;
+	d_list_t		 waitq;
+
+	D_INIT_LIST_HEAD(&waitq);
+
+	D_MUTEX_LOCK(&ctx->cc_lookup_mutex);
+	while ((rlink = d_hash_rec_first(&ctx->cc_lookup_table)) != NULL) {
+		el = el_link2ptr(rlink);
+		/*
+		 * the RPCs are aborted with their endpoints, these are only
+		 * left if that failed, detach them from the freed record and
+		 * fail the waiters below
+		 */
+		if (el->el_leader != NULL || !d_list_empty(&el->el_waitq))
+			D_ERROR("address lookup of rank %d tag %d still in "
+				"flight.\n", el->el_key.elk_rank,
+				el->el_key.elk_tag);
+		if (el->el_leader != NULL) {
+			el->el_leader->crp_lookup = NULL;
+			el->el_leader->crp_lookup_leader = 0;
+		}
+		d_list_for_each_entry(waiter, &el->el_waitq, crp_lookup_link)
+			waiter->crp_lookup = NULL;
+		d_list_splice_init(&el->el_waitq, &waitq);
+		d_hash_rec_delete_at(&ctx->cc_lookup_table, rlink);
+		crt_grp_priv_decref(el->el_key.elk_grp_priv);
+		D_FREE_PTR(el);
+	}
+	d_hash_table_destroy_inplace(&ctx->cc_lookup_table, true /* force */);
+	D_MUTEX_UNLOCK(&ctx->cc_lookup_mutex);
+	D_MUTEX_DESTROY(&ctx->cc_lookup_mutex);
+
+	/* their endpoints are gone already, nothing to untrack */
+	d_list_for_each_entry_safe(waiter, waiter_next, &waitq,
+				   crp_lookup_link) {
+		d_list_del_init(&waiter->crp_lookup_link);
+		crt_rpc_complete(waiter, -DER_CANCELED);
+		RPC_DECREF(waiter);
+	}
+}
+
 static int
 crt_ep_empty(d_list_t *rlink, void *arg)
 {
@@ -164,11 +292,12 @@ static int
 crt_context_init(crt_context_t crt_ctx)
 {
 	struct crt_context	*ctx;
-	uint32_t		 bh_node_cnt;
 	int			 rc;
 
 	D_ASSERT(crt_ctx != NULL);
 	ctx = crt_ctx;
+	ctx->cc_wait_fd = -1;
+	ctx->cc_event_fd = -1;
 
 	rc = D_MUTEX_INIT(&ctx->cc_mutex, NULL);
 	if (rc != 0)
@@ -176,13 +305,19 @@ crt_context_init(crt_context_t crt_ctx)
 
 	D_INIT_LIST_HEAD(&ctx->cc_link);
 
-	/* create timeout binheap */
-	bh_node_cnt = CRT_DEFAULT_CREDITS_PER_EP_CTX * 64;
-	rc = d_binheap_create_inplace(DBH_FT_NOLOCK, bh_node_cnt,
-				      NULL /* priv */, &crt_timeout_bh_ops,
-				      &ctx->cc_bh_timeout);
+	rc = D_SPIN_INIT(&ctx->cc_tw_lock, PTHREAD_PROCESS_PRIVATE);
 	if (rc != 0) {
-		D_ERROR("d_binheap_create_inplace failed, rc: %d.\n", rc);
+		D_MUTEX_DESTROY(&ctx->cc_mutex);
+		D_GOTO(out, rc);
+	}
+
+	/* create timeout timing wheel */
+	rc = d_timewheel_create_inplace(CRT_TIMEOUT_TICK_US,
+					d_timeus_secdiff(0),
+					&ctx->cc_tw_timeout);
+	if (rc != 0) {
+		D_ERROR("d_timewheel_create_inplace failed, rc: %d.\n", rc);
+		D_SPIN_DESTROY(&ctx->cc_tw_lock);
 		D_MUTEX_DESTROY(&ctx->cc_mutex);
 		D_GOTO(out, rc);
 	}
@@ -193,7 +328,56 @@ crt_context_init(crt_context_t crt_ctx)
 					  &ctx->cc_epi_table);
 	if (rc != 0) {
 		D_ERROR("d_hash_table_create_inplace failed, rc: %d.\n", rc);
-		d_binheap_destroy_inplace(&ctx->cc_bh_timeout);
+		d_timewheel_destroy_inplace(&ctx->cc_tw_timeout);
+		D_SPIN_DESTROY(&ctx->cc_tw_lock);
+		D_MUTEX_DESTROY(&ctx->cc_mutex);
+		D_GOTO(out, rc);
+	}
+
+	rc = d_rank_map_init(&ctx->cc_epi_map, CRT_EPI_MAP_MAX);
+	if (rc != 0) {
+		D_ERROR("d_rank_map_init failed, rc: %d.\n", rc);
+		d_hash_table_destroy_inplace(&ctx->cc_epi_table,
+					     true /* force */);
+		d_timewheel_destroy_inplace(&ctx->cc_tw_timeout);
+		D_SPIN_DESTROY(&ctx->cc_tw_lock);
+		D_MUTEX_DESTROY(&ctx->cc_mutex);
+		D_GOTO(out, rc);
+	}
+
+	rc = crt_rpc_cache_init(&ctx->cc_rpc_cache, crt_gdata.cg_rpc_cache_max);
+	if (rc != 0) {
+		D_ERROR("crt_rpc_cache_init failed, rc: %d.\n", rc);
+		d_rank_map_fini(&ctx->cc_epi_map);
+		d_hash_table_destroy_inplace(&ctx->cc_epi_table,
+					     true /* force */);
+		d_timewheel_destroy_inplace(&ctx->cc_tw_timeout);
+		D_SPIN_DESTROY(&ctx->cc_tw_lock);
+		D_MUTEX_DESTROY(&ctx->cc_mutex);
+		D_GOTO(out, rc);
+	}
+
+	rc = crt_context_lookup_init(ctx);
+	if (rc != 0) {
+		crt_rpc_cache_fini(ctx->cc_rpc_cache);
+		d_rank_map_fini(&ctx->cc_epi_map);
+		d_hash_table_destroy_inplace(&ctx->cc_epi_table,
+					     true /* force */);
+		d_timewheel_destroy_inplace(&ctx->cc_tw_timeout);
+		D_SPIN_DESTROY(&ctx->cc_tw_lock);
+		D_MUTEX_DESTROY(&ctx->cc_mutex);
+		D_GOTO(out, rc);
+	}
+
+	rc = crt_corpc_pipe_table_init(ctx);
+	if (rc != 0) {
+		crt_context_lookup_fini(ctx);
+		crt_rpc_cache_fini(ctx->cc_rpc_cache);
+		d_rank_map_fini(&ctx->cc_epi_map);
+		d_hash_table_destroy_inplace(&ctx->cc_epi_table,
+					     true /* force */);
+		d_timewheel_destroy_inplace(&ctx->cc_tw_timeout);
+		D_SPIN_DESTROY(&ctx->cc_tw_lock);
 		D_MUTEX_DESTROY(&ctx->cc_mutex);
 		D_GOTO(out, rc);
 	}
@@ -203,6 +387,210 @@ out:
 	return rc;
 }
 
+static void
+crt_context_wait_fini(struct crt_context *ctx)
+{
+	if (ctx->cc_event_fd >= 0) {
+		close(ctx->cc_event_fd);
+		ctx->cc_event_fd = -1;
+	}
+	if (ctx->cc_wait_fd >= 0) {
+		close(ctx->cc_wait_fd);
+		ctx->cc_wait_fd = -1;
+	}
+}
+
+/* set up cc_wait_fd, the context can only be polled if it fails */
+static void
+crt_context_wait_init(struct crt_context *ctx)
+{
+	struct epoll_event	ev = {0};
+	int			hg_fd;
+
+	hg_fd = crt_hg_get_wait_fd(&ctx->cc_hg_ctx);
+	if (hg_fd < 0) {
+		D_DEBUG(DB_TRACE, "context %d, transport has no wait fd.\n",
+			ctx->cc_idx);
+		return;
+	}
+
+	ctx->cc_wait_fd = epoll_create1(EPOLL_CLOEXEC);
+	if (ctx->cc_wait_fd < 0) {
+		D_ERROR("epoll_create1 failed, errno: %d.\n", errno);
+		D_GOTO(err, 0);
+	}
+	ctx->cc_event_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	if (ctx->cc_event_fd < 0) {
+		D_ERROR("eventfd failed, errno: %d.\n", errno);
+		D_GOTO(err, 0);
+	}
+
+	ev.events = EPOLLIN;
+	ev.data.fd = hg_fd;
+	if (epoll_ctl(ctx->cc_wait_fd, EPOLL_CTL_ADD, hg_fd, &ev) != 0) {
+		D_ERROR("epoll_ctl failed, errno: %d.\n", errno);
+		D_GOTO(err, 0);
+	}
+	ev.data.fd = ctx->cc_event_fd;
+	if (epoll_ctl(ctx->cc_wait_fd, EPOLL_CTL_ADD, ctx->cc_event_fd,
+		      &ev) != 0) {
+		D_ERROR("epoll_ctl failed, errno: %d.\n", errno);
+		D_GOTO(err, 0);
+	}
+	return;
+
+err:
+	crt_context_wait_fini(ctx);
+}
+
+/* wake up the thread sleeping on cc_wait_fd, if any */
+void
+crt_context_signal(struct crt_context *ctx)
+{
+	uint64_t	val = 1;
+
+	if (ctx->cc_event_fd < 0)
+		return;
+
+	/* one unread write keeps cc_wait_fd readable */
+	if (__atomic_exchange_n(&ctx->cc_event_pending, 1, __ATOMIC_ACQ_REL))
+		return;
+
+	if (write(ctx->cc_event_fd, &val, sizeof(val)) != sizeof(val))
+		D_ERROR("write to eventfd failed, errno: %d.\n", errno);
+}
+
+/*
+ * Called on every progress before doing the work a signal asks for. A signal
+ * racing with the read is either consumed by it and served by this progress,
+ * or writes again once cc_event_pending is cleared.
+ */
+static inline void
+crt_context_signal_clear(struct crt_context *ctx)
+{
+	uint64_t	val;
+
+	if (!__atomic_load_n(&ctx->cc_event_pending, __ATOMIC_ACQUIRE))
+		return;
+
+	if (read(ctx->cc_event_fd, &val, sizeof(val)) < 0 && errno != EAGAIN)
+		D_ERROR("read from eventfd failed, errno: %d.\n", errno);
+	__atomic_store_n(&ctx->cc_event_pending, 0, __ATOMIC_RELEASE);
+}
+
+/*
+ * The collectives send on context 0, which also checks their step deadlines.
+ * Returns the primary service group they run on, NULL if none.
+ */
+static struct crt_grp_priv *
+crt_context_coll_grp(struct crt_context *ctx)
+{
+	if (ctx->cc_idx != 0 || !crt_is_service())
+		return NULL;
+
+	return crt_grp_pub2priv(NULL);
+}
+
+/*
+ * micro-seconds until the next RPC timeout of the context, or the next
+ * collective step deadline, -1 if none
+ */
+static int64_t
+crt_context_next_timeout(struct crt_context *ctx)
+{
+	struct crt_grp_priv	*grp_priv;
+	uint64_t		 next;
+	uint64_t		 now;
+	int64_t			 timeout = -1;
+	int64_t			 coll_timeout;
+
+	D_SPIN_LOCK(&ctx->cc_tw_lock);
+	next = d_timewheel_next(&ctx->cc_tw_timeout);
+	D_SPIN_UNLOCK(&ctx->cc_tw_lock);
+	if (next != UINT64_MAX) {
+		now = d_timeus_secdiff(0);
+		timeout = next > now ? next - now : 0;
+	}
+
+	grp_priv = crt_context_coll_grp(ctx);
+	if (grp_priv == NULL)
+		return timeout;
+	coll_timeout = crt_coll_next_timeout(grp_priv);
+	if (timeout < 0 || (coll_timeout >= 0 && coll_timeout < timeout))
+		timeout = coll_timeout;
+
+	return timeout;
+}
+
+/*
+ * Sleep on cc_wait_fd for up to \a timeout micro-seconds (no limit if
+ * negative), and no later than the next RPC timeout.
+ */
+static void
+crt_context_wait(struct crt_context *ctx, int64_t timeout)
+{
+	struct epoll_event	ev;
+	int64_t			next;
+
+	/* completions queued already do not wake up the wait fd */
+	if (crt_hg_event_ready(&ctx->cc_hg_ctx))
+		return;
+
+	next = crt_context_next_timeout(ctx);
+	if (next >= 0 && (timeout < 0 || next < timeout))
+		timeout = next;
+	/* bounded, as the cond_cb can depend on anything */
+	if (timeout < 0 || timeout > CRT_PROGRESS_IDLE_MAX_US)
+		timeout = CRT_PROGRESS_IDLE_MAX_US;
+
+	/* round up, waking up before the timer expired would only spin */
+	if (epoll_wait(ctx->cc_wait_fd, &ev, 1, (timeout + 999) / 1000) < 0 &&
+	    errno != EINTR)
+		D_ERROR("epoll_wait failed, errno: %d.\n", errno);
+}
+
+int
+crt_context_get_wait_fd(crt_context_t crt_ctx, int *fd)
+{
+	struct crt_context	*ctx = crt_ctx;
+
+	if (ctx == CRT_CONTEXT_NULL || fd == NULL) {
+		D_ERROR("invalid parameter, crt_ctx: %p, fd: %p.\n",
+			crt_ctx, fd);
+		return -DER_INVAL;
+	}
+	if (ctx->cc_wait_fd < 0)
+		return -DER_NOSYS;
+
+	*fd = ctx->cc_wait_fd;
+	return 0;
+}
+
+int
+crt_context_get_wait_timeout(crt_context_t crt_ctx, int64_t *timeout)
+{
+	if (crt_ctx == CRT_CONTEXT_NULL || timeout == NULL) {
+		D_ERROR("invalid parameter, crt_ctx: %p, timeout: %p.\n",
+			crt_ctx, timeout);
+		return -DER_INVAL;
+	}
+
+	*timeout = crt_context_next_timeout(crt_ctx);
+	return 0;
+}
+
+int
+crt_context_wakeup(crt_context_t crt_ctx)
+{
+	if (crt_ctx == CRT_CONTEXT_NULL) {
+		D_ERROR("invalid parameter (NULL crt_ctx).\n");
+		return -DER_INVAL;
+	}
+
+	crt_context_signal(crt_ctx);
+	return 0;
+}
+
 int
 crt_context_create(crt_context_t *crt_ctx)
 {
@@ -249,6 +637,8 @@ crt_context_create(crt_context_t *crt_ctx)
 
 	D_RWLOCK_UNLOCK(&crt_gdata.cg_rwlock);
 
+	crt_context_wait_init(ctx);
+
 	*crt_ctx = (crt_context_t)ctx;
 
 out:
@@ -267,6 +657,11 @@ crt_context_register_rpc_task(crt_context_t ctx, crt_rpc_task_t process_cb,
 		return -DER_INVAL;
 	}
 
+	if (crt_ctx->cc_hpool != NULL) {
+		D_ERROR("context %d has a handler pool.\n", crt_ctx->cc_idx);
+		return -DER_ALREADY;
+	}
+
 	crt_ctx->cc_rpc_cb = process_cb;
 	crt_ctx->cc_rpc_cb_arg = arg;
 	return 0;
@@ -277,6 +672,10 @@ crt_rpc_complete(struct crt_rpc_priv *rpc_priv, int rc)
 {
 	D_ASSERT(rpc_priv != NULL);
 
+	/* the RPCs waiting for its address lookup fail or look up again */
+	if (rpc_priv->crp_lookup_leader)
+		crt_req_lookup_done(rpc_priv, rc);
+
 	if (rc == -DER_CANCELED)
 		rpc_priv->crp_state = RPC_STATE_CANCELED;
 	else if (rc == -DER_TIMEDOUT)
@@ -309,6 +708,243 @@ crt_rpc_complete(struct crt_rpc_priv *rpc_priv, int rc)
 	}
 }
 
+static int
+el_expired_find(d_list_t *rlink, void *arg)
+{
+	struct crt_ep_lookup	*el = el_link2ptr(rlink);
+	struct crt_ep_lookup	**expired = arg;
+
+	if (el->el_leader != NULL || !d_list_empty(&el->el_waitq) ||
+	    d_timeus_secdiff(0) < el->el_retry_ts + CRT_LOOKUP_EXPIRE_US)
+		return 0;
+
+	*expired = el;
+	return 1;
+}
+
+/*
+ * Move the failed lookups which expired to \a expired, at most once per
+ * CRT_LOOKUP_EXPIRE_US, otherwise the targets which are never retried stay
+ * in the table until the context is destroyed. Called with cc_lookup_mutex.
+ */
+static void
+crt_context_lookup_expire(struct crt_context *ctx, d_list_t *expired)
+{
+	struct crt_ep_lookup	*el;
+	uint64_t		 now = d_timeus_secdiff(0);
+
+	if (now < ctx->cc_lookup_expire_ts)
+		return;
+	ctx->cc_lookup_expire_ts = now + CRT_LOOKUP_EXPIRE_US;
+
+	while (1) {
+		el = NULL;
+		d_hash_table_traverse(&ctx->cc_lookup_table, el_expired_find,
+				      &el);
+		if (el == NULL)
+			break;
+		d_hash_rec_delete_at(&ctx->cc_lookup_table, &el->el_link);
+		d_list_add(&el->el_link, expired);
+	}
+}
+
+/*
+ * Called by an RPC whose target address is not cached. Returns 0 if the
+ * caller has to look it up, CRT_LOOKUP_PARKED if another RPC of the context
+ * is looking it up already, in which case the RPC is sent again or failed
+ * once that lookup completes, or the error of the last lookup if it failed
+ * less than the backoff ago.
+ */
+int
+crt_req_lookup_park(struct crt_rpc_priv *rpc_priv)
+{
+	struct crt_context		*ctx = rpc_priv->crp_pub.cr_ctx;
+	crt_endpoint_t			*tgt_ep = &rpc_priv->crp_pub.cr_ep;
+	struct crt_ep_lookup_key	 key;
+	struct crt_ep_lookup		*el;
+	struct crt_ep_lookup		*el_next;
+	d_list_t			*rlink;
+	d_list_t			 expired;
+	int				 rc = 0;
+
+	D_ASSERT(rpc_priv->crp_lookup == NULL);
+	D_INIT_LIST_HEAD(&expired);
+
+	key.elk_grp_priv = crt_grp_pub2priv(tgt_ep->ep_grp);
+	key.elk_rank = tgt_ep->ep_rank;
+	key.elk_tag = tgt_ep->ep_tag;
+
+	D_MUTEX_LOCK(&ctx->cc_lookup_mutex);
+	rlink = d_hash_rec_find(&ctx->cc_lookup_table, &key, sizeof(key));
+	if (rlink == NULL) {
+		crt_context_lookup_expire(ctx, &expired);
+		D_ALLOC_PTR(el);
+		if (el == NULL)
+			D_GOTO(out, rc = -DER_NOMEM);
+		el->el_key = key;
+		D_INIT_LIST_HEAD(&el->el_waitq);
+		rc = d_hash_rec_insert(&ctx->cc_lookup_table, &key,
+				       sizeof(key), &el->el_link,
+				       true /* exclusive */);
+		D_ASSERT(rc == 0);
+		/* decref when the record is freed */
+		crt_grp_priv_addref(key.elk_grp_priv);
+	} else {
+		el = el_link2ptr(rlink);
+	}
+
+	if (el->el_leader != NULL) {
+		rpc_priv->crp_state = RPC_STATE_LOOKUP_WAIT;
+		rpc_priv->crp_lookup = el;
+		d_list_add_tail(&rpc_priv->crp_lookup_link, &el->el_waitq);
+		RPC_TRACE(DB_NET, rpc_priv, "waiting for the address lookup "
+			  "of rank %d tag %d.\n", key.elk_rank, key.elk_tag);
+		D_GOTO(out, rc = CRT_LOOKUP_PARKED);
+	}
+
+	if (el->el_fail_num != 0 && d_timeus_secdiff(0) < el->el_retry_ts) {
+		RPC_TRACE(DB_NET, rpc_priv, "address lookup of rank %d tag %d "
+			  "failed %d times, last rc: %d.\n", key.elk_rank,
+			  key.elk_tag, el->el_fail_num, el->el_rc);
+		D_GOTO(out, rc = el->el_rc);
+	}
+
+	el->el_leader = rpc_priv;
+	rpc_priv->crp_lookup = el;
+	rpc_priv->crp_lookup_leader = 1;
+
+out:
+	D_MUTEX_UNLOCK(&ctx->cc_lookup_mutex);
+
+	d_list_for_each_entry_safe(el, el_next, &expired, el_link) {
+		d_list_del(&el->el_link);
+		crt_grp_priv_decref(el->el_key.elk_grp_priv);
+		D_FREE_PTR(el);
+	}
+	return rc;
+}
+
+/* send again or fail an RPC that waited for a lookup */
+static void
+crt_req_lookup_resume(struct crt_rpc_priv *rpc_priv, int rc)
+{
+	if (rc == 0) {
+		rpc_priv->crp_state = RPC_STATE_INITED;
+		rc = crt_req_send_internal(rpc_priv);
+		if (rc == 0)
+			return;
+		RPC_ERROR(rpc_priv, "crt_req_send_internal() failed, rc %d\n",
+			  rc);
+	}
+
+	crt_context_req_untrack(rpc_priv);
+	crt_rpc_complete(rpc_priv, rc);
+	/* Corresponds to cleanup in crt_hg_req_send_cb() */
+	RPC_DECREF(rpc_priv);
+}
+
+/*
+ * Called by the RPC which looked up an address, once the address is cached
+ * (rc == 0) or the lookup failed. The RPCs which waited for it are sent again
+ * on success or if the lookup was canceled, otherwise they fail with rc.
+ */
+void
+crt_req_lookup_done(struct crt_rpc_priv *rpc_priv, int rc)
+{
+	struct crt_context	*ctx = rpc_priv->crp_pub.cr_ctx;
+	struct crt_ep_lookup	*el = rpc_priv->crp_lookup;
+	struct crt_rpc_priv	*waiter;
+	struct crt_rpc_priv	*waiter_next;
+	uint64_t		 backoff;
+	d_list_t		 waitq;
+	bool			 freed = false;
+
+	D_ASSERT(rpc_priv->crp_lookup_leader == 1);
+	D_ASSERT(el != NULL && el->el_leader == rpc_priv);
+
+	D_INIT_LIST_HEAD(&waitq);
+
+	D_MUTEX_LOCK(&ctx->cc_lookup_mutex);
+	el->el_leader = NULL;
+	rpc_priv->crp_lookup = NULL;
+	rpc_priv->crp_lookup_leader = 0;
+
+	if (rc == 0) {
+		el->el_fail_num = 0;
+	} else if (rc != -DER_CANCELED) {
+		backoff = min((uint64_t)CRT_LOOKUP_BACKOFF_MIN_US <<
+			      min(el->el_fail_num, 16),
+			      CRT_LOOKUP_BACKOFF_MAX_US);
+		el->el_fail_num++;
+		el->el_retry_ts = d_timeus_secdiff(0) + backoff;
+		el->el_rc = rc;
+		RPC_ERROR(rpc_priv, "address lookup of rank %d tag %d failed "
+			  "%d times, rc: %d, not retried in "DF_U64"us.\n",
+			  el->el_key.elk_rank, el->el_key.elk_tag,
+			  el->el_fail_num, rc, backoff);
+	}
+
+	/* owned by this function now, crt_req_lookup_unpark() skips them */
+	d_list_splice_init(&el->el_waitq, &waitq);
+	d_list_for_each_entry(waiter, &waitq, crp_lookup_link)
+		waiter->crp_lookup = NULL;
+
+	if (el->el_fail_num == 0) {
+		d_hash_rec_delete_at(&ctx->cc_lookup_table, &el->el_link);
+		freed = true;
+	}
+	D_MUTEX_UNLOCK(&ctx->cc_lookup_mutex);
+
+	if (freed) {
+		crt_grp_priv_decref(el->el_key.elk_grp_priv);
+		D_FREE_PTR(el);
+	}
+
+	/* a canceled lookup is not a failure, one waiter looks up again */
+	if (rc == -DER_CANCELED)
+		rc = 0;
+	d_list_for_each_entry_safe(waiter, waiter_next, &waitq,
+				   crp_lookup_link) {
+		d_list_del_init(&waiter->crp_lookup_link);
+		crt_req_lookup_resume(waiter, rc);
+	}
+}
+
+/*
+ * Stop an RPC waiting for a lookup, returns false if it is being resumed by
+ * crt_req_lookup_done() already.
+ */
+static bool
+crt_req_lookup_unpark(struct crt_rpc_priv *rpc_priv)
+{
+	struct crt_context	*ctx = rpc_priv->crp_pub.cr_ctx;
+	bool			 parked = false;
+
+	D_MUTEX_LOCK(&ctx->cc_lookup_mutex);
+	if (rpc_priv->crp_lookup != NULL) {
+		d_list_del_init(&rpc_priv->crp_lookup_link);
+		rpc_priv->crp_lookup = NULL;
+		parked = true;
+	}
+	D_MUTEX_UNLOCK(&ctx->cc_lookup_mutex);
+
+	return parked;
+}
+
+/*
+ * Fail an RPC waiting for a lookup with -DER_CANCELED, returns false if it
+ * is not parked (anymore).
+ */
+bool
+crt_req_lookup_cancel(struct crt_rpc_priv *rpc_priv)
+{
+	if (!crt_req_lookup_unpark(rpc_priv))
+		return false;
+
+	crt_req_lookup_resume(rpc_priv, -DER_CANCELED);
+	return true;
+}
+
 /* Flag bits definition for crt_ctx_epi_abort */
 #define CRT_EPI_ABORT_FORCE	(0x1)
 #define CRT_EPI_ABORT_WAIT	(0x2)
@@ -447,6 +1083,9 @@ crt_context_destroy(crt_context_t crt_ctx, int force)
 			D_GOTO(out, rc);
 	}
 
+	/* let the handlers still queued run, and send their replies */
+	crt_hpool_destroy(ctx);
+
 	flags = (force != 0) ? (CRT_EPI_ABORT_FORCE | CRT_EPI_ABORT_WAIT) : 0;
 	D_MUTEX_LOCK(&ctx->cc_mutex);
 
@@ -461,6 +1100,8 @@ crt_context_destroy(crt_context_t crt_ctx, int force)
 			D_GOTO(out, rc);
 	}
 
+	/* epis are released along with cc_epi_table */
+	d_rank_map_fini(&ctx->cc_epi_map);
 	rc = d_hash_table_destroy_inplace(&ctx->cc_epi_table,
 					  true /* force */);
 	if (rc != 0) {
@@ -472,17 +1113,26 @@ crt_context_destroy(crt_context_t crt_ctx, int force)
 			D_GOTO(out, rc);
 	}
 
-	d_binheap_destroy_inplace(&ctx->cc_bh_timeout);
-
 	D_MUTEX_UNLOCK(&ctx->cc_mutex);
 	D_MUTEX_DESTROY(&ctx->cc_mutex);
 
+	crt_context_lookup_fini(ctx);
+	crt_corpc_pipe_table_fini(ctx);
+
+	D_SPIN_LOCK(&ctx->cc_tw_lock);
+	d_timewheel_destroy_inplace(&ctx->cc_tw_timeout);
+	D_SPIN_UNLOCK(&ctx->cc_tw_lock);
+	D_SPIN_DESTROY(&ctx->cc_tw_lock);
+
+	crt_context_wait_fini(ctx);
+
 	rc = crt_hg_ctx_fini(&ctx->cc_hg_ctx);
 	if (rc == 0) {
 		D_RWLOCK_WRLOCK(&crt_gdata.cg_rwlock);
 		crt_gdata.cg_ctx_num--;
 		d_list_del(&ctx->cc_link);
 		D_RWLOCK_UNLOCK(&crt_gdata.cg_rwlock);
+		crt_rpc_cache_fini(ctx->cc_rpc_cache);
 		D_FREE_PTR(ctx);
 	} else {
 		D_ERROR("crt_hg_ctx_fini failed rc: %d.\n", rc);
@@ -558,36 +1208,29 @@ crt_ep_abort(crt_endpoint_t *ep)
 	return rc;
 }
 
-/* caller should already hold crt_ctx->cc_mutex */
+/* caller should already hold crt_ctx->cc_tw_lock */
 int
 crt_req_timeout_track(struct crt_rpc_priv *rpc_priv)
 {
 	struct crt_context *crt_ctx = rpc_priv->crp_pub.cr_ctx;
-	int rc;
 
 	D_ASSERT(crt_ctx != NULL);
 
-	if (rpc_priv->crp_in_binheap == 1)
-		D_GOTO(out, rc = 0);
+	if (rpc_priv->crp_in_timewheel == 1)
+		return 0;
 
-	/* add to binheap for timeout tracking */
+	/* add to timing wheel for timeout tracking */
 	RPC_ADDREF(rpc_priv); /* decref in crt_req_timeout_untrack */
-	rc = d_binheap_insert(&crt_ctx->cc_bh_timeout,
-			      &rpc_priv->crp_timeout_bp_node);
-	if (rc == 0) {
-		rpc_priv->crp_in_binheap = 1;
-	} else {
-		RPC_ERROR(rpc_priv,
-			  "d_binheap_insert failed, rc: %d\n",
-			  rc);
-		RPC_DECREF(rpc_priv);
-	}
+	d_timewheel_insert(&crt_ctx->cc_tw_timeout,
+			   &rpc_priv->crp_timeout_tw_node,
+			   rpc_priv->crp_timeout_ts);
+	rpc_priv->crp_in_timewheel = 1;
+	RPC_TRACE(DB_NET, rpc_priv, "entering the timeout timing wheel.\n");
 
-out:
-	return rc;
+	return 0;
 }
 
-/* caller should already hold crt_ctx->cc_mutex */
+/* caller should already hold crt_ctx->cc_tw_lock */
 void
 crt_req_timeout_untrack(struct crt_rpc_priv *rpc_priv)
 {
@@ -595,11 +1238,13 @@ crt_req_timeout_untrack(struct crt_rpc_priv *rpc_priv)
 
 	D_ASSERT(crt_ctx != NULL);
 
-	/* remove from timeout binheap */
-	if (rpc_priv->crp_in_binheap == 1) {
-		rpc_priv->crp_in_binheap = 0;
-		d_binheap_remove(&crt_ctx->cc_bh_timeout,
-				 &rpc_priv->crp_timeout_bp_node);
+	/* remove from timeout timing wheel */
+	if (rpc_priv->crp_in_timewheel == 1) {
+		rpc_priv->crp_in_timewheel = 0;
+		d_timewheel_remove(&crt_ctx->cc_tw_timeout,
+				   &rpc_priv->crp_timeout_tw_node);
+		RPC_TRACE(DB_NET, rpc_priv,
+			  "exiting the timeout timing wheel.\n");
 		RPC_DECREF(rpc_priv); /* addref in crt_req_timeout_track */
 	}
 }
@@ -661,9 +1306,9 @@ crt_req_timeout_reset(struct crt_rpc_priv *rpc_priv)
 	RPC_TRACE(DB_NET, rpc_priv, "reset_timer enabled.\n");
 
 	rpc_priv->crp_timeout_ts = crt_get_timeout(rpc_priv);
-	D_MUTEX_LOCK(&crt_ctx->cc_mutex);
+	D_SPIN_LOCK(&crt_ctx->cc_tw_lock);
 	rc = crt_req_timeout_track(rpc_priv);
-	D_MUTEX_UNLOCK(&crt_ctx->cc_mutex);
+	D_SPIN_UNLOCK(&crt_ctx->cc_tw_lock);
 	if (rc != 0) {
 		D_ERROR("crt_req_timeout_track(opc: %#x) failed, rc: %d.\n",
 			rpc_priv->crp_pub.cr_opc, rc);
@@ -713,8 +1358,20 @@ crt_req_timeout_hdlr(struct crt_rpc_priv *rpc_priv)
 		RPC_ERROR(rpc_priv,
 			  "timedout due to ADDR_LOOKUP to group %s, rank %d, tgt_uri %s timedout\n",
 			  grp_priv->gp_pub.cg_grpid,
-			  tgt_ep->ep_rank,
-			  rpc_priv->crp_tgt_uri);
+			  tgt_ep->ep_rank,
+			  rpc_priv->crp_tgt_uri);
+		crt_context_req_untrack(rpc_priv);
+		crt_rpc_complete(rpc_priv, -DER_UNREACH);
+		RPC_DECREF(rpc_priv);
+		break;
+	case RPC_STATE_LOOKUP_WAIT:
+		/* resumed by crt_req_lookup_done() concurrently */
+		if (!crt_req_lookup_unpark(rpc_priv))
+			break;
+		RPC_ERROR(rpc_priv,
+			  "timedout waiting for the address lookup of group %s, rank %d\n",
+			  grp_priv->gp_pub.cg_grpid,
+			  tgt_ep->ep_rank);
 		crt_context_req_untrack(rpc_priv);
 		crt_rpc_complete(rpc_priv, -DER_UNREACH);
 		RPC_DECREF(rpc_priv);
@@ -738,6 +1395,8 @@ crt_req_timeout_hdlr(struct crt_rpc_priv *rpc_priv)
 				  "aborting to group %s, rank %d, tgt_uri %s\n",
 				  grp_priv->gp_pub.cg_grpid,
 				  tgt_ep->ep_rank, rpc_priv->crp_tgt_uri);
+			/* congestion signal for crt_epi_credit_update() */
+			rpc_priv->crp_timedout = 1;
 			crt_req_abort(&rpc_priv->crp_pub);
 		}
 		break;
@@ -748,43 +1407,54 @@ static void
 crt_context_timeout_check(struct crt_context *crt_ctx)
 {
 	struct crt_rpc_priv		*rpc_priv;
-	struct d_binheap_node		*bh_node;
+	struct crt_grp_priv		*grp_priv;
+	struct d_tw_node		*tw_node;
+	d_list_t			 expired_list;
 	d_list_t			 timeout_list;
 	uint64_t			 ts_now;
 
 	D_ASSERT(crt_ctx != NULL);
 
-	D_INIT_LIST_HEAD(&timeout_list);
+	grp_priv = crt_context_coll_grp(crt_ctx);
+	if (grp_priv != NULL)
+		crt_coll_timeout_check(grp_priv);
+
 	ts_now = d_timeus_secdiff(0);
 
-	D_MUTEX_LOCK(&crt_ctx->cc_mutex);
-	while (1) {
-		bh_node = d_binheap_root(&crt_ctx->cc_bh_timeout);
-		if (bh_node == NULL)
-			break;
-		rpc_priv = container_of(bh_node, struct crt_rpc_priv,
-					crp_timeout_bp_node);
-		if (rpc_priv->crp_timeout_ts > ts_now)
-			break;
+	/* lockless check, called on every progress */
+	if (!d_timewheel_pending(&crt_ctx->cc_tw_timeout, ts_now))
+		return;
 
-		/* +1 to prevent it from being released in timeout_untrack */
-		RPC_ADDREF(rpc_priv);
-		crt_req_timeout_untrack(rpc_priv);
+	D_INIT_LIST_HEAD(&expired_list);
+	D_INIT_LIST_HEAD(&timeout_list);
 
+	D_SPIN_LOCK(&crt_ctx->cc_tw_lock);
+	d_timewheel_expire(&crt_ctx->cc_tw_timeout, ts_now, &expired_list);
+	while ((tw_node = d_list_pop_entry(&expired_list, struct d_tw_node,
+					   tn_link))) {
+		rpc_priv = container_of(tw_node, struct crt_rpc_priv,
+					crp_timeout_tw_node);
+		/*
+		 * already removed from the timing wheel, the reference taken
+		 * by crt_req_timeout_track is passed to timeout_list.
+		 */
+		D_ASSERT(rpc_priv->crp_in_timewheel == 1);
+		rpc_priv->crp_in_timewheel = 0;
 		d_list_add_tail(&rpc_priv->crp_tmp_link, &timeout_list);
+	};
+	D_SPIN_UNLOCK(&crt_ctx->cc_tw_lock);
+
+	/* handle the timeout RPCs */
+	while ((rpc_priv = d_list_pop_entry(&timeout_list,
+					    struct crt_rpc_priv,
+					    crp_tmp_link))) {
 		RPC_ERROR(rpc_priv,
 			  "ctx_id %d, (status: %#x) timed out, tgt rank %d, tag %d\n",
 			  crt_ctx->cc_idx,
 			  rpc_priv->crp_state,
 			  rpc_priv->crp_pub.cr_ep.ep_rank,
 			  rpc_priv->crp_pub.cr_ep.ep_tag);
-	};
-	D_MUTEX_UNLOCK(&crt_ctx->cc_mutex);
 
-	/* handle the timeout RPCs */
-	while ((rpc_priv = d_list_pop_entry(&timeout_list,
-					    struct crt_rpc_priv,
-					    crp_tmp_link))) {
 		/* check for and execute RPC timeout callbacks here */
 		crt_exec_timeout_cb(rpc_priv);
 		crt_req_timeout_hdlr(rpc_priv);
@@ -792,6 +1462,140 @@ crt_context_timeout_check(struct crt_context *crt_ctx)
 	}
 }
 
+/*
+ * Slow path of the epi lookup, finds the crt_ep_inflight in cc_epi_table or
+ * creates one, and publishes it in cc_epi_map for the lockless lookup.
+ *
+ * The epi is only released when destroying the context, so no reference is
+ * held for the caller.
+ */
+static int
+crt_epi_lookup_create(struct crt_context *crt_ctx, d_rank_t ep_rank,
+		      struct crt_ep_inflight **epi_out)
+{
+	struct crt_ep_inflight	*epi;
+	d_list_t		*rlink;
+	int			 rc = 0;
+
+	D_MUTEX_LOCK(&crt_ctx->cc_mutex);
+	rlink = d_hash_rec_find(&crt_ctx->cc_epi_table, (void *)&ep_rank,
+				sizeof(ep_rank));
+	if (rlink != NULL) {
+		epi = epi_link2ptr(rlink);
+		/* the reference of cc_epi_table keeps it */
+		d_hash_rec_decref(&crt_ctx->cc_epi_table, rlink);
+		D_GOTO(out, rc = 0);
+	}
+
+	D_ALLOC_PTR(epi);
+	if (epi == NULL)
+		D_GOTO(out, rc = -DER_NOMEM);
+
+	/* init the epi fields */
+	D_INIT_LIST_HEAD(&epi->epi_link);
+	epi->epi_ep.ep_rank = ep_rank;
+	epi->epi_ctx = crt_ctx;
+	D_INIT_LIST_HEAD(&epi->epi_req_q);
+	epi->epi_req_num = 0;
+	epi->epi_reply_num = 0;
+	D_INIT_LIST_HEAD(&epi->epi_req_waitq);
+	epi->epi_req_wait_num = 0;
+	epi->epi_credits = crt_gdata.cg_credit_ep_ctx;
+	/* the only reference is taken by d_hash_rec_insert */
+	epi->epi_ref = 0;
+	epi->epi_initialized = 1;
+	rc = D_MUTEX_INIT(&epi->epi_mutex, NULL);
+	if (rc != 0) {
+		D_FREE_PTR(epi);
+		D_GOTO(out, rc);
+	}
+
+	rc = d_hash_rec_insert(&crt_ctx->cc_epi_table, &ep_rank,
+			       sizeof(ep_rank), &epi->epi_link,
+			       true /* exclusive */);
+	if (rc != 0) {
+		D_ERROR("d_hash_rec_insert failed, rc: %d.\n", rc);
+		D_MUTEX_DESTROY(&epi->epi_mutex);
+		D_FREE_PTR(epi);
+		D_GOTO(out, rc);
+	}
+
+	/* ranks beyond CRT_EPI_MAP_MAX are only looked up in cc_epi_table */
+	rc = d_rank_map_set(&crt_ctx->cc_epi_map, ep_rank, epi);
+	if (rc != 0 && rc != -DER_OVERFLOW)
+		D_ERROR("d_rank_map_set(rank %d) failed, rc: %d.\n",
+			ep_rank, rc);
+	rc = 0;
+
+out:
+	D_MUTEX_UNLOCK(&crt_ctx->cc_mutex);
+	if (rc == 0)
+		*epi_out = epi;
+	return rc;
+}
+
+/* account a req moved to the inflight queue, called with epi_mutex held */
+static inline void
+crt_epi_inflight_add(struct crt_ep_inflight *epi,
+		     struct crt_rpc_priv *rpc_priv)
+{
+	int64_t		inflight;
+
+	rpc_priv->crp_epi_seq = ++epi->epi_send_seq;
+	inflight = epi->epi_req_num - epi->epi_reply_num;
+	if (inflight > epi->epi_inflight_hwm)
+		epi->epi_inflight_hwm = inflight;
+}
+
+/*
+ * AIMD adjustment of the credits of an epi, called with epi_mutex held when
+ * a req leaves the inflight queue.
+ * A timely reply adds 1/epi_credits to the credits, so the window grows by one
+ * per window of replies, a transport error is no reply and adds nothing.
+ * A timeout on the wire or a -DER_DOS reply halves the window, at most once
+ * per window: the reqs sent before the last decrease carry a
+ * crp_epi_seq <= epi_credit_dec_seq and are not counted again.
+ */
+static void
+crt_epi_credit_update(struct crt_ep_inflight *epi,
+		      struct crt_rpc_priv *rpc_priv)
+{
+	bool		congested;
+
+	if (crt_gdata.cg_credit_ep_ctx == 0 || !crt_gdata.cg_credit_adaptive)
+		return;
+
+	if (rpc_priv->crp_timedout)
+		congested = true;
+	else if (rpc_priv->crp_state == RPC_STATE_COMPLETED &&
+		 rpc_priv->crp_output_got)
+		congested = (int)rpc_priv->crp_reply_hdr.cch_rc == -DER_DOS;
+	else
+		/* canceled, never sent or failed in transport, no signal */
+		return;
+
+	if (congested) {
+		if (rpc_priv->crp_epi_seq <= epi->epi_credit_dec_seq)
+			return;
+		epi->epi_credits = max(epi->epi_credits / 2,
+				       (uint32_t)CRT_MIN_CREDITS_PER_EP_CTX);
+		epi->epi_credit_acc = 0;
+		epi->epi_credit_dec_seq = epi->epi_send_seq;
+		epi->epi_credit_dec_num++;
+		D_DEBUG(DB_NET, "ep rank %d, credits decreased to %u.\n",
+			epi->epi_ep.ep_rank, epi->epi_credits);
+		return;
+	}
+
+	if (epi->epi_credits >= CRT_MAX_CREDITS_PER_EP_CTX)
+		return;
+	if (++epi->epi_credit_acc < epi->epi_credits)
+		return;
+	epi->epi_credits++;
+	epi->epi_credit_acc = 0;
+	epi->epi_credit_inc_num++;
+}
+
 /*
  * Track the rpc request per context
  * return CRT_REQ_TRACK_IN_INFLIGHQ - tacked in crt_ep_inflight::epi_req_q
@@ -803,7 +1607,6 @@ crt_context_req_track(struct crt_rpc_priv *rpc_priv)
 {
 	struct crt_context	*crt_ctx = rpc_priv->crp_pub.cr_ctx;
 	struct crt_ep_inflight	*epi;
-	d_list_t		*rlink;
 	d_rank_t		 ep_rank;
 	int			 rc = 0;
 
@@ -818,48 +1621,13 @@ crt_context_req_track(struct crt_rpc_priv *rpc_priv)
 	ep_rank = rpc_priv->crp_pub.cr_ep.ep_rank;
 
 	/* lookup the crt_ep_inflight (create one if not found) */
-	D_MUTEX_LOCK(&crt_ctx->cc_mutex);
-	rlink = d_hash_rec_find(&crt_ctx->cc_epi_table, (void *)&ep_rank,
-				sizeof(ep_rank));
-	if (rlink == NULL) {
-		D_ALLOC_PTR(epi);
-		if (epi == NULL) {
-			D_MUTEX_UNLOCK(&crt_ctx->cc_mutex);
-			D_GOTO(out, rc = -DER_NOMEM);
-		}
-
-		/* init the epi fields */
-		D_INIT_LIST_HEAD(&epi->epi_link);
-		epi->epi_ep.ep_rank = ep_rank;
-		epi->epi_ctx = crt_ctx;
-		D_INIT_LIST_HEAD(&epi->epi_req_q);
-		epi->epi_req_num = 0;
-		epi->epi_reply_num = 0;
-		D_INIT_LIST_HEAD(&epi->epi_req_waitq);
-		epi->epi_req_wait_num = 0;
-		/* epi_ref init as 1 to avoid other thread delete it but here
-		 * still need to access it, decref before exit this routine. */
-		epi->epi_ref = 1;
-		epi->epi_initialized = 1;
-		rc = D_MUTEX_INIT(&epi->epi_mutex, NULL);
-		if (rc != 0) {
-			D_MUTEX_UNLOCK(&crt_ctx->cc_mutex);
-			D_GOTO(out, rc);
-		}
-
-		rc = d_hash_rec_insert(&crt_ctx->cc_epi_table, &ep_rank,
-				       sizeof(ep_rank), &epi->epi_link,
-				       true /* exclusive */);
+	epi = d_rank_map_lookup(&crt_ctx->cc_epi_map, ep_rank);
+	if (epi == NULL) {
+		rc = crt_epi_lookup_create(crt_ctx, ep_rank, &epi);
 		if (rc != 0)
-			D_ERROR("d_hash_rec_insert failed, rc: %d.\n", rc);
-	} else {
-		epi = epi_link2ptr(rlink);
-		D_ASSERT(epi->epi_ctx == crt_ctx);
+			D_GOTO(out, rc);
 	}
-	D_MUTEX_UNLOCK(&crt_ctx->cc_mutex);
-
-	if (rc != 0)
-		D_GOTO(out, rc);
+	D_ASSERT(epi->epi_ctx == crt_ctx);
 
 	/* add the RPC req to crt_ep_inflight */
 	D_MUTEX_LOCK(&epi->epi_mutex);
@@ -869,20 +1637,23 @@ crt_context_req_track(struct crt_rpc_priv *rpc_priv)
 	RPC_ADDREF(rpc_priv);
 	if (crt_gdata.cg_credit_ep_ctx != 0 &&
 	    (epi->epi_req_num - epi->epi_reply_num) >=
-	     crt_gdata.cg_credit_ep_ctx) {
+	     (int64_t)epi->epi_credits) {
 		d_list_add_tail(&rpc_priv->crp_epi_link,
 				&epi->epi_req_waitq);
 		epi->epi_req_wait_num++;
+		if (epi->epi_req_wait_num > epi->epi_req_wait_hwm)
+			epi->epi_req_wait_hwm = epi->epi_req_wait_num;
 		rpc_priv->crp_state = RPC_STATE_QUEUED;
 		rc = CRT_REQ_TRACK_IN_WAITQ;
 	} else {
-		D_MUTEX_LOCK(&crt_ctx->cc_mutex);
+		D_SPIN_LOCK(&crt_ctx->cc_tw_lock);
 		rc = crt_req_timeout_track(rpc_priv);
-		D_MUTEX_UNLOCK(&crt_ctx->cc_mutex);
+		D_SPIN_UNLOCK(&crt_ctx->cc_tw_lock);
 		if (rc == 0) {
 			d_list_add_tail(&rpc_priv->crp_epi_link,
 					&epi->epi_req_q);
 			epi->epi_req_num++;
+			crt_epi_inflight_add(epi, rpc_priv);
 			rc = CRT_REQ_TRACK_IN_INFLIGHQ;
 		} else {
 			D_ERROR("crt_req_timeout_track failed, rc: %d.\n", rc);
@@ -893,11 +1664,6 @@ crt_context_req_track(struct crt_rpc_priv *rpc_priv)
 
 	D_MUTEX_UNLOCK(&epi->epi_mutex);
 
-	/* reference taken by d_hash_rec_find or "epi->epi_ref = 1" above */
-	D_MUTEX_LOCK(&crt_ctx->cc_mutex);
-	d_hash_rec_decref(&crt_ctx->cc_epi_table, &epi->epi_link);
-	D_MUTEX_UNLOCK(&crt_ctx->cc_mutex);
-
 out:
 	return rc;
 }
@@ -907,6 +1673,7 @@ crt_context_req_untrack(struct crt_rpc_priv *rpc_priv)
 {
 	struct crt_context	*crt_ctx = rpc_priv->crp_pub.cr_ctx;
 	struct crt_ep_inflight	*epi;
+	struct crt_rpc_priv	*batch_rpc;
 	int64_t			 credits, inflight;
 	d_list_t		 submit_list;
 	int			 rc;
@@ -924,11 +1691,22 @@ crt_context_req_untrack(struct crt_rpc_priv *rpc_priv)
 		 rpc_priv->crp_state == RPC_STATE_TIMEOUT ||
 		 rpc_priv->crp_state == RPC_STATE_ADDR_LOOKUP ||
 		 rpc_priv->crp_state == RPC_STATE_URI_LOOKUP ||
+		 rpc_priv->crp_state == RPC_STATE_LOOKUP_WAIT ||
 		 rpc_priv->crp_state == RPC_STATE_CANCELED ||
 		 rpc_priv->crp_state == RPC_STATE_FWD_UNREACH);
 	epi = rpc_priv->crp_epi;
 	D_ASSERT(epi != NULL);
 
+	if (rpc_priv->crp_batched) {
+		/*
+		 * left the waitq in crt_batch_pack(), the CRT_OPC_BATCH req
+		 * holds the credit and the inflight accounting on its behalf.
+		 * Decref corresponding to addref in crt_context_req_track.
+		 */
+		RPC_DECREF(rpc_priv);
+		return;
+	}
+
 	D_INIT_LIST_HEAD(&submit_list);
 
 	D_MUTEX_LOCK(&epi->epi_mutex);
@@ -941,11 +1719,13 @@ crt_context_req_untrack(struct crt_rpc_priv *rpc_priv)
 	D_ASSERT(epi->epi_req_num >= epi->epi_reply_num);
 
 	if (!crt_req_timedout(rpc_priv)) {
-		D_MUTEX_LOCK(&crt_ctx->cc_mutex);
+		D_SPIN_LOCK(&crt_ctx->cc_tw_lock);
 		crt_req_timeout_untrack(rpc_priv);
-		D_MUTEX_UNLOCK(&crt_ctx->cc_mutex);
+		D_SPIN_UNLOCK(&crt_ctx->cc_tw_lock);
 	}
 
+	crt_epi_credit_update(epi, rpc_priv);
+
 	/* decref corresponding to addref in crt_context_req_track */
 	RPC_DECREF(rpc_priv);
 
@@ -955,29 +1735,46 @@ crt_context_req_untrack(struct crt_rpc_priv *rpc_priv)
 		return;
 	}
 
-	/* process waitq */
+	/*
+	 * process waitq, inflight can exceed the credits after a decrease
+	 * in which case the waitq is held until enough replies come back.
+	 */
 	inflight = epi->epi_req_num - epi->epi_reply_num;
-	D_ASSERT(inflight >= 0 && inflight <= crt_gdata.cg_credit_ep_ctx);
-	credits = crt_gdata.cg_credit_ep_ctx - inflight;
+	D_ASSERT(inflight >= 0);
+	credits = (int64_t)epi->epi_credits - inflight;
 	while (credits > 0 && !d_list_empty(&epi->epi_req_waitq)) {
 		D_ASSERT(epi->epi_req_wait_num > 0);
 		rpc_priv = d_list_entry(epi->epi_req_waitq.next,
 					struct crt_rpc_priv, crp_epi_link);
+		batch_rpc = NULL;
+		if (crt_gdata.cg_batch_max > 1)
+			batch_rpc = crt_batch_pack(epi, rpc_priv);
+		if (batch_rpc != NULL) {
+			/* send the packed reqs with one credit */
+			rpc_priv = batch_rpc;
+			rpc_priv->crp_epi = epi;
+			RPC_ADDREF(rpc_priv);
+			d_list_add_tail(&rpc_priv->crp_epi_link,
+					&epi->epi_req_q);
+		} else {
+			/* remove from waitq and add to in-flight queue */
+			d_list_move_tail(&rpc_priv->crp_epi_link,
+					 &epi->epi_req_q);
+			epi->epi_req_wait_num--;
+			D_ASSERT(epi->epi_req_wait_num >= 0);
+		}
 		rpc_priv->crp_state = RPC_STATE_INITED;
 		rpc_priv->crp_timeout_ts = crt_get_timeout(rpc_priv);
 
-		D_MUTEX_LOCK(&crt_ctx->cc_mutex);
+		D_SPIN_LOCK(&crt_ctx->cc_tw_lock);
 		rc = crt_req_timeout_track(rpc_priv);
-		D_MUTEX_UNLOCK(&crt_ctx->cc_mutex);
+		D_SPIN_UNLOCK(&crt_ctx->cc_tw_lock);
 		if (rc != 0)
 			D_ERROR("crt_req_timeout_track failed, rc: %d.\n", rc);
 
-		/* remove from waitq and add to in-flight queue */
-		d_list_move_tail(&rpc_priv->crp_epi_link, &epi->epi_req_q);
-		epi->epi_req_wait_num--;
-		D_ASSERT(epi->epi_req_wait_num >= 0);
 		epi->epi_req_num++;
 		D_ASSERT(epi->epi_req_num >= epi->epi_reply_num);
+		crt_epi_inflight_add(epi, rpc_priv);
 
 		/* add to resend list */
 		d_list_add_tail(&rpc_priv->crp_tmp_link, &submit_list);
@@ -1136,6 +1933,9 @@ crt_progress(crt_context_t crt_ctx, int64_t timeout,
 	int64_t			 hg_timeout;
 	uint64_t		 now;
 	uint64_t		 end = 0;
+	int64_t			 wait_timeout = -1;
+	bool			 blocking;
+	bool			 idle;
 	int			 crt_ctx_idx;
 	int			 rc = 0;
 
@@ -1171,6 +1971,8 @@ crt_progress(crt_context_t crt_ctx, int64_t timeout,
 	ctx = crt_ctx;
 	if (timeout == 0 || cond_cb == NULL) { /** fast path */
 		crt_context_timeout_check(ctx);
+		crt_context_signal_clear(ctx);
+		crt_hpool_progress(ctx);
 		/* check for and execute progress callbacks here */
 		if (crt_ctx_idx == 0)
 			crt_exec_progress_cb(crt_ctx);
@@ -1218,8 +2020,21 @@ crt_progress(crt_context_t crt_ctx, int64_t timeout,
 			hg_timeout = timeout;
 	}
 
+	/**
+	 * In blocking mode only poll the network, and sleep on the wait fd
+	 * when nothing progressed
+	 */
+	blocking = crt_gdata.cg_progress_blocking && ctx->cc_wait_fd >= 0;
+	if (blocking) {
+		hg_timeout = 0;
+		if (timeout > 0)
+			wait_timeout = timeout;
+	}
+
 	while (true) {
 		crt_context_timeout_check(ctx);
+		crt_context_signal_clear(ctx);
+		crt_hpool_progress(ctx);
 		/* check for and execute progress callbacks here */
 		if (crt_ctx_idx == 0)
 			crt_exec_progress_cb(ctx);
@@ -1229,6 +2044,7 @@ crt_progress(crt_context_t crt_ctx, int64_t timeout,
 			D_ERROR("crt_hg_progress failed with %d\n", rc);
 			D_GOTO(out, rc = 0);
 		}
+		idle = (rc == -DER_TIMEDOUT);
 
 		/** execute callback */
 		rc = cond_cb(arg);
@@ -1244,12 +2060,313 @@ crt_progress(crt_context_t crt_ctx, int64_t timeout,
 				rc = -DER_TIMEDOUT;
 				break;
 			}
-			if (end - now > 1000 * 1000)
+			if (blocking)
+				wait_timeout = end - now;
+			else if (end - now > 1000 * 1000)
 				hg_timeout = 1000 * 1000;
 			else
 				hg_timeout = end - now;
 		}
+
+		if (blocking && idle)
+			crt_context_wait(ctx, wait_timeout);
+	}
+out:
+	return rc;
+}
+
+int
+crt_progress_set_create(crt_progress_set_t *set)
+{
+	struct crt_progress_set	*ps;
+
+	if (set == NULL) {
+		D_ERROR("invalid parameter (NULL set).\n");
+		return -DER_INVAL;
+	}
+
+	D_ALLOC_PTR(ps);
+	if (ps == NULL)
+		return -DER_NOMEM;
+
+	ps->ps_wait_fd = epoll_create1(EPOLL_CLOEXEC);
+	if (ps->ps_wait_fd < 0) {
+		D_ERROR("epoll_create1 failed, errno: %d.\n", errno);
+		D_FREE_PTR(ps);
+		return d_errno2der(errno);
+	}
+
+	*set = ps;
+	return 0;
+}
+
+int
+crt_progress_set_destroy(crt_progress_set_t set)
+{
+	struct crt_progress_set	*ps = set;
+
+	if (ps == NULL) {
+		D_ERROR("invalid parameter (NULL set).\n");
+		return -DER_INVAL;
+	}
+
+	close(ps->ps_wait_fd);
+	D_FREE(ps->ps_ctxs);
+	D_FREE_PTR(ps);
+	return 0;
+}
+
+static int
+crt_progress_set_ctl(struct crt_progress_set *ps, int op, uint32_t idx)
+{
+	struct crt_context	*ctx = ps->ps_ctxs[idx];
+	struct epoll_event	 ev = {0};
+
+	if (ctx->cc_wait_fd < 0)
+		return 0;
+
+	ev.events = EPOLLIN;
+	ev.data.u32 = idx;
+	if (epoll_ctl(ps->ps_wait_fd, op, ctx->cc_wait_fd, &ev) != 0) {
+		D_ERROR("epoll_ctl(%d) failed, errno: %d.\n", op, errno);
+		return d_errno2der(errno);
+	}
+
+	return 0;
+}
+
+int
+crt_progress_set_add(crt_progress_set_t set, crt_context_t crt_ctx)
+{
+	struct crt_progress_set	 *ps = set;
+	struct crt_context	**ctxs;
+	int			  i;
+	int			  rc;
+
+	if (ps == NULL || crt_ctx == CRT_CONTEXT_NULL) {
+		D_ERROR("invalid parameter, set: %p, crt_ctx: %p.\n",
+			set, crt_ctx);
+		return -DER_INVAL;
+	}
+
+	for (i = 0; i < ps->ps_num; i++)
+		if (ps->ps_ctxs[i] == crt_ctx)
+			return -DER_EXIST;
+
+	D_REALLOC_ARRAY(ctxs, ps->ps_ctxs, (ps->ps_num + 1));
+	if (ctxs == NULL)
+		return -DER_NOMEM;
+	ps->ps_ctxs = ctxs;
+	ps->ps_ctxs[ps->ps_num] = crt_ctx;
+
+	rc = crt_progress_set_ctl(ps, EPOLL_CTL_ADD, ps->ps_num);
+	if (rc != 0)
+		return rc;
+
+	if (ps->ps_ctxs[ps->ps_num]->cc_wait_fd < 0)
+		ps->ps_nowait_num++;
+	ps->ps_num++;
+
+	return 0;
+}
+
+int
+crt_progress_set_del(crt_progress_set_t set, crt_context_t crt_ctx)
+{
+	struct crt_progress_set	*ps = set;
+	struct crt_context	*ctx = crt_ctx;
+	int			 i;
+	int			 rc;
+
+	if (ps == NULL || ctx == CRT_CONTEXT_NULL) {
+		D_ERROR("invalid parameter, set: %p, crt_ctx: %p.\n",
+			set, crt_ctx);
+		return -DER_INVAL;
+	}
+
+	for (i = 0; i < ps->ps_num; i++)
+		if (ps->ps_ctxs[i] == ctx)
+			break;
+	if (i == ps->ps_num)
+		return -DER_NONEXIST;
+
+	rc = crt_progress_set_ctl(ps, EPOLL_CTL_DEL, i);
+	if (rc != 0)
+		return rc;
+	if (ctx->cc_wait_fd < 0)
+		ps->ps_nowait_num--;
+
+	/* move the last one into the hole, its epoll index changes */
+	ps->ps_num--;
+	if (i != ps->ps_num) {
+		ps->ps_ctxs[i] = ps->ps_ctxs[ps->ps_num];
+		rc = crt_progress_set_ctl(ps, EPOLL_CTL_MOD, i);
+	}
+
+	return rc;
+}
+
+/*
+ * One round over all the contexts of the set, returns the number of contexts
+ * which progressed or a negative error.
+ */
+static int
+crt_progress_set_round(struct crt_progress_set *ps)
+{
+	struct epoll_event	 evs[CRT_PROGRESS_SET_EVENTS];
+	struct crt_context	*ctx;
+	uint8_t			 ready[CRT_PROGRESS_SET_EVENTS];
+	bool			 poll_all;
+	uint32_t		 start;
+	uint32_t		 idx;
+	int			 progressed = 0;
+	int			 nr;
+	int			 i;
+	int			 rc;
+
+	poll_all = ps->ps_nowait_num > 0 || ps->ps_num > CRT_PROGRESS_SET_EVENTS;
+	if (!poll_all) {
+		memset(ready, 0, ps->ps_num);
+		nr = epoll_wait(ps->ps_wait_fd, evs, ps->ps_num, 0);
+		if (nr < 0 && errno != EINTR)
+			D_ERROR("epoll_wait failed, errno: %d.\n", errno);
+		for (i = 0; i < nr; i++)
+			ready[evs[i].data.u32] = 1;
+	}
+
+	start = ps->ps_next++ % ps->ps_num;
+	for (i = 0; i < ps->ps_num; i++) {
+		idx = (start + i) % ps->ps_num;
+		ctx = ps->ps_ctxs[idx];
+
+		crt_context_timeout_check(ctx);
+		/* check for and execute progress callbacks here */
+		if (ctx->cc_idx == 0)
+			crt_exec_progress_cb(ctx);
+		/* nothing to do, skip it */
+		if (!poll_all && !ready[idx] &&
+		    !crt_hg_event_ready(&ctx->cc_hg_ctx))
+			continue;
+
+		crt_context_signal_clear(ctx);
+		crt_hpool_progress(ctx);
+		rc = crt_hg_progress(&ctx->cc_hg_ctx, 0);
+		if (rc == 0)
+			progressed++;
+		else if (rc != -DER_TIMEDOUT)
+			return rc;
+	}
+
+	return progressed;
+}
+
+/* wait up to \a timeout micro-seconds for some context to have work */
+static int
+crt_progress_set_wait(struct crt_progress_set *ps, int64_t timeout)
+{
+	struct epoll_event	 ev;
+	struct crt_context	*ctx;
+	int64_t			 next;
+	int			 i;
+	int			 rc;
+
+	if (ps->ps_nowait_num == 0 && ps->ps_num <= CRT_PROGRESS_SET_EVENTS) {
+		for (i = 0; i < ps->ps_num; i++) {
+			/*
+			 * completions queued already do not wake up the
+			 * wait fd
+			 */
+			if (crt_hg_event_ready(&ps->ps_ctxs[i]->cc_hg_ctx))
+				return 0;
+			next = crt_context_next_timeout(ps->ps_ctxs[i]);
+			if (next >= 0 && (timeout < 0 || next < timeout))
+				timeout = next;
+		}
+		if (timeout < 0 || timeout > CRT_PROGRESS_IDLE_MAX_US)
+			timeout = CRT_PROGRESS_IDLE_MAX_US;
+
+		if (epoll_wait(ps->ps_wait_fd, &ev, 1,
+			       (timeout + 999) / 1000) < 0 && errno != EINTR)
+			D_ERROR("epoll_wait failed, errno: %d.\n", errno);
+		return 0;
+	}
+
+	/* spend the wait on one context, the next one in the next wait */
+	if (timeout < 0 || timeout > CRT_PROGRESS_SET_SLICE_US)
+		timeout = CRT_PROGRESS_SET_SLICE_US;
+	ctx = ps->ps_ctxs[ps->ps_next % ps->ps_num];
+	rc = crt_hg_progress(&ctx->cc_hg_ctx, timeout);
+	if (rc != 0 && rc != -DER_TIMEDOUT)
+		return rc;
+
+	return 0;
+}
+
+int
+crt_progress_set(crt_progress_set_t set, int64_t timeout,
+		 crt_progress_cond_cb_t cond_cb, void *arg)
+{
+	struct crt_progress_set	*ps = set;
+	uint64_t		 now;
+	uint64_t		 end = 0;
+	int64_t			 wait_timeout = -1;
+	int			 progressed;
+	int			 rc = 0;
+
+	if (ps == NULL || ps->ps_num == 0) {
+		D_ERROR("invalid parameter, NULL or empty set %p.\n", set);
+		return -DER_INVAL;
+	}
+	if (timeout < 0 && cond_cb == NULL) {
+		D_ERROR("infinite timeout needs a cond_cb.\n");
+		return -DER_INVAL;
+	}
+
+	if (cond_cb) {
+		rc = cond_cb(arg);
+		if (rc > 0)
+			return 0;
+		if (rc < 0)
+			return rc;
+	}
+
+	if (timeout > 0)
+		end = d_timeus_secdiff(0) + timeout;
+
+	while (true) {
+		progressed = crt_progress_set_round(ps);
+		if (progressed < 0) {
+			D_ERROR("crt_hg_progress failed, rc: %d.\n",
+				progressed);
+			D_GOTO(out, rc = progressed);
+		}
+
+		if (cond_cb) {
+			rc = cond_cb(arg);
+			if (rc > 0)
+				D_GOTO(out, rc = 0);
+			if (rc < 0)
+				D_GOTO(out, rc);
+		} else if (progressed > 0) {
+			D_GOTO(out, rc = 0);
+		}
+
+		if (timeout == 0)
+			D_GOTO(out, rc = progressed > 0 ? 0 : -DER_TIMEDOUT);
+		if (timeout > 0) {
+			now = d_timeus_secdiff(0);
+			if (now >= end)
+				D_GOTO(out, rc = -DER_TIMEDOUT);
+			wait_timeout = end - now;
+		}
+
+		if (progressed == 0) {
+			rc = crt_progress_set_wait(ps, wait_timeout);
+			if (rc != 0)
+				D_GOTO(out, rc);
+		}
 	}
+
 out:
 	return rc;
 }
@@ -1352,12 +2469,12 @@ crt_req_force_timeout(struct crt_rpc_priv *rpc_priv)
 	crt_ctx = rpc_priv->crp_pub.cr_ctx;
 
 	/**
-	 *  set the RPC's expiration time stamp to the past, move it to the top
-	 *  of the heap.
+	 *  set the RPC's expiration time stamp to the past, it will be expired
+	 *  by the next timeout check.
 	 */
-	D_MUTEX_LOCK(&crt_ctx->cc_mutex);
+	D_SPIN_LOCK(&crt_ctx->cc_tw_lock);
 	crt_req_timeout_untrack(rpc_priv);
 	rpc_priv->crp_timeout_ts = 0;
 	crt_req_timeout_track(rpc_priv);
-	D_MUTEX_UNLOCK(&crt_ctx->cc_mutex);
+	D_SPIN_UNLOCK(&crt_ctx->cc_tw_lock);
 }
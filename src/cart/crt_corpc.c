@@ -84,7 +84,6 @@ crt_corpc_info_init(struct crt_rpc_priv *rpc_priv,
 	rpc_priv->crp_pub.cr_co_bulk_hdl = co_bulk_hdl;
 	co_info->co_priv = priv;
 	D_INIT_LIST_HEAD(&co_info->co_child_rpcs);
-	D_INIT_LIST_HEAD(&co_info->co_replied_rpcs);
 
 	/* init the corpc header */
 	co_hdr = &rpc_priv->crp_coreq_hdr;
@@ -101,6 +100,9 @@ crt_corpc_info_init(struct crt_rpc_priv *rpc_priv,
 		co_hdr->coh_grp_ver = grp_ver;
 		co_hdr->coh_tree_topo = tree_topo;
 		co_hdr->coh_root = grp_root;
+		co_hdr->coh_bulk_seg = (co_bulk_hdl == CRT_BULK_NULL) ? 0 :
+				       crt_gdata.cg_corpc_bulk_seg;
+		co_hdr->coh_bulk_pipe = 0;
 	}
 	co_hdr->coh_bulk_hdl = co_bulk_hdl;
 
@@ -118,11 +120,12 @@ crt_corpc_info_fini(struct crt_rpc_priv *rpc_priv)
 	d_rank_list_free(rpc_priv->crp_corpc_info->co_excluded_ranks);
 	if (rpc_priv->crp_corpc_info->co_grp_ref_taken)
 		crt_grp_priv_decref(rpc_priv->crp_corpc_info->co_grp_priv);
+	D_FREE(rpc_priv->crp_corpc_info->co_reduce_buf);
 	D_FREE_PTR(rpc_priv->crp_corpc_info);
 }
 
 static int
-crt_corpc_initiate(struct crt_rpc_priv *rpc_priv)
+crt_corpc_initiate(struct crt_rpc_priv *rpc_priv, struct crt_corpc_pipe *pipe)
 {
 	struct crt_grp_gdata	*grp_gdata;
 	struct crt_grp_priv	*grp_priv;
@@ -164,6 +167,7 @@ crt_corpc_initiate(struct crt_rpc_priv *rpc_priv)
 			rc, rpc_priv->crp_pub.cr_opc);
 		D_GOTO(out, rc);
 	}
+	rpc_priv->crp_corpc_info->co_pipe = pipe;
 
 	rc = crt_corpc_req_hdlr(rpc_priv);
 	if (rc != 0)
@@ -203,7 +207,7 @@ crt_corpc_chained_bulk_cb(const struct crt_bulk_cb_info *cb_info)
 	}
 
 	rpc_priv->crp_pub.cr_co_bulk_hdl = local_bulk_hdl;
-	rc = crt_corpc_initiate(rpc_priv);
+	rc = crt_corpc_initiate(rpc_priv, NULL);
 	if (rc != 0) {
 		RPC_ERROR(rpc_priv,
 			  "crt_corpc_initiate failed, rc: %d\n",
@@ -267,6 +271,518 @@ out:
 	return rc;
 }
 
+/*
+ * Pipelined chained bulk of a forwarded corpc (see CRT_CORPC_BULK_SEG). The
+ * corpc is forwarded to the children right away and the bulk is pulled from
+ * the parent one segment at a time. The children pull the segments already
+ * here and wait for the others with CRT_OPC_CORPC_SEG_WAIT, which is replied
+ * once they land. So a segment moves down the tree while the next ones are
+ * still being pulled, instead of each level pulling the whole bulk before
+ * forwarding it. The local RPC handler runs once all segments landed.
+ *
+ * The pipe lives until the corpc completes, i.e. until all children replied.
+ * Only one transfer or wait is in flight for a pipe at a time.
+ *
+ * The pipes are found by id in the table of the context that received the
+ * corpc. Corpcs and the waits of the children all target tag 0, so the waits
+ * arrive on that same context.
+ */
+struct crt_corpc_pipe {
+	/* link to crt_context::cc_pipe_table */
+	d_list_t		 cp_link;
+	uint64_t		 cp_id;
+	/* held by cc_pipe_table and by the SEG_WAIT handlers looking at it */
+	uint32_t		 cp_ref;
+	/* protects cp_seg_ready, cp_waiters, cp_rc and the flags */
+	pthread_mutex_t		 cp_mutex;
+	struct crt_context	*cp_ctx;
+	struct crt_rpc_priv	*cp_rpc_priv;
+	crt_bulk_t		 cp_local_hdl;
+	crt_bulk_t		 cp_parent_hdl;
+	d_rank_t		 cp_parent_rank;
+	/* parent's pipe, 0 if cp_parent_hdl is complete */
+	uint64_t		 cp_parent_pipe;
+	size_t			 cp_len;
+	uint32_t		 cp_seg_size;
+	uint32_t		 cp_seg_num;
+	/* number of leading segments pulled, and ready on the parent */
+	uint32_t		 cp_seg_ready;
+	uint32_t		 cp_parent_ready;
+	/* parked CRT_OPC_CORPC_SEG_WAIT requests */
+	d_list_t		 cp_waiters;
+	int			 cp_rc;
+	/* the local RPC handler waits for the last segment */
+	bool			 cp_local_pending;
+	/* the corpc completed, waits are no longer parked */
+	bool			 cp_closed;
+};
+
+struct crt_corpc_pipe_waiter {
+	d_list_t		 pw_link;
+	crt_rpc_t		*pw_rpc;
+	uint32_t		 pw_seg_num;
+};
+
+static uint64_t crt_corpc_pipe_last_id;
+
+static void crt_corpc_pipe_fetch(struct crt_corpc_pipe *pipe);
+
+static struct crt_corpc_pipe *
+pipe_link2ptr(d_list_t *rlink)
+{
+	D_ASSERT(rlink != NULL);
+	return container_of(rlink, struct crt_corpc_pipe, cp_link);
+}
+
+static int
+pipe_op_key_get(struct d_hash_table *hhtab, d_list_t *rlink, void **key_pp)
+{
+	struct crt_corpc_pipe *pipe = pipe_link2ptr(rlink);
+
+	*key_pp = (void *)&pipe->cp_id;
+	return sizeof(pipe->cp_id);
+}
+
+static uint32_t
+pipe_op_key_hash(struct d_hash_table *hhtab, const void *key,
+		 unsigned int ksize)
+{
+	D_ASSERT(ksize == sizeof(uint64_t));
+
+	return (uint32_t)(*(const uint64_t *)key &
+			  ((1U << CRT_PIPE_TABLE_BITS) - 1));
+}
+
+static bool
+pipe_op_key_cmp(struct d_hash_table *hhtab, d_list_t *rlink,
+		const void *key, unsigned int ksize)
+{
+	D_ASSERT(ksize == sizeof(uint64_t));
+
+	return pipe_link2ptr(rlink)->cp_id == *(const uint64_t *)key;
+}
+
+/* the table is read locked when taking and dropping references */
+static void
+pipe_op_rec_addref(struct d_hash_table *hhtab, d_list_t *rlink)
+{
+	__atomic_add_fetch(&pipe_link2ptr(rlink)->cp_ref, 1, __ATOMIC_RELAXED);
+}
+
+static bool
+pipe_op_rec_decref(struct d_hash_table *hhtab, d_list_t *rlink)
+{
+	return __atomic_sub_fetch(&pipe_link2ptr(rlink)->cp_ref, 1,
+				  __ATOMIC_ACQ_REL) == 0;
+}
+
+static void
+pipe_op_rec_free(struct d_hash_table *hhtab, d_list_t *rlink)
+{
+	struct crt_corpc_pipe *pipe = pipe_link2ptr(rlink);
+
+	D_ASSERT(d_list_empty(&pipe->cp_waiters));
+	D_MUTEX_DESTROY(&pipe->cp_mutex);
+	D_FREE_PTR(pipe);
+}
+
+static d_hash_table_ops_t pipe_table_ops = {
+	.hop_key_get		= pipe_op_key_get,
+	.hop_key_hash		= pipe_op_key_hash,
+	.hop_key_cmp		= pipe_op_key_cmp,
+	.hop_rec_addref		= pipe_op_rec_addref,
+	.hop_rec_decref		= pipe_op_rec_decref,
+	.hop_rec_free		= pipe_op_rec_free,
+};
+
+int
+crt_corpc_pipe_table_init(struct crt_context *ctx)
+{
+	int	rc;
+
+	rc = d_hash_table_create_inplace(D_HASH_FT_RWLOCK,
+					 CRT_PIPE_TABLE_BITS, NULL,
+					 &pipe_table_ops, &ctx->cc_pipe_table);
+	if (rc != 0)
+		D_ERROR("d_hash_table_create_inplace failed, rc: %d.\n", rc);
+
+	return rc;
+}
+
+void
+crt_corpc_pipe_table_fini(struct crt_context *ctx)
+{
+	int	rc;
+
+	/* the pipes go with their corpcs, aborted before */
+	rc = d_hash_table_destroy_inplace(&ctx->cc_pipe_table,
+					  true /* force */);
+	if (rc != 0)
+		D_ERROR("d_hash_table_destroy_inplace failed, rc: %d.\n", rc);
+}
+
+/* move the waiters for at most seg_num segments to list, lock held */
+static void
+crt_corpc_pipe_waiters_take(struct crt_corpc_pipe *pipe, uint32_t seg_num,
+			    d_list_t *list)
+{
+	struct crt_corpc_pipe_waiter	*pw, *next;
+
+	d_list_for_each_entry_safe(pw, next, &pipe->cp_waiters, pw_link)
+		if (pw->pw_seg_num <= seg_num)
+			d_list_move_tail(&pw->pw_link, list);
+}
+
+static void
+crt_corpc_pipe_waiters_reply(d_list_t *list, uint32_t seg_ready, int rc)
+{
+	struct crt_corpc_pipe_waiter	*pw, *next;
+	struct crt_corpc_seg_wait_out	*sw_out;
+
+	d_list_for_each_entry_safe(pw, next, list, pw_link) {
+		d_list_del(&pw->pw_link);
+		sw_out = crt_reply_get(pw->pw_rpc);
+		sw_out->sw_seg_ready = seg_ready;
+		sw_out->sw_rc = rc;
+		rc = crt_reply_send(pw->pw_rpc);
+		if (rc != 0)
+			D_ERROR("crt_reply_send failed, rc: %d.\n", rc);
+		/* corresponds to addref in crt_hdlr_corpc_seg_wait */
+		crt_req_decref(pw->pw_rpc);
+		D_FREE_PTR(pw);
+	}
+}
+
+/* run the local RPC handler, or complete it with rc if the pipe failed */
+static void
+crt_corpc_pipe_local(struct crt_rpc_priv *rpc_priv, int rc)
+{
+	struct crt_cb_info	cb_info = {};
+
+	if (rc == 0) {
+		rc = crt_rpc_common_hdlr(rpc_priv);
+		if (rc != 0)
+			RPC_ERROR(rpc_priv,
+				  "crt_rpc_common_hdlr failed, rc: %d\n", rc);
+		return;
+	}
+
+	cb_info.cci_rpc = &rpc_priv->crp_pub;
+	cb_info.cci_arg = rpc_priv;
+	cb_info.cci_rc = rc;
+	crt_corpc_reply_hdlr(&cb_info);
+}
+
+/* called once the corpc is forwarded to run the local RPC handler */
+static void
+crt_corpc_pipe_local_ready(struct crt_corpc_pipe *pipe)
+{
+	struct crt_rpc_priv	*rpc_priv = pipe->cp_rpc_priv;
+	bool			 run = true;
+	int			 rc;
+
+	D_MUTEX_LOCK(&pipe->cp_mutex);
+	rc = pipe->cp_rc;
+	if (rc == 0 && pipe->cp_seg_ready < pipe->cp_seg_num) {
+		pipe->cp_local_pending = true;
+		run = false;
+	}
+	D_MUTEX_UNLOCK(&pipe->cp_mutex);
+
+	if (run)
+		crt_corpc_pipe_local(rpc_priv, rc);
+}
+
+static void
+crt_corpc_pipe_fail(struct crt_corpc_pipe *pipe, int rc)
+{
+	struct crt_rpc_priv	*rpc_priv = pipe->cp_rpc_priv;
+	d_list_t		 waiters;
+	bool			 local;
+
+	RPC_ERROR(rpc_priv, "pipelined bulk failed at segment %u, rc: %d\n",
+		  pipe->cp_seg_ready, rc);
+
+	D_INIT_LIST_HEAD(&waiters);
+	D_MUTEX_LOCK(&pipe->cp_mutex);
+	pipe->cp_rc = rc;
+	crt_corpc_pipe_waiters_take(pipe, UINT32_MAX, &waiters);
+	local = pipe->cp_local_pending;
+	pipe->cp_local_pending = false;
+	D_MUTEX_UNLOCK(&pipe->cp_mutex);
+
+	crt_corpc_pipe_waiters_reply(&waiters, 0, rc);
+	/* can complete the corpc and destroy the pipe */
+	if (local)
+		crt_corpc_pipe_local(rpc_priv, rc);
+}
+
+static void
+crt_corpc_pipe_destroy(struct crt_corpc_pipe *pipe)
+{
+	d_list_t	waiters;
+
+	if (pipe == NULL)
+		return;
+
+	D_INIT_LIST_HEAD(&waiters);
+	D_MUTEX_LOCK(&pipe->cp_mutex);
+	pipe->cp_closed = true;
+	/* waits of the children that failed or timed out */
+	crt_corpc_pipe_waiters_take(pipe, UINT32_MAX, &waiters);
+	D_MUTEX_UNLOCK(&pipe->cp_mutex);
+
+	crt_corpc_pipe_waiters_reply(&waiters, 0, -DER_CANCELED);
+	/* freed once no SEG_WAIT handler looks at it */
+	d_hash_rec_delete_at(&pipe->cp_ctx->cc_pipe_table, &pipe->cp_link);
+}
+
+static int
+crt_corpc_pipe_get_cb(const struct crt_bulk_cb_info *cb_info)
+{
+	struct crt_corpc_pipe	*pipe = cb_info->bci_arg;
+	struct crt_rpc_priv	*rpc_priv = pipe->cp_rpc_priv;
+	d_list_t		 waiters;
+	uint32_t		 seg_ready;
+	bool			 local = false;
+	int			 rc = cb_info->bci_rc;
+
+	if (rc != 0) {
+		crt_corpc_pipe_fail(pipe, rc);
+		D_GOTO(out, rc);
+	}
+
+	D_INIT_LIST_HEAD(&waiters);
+	D_MUTEX_LOCK(&pipe->cp_mutex);
+	seg_ready = ++pipe->cp_seg_ready;
+	crt_corpc_pipe_waiters_take(pipe, seg_ready, &waiters);
+	if (seg_ready == pipe->cp_seg_num) {
+		local = pipe->cp_local_pending;
+		pipe->cp_local_pending = false;
+	}
+	D_MUTEX_UNLOCK(&pipe->cp_mutex);
+
+	crt_corpc_pipe_waiters_reply(&waiters, seg_ready, 0);
+	if (seg_ready < pipe->cp_seg_num)
+		crt_corpc_pipe_fetch(pipe);
+	else if (local)
+		crt_corpc_pipe_local(rpc_priv, 0);
+
+out:
+	/* corresponds to addref in crt_corpc_pipe_fetch */
+	RPC_DECREF(rpc_priv);
+	return rc;
+}
+
+static void
+crt_corpc_pipe_wait_cb(const struct crt_cb_info *cb_info)
+{
+	struct crt_corpc_pipe		*pipe = cb_info->cci_arg;
+	struct crt_corpc_seg_wait_out	*sw_out;
+	int				 rc = cb_info->cci_rc;
+
+	if (rc != 0) {
+		crt_corpc_pipe_fail(pipe, rc);
+		return;
+	}
+	sw_out = crt_reply_get(cb_info->cci_rpc);
+	if (sw_out->sw_rc != 0) {
+		crt_corpc_pipe_fail(pipe, sw_out->sw_rc);
+		return;
+	}
+
+	pipe->cp_parent_ready = min(sw_out->sw_seg_ready, pipe->cp_seg_num);
+	crt_corpc_pipe_fetch(pipe);
+}
+
+/* pull the next segment, after waiting for the parent to have it if needed */
+static void
+crt_corpc_pipe_fetch(struct crt_corpc_pipe *pipe)
+{
+	struct crt_rpc_priv		*rpc_priv = pipe->cp_rpc_priv;
+	struct crt_corpc_seg_wait_in	*sw_in;
+	struct crt_bulk_desc		 bulk_desc;
+	crt_endpoint_t			 tgt_ep = {0};
+	crt_rpc_t			*req;
+	uint32_t			 seg = pipe->cp_seg_ready;
+	size_t				 off;
+	int				 rc;
+
+	if (pipe->cp_parent_pipe != 0 && seg >= pipe->cp_parent_ready) {
+		tgt_ep.ep_rank = pipe->cp_parent_rank;
+		rc = crt_req_create(rpc_priv->crp_pub.cr_ctx, &tgt_ep,
+				    CRT_OPC_CORPC_SEG_WAIT, &req);
+		if (rc != 0) {
+			D_ERROR("crt_req_create failed, rc: %d.\n", rc);
+			D_GOTO(out, rc);
+		}
+		sw_in = crt_req_get(req);
+		sw_in->sw_pipe = pipe->cp_parent_pipe;
+		sw_in->sw_seg_num = seg + 1;
+		/* failures are reported through crt_corpc_pipe_wait_cb */
+		crt_req_send(req, crt_corpc_pipe_wait_cb, pipe);
+		return;
+	}
+
+	off = (size_t)seg * pipe->cp_seg_size;
+	bulk_desc.bd_rpc = &rpc_priv->crp_pub;
+	bulk_desc.bd_bulk_op = CRT_BULK_GET;
+	bulk_desc.bd_remote_hdl = pipe->cp_parent_hdl;
+	bulk_desc.bd_remote_off = off;
+	bulk_desc.bd_local_hdl = pipe->cp_local_hdl;
+	bulk_desc.bd_local_off = off;
+	bulk_desc.bd_len = min(pipe->cp_len - off, pipe->cp_seg_size);
+
+	RPC_ADDREF(rpc_priv);
+	rc = crt_bulk_transfer(&bulk_desc, crt_corpc_pipe_get_cb, pipe, NULL);
+	if (rc != 0) {
+		D_ERROR("crt_bulk_transfer failed, rc: %d.\n", rc);
+		RPC_DECREF(rpc_priv);
+	}
+
+out:
+	if (rc != 0)
+		crt_corpc_pipe_fail(pipe, rc);
+}
+
+static int
+crt_corpc_pipe_start(struct crt_rpc_priv *rpc_priv, size_t bulk_len)
+{
+	struct crt_corpc_hdr	*co_hdr = &rpc_priv->crp_coreq_hdr;
+	struct crt_corpc_pipe	*pipe;
+	d_sg_list_t		 bulk_sgl;
+	d_iov_t			 bulk_iov;
+	int			 rc;
+
+	D_ALLOC_PTR(pipe);
+	if (pipe == NULL)
+		return -DER_NOMEM;
+
+	rc = D_MUTEX_INIT(&pipe->cp_mutex, NULL);
+	if (rc != 0) {
+		D_FREE_PTR(pipe);
+		return rc;
+	}
+
+	/* freed by crt_corpc_free_chained_bulk */
+	bulk_iov.iov_buf = calloc(1, bulk_len);
+	if (bulk_iov.iov_buf == NULL) {
+		D_MUTEX_DESTROY(&pipe->cp_mutex);
+		D_FREE_PTR(pipe);
+		return -DER_NOMEM;
+	}
+	bulk_iov.iov_buf_len = bulk_len;
+	bulk_sgl.sg_nr = 1;
+	bulk_sgl.sg_iovs = &bulk_iov;
+
+	rc = crt_bulk_create(rpc_priv->crp_pub.cr_ctx, &bulk_sgl, CRT_BULK_RW,
+			     &pipe->cp_local_hdl);
+	if (rc != 0) {
+		D_ERROR("crt_bulk_create failed, rc: %d, opc: %#x.\n",
+			rc, rpc_priv->crp_pub.cr_opc);
+		free(bulk_iov.iov_buf);
+		D_MUTEX_DESTROY(&pipe->cp_mutex);
+		D_FREE_PTR(pipe);
+		return rc;
+	}
+
+	pipe->cp_id = __atomic_add_fetch(&crt_corpc_pipe_last_id, 1,
+					 __ATOMIC_RELAXED);
+	pipe->cp_ctx = rpc_priv->crp_pub.cr_ctx;
+	pipe->cp_rpc_priv = rpc_priv;
+	pipe->cp_parent_hdl = co_hdr->coh_bulk_hdl;
+	pipe->cp_parent_rank = rpc_priv->crp_req_hdr.cch_rank;
+	pipe->cp_parent_pipe = co_hdr->coh_bulk_pipe;
+	pipe->cp_len = bulk_len;
+	pipe->cp_seg_size = co_hdr->coh_bulk_seg;
+	pipe->cp_seg_num = (bulk_len + pipe->cp_seg_size - 1) /
+			   pipe->cp_seg_size;
+	D_INIT_LIST_HEAD(&pipe->cp_waiters);
+
+	/* the reference of the table is dropped by crt_corpc_pipe_destroy */
+	rc = d_hash_rec_insert(&pipe->cp_ctx->cc_pipe_table, &pipe->cp_id,
+			       sizeof(pipe->cp_id), &pipe->cp_link,
+			       false /* exclusive */);
+	D_ASSERT(rc == 0);
+
+	D_DEBUG(DB_TRACE, "opc %#x pipe "DF_U64", %u segments of %u bytes, "
+		"parent rank %d pipe "DF_U64".\n", rpc_priv->crp_pub.cr_opc,
+		pipe->cp_id, pipe->cp_seg_num, pipe->cp_seg_size,
+		pipe->cp_parent_rank, pipe->cp_parent_pipe);
+
+	rpc_priv->crp_pub.cr_co_bulk_hdl = pipe->cp_local_hdl;
+	rc = crt_corpc_initiate(rpc_priv, pipe);
+	if (rc != 0 && rpc_priv->crp_corpc_info == NULL) {
+		/* not forwarded, the caller replies the error */
+		rpc_priv->crp_pub.cr_co_bulk_hdl = CRT_BULK_NULL;
+		crt_corpc_free_chained_bulk(pipe->cp_local_hdl);
+		d_hash_rec_delete_at(&pipe->cp_ctx->cc_pipe_table,
+				     &pipe->cp_link);
+		return rc;
+	}
+	if (rc != 0)
+		RPC_ERROR(rpc_priv, "crt_corpc_initiate failed, rc: %d\n", rc);
+
+	/* the corpc completes through the local handler */
+	crt_corpc_pipe_fetch(pipe);
+	return 0;
+}
+
+void
+crt_hdlr_corpc_seg_wait(crt_rpc_t *rpc_req)
+{
+	struct crt_corpc_seg_wait_in	*sw_in;
+	struct crt_corpc_seg_wait_out	*sw_out;
+	struct crt_context		*ctx = rpc_req->cr_ctx;
+	struct crt_corpc_pipe		*pipe;
+	struct crt_corpc_pipe_waiter	*pw;
+	d_list_t			*rlink;
+	uint32_t			 seg_ready = 0;
+	int				 rc = 0;
+
+	sw_in = crt_req_get(rpc_req);
+	sw_out = crt_reply_get(rpc_req);
+
+	rlink = d_hash_rec_find(&ctx->cc_pipe_table, &sw_in->sw_pipe,
+				sizeof(sw_in->sw_pipe));
+	if (rlink == NULL) {
+		D_ERROR("pipe "DF_U64" not found.\n", sw_in->sw_pipe);
+		D_GOTO(out, rc = -DER_NONEXIST);
+	}
+	pipe = pipe_link2ptr(rlink);
+
+	D_MUTEX_LOCK(&pipe->cp_mutex);
+	if (pipe->cp_closed)
+		D_GOTO(out_unlock, rc = -DER_CANCELED);
+	if (pipe->cp_rc != 0)
+		D_GOTO(out_unlock, rc = pipe->cp_rc);
+
+	seg_ready = pipe->cp_seg_ready;
+	if (sw_in->sw_seg_num > seg_ready) {
+		D_ALLOC_PTR(pw);
+		if (pw == NULL)
+			D_GOTO(out_unlock, rc = -DER_NOMEM);
+		/* replied by crt_corpc_pipe_waiters_reply */
+		crt_req_addref(rpc_req);
+		pw->pw_rpc = rpc_req;
+		pw->pw_seg_num = sw_in->sw_seg_num;
+		d_list_add_tail(&pw->pw_link, &pipe->cp_waiters);
+		D_MUTEX_UNLOCK(&pipe->cp_mutex);
+		d_hash_rec_decref(&ctx->cc_pipe_table, rlink);
+		return;
+	}
+
+out_unlock:
+	D_MUTEX_UNLOCK(&pipe->cp_mutex);
+	d_hash_rec_decref(&ctx->cc_pipe_table, rlink);
+out:
+	sw_out->sw_seg_ready = seg_ready;
+	sw_out->sw_rc = rc;
+	rc = crt_reply_send(rpc_req);
+	if (rc != 0)
+		D_ERROR("crt_reply_send failed, rc: %d.\n", rc);
+}
+
 /* only be called in crt_rpc_handler_common after RPC header unpacked */
 int
 crt_corpc_common_hdlr(struct crt_rpc_priv *rpc_priv)
@@ -277,6 +793,7 @@ crt_corpc_common_hdlr(struct crt_rpc_priv *rpc_priv)
 	d_iov_t			 bulk_iov;
 	size_t			 bulk_len;
 	struct crt_bulk_desc	 bulk_desc;
+	struct crt_corpc_ops	*co_ops;
 	int			 rc = 0;
 
 	D_ASSERT(rpc_priv != NULL && (rpc_priv->crp_flags & CRT_RPC_FLAG_COLL));
@@ -301,6 +818,14 @@ crt_corpc_common_hdlr(struct crt_rpc_priv *rpc_priv)
 			D_GOTO(out, rc);
 		}
 
+		co_ops = rpc_priv->crp_opc_info->coi_co_ops;
+		if (co_hdr->coh_bulk_seg != 0 &&
+		    bulk_len > co_hdr->coh_bulk_seg &&
+		    (co_ops == NULL || co_ops->co_pre_forward == NULL)) {
+			rc = crt_corpc_pipe_start(rpc_priv, bulk_len);
+			D_GOTO(out, rc);
+		}
+
 		bulk_iov.iov_buf = calloc(1, bulk_len);
 		if (bulk_iov.iov_buf == NULL)
 			D_GOTO(out, rc = -DER_NOMEM);
@@ -338,7 +863,7 @@ crt_corpc_common_hdlr(struct crt_rpc_priv *rpc_priv)
 		D_GOTO(out, rc);
 	} else {
 		rpc_priv->crp_pub.cr_co_bulk_hdl = CRT_BULK_NULL;
-		rc = crt_corpc_initiate(rpc_priv);
+		rc = crt_corpc_initiate(rpc_priv, NULL);
 		if (rc != 0)
 			D_ERROR("crt_corpc_initiate failed,rc: %d,opc: %#x.\n",
 				rc, rpc_priv->crp_pub.cr_opc);
@@ -399,7 +924,8 @@ crt_corpc_req_create(crt_context_t crt_ctx, crt_group_t *grp,
 		}
 	}
 
-	rc = crt_rpc_priv_alloc(opc, &rpc_priv, false /* forward */);
+	rc = crt_rpc_priv_alloc(crt_ctx, opc, &rpc_priv,
+				false /* forward */);
 	if (rc != 0) {
 		D_ERROR("crt_rpc_priv_alloc, rc: %d, opc: %#x.\n", rc, opc);
 		D_GOTO(out, rc);
@@ -503,9 +1029,12 @@ corpc_add_child_rpc(struct crt_rpc_priv *parent_rpc_priv,
 	child_co_hdr->coh_grp_ver = parent_co_hdr->coh_grp_ver;
 	child_co_hdr->coh_tree_topo = parent_co_hdr->coh_tree_topo;
 	child_co_hdr->coh_root = parent_co_hdr->coh_root;
-	child_co_hdr->coh_padding = parent_co_hdr->coh_padding;
 
 	co_info = parent_rpc_priv->crp_corpc_info;
+	child_co_hdr->coh_bulk_seg = parent_co_hdr->coh_bulk_seg;
+	/* the child waits for the segments not pulled yet */
+	child_co_hdr->coh_bulk_pipe = (co_info->co_pipe == NULL) ? 0 :
+				      co_info->co_pipe->cp_id;
 
 	RPC_ADDREF(child_rpc_priv);
 
@@ -536,12 +1065,70 @@ crt_corpc_fail_parent_rpc(struct crt_rpc_priv *parent_rpc_priv, int failed_rc)
 
 	crt_group_rank(NULL, &myrank);
 
-	parent_rpc_priv->crp_reply_hdr.cch_rc = failed_rc;
-	parent_rpc_priv->crp_corpc_info->co_rc = failed_rc;
+	/* by the reply handlers of several children at once */
+	__atomic_store_n(&parent_rpc_priv->crp_reply_hdr.cch_rc, failed_rc,
+			 __ATOMIC_RELAXED);
+	__atomic_store_n(&parent_rpc_priv->crp_corpc_info->co_rc, failed_rc,
+			 __ATOMIC_RELAXED);
 	D_ERROR("myrank %d, set parent rpc (opc %#x) as failed, rc: %d.\n",
 		myrank, parent_rpc_priv->crp_pub.cr_opc, failed_rc);
 }
 
+/* account the reply aggregation of @rpc_priv in the stats of its context */
+static void
+crt_corpc_stats_add(struct crt_rpc_priv *rpc_priv)
+{
+	struct crt_corpc_info	*co_info = rpc_priv->crp_corpc_info;
+	struct crt_context	*ctx = rpc_priv->crp_pub.cr_ctx;
+	struct crt_corpc_stats	*stats = &ctx->cc_corpc_stats;
+	uint64_t		 max_ns;
+
+	RPC_TRACE(DB_TRACE, rpc_priv, "aggregated %u replies in "DF_U64" ns, "
+		  "%u of them for other threads.\n", co_info->co_child_ack_num,
+		  co_info->co_agg_ns, co_info->co_agg_combined);
+
+	__atomic_add_fetch(&stats->cs_corpc_num, 1, __ATOMIC_RELAXED);
+	__atomic_add_fetch(&stats->cs_reply_num, co_info->co_child_ack_num,
+			   __ATOMIC_RELAXED);
+	__atomic_add_fetch(&stats->cs_combined, co_info->co_agg_combined,
+			   __ATOMIC_RELAXED);
+	__atomic_add_fetch(&stats->cs_agg_ns, co_info->co_agg_ns,
+			   __ATOMIC_RELAXED);
+	max_ns = __atomic_load_n(&stats->cs_agg_max_ns, __ATOMIC_RELAXED);
+	while (co_info->co_agg_ns > max_ns &&
+	       !__atomic_compare_exchange_n(&stats->cs_agg_max_ns, &max_ns,
+					    co_info->co_agg_ns, true,
+					    __ATOMIC_RELAXED,
+					    __ATOMIC_RELAXED))
+		;
+}
+
+int
+crt_context_corpc_stats(crt_context_t crt_ctx, struct crt_corpc_stats *stats)
+{
+	struct crt_context	*ctx = crt_ctx;
+	struct crt_corpc_stats	*cs;
+
+	if (ctx == CRT_CONTEXT_NULL || stats == NULL) {
+		D_ERROR("invalid parameter, crt_ctx: %p, stats: %p.\n",
+			crt_ctx, stats);
+		return -DER_INVAL;
+	}
+
+	cs = &ctx->cc_corpc_stats;
+	stats->cs_corpc_num = __atomic_load_n(&cs->cs_corpc_num,
+					      __ATOMIC_RELAXED);
+	stats->cs_reply_num = __atomic_load_n(&cs->cs_reply_num,
+					      __ATOMIC_RELAXED);
+	stats->cs_combined = __atomic_load_n(&cs->cs_combined,
+					     __ATOMIC_RELAXED);
+	stats->cs_agg_ns = __atomic_load_n(&cs->cs_agg_ns, __ATOMIC_RELAXED);
+	stats->cs_agg_max_ns = __atomic_load_n(&cs->cs_agg_max_ns,
+					       __ATOMIC_RELAXED);
+
+	return 0;
+}
+
 static inline void
 crt_corpc_complete(struct crt_rpc_priv *rpc_priv)
 {
@@ -553,6 +1140,8 @@ crt_corpc_complete(struct crt_rpc_priv *rpc_priv)
 	co_info = rpc_priv->crp_corpc_info;
 	D_ASSERT(co_info != NULL);
 
+	crt_corpc_stats_add(rpc_priv);
+
 	myrank = co_info->co_grp_priv->gp_self;
 	am_root = (myrank == co_info->co_root);
 	if (am_root) {
@@ -565,6 +1154,9 @@ crt_corpc_complete(struct crt_rpc_priv *rpc_priv)
 		if (rc != 0)
 			D_ERROR("crt_hg_reply_send failed, rc: %d,opc: %#x.\n",
 				rc, rpc_priv->crp_pub.cr_opc);
+		/* no child pulls from the chained bulk any more */
+		crt_corpc_pipe_destroy(co_info->co_pipe);
+		co_info->co_pipe = NULL;
 		/*
 		 * on root node, don't need to free chained bulk handle as it is
 		 * created and passed in by user.
@@ -588,52 +1180,164 @@ crt_corpc_complete(struct crt_rpc_priv *rpc_priv)
 	RPC_DECREF(rpc_priv);
 }
 
+/*
+ * Count @num more replies of @parent_rpc_priv as done, returns true if they
+ * were the last ones, the caller then completes the corpc.
+ */
+static inline bool
+crt_corpc_done_add(struct crt_rpc_priv *parent_rpc_priv, uint32_t num)
+{
+	struct crt_corpc_info	*co_info = parent_rpc_priv->crp_corpc_info;
+	uint32_t		 wait_num, done_num;
+
+	wait_num = co_info->co_child_num;
+	/* the extra +1 is for local RPC handler */
+	if (co_info->co_root_excluded == 0)
+		wait_num++;
+
+	done_num = __atomic_add_fetch(&co_info->co_done_num, num,
+				      __ATOMIC_ACQ_REL);
+	D_ASSERT(wait_num >= done_num);
+	return num > 0 && wait_num == done_num;
+}
+
 static inline void
 crt_corpc_fail_child_rpc(struct crt_rpc_priv *parent_rpc_priv,
 			 uint32_t failed_num, int failed_rc)
 {
 	struct crt_corpc_info	*co_info;
-	uint32_t		 wait_num;
-	uint32_t		 done_num;
-	bool			 req_done = false;
 
 	D_ASSERT(parent_rpc_priv != NULL);
 	co_info = parent_rpc_priv->crp_corpc_info;
 	D_ASSERT(co_info != NULL);
 
-	D_SPIN_LOCK(&parent_rpc_priv->crp_lock);
+	__atomic_add_fetch(&co_info->co_child_failed_num, failed_num,
+			   __ATOMIC_RELAXED);
+	crt_corpc_fail_parent_rpc(parent_rpc_priv, failed_rc);
 
-	wait_num = co_info->co_child_num;
-	/* the extra +1 is for local RPC handler */
-	if (co_info->co_root_excluded == 0)
-		wait_num++;
+	if (crt_corpc_done_add(parent_rpc_priv, failed_num))
+		crt_corpc_complete(parent_rpc_priv);
+}
 
-	done_num = co_info->co_child_ack_num + co_info->co_child_failed_num;
-	done_num += failed_num;
-	D_ASSERT(done_num <= wait_num);
-	co_info->co_rc = failed_rc;
-	co_info->co_child_failed_num += failed_num;
-	if (wait_num == done_num)
-		req_done = true;
-	crt_corpc_fail_parent_rpc(parent_rpc_priv, failed_rc);
+/* aggregate the reply of @child_rpc_priv into @parent_rpc_priv */
+static void
+crt_corpc_aggregate(struct crt_rpc_priv *parent_rpc_priv,
+		    struct crt_rpc_priv *child_rpc_priv)
+{
+	struct crt_corpc_info	*co_info = parent_rpc_priv->crp_corpc_info;
+	struct crt_corpc_ops	*co_ops;
+	bool			 first = false;
+	int			 rc;
 
-	D_SPIN_UNLOCK(&parent_rpc_priv->crp_lock);
+	co_ops = parent_rpc_priv->crp_opc_info->coi_co_ops;
+	if (co_info->co_root_excluded == 1 && co_info->co_child_ack_num == 0 &&
+	    parent_rpc_priv->crp_pub.cr_output_size > 0) {
+		/* when root excluded, copy first reply's content to parent. */
+		memcpy(parent_rpc_priv->crp_pub.cr_output,
+		       child_rpc_priv->crp_pub.cr_output,
+		       parent_rpc_priv->crp_pub.cr_output_size);
+		if (co_ops->co_aggregate != NULL)
+			return;
+		first = true;
+	}
 
-	if (req_done == true)
-		crt_corpc_complete(parent_rpc_priv);
+	if (co_ops->co_aggregate == NULL) {
+		D_ASSERT(co_ops->co_reduce_op != CRT_REDUCE_NONE);
+		rc = crt_corpc_reduce(parent_rpc_priv, &child_rpc_priv->crp_pub,
+				      first);
+		/* the result misses a reply */
+		if (rc != 0)
+			crt_corpc_fail_parent_rpc(parent_rpc_priv, rc);
+	} else {
+		rc = co_ops->co_aggregate(&child_rpc_priv->crp_pub,
+					  &parent_rpc_priv->crp_pub,
+					  co_info->co_priv);
+	}
+	if (rc != 0)
+		D_ERROR("co_ops->co_aggregate failed, rc: %d, opc: %#x.\n",
+			rc, parent_rpc_priv->crp_pub.cr_opc);
+}
+
+/*
+ * Fold one reply of @parent_rpc_priv, the local one if @child_rpc_priv is
+ * @parent_rpc_priv. Returns the number of replies acked.
+ */
+static uint32_t
+crt_corpc_fold(struct crt_rpc_priv *parent_rpc_priv,
+	       struct crt_rpc_priv *child_rpc_priv)
+{
+	struct crt_corpc_info	*co_info = parent_rpc_priv->crp_corpc_info;
+	struct crt_rpc_priv	*tmp_rpc_priv;
+	uint32_t		 ack_num = 0;
+
+	if (parent_rpc_priv->crp_opc_info->coi_co_ops == NULL) {
+		ack_num++;
+		goto out;
+	}
+
+	if (parent_rpc_priv == child_rpc_priv) {
+		__atomic_store_n(&co_info->co_local_done, 1, __ATOMIC_RELEASE);
+		/* aggregate previously replied RPCs */
+		while (co_info->co_agg_deferred != NULL) {
+			tmp_rpc_priv = co_info->co_agg_deferred;
+			co_info->co_agg_deferred = tmp_rpc_priv->crp_agg_next;
+			crt_corpc_aggregate(parent_rpc_priv, tmp_rpc_priv);
+			co_info->co_child_ack_num++;
+			ack_num++;
+			D_SPIN_LOCK(&parent_rpc_priv->crp_lock);
+			corpc_del_child_rpc_locked(parent_rpc_priv,
+						   tmp_rpc_priv);
+			D_SPIN_UNLOCK(&parent_rpc_priv->crp_lock);
+		}
+		co_info->co_child_ack_num++;
+		ack_num++;
+		goto out;
+	}
+
+	if (co_info->co_root_excluded == 0 &&
+	    __atomic_load_n(&co_info->co_local_done, __ATOMIC_ACQUIRE) == 0) {
+		child_rpc_priv->crp_agg_next = co_info->co_agg_deferred;
+		co_info->co_agg_deferred = child_rpc_priv;
+		D_DEBUG(DB_NET, "parent rpc %p, child rpc %p deferred.\n",
+			parent_rpc_priv, child_rpc_priv);
+		return 0;
+	}
+
+	crt_corpc_aggregate(parent_rpc_priv, child_rpc_priv);
+	co_info->co_child_ack_num++;
+	ack_num++;
+
+out:
+	D_DEBUG(DB_NET, "parent rpc %p, child rpc %p, ack_num %d.\n",
+		parent_rpc_priv, child_rpc_priv, co_info->co_child_ack_num);
+	if (parent_rpc_priv != child_rpc_priv) {
+		D_SPIN_LOCK(&parent_rpc_priv->crp_lock);
+		corpc_del_child_rpc_locked(parent_rpc_priv, child_rpc_priv);
+		D_SPIN_UNLOCK(&parent_rpc_priv->crp_lock);
+	}
+	return ack_num;
 }
 
+/*
+ * Child replies and the local reply are pushed onto co_agg_stack without
+ * lock. The thread raising co_agg_pending from zero becomes the owner and
+ * folds them, including the ones pushed by others meanwhile, until none is
+ * pending. So co_aggregate callbacks of one corpc never run concurrently,
+ * and the other threads return right after pushing instead of spinning on
+ * crp_lock.
+ */
 void
 crt_corpc_reply_hdlr(const struct crt_cb_info *cb_info)
 {
 	struct crt_rpc_priv	*parent_rpc_priv;
 	struct crt_corpc_info	*co_info;
 	struct crt_rpc_priv	*child_rpc_priv;
+	struct crt_rpc_priv	*list, *next;
 	crt_rpc_t		*child_req;
-	struct crt_opc_info	*opc_info;
-	struct crt_corpc_ops	*co_ops;
+	struct timespec		 start, end;
+	bool			 owner, local_done;
 	bool			 req_done = false;
-	uint32_t		 wait_num, done_num;
+	uint32_t		 num, ack_num, left;
 	int			 rc = 0;
 
 	child_req = cb_info->cci_rpc;
@@ -643,123 +1347,71 @@ crt_corpc_reply_hdlr(const struct crt_cb_info *cb_info)
 	co_info = parent_rpc_priv->crp_corpc_info;
 	D_ASSERT(co_info != NULL);
 	D_ASSERT(parent_rpc_priv->crp_pub.cr_opc == child_req->cr_opc);
-	opc_info = parent_rpc_priv->crp_opc_info;
-	D_ASSERT(opc_info != NULL);
+	D_ASSERT(parent_rpc_priv->crp_opc_info != NULL);
 
-	D_SPIN_LOCK(&parent_rpc_priv->crp_lock);
 	if (parent_rpc_priv == child_rpc_priv &&
-	    child_req->cr_opc == CRT_OPC_RANK_EVICT &&
-	    co_info->co_local_done != 1) {
-		D_SPIN_UNLOCK(&parent_rpc_priv->crp_lock);
-		D_GOTO(out, rc);
-	}
-
-
-	wait_num = co_info->co_child_num;
-	/* the extra +1 is for local RPC handler */
-	if (co_info->co_root_excluded == 0) {
-		wait_num++;
-	} else {
-		D_ASSERT(parent_rpc_priv != child_rpc_priv);
-		co_info->co_local_done = 1;
+	    child_req->cr_opc == CRT_OPC_RANK_EVICT) {
+		local_done = __atomic_load_n(&co_info->co_local_done,
+					     __ATOMIC_ACQUIRE);
+		/* replied again once forwarded, see crt_corpc_req_hdlr() */
+		if (!local_done)
+			D_GOTO(out, rc);
 	}
+	D_ASSERT(co_info->co_root_excluded == 0 ||
+		 parent_rpc_priv != child_rpc_priv);
 
 	rc = cb_info->cci_rc;
 	if (rc != 0) {
 		D_ERROR("RPC(opc: %#x) error, rc: %d.\n",
 			child_req->cr_opc, rc);
-		co_info->co_rc = rc;
+		__atomic_store_n(&co_info->co_rc, rc, __ATOMIC_RELAXED);
 	}
 	/* propagate failure rc to parent */
 	if (child_rpc_priv->crp_reply_hdr.cch_rc != 0)
 		crt_corpc_fail_parent_rpc(parent_rpc_priv,
 			child_rpc_priv->crp_reply_hdr.cch_rc);
 
-	co_ops = opc_info->coi_co_ops;
-	if (co_ops == NULL) {
-		co_info->co_child_ack_num++;
-		if (parent_rpc_priv != child_rpc_priv)
-			corpc_del_child_rpc_locked(parent_rpc_priv,
-						   child_rpc_priv);
-		goto aggregate_done;
-	}
-
-	if (parent_rpc_priv == child_rpc_priv) {
-		struct crt_rpc_priv	*tmp_rpc_priv, *next;
-
-		co_info->co_local_done = 1;
-		/* aggregate previously replied RPCs */
-		d_list_for_each_entry_safe(tmp_rpc_priv, next,
-					   &co_info->co_replied_rpcs,
-					   crp_parent_link) {
-			D_ASSERT(tmp_rpc_priv != parent_rpc_priv);
-			D_ASSERT(co_ops->co_aggregate != NULL);
-			rc = co_ops->co_aggregate(&tmp_rpc_priv->crp_pub,
-						  &parent_rpc_priv->crp_pub,
-						  co_info->co_priv);
-			if (rc != 0) {
-				D_ERROR("co_ops->co_aggregate failed, rc: %d, "
-					"opc: %#x.\n", rc, child_req->cr_opc);
-				rc = 0;
-			}
-			co_info->co_child_ack_num++;
-			D_DEBUG(DB_NET, "parent rpc %p, child rpc %p, "
-				"wait_num %d, ack_num %d.\n", parent_rpc_priv,
-				child_rpc_priv, wait_num,
-				co_info->co_child_ack_num);
-			corpc_del_child_rpc_locked(parent_rpc_priv,
-						   tmp_rpc_priv);
+	owner = __atomic_fetch_add(&co_info->co_agg_pending, 1,
+				   __ATOMIC_ACQ_REL) == 0;
+	list = __atomic_load_n(&co_info->co_agg_stack, __ATOMIC_RELAXED);
+	do {
+		child_rpc_priv->crp_agg_next = list;
+	} while (!__atomic_compare_exchange_n(&co_info->co_agg_stack, &list,
+					      child_rpc_priv, true,
+					      __ATOMIC_RELEASE,
+					      __ATOMIC_RELAXED));
+	/* the owner folds it */
+	if (!owner)
+		D_GOTO(out, rc = 0);
+
+	d_gettime(&start);
+	do {
+		/* pending ones not pushed yet are picked by the next round */
+		list = __atomic_exchange_n(&co_info->co_agg_stack, NULL,
+					   __ATOMIC_ACQUIRE);
+		num = 0;
+		ack_num = 0;
+		for (; list != NULL; list = next) {
+			next = list->crp_agg_next;
+			ack_num += crt_corpc_fold(parent_rpc_priv, list);
+			num++;
 		}
-	}
 
-	/* reply aggregate */
-	if (co_info->co_local_done == 1) {
-		if (child_rpc_priv != parent_rpc_priv) {
-			if (co_info->co_root_excluded == 1 &&
-			    co_info->co_child_ack_num == 0 &&
-			    parent_rpc_priv->crp_pub.cr_output_size > 0) {
-				/*
-				 * when root excluded, copy first reply's
-				 * content to parent.
-				 */
-				memcpy(parent_rpc_priv->crp_pub.cr_output,
-				       child_rpc_priv->crp_pub.cr_output,
-				       parent_rpc_priv->crp_pub.cr_output_size);
-			} else {
-				D_ASSERT(co_ops->co_aggregate != NULL);
-				rc = co_ops->co_aggregate(child_req,
-					&parent_rpc_priv->crp_pub,
-					co_info->co_priv);
-				if (rc != 0) {
-					D_ERROR("co_ops->co_aggregate failed, "
-						"rc: %d, opc: %#x.\n",
-						rc, child_req->cr_opc);
-					rc = 0;
-				}
-			}
+		d_gettime(&end);
+		co_info->co_agg_ns += d_timediff_ns(&start, &end);
+		start = end;
+		/* all but its own one were pushed by other threads */
+		co_info->co_agg_combined += num;
+		if (owner && num > 0) {
+			co_info->co_agg_combined--;
+			owner = false;
 		}
-		co_info->co_child_ack_num++;
-		D_DEBUG(DB_NET, "parent rpc %p, child rpc %p, wait_num %d, "
-			"ack_num %d.\n", parent_rpc_priv, child_rpc_priv,
-			wait_num, co_info->co_child_ack_num);
-		if (parent_rpc_priv != child_rpc_priv)
-			corpc_del_child_rpc_locked(parent_rpc_priv,
-						   child_rpc_priv);
-	} else {
-		D_ASSERT(wait_num > co_info->co_child_ack_num);
-		d_list_move_tail(&child_rpc_priv->crp_parent_link,
-				 &co_info->co_replied_rpcs);
-		D_DEBUG(DB_NET, "parent rpc %p, child rpc %p move to "
-			"replided rpcs.\n", parent_rpc_priv, child_rpc_priv);
-	}
-
-aggregate_done:
-	done_num = co_info->co_child_ack_num + co_info->co_child_failed_num;
-	D_ASSERT(wait_num >= done_num);
-	if (wait_num == done_num)
-		req_done = true;
 
-	D_SPIN_UNLOCK(&parent_rpc_priv->crp_lock);
+		/* another thread can take over once left drops to zero */
+		left = __atomic_sub_fetch(&co_info->co_agg_pending, num,
+					  __ATOMIC_ACQ_REL);
+		req_done = crt_corpc_done_add(parent_rpc_priv, ack_num);
+	} while (!req_done && left != 0);
 
 	if (req_done)
 		crt_corpc_complete(parent_rpc_priv);
@@ -908,14 +1560,15 @@ forward_done:
 	if (rpc_priv->crp_pub.cr_opc == CRT_OPC_RANK_EVICT) {
 		struct crt_cb_info cb_info = {};
 
-		D_SPIN_LOCK(&rpc_priv->crp_lock);
-		co_info->co_local_done = 1;
-		D_SPIN_UNLOCK(&rpc_priv->crp_lock);
+		__atomic_store_n(&co_info->co_local_done, 1, __ATOMIC_RELEASE);
 
 		cb_info.cci_rpc = &rpc_priv->crp_pub;
 		cb_info.cci_arg = rpc_priv;
 
 		crt_corpc_reply_hdlr(&cb_info);
+	} else if (co_info->co_pipe != NULL) {
+		/* the handler needs the whole bulk */
+		crt_corpc_pipe_local_ready(co_info->co_pipe);
 	} else {
 		rc = crt_rpc_common_hdlr(rpc_priv);
 		if (rc != 0)
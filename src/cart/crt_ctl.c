@@ -44,30 +44,29 @@
 
 #define MAX_HOSTNAME_SIZE 1024
 
-static int verify_ctl_in_args(struct crt_ctl_ep_ls_in *in_args)
+/* checks the CRT_ISEQ_CTL fields every ctl RPC input starts with */
+static int verify_ctl_grp_rank(crt_group_id_t grp_id, d_rank_t rank)
 {
 	struct crt_grp_priv	*grp_priv;
 	int			rc = 0;
 
-	if (in_args->cel_grp_id == NULL) {
+	if (grp_id == NULL) {
 		D_ERROR("invalid parameter, NULL input grp_id.\n");
 		D_GOTO(out, rc = -DER_INVAL);
 	}
-	if (crt_validate_grpid(in_args->cel_grp_id) != 0) {
+	if (crt_validate_grpid(grp_id) != 0) {
 		D_ERROR("srv_grpid contains invalid characters "
 			"or is too long\n");
 		D_GOTO(out, rc = -DER_INVAL);
 	}
 	grp_priv = crt_gdata.cg_grp->gg_srv_pri_grp;
 
-	if (!crt_grp_id_identical(in_args->cel_grp_id,
-				  grp_priv->gp_pub.cg_grpid)) {
-		D_ERROR("RPC request has wrong grp_id: %s\n",
-			in_args->cel_grp_id);
+	if (!crt_grp_id_identical(grp_id, grp_priv->gp_pub.cg_grpid)) {
+		D_ERROR("RPC request has wrong grp_id: %s\n", grp_id);
 		D_GOTO(out, rc = -DER_INVAL);
 	}
-	if (in_args->cel_rank != grp_priv->gp_self) {
-		D_ERROR("RPC request has wrong rank: %d\n", in_args->cel_rank);
+	if (rank != grp_priv->gp_self) {
+		D_ERROR("RPC request has wrong rank: %d\n", rank);
 		D_GOTO(out, rc = -DER_INVAL);
 	}
 
@@ -75,6 +74,11 @@ out:
 	return rc;
 }
 
+static int verify_ctl_in_args(struct crt_ctl_ep_ls_in *in_args)
+{
+	return verify_ctl_grp_rank(in_args->cel_grp_id, in_args->cel_rank);
+}
+
 void
 crt_hdlr_ctl_get_hostname(crt_rpc_t *rpc_req)
 {
@@ -207,3 +211,142 @@ out:
 	D_DEBUG(DB_TRACE, "sent reply to endpoint list request\n");
 	D_FREE(addr_buf);
 }
+
+void
+crt_hdlr_ctl_hg_pool(crt_rpc_t *rpc_req)
+{
+	struct crt_ctl_hg_pool_in	*in_args;
+	struct crt_ctl_hg_pool_out	*out_args;
+	struct crt_context		*ctx = NULL;
+	struct crt_hg_pool		*hg_pool;
+	uint64_t			*stats = NULL;
+	uint64_t			*cur;
+	int				 count = 0;
+	int				 rc = 0;
+
+	D_ASSERTF(crt_is_service(), "Must be called in a service process\n");
+	in_args = crt_req_get(rpc_req);
+	D_ASSERTF(in_args != NULL, "NULL input args\n");
+	out_args = crt_reply_get(rpc_req);
+	D_ASSERTF(out_args != NULL, "NULL output args\n");
+
+	rc = verify_ctl_grp_rank(in_args->cel_grp_id, in_args->cel_rank);
+	if (rc != 0)
+		D_GOTO(out, rc);
+
+	D_RWLOCK_RDLOCK(&crt_gdata.cg_rwlock);
+
+	D_ALLOC_ARRAY(stats, crt_gdata.cg_ctx_num * CRT_CTL_HGP_NR);
+	if (stats == NULL) {
+		D_RWLOCK_UNLOCK(&crt_gdata.cg_rwlock);
+		D_GOTO(out, rc = -DER_NOMEM);
+	}
+
+	cur = stats;
+	d_list_for_each_entry(ctx, &crt_gdata.cg_ctx_list, cc_link) {
+		if (in_args->chpi_max_num >= 0) {
+			rc = crt_hg_pool_resize(&ctx->cc_hg_ctx,
+						in_args->chpi_max_num);
+			if (rc != 0) {
+				D_ERROR("context (idx %d), crt_hg_pool_resize "
+					"failed rc: %d.\n", ctx->cc_idx, rc);
+				break;
+			}
+		}
+
+		hg_pool = &ctx->cc_hg_ctx.chc_hg_pool;
+		D_SPIN_LOCK(&hg_pool->chp_lock);
+		cur[CRT_CTL_HGP_MAX_NUM] = hg_pool->chp_max_num;
+		cur[CRT_CTL_HGP_NUM] = hg_pool->chp_num;
+		cur[CRT_CTL_HGP_AUTO] = hg_pool->chp_auto;
+		cur[CRT_CTL_HGP_INFLIGHT] = hg_pool->chp_inflight;
+		cur[CRT_CTL_HGP_HWM] = hg_pool->chp_hwm;
+		cur[CRT_CTL_HGP_HIT] = hg_pool->chp_hit;
+		cur[CRT_CTL_HGP_MISS] = hg_pool->chp_miss;
+		cur[CRT_CTL_HGP_DROP] = hg_pool->chp_drop;
+		D_SPIN_UNLOCK(&hg_pool->chp_lock);
+
+		cur += CRT_CTL_HGP_NR;
+		count++;
+	}
+
+	D_RWLOCK_UNLOCK(&crt_gdata.cg_rwlock);
+
+	out_args->chpo_ctx_num = count;
+	out_args->chpo_stats.ca_count = count * CRT_CTL_HGP_NR;
+	out_args->chpo_stats.ca_arrays = stats;
+
+out:
+	out_args->chpo_rc = rc;
+	rc = crt_reply_send(rpc_req);
+	if (rc != 0)
+		D_ERROR("crt_reply_send() failed with rc %d\n", rc);
+	D_FREE(stats);
+}
+
+void
+crt_hdlr_ctl_rpc_cache(crt_rpc_t *rpc_req)
+{
+	struct crt_ctl_rpc_cache_in	*in_args;
+	struct crt_ctl_rpc_cache_out	*out_args;
+	struct crt_context		*ctx = NULL;
+	struct crt_rpc_cache		*cache;
+	uint64_t			*stats = NULL;
+	uint64_t			*cur;
+	uint64_t			 num;
+	int				 count = 0;
+	int				 i;
+	int				 rc = 0;
+
+	D_ASSERTF(crt_is_service(), "Must be called in a service process\n");
+	in_args = crt_req_get(rpc_req);
+	D_ASSERTF(in_args != NULL, "NULL input args\n");
+	out_args = crt_reply_get(rpc_req);
+	D_ASSERTF(out_args != NULL, "NULL output args\n");
+
+	rc = verify_ctl_grp_rank(in_args->cel_grp_id, in_args->cel_rank);
+	if (rc != 0)
+		D_GOTO(out, rc);
+
+	D_RWLOCK_RDLOCK(&crt_gdata.cg_rwlock);
+
+	D_ALLOC_ARRAY(stats, crt_gdata.cg_ctx_num * CRT_CTL_RPCC_NR);
+	if (stats == NULL) {
+		D_RWLOCK_UNLOCK(&crt_gdata.cg_rwlock);
+		D_GOTO(out, rc = -DER_NOMEM);
+	}
+
+	cur = stats;
+	d_list_for_each_entry(ctx, &crt_gdata.cg_ctx_list, cc_link) {
+		cache = ctx->cc_rpc_cache;
+		num = 0;
+		D_SPIN_LOCK(&cache->crc_lock);
+		for (i = 0; i < CRT_RPC_CACHE_CLASS_NUM; i++)
+			num += cache->crc_free_num[i];
+		cur[CRT_CTL_RPCC_MAX_NUM] = cache->crc_max_num;
+		cur[CRT_CTL_RPCC_NUM] = num;
+		/* minus the reference of the context */
+		cur[CRT_CTL_RPCC_INUSE] = cache->crc_ref - 1;
+		cur[CRT_CTL_RPCC_HIT] = cache->crc_hit;
+		cur[CRT_CTL_RPCC_MISS] = cache->crc_miss;
+		cur[CRT_CTL_RPCC_RECYCLED] = cache->crc_recycled;
+		cur[CRT_CTL_RPCC_RELEASED] = cache->crc_released;
+		D_SPIN_UNLOCK(&cache->crc_lock);
+
+		cur += CRT_CTL_RPCC_NR;
+		count++;
+	}
+
+	D_RWLOCK_UNLOCK(&crt_gdata.cg_rwlock);
+
+	out_args->crco_ctx_num = count;
+	out_args->crco_stats.ca_count = count * CRT_CTL_RPCC_NR;
+	out_args->crco_stats.ca_arrays = stats;
+
+out:
+	out_args->crco_rc = rc;
+	rc = crt_reply_send(rpc_req);
+	if (rc != 0)
+		D_ERROR("crt_reply_send() failed with rc %d\n", rc);
+	D_FREE(stats);
+}
@@ -45,5 +45,32 @@
 void crt_hdlr_ctl_ls(crt_rpc_t *rpc_req);
 void crt_hdlr_ctl_get_hostname(crt_rpc_t *rpc_req);
 void crt_hdlr_ctl_get_pid(crt_rpc_t *rpc_req);
+void crt_hdlr_ctl_hg_pool(crt_rpc_t *rpc_req);
+void crt_hdlr_ctl_rpc_cache(crt_rpc_t *rpc_req);
+
+/* per context counters in crt_ctl_hg_pool_out::chpo_stats */
+enum crt_ctl_hg_pool_stat {
+	CRT_CTL_HGP_MAX_NUM,	/* max number of handles in pool */
+	CRT_CTL_HGP_NUM,	/* handles currently in pool */
+	CRT_CTL_HGP_AUTO,	/* 1 if sized by the workload */
+	CRT_CTL_HGP_INFLIGHT,	/* requests currently in flight */
+	CRT_CTL_HGP_HWM,	/* high-water mark of requests in flight */
+	CRT_CTL_HGP_HIT,	/* handles got from pool */
+	CRT_CTL_HGP_MISS,	/* handles created as pool was empty */
+	CRT_CTL_HGP_DROP,	/* handles destroyed as pool was full */
+	CRT_CTL_HGP_NR,
+};
+
+/* per context counters in crt_ctl_rpc_cache_out::crco_stats */
+enum crt_ctl_rpc_cache_stat {
+	CRT_CTL_RPCC_MAX_NUM,	/* max cached descriptors per size class */
+	CRT_CTL_RPCC_NUM,	/* descriptors currently cached */
+	CRT_CTL_RPCC_INUSE,	/* descriptors from the cache in use */
+	CRT_CTL_RPCC_HIT,	/* allocations served from the cache */
+	CRT_CTL_RPCC_MISS,	/* allocations which fell back to D_ALLOC */
+	CRT_CTL_RPCC_RECYCLED,	/* descriptors put back to the cache */
+	CRT_CTL_RPCC_RELEASED,	/* descriptors freed as the cache was full */
+	CRT_CTL_RPCC_NR,
+};
 
 #endif /* __CRT_CTL_H__ */
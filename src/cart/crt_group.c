@@ -42,118 +42,325 @@
 
 #include "crt_internal.h"
 #include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
 
 /* global CRT group list */
 D_LIST_HEAD(crt_grp_list);
 /* protect global group list */
 pthread_rwlock_t crt_grp_list_rwlock = PTHREAD_RWLOCK_INITIALIZER;
 
+/*
+ * the block is freed with the cache, a reader may still walk it. See
+ * crt_lookup_retired for the bound on the retired blocks.
+ */
+static void
+crt_grp_lc_retire(struct crt_lookup_cache *lc, struct crt_lookup_retired *lr)
+{
+	D_SPIN_LOCK(&lc->lc_lock);
+	lr->lr_next = lc->lc_retired;
+	lc->lc_retired = lr;
+	D_SPIN_UNLOCK(&lc->lc_lock);
+}
+
 static void
 crt_li_destroy(struct crt_lookup_item *li)
 {
-	int	i;
+	struct crt_lookup_tags	*tags = li->li_tags;
+	struct crt_lookup_tag	*lt;
+	int			 i;
+	int			 j;
 
 	D_ASSERT(li != NULL);
-	D_ASSERT(li->li_ref == 0);
-	D_ASSERT(li->li_initialized == 1);
-
-	D_FREE(li->li_base_phy_addr);
 
-	for (i = 0; i < CRT_SRV_CONTEXT_NUM; i++) {
-		if (li->li_tag_addr[i] != NULL)
-			D_ERROR("tag %d, li_tag_addr not freed.\n", i);
-
-		if (li->li_uri[i])
-			D_FREE(li->li_uri[i]);
-	}
+	for (i = 0; tags != NULL && i < tags->lts_num; i++) {
+		lt = &tags->lts_tag[i];
+		for (j = 0; lt->lt_addrs != NULL && j < lt->lt_addrs->la_num;
+		     j++)
+			if (lt->lt_addrs->la_addr[j] != NULL)
+				D_ERROR("tag %d, ctx_idx %d, hg addr not "
+					"freed.\n", lt->lt_tag, j);
+		D_FREE(lt->lt_addrs);
+		D_FREE(lt->lt_uri);
+	}
+	D_FREE(li->li_tags);
+	for (i = 0; i < li->li_old_nr; i++)
+		D_FREE(li->li_old_uris[i]);
+	D_FREE(li->li_old_uris);
 
 	D_MUTEX_DESTROY(&li->li_mutex);
 
 	D_FREE_PTR(li);
 }
 
-struct crt_lookup_item *
-crt_li_link2ptr(d_list_t *rlink)
+static struct crt_lookup_item *
+crt_li_create(struct crt_grp_priv *grp_priv, d_rank_t rank)
 {
-	D_ASSERT(rlink != NULL);
-	return container_of(rlink, struct crt_lookup_item, li_link);
+	struct crt_lookup_item	*li;
+	int			 rc;
+
+	D_ALLOC_PTR(li);
+	if (li == NULL)
+		return NULL;
+
+	rc = D_MUTEX_INIT(&li->li_mutex, NULL);
+	if (rc != 0) {
+		D_FREE_PTR(li);
+		return NULL;
+	}
+	D_INIT_LIST_HEAD(&li->li_link);
+	li->li_grp_priv = grp_priv;
+	li->li_rank = rank;
+
+	return li;
 }
 
-static int
-li_op_key_get(struct d_hash_table *hhtab, d_list_t *rlink, void **key_pp)
+/*
+ * returns a copy of uri for a tag of li, taken back from li_old_uris if the
+ * rank had it before, li_mutex held
+ */
+static char *
+crt_li_uri_get(struct crt_lookup_item *li, const char *uri)
 {
-	struct crt_lookup_item *li = crt_li_link2ptr(rlink);
+	char		*new_uri;
+	uint32_t	 i;
 
-	*key_pp = (void *)&li->li_rank;
-	return sizeof(li->li_rank);
+	for (i = 0; i < li->li_old_nr; i++) {
+		if (strncmp(li->li_old_uris[i], uri, CRT_ADDR_STR_MAX_LEN))
+			continue;
+		new_uri = li->li_old_uris[i];
+		li->li_old_uris[i] = li->li_old_uris[--li->li_old_nr];
+		return new_uri;
+	}
+
+	D_STRNDUP(new_uri, uri, CRT_ADDR_STR_MAX_LEN);
+	return new_uri;
 }
 
-static uint32_t
-li_op_key_hash(struct d_hash_table *hhtab, const void *key, unsigned int ksize)
+/*
+ * moves the URI of lt to li_old_uris, a reader may still use it, li_mutex
+ * held
+ */
+static void
+crt_li_uri_drop(struct crt_lookup_item *li, struct crt_lookup_tag *lt)
 {
-	D_ASSERT(ksize == sizeof(d_rank_t));
+	char		**old_uris;
+	uint32_t	  nr = li->li_old_nr + 1;
+
+	if (lt->lt_uri == NULL)
+		return;
 
-	return (unsigned int)(*(const uint32_t *)key %
-		(1U << CRT_LOOKUP_CACHE_BITS));
+	D_REALLOC_ARRAY(old_uris, li->li_old_uris, nr);
+	if (old_uris == NULL) {
+		/* can not be freed either, leave it to the lookups */
+		D_ERROR("rank %d tag %d, URI not dropped.\n", li->li_rank,
+			lt->lt_tag);
+		return;
+	}
+	old_uris[li->li_old_nr++] = lt->lt_uri;
+	li->li_old_uris = old_uris;
+	__atomic_store_n(&lt->lt_uri, NULL, __ATOMIC_RELEASE);
 }
 
-static bool
-li_op_key_cmp(struct d_hash_table *hhtab, d_list_t *rlink,
-	      const void *key, unsigned int ksize)
+/* returns the tag entry of li, NULL if it has none, lockless, linear scan */
+static struct crt_lookup_tag *
+crt_li_tag_find(struct crt_lookup_item *li, uint32_t tag)
 {
-	struct crt_lookup_item *li = crt_li_link2ptr(rlink);
+	struct crt_lookup_tags	*tags;
+	uint32_t		 num;
+	int			 i;
+
+	tags = __atomic_load_n(&li->li_tags, __ATOMIC_ACQUIRE);
+	if (tags == NULL)
+		return NULL;
 
-	D_ASSERT(ksize == sizeof(d_rank_t));
+	num = __atomic_load_n(&tags->lts_num, __ATOMIC_ACQUIRE);
+	for (i = 0; i < num; i++)
+		if (tags->lts_tag[i].lt_tag == tag)
+			return &tags->lts_tag[i];
 
-	return li->li_rank == *(d_rank_t *)key;
+	return NULL;
 }
 
-static void
-li_op_rec_addref(struct d_hash_table *hhtab, d_list_t *rlink)
+/* returns the tag entry of li, adds it if missing, li_mutex held */
+static struct crt_lookup_tag *
+crt_li_tag_get(struct crt_lookup_item *li, uint32_t tag)
 {
-	struct crt_lookup_item *li = crt_li_link2ptr(rlink);
+	struct crt_lookup_tags	*tags = li->li_tags;
+	struct crt_lookup_tags	*new_tags = NULL;
+	struct crt_lookup_tag	*lt;
+	uint32_t		 cap;
+
+	lt = crt_li_tag_find(li, tag);
+	if (lt != NULL)
+		return lt;
+
+	if (tags == NULL || tags->lts_num == tags->lts_cap) {
+		cap = tags == NULL ? 1 : tags->lts_cap * 2;
+		D_ALLOC(new_tags, sizeof(*new_tags) + cap * sizeof(*lt));
+		if (new_tags == NULL)
+			return NULL;
+		new_tags->lts_cap = cap;
+		if (tags != NULL) {
+			memcpy(new_tags->lts_tag, tags->lts_tag,
+			       tags->lts_num * sizeof(*lt));
+			new_tags->lts_num = tags->lts_num;
+		}
+	}
 
-	D_ASSERT(li->li_initialized);
-	D_MUTEX_LOCK(&li->li_mutex);
-	li->li_ref++;
-	D_MUTEX_UNLOCK(&li->li_mutex);
+	lt = new_tags == NULL ? &tags->lts_tag[tags->lts_num] :
+				&new_tags->lts_tag[new_tags->lts_num];
+	lt->lt_tag = tag;
+	lt->lt_uri = NULL;
+	lt->lt_addrs = NULL;
+
+	if (new_tags == NULL) {
+		__atomic_store_n(&tags->lts_num, tags->lts_num + 1,
+				 __ATOMIC_RELEASE);
+	} else {
+		new_tags->lts_num++;
+		__atomic_store_n(&li->li_tags, new_tags, __ATOMIC_RELEASE);
+		if (tags != NULL)
+			crt_grp_lc_retire(li->li_grp_priv->gp_lookup_cache,
+					  &tags->lts_retired);
+	}
+
+	return lt;
 }
 
-static bool
-li_op_rec_decref(struct d_hash_table *hhtab, d_list_t *rlink)
+/* returns the HG addr slot of ctx_idx in lt, grows it if needed */
+static hg_addr_t *
+crt_lt_addr_get(struct crt_lookup_item *li, struct crt_lookup_tag *lt,
+		int ctx_idx)
 {
-	uint32_t			 ref;
-	struct crt_lookup_item		*li = crt_li_link2ptr(rlink);
+	struct crt_lookup_addrs	*addrs = lt->lt_addrs;
+	struct crt_lookup_addrs	*new_addrs;
+	uint32_t		 num;
 
-	D_ASSERT(li->li_initialized);
-	D_MUTEX_LOCK(&li->li_mutex);
-	li->li_ref--;
-	ref = li->li_ref;
-	D_MUTEX_UNLOCK(&li->li_mutex);
+	if (addrs != NULL && ctx_idx < addrs->la_num)
+		return &addrs->la_addr[ctx_idx];
+
+	/* sized by the contexts in use, not by CRT_SRV_CONTEXT_NUM */
+	num = max(ctx_idx + 1, crt_gdata.cg_ctx_num);
+	D_ALLOC(new_addrs, sizeof(*new_addrs) + num * sizeof(hg_addr_t));
+	if (new_addrs == NULL)
+		return NULL;
+	new_addrs->la_num = num;
+	if (addrs != NULL)
+		memcpy(new_addrs->la_addr, addrs->la_addr,
+		       addrs->la_num * sizeof(hg_addr_t));
+
+	__atomic_store_n(&lt->lt_addrs, new_addrs, __ATOMIC_RELEASE);
+	if (addrs != NULL)
+		crt_grp_lc_retire(li->li_grp_priv->gp_lookup_cache,
+				  &addrs->la_retired);
 
-	return ref == 0;
+	return &new_addrs->la_addr[ctx_idx];
 }
 
-static void
-li_op_rec_free(struct d_hash_table *hhtab, d_list_t *rlink)
+/* returns the item of rank, NULL if not cached, lockless */
+static struct crt_lookup_item *
+crt_grp_lc_find(struct crt_grp_priv *grp_priv, d_rank_t rank)
 {
-	crt_li_destroy(crt_li_link2ptr(rlink));
+	struct crt_lookup_dir	 *dir;
+	struct crt_lookup_item	**page;
+	uint32_t		  page_idx = rank >> CRT_LOOKUP_CACHE_PAGE_BITS;
+
+	dir = __atomic_load_n(&grp_priv->gp_lookup_cache->lc_dir,
+			      __ATOMIC_ACQUIRE);
+	if (dir == NULL || page_idx >= dir->ld_num)
+		return NULL;
+	page = __atomic_load_n(&dir->ld_pages[page_idx], __ATOMIC_ACQUIRE);
+	if (page == NULL)
+		return NULL;
+
+	return __atomic_load_n(&page[rank & (CRT_LOOKUP_CACHE_PAGE_SIZE - 1)],
+			       __ATOMIC_ACQUIRE);
 }
 
-static d_hash_table_ops_t lookup_table_ops = {
-	.hop_key_get		= li_op_key_get,
-	.hop_key_hash		= li_op_key_hash,
-	.hop_key_cmp		= li_op_key_cmp,
-	.hop_rec_addref		= li_op_rec_addref,
-	.hop_rec_decref		= li_op_rec_decref,
-	.hop_rec_free		= li_op_rec_free,
-};
+/* takes the removed item of rank off lc_removed, gp_rwlock held for write */
+static struct crt_lookup_item *
+crt_grp_lc_reuse(struct crt_lookup_cache *lc, d_rank_t rank)
+{
+	struct crt_lookup_item	*li;
+
+	d_list_for_each_entry(li, &lc->lc_removed, li_link) {
+		if (li->li_rank != rank)
+			continue;
+		d_list_del_init(&li->li_link);
+		__atomic_store_n(&li->li_evicted, 0, __ATOMIC_RELEASE);
+		return li;
+	}
+
+	return NULL;
+}
+
+/*
+ * returns the item of rank in *li_p, creates it if not cached, gp_rwlock
+ * held for write.
+ */
+static int
+crt_grp_lc_get(struct crt_grp_priv *grp_priv, d_rank_t rank,
+	       struct crt_lookup_item **li_p)
+{
+	struct crt_lookup_cache	 *lc = grp_priv->gp_lookup_cache;
+	struct crt_lookup_dir	 *dir = lc->lc_dir;
+	struct crt_lookup_dir	 *new_dir;
+	struct crt_lookup_item	**page;
+	struct crt_lookup_item	 *li;
+	uint32_t		  page_idx = rank >> CRT_LOOKUP_CACHE_PAGE_BITS;
+	uint32_t		  num;
+
+	li = crt_grp_lc_find(grp_priv, rank);
+	if (li != NULL)
+		D_GOTO(out, 0);
+
+	if (dir == NULL || page_idx >= dir->ld_num) {
+		num = max(page_idx + 1, dir == NULL ? 1 : dir->ld_num * 2);
+		D_ALLOC(new_dir, sizeof(*new_dir) + num * sizeof(page));
+		if (new_dir == NULL)
+			return -DER_NOMEM;
+		new_dir->ld_num = num;
+		if (dir != NULL)
+			memcpy(new_dir->ld_pages, dir->ld_pages,
+			       dir->ld_num * sizeof(page));
+		__atomic_store_n(&lc->lc_dir, new_dir, __ATOMIC_RELEASE);
+		if (dir != NULL)
+			crt_grp_lc_retire(lc, &dir->ld_retired);
+		dir = new_dir;
+	}
+
+	page = dir->ld_pages[page_idx];
+	if (page == NULL) {
+		D_ALLOC_ARRAY(page, CRT_LOOKUP_CACHE_PAGE_SIZE);
+		if (page == NULL)
+			return -DER_NOMEM;
+		__atomic_store_n(&dir->ld_pages[page_idx], page,
+				 __ATOMIC_RELEASE);
+	}
+
+	/* no new item nor blocks for a rank added back */
+	li = crt_grp_lc_reuse(lc, rank);
+	if (li == NULL)
+		li = crt_li_create(grp_priv, rank);
+	if (li == NULL)
+		return -DER_NOMEM;
+	__atomic_store_n(&page[rank & (CRT_LOOKUP_CACHE_PAGE_SIZE - 1)], li,
+			 __ATOMIC_RELEASE);
+	lc->lc_item_num++;
+	D_DEBUG(DB_TRACE, "Inserted lookup table entry, grp_priv %p, "
+		"rank: %d, li %p.\n", grp_priv, rank, li);
+
+out:
+	*li_p = li;
+	return 0;
+}
 
 static int
 crt_grp_lc_create(struct crt_grp_priv *grp_priv)
 {
-	struct d_hash_table	*htables;
-	int			  rc = 0, rc2, i, j;
+	struct crt_lookup_cache	*lc;
+	int			 rc = 0;
 
 	D_ASSERT(grp_priv != NULL);
 	if (grp_priv->gp_primary == 0) {
@@ -161,29 +368,18 @@ crt_grp_lc_create(struct crt_grp_priv *grp_priv)
 		D_GOTO(out, rc = -DER_NO_PERM);
 	}
 
-	D_ALLOC_ARRAY(htables, CRT_SRV_CONTEXT_NUM);
-	if (htables == NULL)
+	D_ALLOC_PTR(lc);
+	if (lc == NULL)
 		D_GOTO(out, rc = -DER_NOMEM);
 
-	for (i = 0; i < CRT_SRV_CONTEXT_NUM; i++) {
-		rc = d_hash_table_create_inplace(D_HASH_FT_NOLOCK,
-						 CRT_LOOKUP_CACHE_BITS,
-						 NULL, &lookup_table_ops, &htables[i]);
-		if (rc != 0) {
-			D_ERROR("d_hash_table_create failed, rc: %d.\n", rc);
-			D_GOTO(free_htables, rc);
-		}
+	rc = D_SPIN_INIT(&lc->lc_lock, PTHREAD_PROCESS_PRIVATE);
+	if (rc != 0) {
+		D_FREE_PTR(lc);
+		D_GOTO(out, rc);
 	}
-	grp_priv->gp_lookup_cache = htables;
-	return 0;
+	D_INIT_LIST_HEAD(&lc->lc_removed);
 
-free_htables:
-	for (j = 0; j < i; j++) {
-		rc2 = d_hash_table_destroy_inplace(&htables[j], true /* force */);
-		if (rc2 != 0)
-			D_ERROR("d_hash_table_destroy failed, rc: %d.\n", rc2);
-	}
-	D_FREE(htables);
+	grp_priv->gp_lookup_cache = lc;
 
 out:
 	if (rc != 0)
@@ -195,171 +391,167 @@ out:
 static int
 crt_grp_lc_destroy(struct crt_grp_priv *grp_priv)
 {
-	int	rc = 0, rc2, i;
+	struct crt_lookup_cache		*lc;
+	struct crt_lookup_dir		*dir;
+	struct crt_lookup_item		*li;
+	struct crt_lookup_retired	*lr;
+	int				 i;
+	int				 j;
 
 	D_ASSERT(grp_priv != NULL);
 
-	if (grp_priv->gp_lookup_cache == NULL)
+	lc = grp_priv->gp_lookup_cache;
+	if (lc == NULL)
 		return 0;
 
-	for (i = 0; i < CRT_SRV_CONTEXT_NUM; i++) {
-		rc2 = d_hash_table_destroy_inplace(&grp_priv->gp_lookup_cache[i],
-						   true /* force */);
-		if (rc2 != 0) {
-			D_ERROR("d_hash_table_destroy failed, rc: %d.\n", rc2);
-			rc = rc ? rc : rc2;
-		}
+	dir = lc->lc_dir;
+	for (i = 0; dir != NULL && i < dir->ld_num; i++) {
+		if (dir->ld_pages[i] == NULL)
+			continue;
+		for (j = 0; j < CRT_LOOKUP_CACHE_PAGE_SIZE; j++)
+			if (dir->ld_pages[i][j] != NULL)
+				crt_li_destroy(dir->ld_pages[i][j]);
+		D_FREE(dir->ld_pages[i]);
 	}
-	D_FREE(grp_priv->gp_lookup_cache);
+	D_FREE(lc->lc_dir);
 
-	return rc;
+	while ((li = d_list_pop_entry(&lc->lc_removed,
+				      struct crt_lookup_item, li_link)))
+		crt_li_destroy(li);
+
+	while ((lr = lc->lc_retired) != NULL) {
+		lc->lc_retired = lr->lr_next;
+		/* lr is the first member of each retired block */
+		D_FREE(lr);
+	}
+
+	D_SPIN_DESTROY(&lc->lc_lock);
+	D_FREE_PTR(lc);
+	grp_priv->gp_lookup_cache = NULL;
+
+	return 0;
 }
 
 
 static void
-crt_grp_lc_uri_remove(struct crt_grp_priv *grp_priv, int ctx_idx,
-		d_rank_t rank)
+crt_grp_lc_uri_remove(struct crt_grp_priv *grp_priv, d_rank_t rank)
 {
-	d_list_t		*rlink;
+	struct crt_lookup_cache	*lc = grp_priv->gp_lookup_cache;
 	struct crt_lookup_item	*li;
-	int i;
+	struct crt_lookup_tags	*tags;
+	struct crt_lookup_tag	*lt;
+	struct crt_context	*ctx;
+	uint32_t		 page_idx = rank >> CRT_LOOKUP_CACHE_PAGE_BITS;
+	int			 i;
+	int			 j;
+	int			 rc;
 
-	rlink = d_hash_rec_find(&grp_priv->gp_lookup_cache[ctx_idx],
-				&rank, sizeof(rank));
-	if (rlink == NULL) {
-		D_ERROR("Record for rank %d is not found\n", rank);
+	D_RWLOCK_WRLOCK(&grp_priv->gp_rwlock);
+	li = crt_grp_lc_find(grp_priv, rank);
+	if (li == NULL) {
+		D_RWLOCK_UNLOCK(&grp_priv->gp_rwlock);
+		/* never looked up, or removed by an earlier group change */
+		D_DEBUG(DB_TRACE, "Record for rank %d is not found\n", rank);
 		return;
 	}
+	__atomic_store_n(&lc->lc_dir->ld_pages[page_idx]
+			 [rank & (CRT_LOOKUP_CACHE_PAGE_SIZE - 1)], NULL,
+			 __ATOMIC_RELEASE);
+	lc->lc_item_num--;
+	/* a reader may still hold it, reused if the rank is added back */
+	d_list_add(&li->li_link, &lc->lc_removed);
 
-	li = crt_li_link2ptr(rlink);
-	D_FREE(li->li_base_phy_addr);
-
-	for (i = 0; i < CRT_SRV_CONTEXT_NUM; i++) {
-		if (li->li_tag_addr[i])
-			D_FREE(li->li_tag_addr[i]);
-
-		if (li->li_uri[i])
-			D_FREE(li->li_uri[i]);
+	/* cleared before crt_grp_lc_get() can reuse it */
+	D_MUTEX_LOCK(&li->li_mutex);
+	tags = li->li_tags;
+	for (i = 0; tags != NULL && i < tags->lts_num; i++) {
+		lt = &tags->lts_tag[i];
+		for (j = 0; lt->lt_addrs != NULL && j < lt->lt_addrs->la_num;
+		     j++) {
+			if (lt->lt_addrs->la_addr[j] == NULL)
+				continue;
+			ctx = crt_context_lookup(j);
+			if (ctx != NULL) {
+				rc = crt_hg_addr_free(&ctx->cc_hg_ctx,
+						      lt->lt_addrs->la_addr[j]);
+				if (rc != 0)
+					D_ERROR("crt_hg_addr_free failed, "
+						"ctx_idx %d, tag %d, rc: %d.\n",
+						j, lt->lt_tag, rc);
+			}
+			lt->lt_addrs->la_addr[j] = NULL;
+		}
+		crt_li_uri_drop(li, lt);
 	}
-
-	d_hash_rec_delete_at(&grp_priv->gp_lookup_cache[ctx_idx], rlink);
-	D_MUTEX_DESTROY(&li->li_mutex);
-	D_FREE(li);
-	return;
+	D_MUTEX_UNLOCK(&li->li_mutex);
+	D_RWLOCK_UNLOCK(&grp_priv->gp_rwlock);
 }
 
 /*
- * Fill in the base URI of rank in the lookup cache of the crt_ctx.
+ * Fill in the URI of (rank, tag) in the lookup cache, which is shared by all
+ * contexts.
  */
 int
-crt_grp_lc_uri_insert(struct crt_grp_priv *grp_priv, int ctx_idx,
-		      d_rank_t rank, uint32_t tag, const char *uri)
+crt_grp_lc_uri_insert(struct crt_grp_priv *grp_priv, d_rank_t rank,
+		      uint32_t tag, const char *uri)
 {
-	d_list_t		*rlink;
 	struct crt_lookup_item	*li;
+	struct crt_lookup_tag	*lt;
+	char			*new_uri;
 	int			 rc = 0;
 
-	D_ASSERT(ctx_idx >= 0 && ctx_idx < CRT_SRV_CONTEXT_NUM);
 	if (tag >= CRT_SRV_CONTEXT_NUM) {
 		D_ERROR("tag %d out of range [0, %d].\n",
 			tag, CRT_SRV_CONTEXT_NUM - 1);
 		return -DER_INVAL;
 	}
-	D_RWLOCK_RDLOCK(&grp_priv->gp_rwlock);
-	rlink = d_hash_rec_find(&grp_priv->gp_lookup_cache[ctx_idx],
-				(void *)&rank, sizeof(rank));
-	if (rlink == NULL) {
-		D_RWLOCK_UNLOCK(&grp_priv->gp_rwlock);
+	li = crt_grp_lc_find(grp_priv, rank);
+	if (li == NULL) {
 		/* target rank not in cache */
-		D_ALLOC_PTR(li);
-		if (li == NULL)
-			D_GOTO(out, rc = -DER_NOMEM);
-
-		rc = D_MUTEX_INIT(&li->li_mutex, NULL);
-		if (rc != 0)
-			D_GOTO(err_free_li, rc);
-
-		D_INIT_LIST_HEAD(&li->li_link);
-		li->li_grp_priv = grp_priv;
-		li->li_rank = rank;
-		D_STRNDUP(li->li_uri[tag], uri, CRT_ADDR_STR_MAX_LEN);
-		if (li->li_uri[tag] == NULL)
-			D_GOTO(err_destroy_mutex, rc = -DER_NOMEM);
-		if (tag == 0) {
-			D_STRNDUP(li->li_base_phy_addr, uri,
-				  CRT_ADDR_STR_MAX_LEN);
-			if (li->li_base_phy_addr == NULL)
-				D_GOTO(err_free_uri, rc = -DER_NOMEM);
-		}
-		li->li_initialized = 1;
-		li->li_evicted = 0;
-
 		D_RWLOCK_WRLOCK(&grp_priv->gp_rwlock);
-		rc = d_hash_rec_insert(&grp_priv->gp_lookup_cache[ctx_idx],
-				       &rank, sizeof(rank), &li->li_link,
-				       true /* exclusive */);
-		if (rc != 0) {
-			D_DEBUG(DB_TRACE, "entry already exists in lookup "
-				"table, grp_priv %p ctx_idx %d, rank: %d.\n",
-				grp_priv, ctx_idx, rank);
-			crt_li_destroy(li);
-			rc = 0;
-		} else {
-			D_DEBUG(DB_TRACE, "Filling in URI in lookup table. "
-				" grp_priv %p ctx_idx %d, rank: %d, rlink %p\n",
-				grp_priv, ctx_idx, rank, &li->li_link);
-		}
-		D_GOTO(unlock, rc);
+		rc = crt_grp_lc_get(grp_priv, rank, &li);
+		D_RWLOCK_UNLOCK(&grp_priv->gp_rwlock);
+		if (rc != 0)
+			D_GOTO(out, rc);
 	}
-	li = crt_li_link2ptr(rlink);
 	D_ASSERT(li->li_grp_priv == grp_priv);
 	D_ASSERT(li->li_rank == rank);
-	D_ASSERT(li->li_initialized != 0);
+
 	D_MUTEX_LOCK(&li->li_mutex);
-	if (li->li_uri[tag] == NULL) {
-		D_STRNDUP(li->li_uri[tag], uri, CRT_ADDR_STR_MAX_LEN);
-		if (li->li_uri[tag] == NULL)
-			rc = -DER_NOMEM;
-		if (rc == DER_SUCCESS && tag == 0) {
-			D_STRNDUP(li->li_base_phy_addr, uri,
-				  CRT_ADDR_STR_MAX_LEN);
-			if (li->li_base_phy_addr == NULL) {
-				D_FREE(li->li_uri[tag]);
-				rc = -DER_NOMEM;
-			}
-		}
+	lt = crt_li_tag_get(li, tag);
+	if (lt == NULL)
+		D_GOTO(unlock, rc = -DER_NOMEM);
+
+	if (lt->lt_uri == NULL) {
+		new_uri = crt_li_uri_get(li, uri);
+		if (new_uri == NULL)
+			D_GOTO(unlock, rc = -DER_NOMEM);
+		__atomic_store_n(&lt->lt_uri, new_uri, __ATOMIC_RELEASE);
 		D_DEBUG(DB_TRACE, "Filling in URI in lookup table. "
-			"grp_priv %p ctx_idx %d, rank: %d, tag: %u rlink %p\n",
-			grp_priv, ctx_idx, rank, tag, &li->li_link);
+			"grp_priv %p, rank: %d, tag: %u, li %p\n",
+			grp_priv, rank, tag, li);
+	} else if (strncmp(lt->lt_uri, uri, CRT_ADDR_STR_MAX_LEN) == 0) {
+		/* inserted already through another context */
+		D_DEBUG(DB_TRACE, "URI already in lookup table. "
+			"grp_priv %p, rank: %d, tag: %u, li %p\n",
+			grp_priv, rank, tag, li);
 	} else {
 		if (!CRT_PMIX_ENABLED()) {
-			D_ERROR("URI already exists. grp_priv %p ctx_idx %d, "
-				"tag: %u rank: %d, rlink %p\n", grp_priv,
-				ctx_idx, rank, tag, &li->li_link);
+			D_ERROR("URI already exists. grp_priv %p, "
+				"tag: %u rank: %d, li %p\n", grp_priv,
+				tag, rank, li);
 
 			D_GOTO(unlock, rc = -DER_EXIST);
 		}
 
-		D_WARN("URI already exists. grp_priv %p ctx_idx %d, "
-			"tag: %u rank: %d, rlink %p\n", grp_priv, ctx_idx, rank,
-			tag, &li->li_link);
+		D_WARN("URI already exists. grp_priv %p, "
+			"tag: %u rank: %d, li %p\n", grp_priv, tag, rank, li);
 	}
-	D_MUTEX_UNLOCK(&li->li_mutex);
-	d_hash_rec_decref(&grp_priv->gp_lookup_cache[ctx_idx], rlink);
 
 unlock:
-	D_RWLOCK_UNLOCK(&grp_priv->gp_rwlock);
+	D_MUTEX_UNLOCK(&li->li_mutex);
 out:
 	return rc;
-
-err_free_uri:
-	D_FREE(li->li_uri[tag]);
-err_destroy_mutex:
-	D_MUTEX_DESTROY(&li->li_mutex);
-err_free_li:
-	D_FREE(li);
-
-	return rc;
 }
 
 /**
@@ -371,81 +563,89 @@ crt_grp_lc_uri_insert_all(crt_group_t *grp, d_rank_t rank, int tag,
 			const char *uri)
 {
 	struct crt_grp_priv	*grp_priv;
-	int			 i;
 	int			 rc = 0;
 
 	grp_priv = crt_grp_pub2priv(grp);
 
-	for (i = 0; i < CRT_SRV_CONTEXT_NUM; i++) {
-		rc = crt_grp_lc_uri_insert(grp_priv, i, rank, tag, uri);
-		if (rc != 0) {
-			D_ERROR("crt_grp_lc_uri_insert(%p, %d, %d, %d, %s)"
-				" failed. rc: %d\n", grp_priv, i, rank, tag,
-				uri, rc);
-			return rc;
-		}
-	}
+	/* one cache is shared by all contexts */
+	rc = crt_grp_lc_uri_insert(grp_priv, rank, tag, uri);
+	if (rc != 0)
+		D_ERROR("crt_grp_lc_uri_insert(%p, %d, %d, %s) failed. "
+			"rc: %d\n", grp_priv, rank, tag, uri, rc);
 
 	return rc;
 }
 
-int
-crt_grp_lc_addr_invalid(d_list_t *rlink, void *arg)
+static int
+crt_grp_lc_addr_invalid(struct crt_lookup_item *li, struct crt_context *ctx)
 {
-	struct crt_lookup_item	*li;
-	struct crt_context	*ctx;
+	struct crt_lookup_tags	*tags;
+	struct crt_lookup_addrs	*addrs;
 	int			 i;
 	int			 rc = 0;
 
-	D_ASSERT(rlink != NULL);
-	D_ASSERT(arg != NULL);
-	li = crt_li_link2ptr(rlink);
-	ctx = (struct crt_context *)arg;
-
 	D_MUTEX_LOCK(&li->li_mutex);
-	for (i = 0; i < CRT_SRV_CONTEXT_NUM; i++) {
-		if (li->li_uri[i])
-			D_FREE(li->li_uri[i]);
-
-		if (li->li_tag_addr[i] == NULL)
+	tags = li->li_tags;
+	for (i = 0; tags != NULL && i < tags->lts_num; i++) {
+		addrs = tags->lts_tag[i].lt_addrs;
+		if (addrs == NULL || ctx->cc_idx >= addrs->la_num ||
+		    addrs->la_addr[ctx->cc_idx] == NULL)
 			continue;
-		rc = crt_hg_addr_free(&ctx->cc_hg_ctx, li->li_tag_addr[i]);
+		rc = crt_hg_addr_free(&ctx->cc_hg_ctx,
+				      addrs->la_addr[ctx->cc_idx]);
 		if (rc != 0) {
 			D_ERROR("crt_hg_addr_free failed, ctx_idx %d, tag %d, "
-				"rc: %d.\n", ctx->cc_idx, i, rc);
+				"rc: %d.\n", ctx->cc_idx,
+				tags->lts_tag[i].lt_tag, rc);
 			D_GOTO(out, rc);
 		}
-		li->li_tag_addr[i] = NULL;
+		__atomic_store_n(&addrs->la_addr[ctx->cc_idx], NULL,
+				 __ATOMIC_RELEASE);
 	}
 
-	D_FREE(li->li_base_phy_addr);
-
 out:
 	D_MUTEX_UNLOCK(&li->li_mutex);
 	return rc;
 }
 
 /*
- * Invalid all cached hg_addr in group of one context.
+ * Invalid all cached hg_addr in group of one context, the URIs are kept for
+ * the other contexts.
  * It should only be called by crt_context_destroy.
  */
 static int
 crt_grp_lc_ctx_invalid(struct crt_grp_priv *grp_priv, struct crt_context *ctx)
 {
-	int	 ctx_idx;
-	int	 rc = 0;
+	struct crt_lookup_dir	*dir;
+	int			 i;
+	int			 j;
+	int			 rc = 0;
 
 	D_ASSERT(grp_priv != NULL && grp_priv->gp_primary == 1);
 	D_ASSERT(ctx != NULL);
-	ctx_idx = ctx->cc_idx;
-	D_ASSERT(ctx_idx >= 0 && ctx_idx < CRT_SRV_CONTEXT_NUM);
+	D_ASSERT(ctx->cc_idx >= 0 && ctx->cc_idx < CRT_SRV_CONTEXT_NUM);
 
-	rc = d_hash_table_traverse(&grp_priv->gp_lookup_cache[ctx_idx],
-				   crt_grp_lc_addr_invalid, ctx);
-	if (rc != 0)
-		D_ERROR("d_hash_table_traverse failed, ctx_idx %d, rc: %d.\n",
-			ctx_idx, rc);
+	D_RWLOCK_RDLOCK(&grp_priv->gp_rwlock);
+	dir = grp_priv->gp_lookup_cache == NULL ? NULL :
+	      grp_priv->gp_lookup_cache->lc_dir;
+	for (i = 0; dir != NULL && i < dir->ld_num; i++) {
+		if (dir->ld_pages[i] == NULL)
+			continue;
+		for (j = 0; j < CRT_LOOKUP_CACHE_PAGE_SIZE; j++) {
+			if (dir->ld_pages[i][j] == NULL)
+				continue;
+			rc = crt_grp_lc_addr_invalid(dir->ld_pages[i][j], ctx);
+			if (rc != 0) {
+				D_ERROR("crt_grp_lc_addr_invalid failed, "
+					"ctx_idx %d, rc: %d.\n",
+					ctx->cc_idx, rc);
+				D_GOTO(out, rc);
+			}
+		}
+	}
 
+out:
+	D_RWLOCK_UNLOCK(&grp_priv->gp_rwlock);
 	return rc;
 }
 
@@ -495,17 +695,16 @@ out:
 }
 
 /*
- * Fill in the hg address  of a tag in the lookup cache of crt_ctx. The host
- * rank where the tag resides in must exist in the cache before calling this
- * routine.
+ * Fill in the hg address  of a tag in the lookup cache of crt_ctx.
  */
 int
 crt_grp_lc_addr_insert(struct crt_grp_priv *grp_priv,
 		       struct crt_context *crt_ctx,
 		       d_rank_t rank, uint32_t tag, hg_addr_t *hg_addr)
 {
-	d_list_t		*rlink;
 	struct crt_lookup_item	*li;
+	struct crt_lookup_tag	*lt;
+	hg_addr_t		*addr;
 	int			 ctx_idx;
 	int			 rc = 0;
 
@@ -515,36 +714,43 @@ crt_grp_lc_addr_insert(struct crt_grp_priv *grp_priv,
 		tag = 0;
 
 	ctx_idx = crt_ctx->cc_idx;
-	D_RWLOCK_RDLOCK(&grp_priv->gp_rwlock);
-	rlink = d_hash_rec_find(&grp_priv->gp_lookup_cache[ctx_idx],
-				(void *)&rank, sizeof(rank));
-	D_ASSERT(rlink != NULL);
-	li = crt_li_link2ptr(rlink);
+	li = crt_grp_lc_find(grp_priv, rank);
+	if (li == NULL) {
+		D_RWLOCK_WRLOCK(&grp_priv->gp_rwlock);
+		rc = crt_grp_lc_get(grp_priv, rank, &li);
+		D_RWLOCK_UNLOCK(&grp_priv->gp_rwlock);
+		if (rc != 0)
+			return rc;
+	}
 	D_ASSERT(li->li_grp_priv == grp_priv);
 	D_ASSERT(li->li_rank == rank);
-	D_ASSERT(li->li_initialized != 0);
 
 	D_MUTEX_LOCK(&li->li_mutex);
 	if (li->li_evicted == 1)
 		rc = -DER_EVICTED;
-	if (li->li_tag_addr[tag] == NULL) {
-		li->li_tag_addr[tag] = *hg_addr;
+	lt = crt_li_tag_get(li, tag);
+	addr = lt == NULL ? NULL : crt_lt_addr_get(li, lt, ctx_idx);
+	if (addr == NULL) {
+		D_ERROR("failed to cache NA address, grp_priv %p ctx_idx %d, "
+			"rank: %d, tag %d.\n", grp_priv, ctx_idx, rank, tag);
+		D_GOTO(out, rc = -DER_NOMEM);
+	}
+	if (*addr == NULL) {
+		__atomic_store_n(addr, *hg_addr, __ATOMIC_RELEASE);
 	} else {
 		D_WARN("NA address already exits. "
-		       " grp_priv %p ctx_idx %d, rank: %d, tag %d, rlink %p\n",
-		       grp_priv, ctx_idx, rank, tag, &li->li_link);
+		       " grp_priv %p ctx_idx %d, rank: %d, tag %d, li %p\n",
+		       grp_priv, ctx_idx, rank, tag, li);
 		rc = crt_hg_addr_free(&crt_ctx->cc_hg_ctx, *hg_addr);
 		if (rc != 0) {
 			D_ERROR("crt_hg_addr_free failed, crt_idx %d, *hg_addr"
 				" 0x%p, rc %d\n", ctx_idx, *hg_addr, rc);
 			D_GOTO(out, rc);
 		}
-		*hg_addr = li->li_tag_addr[tag];
+		*hg_addr = *addr;
 	}
 out:
 	D_MUTEX_UNLOCK(&li->li_mutex);
-	D_RWLOCK_UNLOCK(&grp_priv->gp_rwlock);
-	d_hash_rec_decref(&grp_priv->gp_lookup_cache[ctx_idx], rlink);
 
 	return rc;
 }
@@ -552,11 +758,13 @@ out:
 /*
  * Lookup the URI and NA address of a (rank, tag) combination in the addr cache.
  * This function only looks into the address cache. If the requested (rank, tag)
- * pair doesn't exist in the address cache, *hg_addr will be NULL on return, and
- * an empty record for the requested rank with NULL values will be inserted to
- * the cache. For input parameters, base_addr and hg_addr can not be both NULL.
+ * pair doesn't exist in the address cache, *hg_addr will be NULL on return.
+ * For input parameters, base_addr and hg_addr can not be both NULL.
  * (hg_addr == NULL) means the caller only want to lookup the base_addr.
  * (base_addr == NULL) means the caller only want to lookup the hg_addr.
+ *
+ * It takes no lock, so it can miss an entry being added concurrently, in
+ * which case the caller resolves it again and the insert finds it.
  */
 int
 crt_grp_lc_lookup(struct crt_grp_priv *grp_priv, int ctx_idx,
@@ -564,8 +772,10 @@ crt_grp_lc_lookup(struct crt_grp_priv *grp_priv, int ctx_idx,
 		  crt_phy_addr_t *uri, hg_addr_t *hg_addr)
 {
 	struct crt_lookup_item	*li;
-	d_list_t		*rlink;
+	struct crt_lookup_tag	*lt;
+	struct crt_lookup_addrs	*addrs = NULL;
 	struct crt_grp_priv	*default_grp_priv;
+	hg_addr_t		 addr = NULL;
 	int			 rc = 0;
 
 	D_ASSERT(grp_priv != NULL);
@@ -587,71 +797,36 @@ crt_grp_lc_lookup(struct crt_grp_priv *grp_priv, int ctx_idx,
 		rank = grp_priv_get_primary_rank(grp_priv, rank);
 	}
 
-	D_RWLOCK_RDLOCK(&default_grp_priv->gp_rwlock);
-	rlink = d_hash_rec_find(&default_grp_priv->gp_lookup_cache[ctx_idx],
-				(void *)&rank, sizeof(rank));
-	if (rlink != NULL) {
-		li = crt_li_link2ptr(rlink);
-		D_ASSERT(li->li_grp_priv == default_grp_priv);
-		D_ASSERT(li->li_rank == rank);
-		D_ASSERT(li->li_initialized != 0);
-
-		D_MUTEX_LOCK(&li->li_mutex);
-		if (li->li_evicted == 1) {
-			D_MUTEX_UNLOCK(&li->li_mutex);
-			D_RWLOCK_UNLOCK(&default_grp_priv->gp_rwlock);
-			d_hash_rec_decref(&default_grp_priv->gp_lookup_cache[ctx_idx],
-					  rlink);
-			D_ERROR("tag %d on rank %d already evicted.\n", tag,
-				rank);
-			D_GOTO(out, rc = -DER_EVICTED);
-		}
-		D_MUTEX_UNLOCK(&li->li_mutex);
-		if (uri != NULL)
-			*uri = li->li_uri[tag];
-		if (hg_addr == NULL)
-			D_ASSERT(uri != NULL);
-		else if (li->li_tag_addr[tag] != NULL)
-			*hg_addr = li->li_tag_addr[tag];
-		D_RWLOCK_UNLOCK(&default_grp_priv->gp_rwlock);
-		d_hash_rec_decref(&default_grp_priv->gp_lookup_cache[ctx_idx],
-				  rlink);
+	li = crt_grp_lc_find(default_grp_priv, rank);
+	if (li == NULL) {
+		D_DEBUG(DB_TRACE, "rank %d not in lookup table, "
+			"default_grp_priv %p.\n", rank, default_grp_priv);
 		D_GOTO(out, rc);
 	}
-	D_RWLOCK_UNLOCK(&default_grp_priv->gp_rwlock);
+	D_ASSERT(li->li_grp_priv == default_grp_priv);
+	D_ASSERT(li->li_rank == rank);
 
-	/* target rank not in cache */
-	D_ALLOC_PTR(li);
-	if (li == NULL)
-		D_GOTO(out, rc = -DER_NOMEM);
-	D_INIT_LIST_HEAD(&li->li_link);
-	li->li_grp_priv = default_grp_priv;
-	li->li_rank = rank;
-	li->li_base_phy_addr = NULL;
-	li->li_initialized = 1;
-	li->li_evicted = 0;
+	if (__atomic_load_n(&li->li_evicted, __ATOMIC_ACQUIRE) == 1) {
+		D_ERROR("tag %d on rank %d already evicted.\n", tag, rank);
+		D_GOTO(out, rc = -DER_EVICTED);
+	}
 
-	rc = D_MUTEX_INIT(&li->li_mutex, NULL);
-	if (rc != 0) {
-		crt_li_destroy(li);
+	lt = crt_li_tag_find(li, tag);
+	if (uri != NULL)
+		*uri = lt == NULL ? NULL :
+		       __atomic_load_n(&lt->lt_uri, __ATOMIC_ACQUIRE);
+	if (hg_addr == NULL) {
+		D_ASSERT(uri != NULL);
 		D_GOTO(out, rc);
 	}
 
-	D_RWLOCK_WRLOCK(&default_grp_priv->gp_rwlock);
-	rc = d_hash_rec_insert(&default_grp_priv->gp_lookup_cache[ctx_idx],
-			       &rank, sizeof(rank), &li->li_link,
-			       true /* exclusive */);
-	if (rc != 0) {
-		D_DEBUG(DB_TRACE, "entry already exists.\n");
-		crt_li_destroy(li);
-	} else {
-		D_DEBUG(DB_TRACE, "Inserted lookup table entry without base "
-			"URI. default_grp_priv %p ctx_idx %d, rank: %d, "
-			"tag: %u, rlink %p\n", default_grp_priv, ctx_idx, rank,
-			tag, &li->li_link);
-	}
-	/* the only possible failure is key conflict */
-	D_RWLOCK_UNLOCK(&default_grp_priv->gp_rwlock);
+	if (lt != NULL)
+		addrs = __atomic_load_n(&lt->lt_addrs, __ATOMIC_ACQUIRE);
+	if (addrs != NULL && ctx_idx < addrs->la_num)
+		addr = __atomic_load_n(&addrs->la_addr[ctx_idx],
+				       __ATOMIC_ACQUIRE);
+	if (addr != NULL)
+		*hg_addr = addr;
 
 out:
 	return rc;
@@ -782,9 +957,28 @@ crt_grp_priv_create(struct crt_grp_priv **grp_priv_created,
 		D_GOTO(out, rc);
 	}
 
+	rc = D_MUTEX_INIT(&grp_priv->gp_info_mutex, NULL);
+	if (rc != 0) {
+		D_FREE(grp_priv->gp_pub.cg_grpid);
+		D_RWLOCK_DESTROY(&grp_priv->gp_rwlock);
+		D_FREE_PTR(grp_priv);
+		D_GOTO(out, rc);
+	}
+
 	rc = crt_barrier_info_init(grp_priv);
 	if (rc != 0) {
 		D_FREE(grp_priv->gp_pub.cg_grpid);
+		D_MUTEX_DESTROY(&grp_priv->gp_info_mutex);
+		D_RWLOCK_DESTROY(&grp_priv->gp_rwlock);
+		D_FREE_PTR(grp_priv);
+		D_GOTO(out, rc);
+	}
+
+	rc = crt_coll_info_init(grp_priv);
+	if (rc != 0) {
+		crt_barrier_info_destroy(grp_priv);
+		D_FREE(grp_priv->gp_pub.cg_grpid);
+		D_MUTEX_DESTROY(&grp_priv->gp_info_mutex);
 		D_RWLOCK_DESTROY(&grp_priv->gp_rwlock);
 		D_FREE_PTR(grp_priv);
 		D_GOTO(out, rc);
@@ -912,6 +1106,23 @@ out:
 	return rc;
 }
 
+static void
+crt_uri_tmpl_free(struct crt_uri_tmpl *tmpl)
+{
+	uint32_t	i;
+
+	if (tmpl == NULL)
+		return;
+
+	if (tmpl->ut_hosts != NULL) {
+		for (i = 0; i < tmpl->ut_host_num; i++)
+			D_FREE(tmpl->ut_hosts[i]);
+		D_FREE(tmpl->ut_hosts);
+	}
+	D_FREE(tmpl->ut_fmt);
+	D_FREE_PTR(tmpl);
+}
+
 void
 crt_grp_priv_destroy(struct crt_grp_priv *grp_priv)
 {
@@ -928,10 +1139,18 @@ crt_grp_priv_destroy(struct crt_grp_priv *grp_priv)
 
 	if (grp_priv->gp_psr_phy_addr != NULL)
 		free(grp_priv->gp_psr_phy_addr);
+	crt_uri_tmpl_free(grp_priv->gp_uri_tmpl);
+	D_FREE(grp_priv->gp_loc_map);
+	crt_tree_cache_destroy(grp_priv);
+	D_FREE(grp_priv->gp_info_log);
+	if (grp_priv->gp_ai_map != NULL)
+		munmap(grp_priv->gp_ai_map, grp_priv->gp_ai_map_size);
+	D_MUTEX_DESTROY(&grp_priv->gp_info_mutex);
 	D_RWLOCK_DESTROY(&grp_priv->gp_rwlock);
 	D_FREE(grp_priv->gp_pub.cg_grpid);
 
 	crt_barrier_info_destroy(grp_priv);
+	crt_coll_info_destroy(grp_priv);
 
 	D_FREE_PTR(grp_priv);
 }
@@ -1545,11 +1764,23 @@ out:
 	return rc;
 }
 
+static int
+crt_rank_cmp(const void *a, const void *b)
+{
+	d_rank_t	ra = *(const d_rank_t *)a;
+	d_rank_t	rb = *(const d_rank_t *)b;
+
+	if (ra < rb)
+		return -1;
+	return ra > rb ? 1 : 0;
+}
+
 int
 crt_group_rank_p2s(crt_group_t *subgrp, d_rank_t rank_in, d_rank_t *rank_out)
 {
 	struct crt_grp_priv	*grp_priv;
 	d_rank_list_t		*membs;
+	d_rank_t		*rank;
 	int			 rc = 0;
 
 	if (!crt_initialized()) {
@@ -1585,13 +1816,17 @@ crt_group_rank_p2s(crt_group_t *subgrp, d_rank_t rank_in, d_rank_t *rank_out)
 		return rc;
 	}
 
+	/* the members of a subgroup are sorted, see grp_priv_set_membs() */
 	membs = grp_priv_get_membs(grp_priv);
-	rc = d_idx_in_rank_list(membs, rank_in, rank_out);
-	if (rc != 0) {
+	rank = membs == NULL ? NULL :
+	       bsearch(&rank_in, membs->rl_ranks, membs->rl_nr,
+		       sizeof(rank_in), crt_rank_cmp);
+	if (rank == NULL) {
 		D_ERROR("primary rank %d is not a member of subgroup %s.\n",
 			rank_in, subgrp->cg_grpid);
-		rc = -DER_OOG;
+		return -DER_OOG;
 	}
+	*rank_out = rank - membs->rl_ranks;
 
 	return rc;
 }
@@ -1872,7 +2107,6 @@ crt_uri_lookup_forward_cb(const struct crt_cb_info *cb_info)
 	struct crt_uri_lookup_out	*ul_out;
 	struct crt_uri_lookup_in	*ul_fwd_in;
 	struct crt_uri_lookup_out	*ul_fwd_out;
-	struct crt_context		*crt_ctx;
 	d_rank_t			 g_rank;
 	uint32_t			 tag;
 	char				*uri = NULL;
@@ -1888,18 +2122,15 @@ crt_uri_lookup_forward_cb(const struct crt_cb_info *cb_info)
 	ul_fwd_in = crt_req_get(cb_info->cci_rpc);
 	ul_fwd_out = crt_reply_get(cb_info->cci_rpc);
 
-	crt_ctx = cb_info->cci_rpc->cr_ctx;
 	g_rank = ul_fwd_in->ul_rank;
 	tag = ul_fwd_in->ul_tag;
 	uri = ul_fwd_out->ul_uri;
 
 	default_grp_priv = crt_gdata.cg_grp->gg_srv_pri_grp;
-	rc = crt_grp_lc_uri_insert(default_grp_priv, crt_ctx->cc_idx,
-				   g_rank, tag, uri);
+	rc = crt_grp_lc_uri_insert(default_grp_priv, g_rank, tag, uri);
 	if (rc != 0)
-		D_ERROR("crt_grp_lc_uri_insert(%p, %d, %u, %s) failed."
-			" rc: %d\n", default_grp_priv, crt_ctx->cc_idx, g_rank,
-			uri, rc);
+		D_ERROR("crt_grp_lc_uri_insert(%p, %u, %s) failed."
+			" rc: %d\n", default_grp_priv, g_rank, uri, rc);
 
 out:
 	/* reply to original requester */
@@ -1962,54 +2193,71 @@ err_out:
 	return rc;
 }
 
-void
-crt_hdlr_uri_lookup(crt_rpc_t *rpc_req)
+/*
+ * Returns the group a URI lookup refers to with a reference held, the primary
+ * service group or one of its subgroups.
+ */
+static int
+crt_uri_lookup_grp_get(crt_group_id_t grp_id, struct crt_grp_priv **grp_priv)
 {
-	struct crt_grp_priv		*grp_priv;
-	struct crt_grp_priv		*default_grp_priv;
-	struct crt_context		*crt_ctx;
-	struct crt_uri_lookup_in	*ul_in;
-	struct crt_uri_lookup_out	*ul_out;
-	d_rank_t			 g_rank;
-	d_rank_t			 my_rank;
-	char				*tmp_uri = NULL;
-	char				*cached_uri = NULL;
-	bool				 should_decref = false;
-	int				rc = 0;
-	d_rank_list_t			*membs;
-
-	D_ASSERT(rpc_req != NULL);
-	ul_in = crt_req_get(rpc_req);
-	ul_out = crt_reply_get(rpc_req);
+	struct crt_grp_priv	*default_grp_priv;
+	struct crt_grp_priv	*tmp;
 
 	if (!crt_is_service()) {
-		D_ERROR("crt_hdlr_uri_lookup invalid on client.\n");
-		rc = -DER_PROTO;
+		D_ERROR("URI lookup invalid on client.\n");
+		return -DER_PROTO;
 	}
+
 	default_grp_priv = crt_gdata.cg_grp->gg_srv_pri_grp;
-	if (strncmp(ul_in->ul_grp_id, default_grp_priv->gp_pub.cg_grpid,
+	if (strncmp(grp_id, default_grp_priv->gp_pub.cg_grpid,
 		    CRT_GROUP_ID_MAX_LEN) == 0) {
-		grp_priv = default_grp_priv;
-		D_DEBUG(DB_TRACE, "ul_grp_id %s matches with gg_srv_pri_grp "
-			"%s.\n", ul_in->ul_grp_id,
-			default_grp_priv->gp_pub.cg_grpid);
-	} else {
-		/* handle subgroup lookups */
-		D_RWLOCK_RDLOCK(&crt_grp_list_rwlock);
-		grp_priv = crt_grp_lookup_locked(ul_in->ul_grp_id);
-		if (grp_priv == NULL) {
-			rc = -DER_INVAL;
-		} else {
-			crt_grp_priv_addref(grp_priv);
-			should_decref = true;
-		}
-		D_RWLOCK_UNLOCK(&crt_grp_list_rwlock);
+		D_DEBUG(DB_TRACE, "grp_id %s matches with gg_srv_pri_grp.\n",
+			grp_id);
+		crt_grp_priv_addref(default_grp_priv);
+		*grp_priv = default_grp_priv;
+		return 0;
 	}
 
+	/* handle subgroup lookups */
+	D_RWLOCK_RDLOCK(&crt_grp_list_rwlock);
+	tmp = crt_grp_lookup_locked(grp_id);
+	if (tmp != NULL)
+		crt_grp_priv_addref(tmp);
+	D_RWLOCK_UNLOCK(&crt_grp_list_rwlock);
+	if (tmp == NULL)
+		return -DER_INVAL;
+
+	*grp_priv = tmp;
+	return 0;
+}
+
+void
+crt_hdlr_uri_lookup(crt_rpc_t *rpc_req)
+{
+	struct crt_grp_priv		*grp_priv;
+	struct crt_grp_priv		*default_grp_priv;
+	struct crt_context		*crt_ctx;
+	struct crt_uri_lookup_in	*ul_in;
+	struct crt_uri_lookup_out	*ul_out;
+	d_rank_t			 g_rank;
+	d_rank_t			 my_rank;
+	char				*tmp_uri = NULL;
+	char				*cached_uri = NULL;
+	bool				 should_decref = false;
+	int				rc = 0;
+	d_rank_list_t			*membs;
+
+	D_ASSERT(rpc_req != NULL);
+	ul_in = crt_req_get(rpc_req);
+	ul_out = crt_reply_get(rpc_req);
+
+	rc = crt_uri_lookup_grp_get(ul_in->ul_grp_id, &grp_priv);
 	if (rc != 0) {
 		ul_out->ul_uri = NULL;
 		D_GOTO(out, rc = 0);
 	}
+	should_decref = true;
+	default_grp_priv = crt_gdata.cg_grp->gg_srv_pri_grp;
 
 	crt_ctx = rpc_req->cr_ctx;
 
@@ -2083,8 +2331,8 @@ crt_hdlr_uri_lookup(crt_rpc_t *rpc_req)
 			D_ERROR("crt_pmix_uri_lookup() failed, rc %d\n", rc);
 			D_GOTO(out, rc);
 		}
-		rc = crt_grp_lc_uri_insert(default_grp_priv, crt_ctx->cc_idx,
-				g_rank, 0, tmp_uri);
+		rc = crt_grp_lc_uri_insert(default_grp_priv, g_rank, 0,
+					   tmp_uri);
 		if (rc != 0) {
 			D_ERROR("crt_grp_lc_uri_insert() failed, rc %d\n", rc);
 			D_GOTO(out, rc);
@@ -2123,6 +2371,452 @@ out:
 		free(tmp_uri);
 }
 
+/* size of a packed rank:tag:uri_size:uri entry */
+#define CRT_URI_ENTRY_SIZE(uri_size)					\
+	(sizeof(d_rank_t) + 2 * sizeof(uint32_t) + (uri_size))
+
+static void
+crt_uri_entry_pack(char **ptr, d_rank_t rank, uint32_t tag, const char *uri,
+		   uint32_t uri_size)
+{
+	*((d_rank_t *)*ptr) = rank;
+	*ptr += sizeof(d_rank_t);
+	*((uint32_t *)*ptr) = tag;
+	*ptr += sizeof(uint32_t);
+	*((uint32_t *)*ptr) = uri_size;
+	*ptr += sizeof(uint32_t);
+	memcpy(*ptr, uri, uri_size);
+	*ptr += uri_size;
+}
+
+/* insert the packed URIs returned by CRT_OPC_URI_LOOKUP_BATCH in the cache */
+static int
+crt_uri_entries_insert(struct crt_grp_priv *grp_priv, char *buf, size_t size)
+{
+	char		*ptr = buf;
+	d_rank_t	 rank;
+	uint32_t	 tag;
+	uint32_t	 uri_size;
+	int		 rc = 0;
+
+	while (ptr < buf + size) {
+		if (ptr + CRT_URI_ENTRY_SIZE(0) > buf + size)
+			D_GOTO(out, rc = -DER_PROTO);
+		rank = *((d_rank_t *)ptr);
+		ptr += sizeof(d_rank_t);
+		tag = *((uint32_t *)ptr);
+		ptr += sizeof(uint32_t);
+		uri_size = *((uint32_t *)ptr);
+		ptr += sizeof(uint32_t);
+		if (uri_size == 0 || uri_size > CRT_ADDR_STR_MAX_LEN ||
+		    ptr + uri_size > buf + size || ptr[uri_size - 1] != '\0')
+			D_GOTO(out, rc = -DER_PROTO);
+
+		rc = crt_grp_lc_uri_insert(grp_priv, rank, tag, ptr);
+		if (rc != 0) {
+			D_ERROR("crt_grp_lc_uri_insert(%p, %d, %d, %s) failed, "
+				"rc: %d\n", grp_priv, rank, tag, ptr, rc);
+			D_GOTO(out, rc);
+		}
+		ptr += uri_size;
+	}
+
+out:
+	if (rc == -DER_PROTO)
+		D_ERROR("malformed URI batch at offset %zu of %zu.\n",
+			(size_t)(ptr - buf), size);
+	return rc;
+}
+
+static int
+crt_uri_lookup_batch_put_cb(const struct crt_bulk_cb_info *cb_info)
+{
+	struct crt_uri_lookup_batch_out	*ulb_out;
+	crt_rpc_t			*rpc_req;
+	char				*buf;
+	int				 rc;
+
+	rpc_req = cb_info->bci_bulk_desc->bd_rpc;
+	ulb_out = crt_reply_get(rpc_req);
+	if (cb_info->bci_rc != 0) {
+		D_ERROR("bulk PUT of the URIs failed, rc: %d.\n",
+			cb_info->bci_rc);
+		ulb_out->ulb_bulk_size = 0;
+		ulb_out->ulb_rank_done = 0;
+		ulb_out->ulb_rc = cb_info->bci_rc;
+	}
+
+	rc = crt_reply_send(rpc_req);
+	if (rc != 0)
+		D_ERROR("crt_reply_send failed, rc: %d, opc: %#x.\n",
+			rc, rpc_req->cr_opc);
+
+	crt_bulk_free(cb_info->bci_bulk_desc->bd_local_hdl);
+	buf = cb_info->bci_arg;
+	D_FREE(buf);
+	/* addref in crt_hdlr_uri_lookup_batch */
+	RPC_PUB_DECREF(rpc_req);
+
+	return 0;
+}
+
+/*
+ * Look up the URIs of a list or a range of ranks in one go. Only the URIs
+ * this rank knows are returned, the others are left to CRT_OPC_URI_LOOKUP.
+ * The packed URIs are inlined if small enough, otherwise PUT to the buffer
+ * of the caller, and the ranks that fit in neither are left for another RPC.
+ */
+void
+crt_hdlr_uri_lookup_batch(crt_rpc_t *rpc_req)
+{
+	struct crt_uri_lookup_batch_in	*ulb_in;
+	struct crt_uri_lookup_batch_out	*ulb_out;
+	struct crt_grp_priv		*grp_priv = NULL;
+	struct crt_grp_priv		*default_grp_priv;
+	struct crt_context		*crt_ctx = rpc_req->cr_ctx;
+	struct crt_bulk_desc		 bulk_desc;
+	crt_bulk_opid_t			 opid;
+	crt_bulk_t			 bulk_hdl;
+	d_sg_list_t			 sgl;
+	d_iov_t				 iov;
+	d_rank_list_t			*membs;
+	d_rank_t			*ranks;
+	d_rank_t			 rank;
+	uint32_t			 num;
+	uint32_t			 uri_size;
+	size_t				 buf_len = CRT_URI_LOOKUP_BATCH_INLINE;
+	char				*buf = NULL;
+	char				*ptr;
+	char				*uri;
+	char				*self_uri;
+	int				 i;
+	int				 rc;
+
+	ulb_in = crt_req_get(rpc_req);
+	ulb_out = crt_reply_get(rpc_req);
+
+	rc = crt_uri_lookup_grp_get(ulb_in->ulb_grp_id, &grp_priv);
+	if (rc != 0)
+		D_GOTO(out, rc);
+
+	if (ulb_in->ulb_tag >= CRT_SRV_CONTEXT_NUM) {
+		D_WARN("Looking up invalid tag %d in group %s.\n",
+		       ulb_in->ulb_tag, grp_priv->gp_pub.cg_grpid);
+		D_GOTO(out, rc = -DER_INVAL);
+	}
+
+	if (ulb_in->ulb_bulk != CRT_BULK_NULL) {
+		rc = crt_bulk_get_len(ulb_in->ulb_bulk, &buf_len);
+		if (rc != 0)
+			D_GOTO(out, rc);
+	}
+	D_ALLOC(buf, buf_len);
+	if (buf == NULL)
+		D_GOTO(out, rc = -DER_NOMEM);
+
+	default_grp_priv = crt_gdata.cg_grp->gg_srv_pri_grp;
+	membs = grp_priv_get_membs(grp_priv);
+	ranks = ulb_in->ulb_ranks.ca_count != 0 ?
+		ulb_in->ulb_ranks.ca_arrays : NULL;
+	num = ulb_in->ulb_ranks.ca_count != 0 ? ulb_in->ulb_ranks.ca_count :
+						ulb_in->ulb_rank_num;
+	ptr = buf;
+	for (i = 0; i < num; i++) {
+		rank = ranks != NULL ? ranks[i] : ulb_in->ulb_rank_start + i;
+		if (rank >= grp_priv->gp_size)
+			continue;
+
+		uri = NULL;
+		self_uri = NULL;
+		if (rank == grp_priv->gp_self) {
+			rc = crt_self_uri_get(ulb_in->ulb_tag, &self_uri);
+			if (rc != 0)
+				D_GOTO(out, rc);
+			uri = self_uri;
+		} else {
+			rc = crt_grp_lc_lookup(default_grp_priv,
+					       crt_ctx->cc_idx,
+					       membs->rl_ranks[rank],
+					       ulb_in->ulb_tag, &uri, NULL);
+			/* an evicted rank is left to the single lookup */
+			if (rc == -DER_EVICTED)
+				rc = 0;
+			if (rc != 0)
+				D_GOTO(out, rc);
+		}
+		if (uri == NULL)
+			continue;
+
+		uri_size = strlen(uri) + 1;
+		if (ptr + CRT_URI_ENTRY_SIZE(uri_size) > buf + buf_len) {
+			free(self_uri);
+			break;
+		}
+		crt_uri_entry_pack(&ptr, rank, ulb_in->ulb_tag, uri, uri_size);
+		free(self_uri);
+	}
+	if (i == 0 && num != 0)
+		D_GOTO(out, rc = -DER_TRUNC);
+	ulb_out->ulb_rank_done = i;
+
+	if (ptr - buf <= CRT_URI_LOOKUP_BATCH_INLINE) {
+		d_iov_set(&ulb_out->ulb_uris, buf, ptr - buf);
+		D_GOTO(out, rc);
+	}
+
+	d_iov_set(&iov, buf, ptr - buf);
+	sgl.sg_nr = 1;
+	sgl.sg_nr_out = 0;
+	sgl.sg_iovs = &iov;
+	rc = crt_bulk_create(rpc_req->cr_ctx, &sgl, CRT_BULK_RO, &bulk_hdl);
+	if (rc != 0) {
+		D_ERROR("crt_bulk_create failed, rc: %d.\n", rc);
+		D_GOTO(out, rc);
+	}
+	ulb_out->ulb_bulk_size = ptr - buf;
+
+	memset(&bulk_desc, 0, sizeof(bulk_desc));
+	bulk_desc.bd_rpc = rpc_req;
+	bulk_desc.bd_bulk_op = CRT_BULK_PUT;
+	bulk_desc.bd_remote_hdl = ulb_in->ulb_bulk;
+	bulk_desc.bd_local_hdl = bulk_hdl;
+	bulk_desc.bd_len = ptr - buf;
+
+	/* decref in crt_uri_lookup_batch_put_cb */
+	RPC_PUB_ADDREF(rpc_req);
+	rc = crt_bulk_transfer(&bulk_desc, crt_uri_lookup_batch_put_cb, buf,
+			       &opid);
+	if (rc != 0) {
+		D_ERROR("crt_bulk_transfer failed, rc: %d.\n", rc);
+		RPC_PUB_DECREF(rpc_req);
+		crt_bulk_free(bulk_hdl);
+		D_GOTO(out, rc);
+	}
+	crt_grp_priv_decref(grp_priv);
+	return;
+
+out:
+	if (grp_priv != NULL)
+		crt_grp_priv_decref(grp_priv);
+	if (rc != 0) {
+		d_iov_set(&ulb_out->ulb_uris, NULL, 0);
+		ulb_out->ulb_bulk_size = 0;
+		ulb_out->ulb_rank_done = 0;
+	}
+	ulb_out->ulb_rc = rc;
+	rc = crt_reply_send(rpc_req);
+	if (rc != 0)
+		D_ERROR("crt_reply_send failed, rc: %d, opc: %#x.\n",
+			rc, rpc_req->cr_opc);
+	D_FREE(buf);
+}
+
+/* state of a crt_group_uri_prefetch in flight */
+struct crt_uri_prefetch {
+	struct crt_grp_priv	*up_grp_priv;
+	crt_context_t		 up_ctx;
+	uint32_t		 up_tag;
+	/* first rank not looked up yet */
+	d_rank_t		 up_next;
+	/* buffer the PSR PUTs the URIs to */
+	d_iov_t			 up_iov;
+	crt_bulk_t		 up_bulk;
+	crt_cb_t		 up_complete_cb;
+	void			*up_arg;
+};
+
+static int crt_uri_prefetch_send(struct crt_uri_prefetch *up);
+
+static void
+crt_uri_prefetch_complete(struct crt_uri_prefetch *up, int rc)
+{
+	struct crt_cb_info	cb_info;
+
+	if (rc != 0)
+		D_ERROR("URI prefetch of group %s stopped at rank %d, "
+			"rc: %d.\n", up->up_grp_priv->gp_pub.cg_grpid,
+			up->up_next, rc);
+	else
+		D_DEBUG(DB_TRACE, "URI prefetch of group %s done.\n",
+			up->up_grp_priv->gp_pub.cg_grpid);
+
+	if (up->up_complete_cb != NULL) {
+		cb_info.cci_rpc = NULL;
+		cb_info.cci_arg = up->up_arg;
+		cb_info.cci_rc = rc;
+		up->up_complete_cb(&cb_info);
+	}
+
+	if (up->up_bulk != CRT_BULK_NULL)
+		crt_bulk_free(up->up_bulk);
+	D_FREE(up->up_iov.iov_buf);
+	crt_grp_priv_decref(up->up_grp_priv);
+	D_FREE_PTR(up);
+}
+
+static void
+crt_uri_prefetch_cb(const struct crt_cb_info *cb_info)
+{
+	struct crt_uri_prefetch		*up = cb_info->cci_arg;
+	struct crt_uri_lookup_batch_out	*ulb_out;
+	int				 rc;
+
+	rc = cb_info->cci_rc;
+	if (rc != 0)
+		D_GOTO(out, rc);
+
+	ulb_out = crt_reply_get(cb_info->cci_rpc);
+	rc = ulb_out->ulb_rc;
+	if (rc != 0)
+		D_GOTO(out, rc);
+	if (ulb_out->ulb_rank_done == 0 ||
+	    ulb_out->ulb_bulk_size > up->up_iov.iov_buf_len)
+		D_GOTO(out, rc = -DER_PROTO);
+
+	if (ulb_out->ulb_bulk_size != 0)
+		rc = crt_uri_entries_insert(up->up_grp_priv,
+					    up->up_iov.iov_buf,
+					    ulb_out->ulb_bulk_size);
+	else
+		rc = crt_uri_entries_insert(up->up_grp_priv,
+					    ulb_out->ulb_uris.iov_buf,
+					    ulb_out->ulb_uris.iov_len);
+	if (rc != 0)
+		D_GOTO(out, rc);
+
+	up->up_next += ulb_out->ulb_rank_done;
+	if (up->up_next < up->up_grp_priv->gp_size) {
+		/* crt_uri_prefetch_send completes up on failure */
+		crt_uri_prefetch_send(up);
+		return;
+	}
+
+out:
+	crt_uri_prefetch_complete(up, rc);
+}
+
+static int
+crt_uri_prefetch_send(struct crt_uri_prefetch *up)
+{
+	struct crt_grp_priv		*grp_priv = up->up_grp_priv;
+	struct crt_uri_lookup_batch_in	*ulb_in;
+	crt_endpoint_t			 tgt_ep;
+	crt_rpc_t			*ulb_req;
+	int				 rc;
+
+	tgt_ep.ep_grp = &grp_priv->gp_pub;
+	tgt_ep.ep_rank = grp_priv->gp_psr_rank;
+	tgt_ep.ep_tag = 0;
+	rc = crt_req_create(up->up_ctx, &tgt_ep, CRT_OPC_URI_LOOKUP_BATCH,
+			    &ulb_req);
+	if (rc != 0) {
+		D_ERROR("crt_req_create URI_LOOKUP_BATCH failed, rc: %d.\n",
+			rc);
+		crt_uri_prefetch_complete(up, rc);
+		return rc;
+	}
+
+	ulb_in = crt_req_get(ulb_req);
+	ulb_in->ulb_grp_id = grp_priv->gp_pub.cg_grpid;
+	ulb_in->ulb_rank_start = up->up_next;
+	ulb_in->ulb_rank_num = min(grp_priv->gp_size - up->up_next,
+				   CRT_URI_LOOKUP_BATCH_RANKS);
+	ulb_in->ulb_tag = up->up_tag;
+	ulb_in->ulb_bulk = up->up_bulk;
+
+	/* crt_req_send() calls the callback on failure */
+	rc = crt_req_send(ulb_req, crt_uri_prefetch_cb, up);
+	if (rc != 0)
+		D_ERROR("crt_req_send URI_LOOKUP_BATCH failed, rc: %d.\n", rc);
+
+	return rc;
+}
+
+int
+crt_group_uri_prefetch(crt_context_t crt_ctx, crt_group_t *grp, uint32_t tag,
+		       crt_cb_t complete_cb, void *arg)
+{
+	struct crt_grp_priv	*grp_priv;
+	struct crt_uri_prefetch	*up;
+	d_sg_list_t		 sgl;
+	int			 rc = 0;
+
+	if (crt_ctx == CRT_CONTEXT_NULL || grp == NULL) {
+		D_ERROR("invalid parameter, NULL crt_ctx or grp.\n");
+		D_GOTO(out, rc = -DER_INVAL);
+	}
+	if (tag >= CRT_SRV_CONTEXT_NUM) {
+		D_ERROR("invalid parameter, tag %d out of range [0, %d].\n",
+			tag, CRT_SRV_CONTEXT_NUM - 1);
+		D_GOTO(out, rc = -DER_INVAL);
+	}
+	grp_priv = crt_grp_pub2priv(grp);
+	if (grp_priv->gp_local == 1 || grp_priv->gp_service == 0) {
+		D_ERROR("group %s is not an attached service group.\n",
+			grp->cg_grpid);
+		D_GOTO(out, rc = -DER_INVAL);
+	}
+
+	D_ALLOC_PTR(up);
+	if (up == NULL)
+		D_GOTO(out, rc = -DER_NOMEM);
+	/* one buffer big enough for the replies of all batches */
+	D_ALLOC(up->up_iov.iov_buf, CRT_URI_LOOKUP_BATCH_RANKS *
+		CRT_URI_ENTRY_SIZE(CRT_ADDR_STR_MAX_LEN));
+	if (up->up_iov.iov_buf == NULL) {
+		D_FREE_PTR(up);
+		D_GOTO(out, rc = -DER_NOMEM);
+	}
+	up->up_iov.iov_buf_len = CRT_URI_LOOKUP_BATCH_RANKS *
+				 CRT_URI_ENTRY_SIZE(CRT_ADDR_STR_MAX_LEN);
+	up->up_iov.iov_len = up->up_iov.iov_buf_len;
+
+	sgl.sg_nr = 1;
+	sgl.sg_nr_out = 0;
+	sgl.sg_iovs = &up->up_iov;
+	rc = crt_bulk_create(crt_ctx, &sgl, CRT_BULK_RW, &up->up_bulk);
+	if (rc != 0) {
+		D_ERROR("crt_bulk_create failed, rc: %d.\n", rc);
+		D_FREE(up->up_iov.iov_buf);
+		D_FREE_PTR(up);
+		D_GOTO(out, rc);
+	}
+
+	crt_grp_priv_addref(grp_priv);
+	up->up_grp_priv = grp_priv;
+	up->up_ctx = crt_ctx;
+	up->up_tag = tag;
+	up->up_complete_cb = complete_cb;
+	up->up_arg = arg;
+
+	/* the callback is called on failure */
+	crt_uri_prefetch_send(up);
+
+out:
+	return rc;
+}
+
+/* start the prefetch enabled by CRT_ATTACH_PREFETCH on context 0 */
+static void
+crt_grp_uri_prefetch(crt_group_t *grp)
+{
+	crt_context_t	crt_ctx;
+	int		rc;
+
+	crt_ctx = crt_context_lookup(0);
+	if (crt_ctx == NULL) {
+		D_WARN("no context 0, URIs of group %s not prefetched.\n",
+		       grp->cg_grpid);
+		return;
+	}
+
+	/* failures only cost the lookups on first contact */
+	rc = crt_group_uri_prefetch(crt_ctx, grp, 0, NULL, NULL);
+	if (rc != 0)
+		D_WARN("crt_group_uri_prefetch(%s) failed, rc: %d.\n",
+		       grp->cg_grpid, rc);
+}
+
 int
 crt_group_attach(crt_group_id_t srv_grpid, crt_group_t **attached_grp)
 {
@@ -2130,6 +2824,7 @@ crt_group_attach(crt_group_id_t srv_grpid, crt_group_t **attached_grp)
 	struct crt_grp_priv	*grp_priv;
 	crt_group_t		*grp_at = NULL;
 	bool			 is_service;
+	bool			 attached = false;
 	int			 rc = 0;
 
 	if (srv_grpid == NULL) {
@@ -2213,6 +2908,7 @@ crt_group_attach(crt_group_id_t srv_grpid, crt_group_t **attached_grp)
 						struct crt_grp_priv, gp_pub);
 			crt_grp_priv_addref(grp_gdata->gg_srv_pri_grp);
 			*attached_grp = grp_at;
+			attached = true;
 			D_RWLOCK_UNLOCK(&grp_gdata->gg_rwlock);
 			D_GOTO(out, rc);
 		} else if (crt_grp_id_identical(srv_grpid,
@@ -2253,10 +2949,13 @@ crt_group_attach(crt_group_id_t srv_grpid, crt_group_t **attached_grp)
 	crt_grp_priv_addref(grp_priv);
 	d_list_add_tail(&grp_priv->gp_link, &grp_gdata->gg_srv_grps_attached);
 	*attached_grp = grp_at;
+	attached = true;
 
 	D_RWLOCK_UNLOCK(&grp_gdata->gg_rwlock);
 
 out:
+	if (attached && crt_gdata.cg_attach_prefetch)
+		crt_grp_uri_prefetch(grp_at);
 	if (rc != 0)
 		D_ERROR("crt_group_attach failed, rc: %d.\n", rc);
 	return rc;
@@ -2266,7 +2965,6 @@ int
 crt_grp_attach(crt_group_id_t srv_grpid, crt_group_t **attached_grp)
 {
 	struct crt_grp_priv	*grp_priv = NULL;
-	struct crt_context	*crt_ctx = NULL;
 	int			 rc = 0;
 
 	D_ASSERT(srv_grpid != NULL);
@@ -2305,15 +3003,19 @@ crt_grp_attach(crt_group_id_t srv_grpid, crt_group_t **attached_grp)
 		D_ERROR("crt_grp_lc_create failed, rc: %d.\n", rc);
 		D_GOTO(out, rc);
 	}
-	/* insert PSR's base uri into hash table */
-	d_list_for_each_entry(crt_ctx, &crt_gdata.cg_ctx_list, cc_link) {
-		rc = crt_grp_lc_uri_insert(grp_priv, crt_ctx->cc_idx,
-					   grp_priv->gp_psr_rank, 0,
-					   grp_priv->gp_psr_phy_addr);
-		if (rc != 0) {
-			D_ERROR("crt_grp_lc_uri_insert() failed, rc %d\n", rc);
-			D_GOTO(out, rc);
-		}
+	/* insert PSR's base uri into lookup cache */
+	rc = crt_grp_lc_uri_insert(grp_priv, grp_priv->gp_psr_rank, 0,
+				   grp_priv->gp_psr_phy_addr);
+	if (rc != 0) {
+		D_ERROR("crt_grp_lc_uri_insert() failed, rc %d\n", rc);
+		D_GOTO(out, rc);
+	}
+
+	/* and the other ranks' if the attach info file holds them */
+	rc = crt_grp_config_lc_fill(grp_priv);
+	if (rc != 0) {
+		D_ERROR("crt_grp_config_lc_fill() failed, rc %d\n", rc);
+		D_GOTO(out, rc);
 	}
 
 	rc = crt_grp_ras_init(grp_priv);
@@ -2624,24 +3326,156 @@ crt_group_config_path_set(const char *path)
 	return 0;
 }
 
-/**
- * Save attach info to file with the name
- * "<singleton_attach_path>/grpid.attach_info_tmp".
- * The format of the file is:
- * line 1: the process set name
- * line 2: process set size
- * line 3: "all" or "self"
- *	   "all" means dump all ranks' uri
- *	   "self" means only dump this rank's uri
- * line 4 ~ N: <rank> <uri>
- *
- * An example file named service_set.attach_info:
+/*
+ * Binary attach info, "<prefix>/<grpid>.attach_info_bin". It is saved along
+ * with the text file, holds the same rank to URI table, and is mapped
+ * read-only by the loader:
+ *   struct crt_ai_hdr
+ *   struct crt_ai_entry[aih_entry_num], sorted by rank
+ *   NUL terminated URIs, at aie_uri_off from the start of the file
+ * Fields are in host byte order, a foreign layout fails the aih_magic check.
+ */
+#define CRT_AI_MAGIC		(0x43525441) /* "CRTA" */
+#define CRT_AI_VERSION		(1)
+/* all ranks' URIs, as opposed to the saving rank's only */
+#define CRT_AI_FORALL		(1U << 0)
+
+struct crt_ai_hdr {
+	uint32_t	aih_magic;
+	uint16_t	aih_version;
+	uint16_t	aih_flags;
+	uint32_t	aih_grp_size;
+	uint32_t	aih_entry_num;
+	uint64_t	aih_file_size;
+	char		aih_grpid[CRT_GROUP_ID_MAX_LEN + 1];
+};
+
+struct crt_ai_entry {
+	d_rank_t	aie_rank;
+	/* length of the URI, not counting the NUL */
+	uint32_t	aie_uri_len;
+	uint64_t	aie_uri_off;
+};
+
+static inline char *
+crt_grp_attach_info_bin_filename(struct crt_grp_priv *grp_priv)
+{
+	char		*filename;
+
+	D_ASSERT(grp_priv != NULL);
+	D_ASPRINTF(filename, "%s/%s.attach_info_bin", crt_attach_prefix,
+		   grp_priv->gp_pub.cg_grpid);
+
+	return filename;
+}
+
+/* write the binary attach info of the num ranks in ranks/uris */
+static int
+crt_grp_config_bin_save(struct crt_grp_priv *grp_priv, bool forall,
+			d_rank_t *ranks, char **uris, uint32_t num)
+{
+	struct crt_ai_hdr	*hdr;
+	struct crt_ai_entry	*entries;
+	char			*buf = NULL;
+	char			*filename = NULL;
+	char			*tmp_name = NULL;
+	FILE			*fp = NULL;
+	size_t			 size;
+	size_t			 off;
+	uint32_t		 i;
+	int			 rc = 0;
+
+	size = sizeof(*hdr) + num * sizeof(*entries);
+	for (i = 0; i < num; i++)
+		size += strlen(uris[i]) + 1;
+
+	D_ALLOC(buf, size);
+	if (buf == NULL)
+		D_GOTO(out, rc = -DER_NOMEM);
+
+	hdr = (struct crt_ai_hdr *)buf;
+	hdr->aih_magic = CRT_AI_MAGIC;
+	hdr->aih_version = CRT_AI_VERSION;
+	hdr->aih_flags = forall ? CRT_AI_FORALL : 0;
+	hdr->aih_grp_size = grp_priv->gp_size;
+	hdr->aih_entry_num = num;
+	hdr->aih_file_size = size;
+	strncpy(hdr->aih_grpid, grp_priv->gp_pub.cg_grpid,
+		CRT_GROUP_ID_MAX_LEN);
+
+	entries = (struct crt_ai_entry *)(hdr + 1);
+	off = sizeof(*hdr) + num * sizeof(*entries);
+	for (i = 0; i < num; i++) {
+		entries[i].aie_rank = ranks[i];
+		entries[i].aie_uri_len = strlen(uris[i]);
+		entries[i].aie_uri_off = off;
+		memcpy(buf + off, uris[i], entries[i].aie_uri_len + 1);
+		off += entries[i].aie_uri_len + 1;
+	}
+	D_ASSERT(off == size);
+
+	filename = crt_grp_attach_info_bin_filename(grp_priv);
+	if (filename == NULL)
+		D_GOTO(out, rc = -DER_NOMEM);
+
+	fp = open_tmp_attach_info_file(&tmp_name);
+	if (fp == NULL) {
+		D_ERROR("cannot create temp file.\n");
+		D_GOTO(out, rc = d_errno2der(errno));
+	}
+	if (fwrite(buf, 1, size, fp) != size) {
+		D_ERROR("write to file %s failed (%s).\n",
+			tmp_name, strerror(errno));
+		D_GOTO(out, rc = d_errno2der(errno));
+	}
+	rc = fclose(fp);
+	fp = NULL;
+	if (rc != 0) {
+		D_ERROR("file %s closing failed (%s).\n",
+			tmp_name, strerror(errno));
+		D_GOTO(out, rc = d_errno2der(errno));
+	}
+
+	rc = rename(tmp_name, filename);
+	if (rc != 0) {
+		D_ERROR("Failed to rename %s to %s (%s).\n",
+			tmp_name, filename, strerror(errno));
+		rc = d_errno2der(errno);
+	}
+out:
+	if (fp != NULL)
+		fclose(fp);
+	if (tmp_name != NULL) {
+		if (rc != 0)
+			unlink(tmp_name);
+		D_FREE(tmp_name);
+	}
+	D_FREE(filename);
+	D_FREE(buf);
+	return rc;
+}
+
+/**
+ * Save attach info to file with the name
+ * "<singleton_attach_path>/grpid.attach_info_tmp".
+ * The format of the file is:
+ * line 1: the process set name
+ * line 2: process set size
+ * line 3: "all" or "self"
+ *	   "all" means dump all ranks' uri
+ *	   "self" means only dump this rank's uri
+ * line 4 ~ N: <rank> <uri>
+ *
+ * An example file named service_set.attach_info:
  * ========================
  * service_set
  * 5
  * self
  * 4 tcp://192.168.0.1:1234
  * ========================
+ *
+ * The same table is saved in binary to "grpid.attach_info_bin", see
+ * struct crt_ai_hdr.
  */
 int
 crt_group_config_save(crt_group_t *grp, bool forall)
@@ -2649,11 +3483,16 @@ crt_group_config_save(crt_group_t *grp, bool forall)
 	struct crt_grp_priv	*grp_priv;
 	FILE			*fp = NULL;
 	char			*filename = NULL;
+	char			*bin_name = NULL;
 	char			*tmp_name = NULL;
 	crt_group_id_t		 grpid;
 	d_rank_t		 rank;
 	crt_phy_addr_t		 addr = NULL;
 	bool			 addr_free = false;
+	d_rank_t		*ranks = NULL;
+	char			**uris = NULL;
+	uint32_t		 num = 0;
+	uint32_t		 i;
 	int			 rc = 0;
 
 
@@ -2683,6 +3522,41 @@ crt_group_config_save(crt_group_t *grp, bool forall)
 	}
 
 	grpid = grp_priv->gp_pub.cg_grpid;
+
+	/* collect the table first, both files are written from it */
+	num = (!forall || grp_priv->gp_size == 1) ? 1 : grp_priv->gp_size;
+	D_ALLOC_ARRAY(ranks, num);
+	if (ranks == NULL)
+		D_GOTO(out, rc = -DER_NOMEM);
+	D_ALLOC_ARRAY(uris, num);
+	if (uris == NULL)
+		D_GOTO(out, rc = -DER_NOMEM);
+
+	if (num == 1) {
+		ranks[0] = rank;
+		D_STRNDUP(uris[0], addr, CRT_ADDR_STR_MAX_LEN);
+		if (uris[0] == NULL)
+			D_GOTO(out, rc = -DER_NOMEM);
+	} else {
+		for (i = 0; i < num; i++) {
+			char *uri;
+
+			uri = NULL;
+			rc = crt_pmix_uri_lookup(grpid, i, &uri);
+			if (rc != 0) {
+				D_ERROR("crt_pmix_uri_lookup(grp %s, rank %d), "
+					"failed rc: %d.\n", grpid, i, rc);
+				D_GOTO(out, rc);
+			}
+			D_ASSERT(uri != NULL);
+			ranks[i] = i;
+			D_STRNDUP(uris[i], uri, CRT_ADDR_STR_MAX_LEN);
+			free(uri);
+			if (uris[i] == NULL)
+				D_GOTO(out, rc = -DER_NOMEM);
+		}
+	}
+
 	filename = crt_grp_attach_info_filename(grp_priv);
 	if (filename == NULL)
 		D_GOTO(out, rc = -DER_NOMEM);
@@ -2715,29 +3589,8 @@ crt_group_config_save(crt_group_t *grp, bool forall)
 		D_GOTO(out, rc = d_errno2der(errno));
 	}
 
-	if (!forall || grp_priv->gp_size == 1) {
-		rc = fprintf(fp, "%d %s\n", rank, addr);
-		if (rc < 0) {
-			D_ERROR("write to file %s failed (%s).\n",
-				tmp_name, strerror(errno));
-			D_GOTO(out, rc = d_errno2der(errno));
-		}
-		D_GOTO(done, rc);
-	}
-
-	for (rank = 0; rank < grp_priv->gp_size; rank++) {
-		char *uri;
-
-		uri = NULL;
-		rc = crt_pmix_uri_lookup(grpid, rank, &uri);
-		if (rc != 0) {
-			D_ERROR("crt_pmix_uri_lookup(grp %s, rank %d), failed "
-				"rc: %d.\n", grpid, rank, rc);
-			D_GOTO(out, rc);
-		}
-		D_ASSERT(uri != NULL);
-		rc = fprintf(fp, "%d %s\n", rank, uri);
-		free(uri);
+	for (i = 0; i < num; i++) {
+		rc = fprintf(fp, "%d %s\n", ranks[i], uris[i]);
 		if (rc < 0) {
 			D_ERROR("write to file %s failed (%s).\n",
 				tmp_name, strerror(errno));
@@ -2745,7 +3598,6 @@ crt_group_config_save(crt_group_t *grp, bool forall)
 		}
 	}
 
-done:
 	if (fclose(fp) != 0) {
 		D_ERROR("file %s closing failed (%s).\n",
 			tmp_name, strerror(errno));
@@ -2754,13 +3606,34 @@ done:
 	}
 	fp = NULL;
 
+	/*
+	 * crt_grp_config_psr_load() prefers the binary file, remove the one of
+	 * a previous run before the new text file is in place
+	 */
+	bin_name = crt_grp_attach_info_bin_filename(grp_priv);
+	if (bin_name == NULL)
+		D_GOTO(out, rc = -DER_NOMEM);
+	if (unlink(bin_name) != 0 && errno != ENOENT) {
+		D_ERROR("Failed to remove %s (%s).\n",
+			bin_name, strerror(errno));
+		D_GOTO(out, rc = d_errno2der(errno));
+	}
+
 	rc = rename(tmp_name, filename);
 	if (rc != 0) {
 		D_ERROR("Failed to rename %s to %s (%s).\n",
 			tmp_name, filename, strerror(errno));
-		rc = d_errno2der(errno);
+		D_GOTO(out, rc = d_errno2der(errno));
+	}
+
+	rc = crt_grp_config_bin_save(grp_priv, forall, ranks, uris, num);
+	if (rc != 0) {
+		D_ERROR("crt_grp_config_bin_save(grp %s) failed, rc: %d.\n",
+			grpid, rc);
+		unlink(bin_name);
 	}
 out:
+	D_FREE(bin_name);
 	D_FREE(filename);
 	if (tmp_name != NULL) {
 		if (rc != 0)
@@ -2769,6 +3642,12 @@ out:
 	}
 	if (fp != NULL)
 		fclose(fp);
+	if (uris != NULL) {
+		for (i = 0; i < num; i++)
+			D_FREE(uris[i]);
+		D_FREE(uris);
+	}
+	D_FREE(ranks);
 	if (addr_free)
 		D_FREE(addr);
 	return rc;
@@ -2805,10 +3684,232 @@ crt_group_config_remove(crt_group_t *grp)
 		D_ERROR("Failed to remove %s (%s).\n",
 			filename, strerror(errno));
 	}
+	D_FREE(filename);
+
+	/* the binary file is missing if saved by an older version */
+	filename = crt_grp_attach_info_bin_filename(grp_priv);
+	if (filename == NULL)
+		D_GOTO(out, rc = -DER_NOMEM);
+	if (unlink(filename) != 0 && errno != ENOENT && rc == 0) {
+		rc = d_errno2der(errno);
+		D_ERROR("Failed to remove %s (%s).\n",
+			filename, strerror(errno));
+	}
+
+out:
+	D_FREE(filename);
+
+	return rc;
+}
+
+static void
+crt_grp_config_bin_unmap(struct crt_grp_priv *grp_priv)
+{
+	if (grp_priv->gp_ai_map == NULL)
+		return;
+
+	munmap(grp_priv->gp_ai_map, grp_priv->gp_ai_map_size);
+	grp_priv->gp_ai_map = NULL;
+	grp_priv->gp_ai_map_size = 0;
+}
+
+/*
+ * Map the binary attach info of grp_priv read-only and validate it, returns
+ * -DER_NONEXIST if there is no binary file.
+ */
+static int
+crt_grp_config_bin_map(struct crt_grp_priv *grp_priv)
+{
+	struct crt_ai_hdr	*hdr;
+	struct crt_ai_entry	*entries;
+	char			*filename = NULL;
+	char			*map = NULL;
+	struct stat		 st;
+	size_t			 size = 0;
+	uint32_t		 i;
+	int			 fd = -1;
+	int			 rc = 0;
+
+	if (grp_priv->gp_ai_map != NULL)
+		return 0;
+
+	filename = crt_grp_attach_info_bin_filename(grp_priv);
+	if (filename == NULL)
+		D_GOTO(out, rc = -DER_NOMEM);
+
+	fd = open(filename, O_RDONLY);
+	if (fd < 0) {
+		rc = d_errno2der(errno);
+		if (rc != -DER_NONEXIST)
+			D_ERROR("open file %s failed (%s).\n",
+				filename, strerror(errno));
+		D_GOTO(out, rc);
+	}
+	if (fstat(fd, &st) != 0) {
+		D_ERROR("stat file %s failed (%s).\n",
+			filename, strerror(errno));
+		D_GOTO(out, rc = d_errno2der(errno));
+	}
+	size = st.st_size;
+	if (size < sizeof(*hdr)) {
+		D_ERROR("file %s is truncated.\n", filename);
+		D_GOTO(out, rc = -DER_INVAL);
+	}
+
+	map = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+	if (map == MAP_FAILED) {
+		D_ERROR("mmap file %s failed (%s).\n",
+			filename, strerror(errno));
+		map = NULL;
+		D_GOTO(out, rc = d_errno2der(errno));
+	}
+
+	hdr = (struct crt_ai_hdr *)map;
+	if (hdr->aih_magic != CRT_AI_MAGIC ||
+	    hdr->aih_version != CRT_AI_VERSION) {
+		D_ERROR("file %s has bad magic %#x or version %d.\n",
+			filename, hdr->aih_magic, hdr->aih_version);
+		D_GOTO(out, rc = -DER_MISMATCH);
+	}
+	if (hdr->aih_file_size != size || hdr->aih_entry_num == 0 ||
+	    hdr->aih_grp_size == 0 ||
+	    hdr->aih_entry_num > (size - sizeof(*hdr)) / sizeof(*entries)) {
+		D_ERROR("file %s is truncated or corrupted.\n", filename);
+		D_GOTO(out, rc = -DER_INVAL);
+	}
+	if (strncmp(hdr->aih_grpid, grp_priv->gp_pub.cg_grpid,
+		    CRT_GROUP_ID_MAX_LEN) != 0) {
+		D_ERROR("grpname %.*s in file mismatch with grpid %s.\n",
+			CRT_GROUP_ID_MAX_LEN, hdr->aih_grpid,
+			grp_priv->gp_pub.cg_grpid);
+		D_GOTO(out, rc = -DER_INVAL);
+	}
+
+	/* check every URI once here so the users can trust the mapping */
+	entries = (struct crt_ai_entry *)(hdr + 1);
+	for (i = 0; i < hdr->aih_entry_num; i++) {
+		if (entries[i].aie_rank >= hdr->aih_grp_size ||
+		    (i > 0 && entries[i].aie_rank <= entries[i - 1].aie_rank) ||
+		    entries[i].aie_uri_len >= CRT_ADDR_STR_MAX_LEN ||
+		    entries[i].aie_uri_off >= size ||
+		    entries[i].aie_uri_len >= size - entries[i].aie_uri_off ||
+		    map[entries[i].aie_uri_off + entries[i].aie_uri_len] !=
+		    '\0') {
+			D_ERROR("file %s has a bad entry %d.\n", filename, i);
+			D_GOTO(out, rc = -DER_INVAL);
+		}
+	}
+
+	grp_priv->gp_ai_map = map;
+	grp_priv->gp_ai_map_size = size;
+	map = NULL;
 
 out:
+	if (map != NULL)
+		munmap(map, size);
+	if (fd >= 0)
+		close(fd);
 	D_FREE(filename);
+	return rc;
+}
+
+static int
+crt_ai_entry_cmp(const void *key, const void *elem)
+{
+	d_rank_t			 rank = *(const d_rank_t *)key;
+	const struct crt_ai_entry	*entry = elem;
+
+	if (rank < entry->aie_rank)
+		return -1;
+	return rank > entry->aie_rank ? 1 : 0;
+}
+
+/* Load the PSR from the binary attach info, see crt_grp_config_psr_load() */
+static int
+crt_grp_config_bin_psr_load(struct crt_grp_priv *grp_priv, d_rank_t psr_rank)
+{
+	struct crt_ai_hdr	*hdr;
+	struct crt_ai_entry	*entries;
+	struct crt_ai_entry	*entry;
+	crt_phy_addr_t		 addr_str = NULL;
+	d_rank_t		 rank;
+	int			 rc;
+
+	rc = crt_grp_config_bin_map(grp_priv);
+	if (rc != 0)
+		return rc;
+
+	hdr = grp_priv->gp_ai_map;
+	entries = (struct crt_ai_entry *)(hdr + 1);
+	grp_priv->gp_size = hdr->aih_grp_size;
+
+	if (psr_rank == -1) {
+		crt_group_rank(NULL, &rank);
+		psr_rank = rank % grp_priv->gp_size;
+	} else if (psr_rank >= grp_priv->gp_size) {
+		D_ERROR("invalid parameter (psr %d, gp_size %d).\n",
+			psr_rank, grp_priv->gp_size);
+		D_GOTO(out, rc = -DER_INVAL);
+	}
+
+	if (!(hdr->aih_flags & CRT_AI_FORALL)) {
+		entry = &entries[0];
+	} else {
+		entry = bsearch(&psr_rank, entries, hdr->aih_entry_num,
+				sizeof(*entries), crt_ai_entry_cmp);
+		if (entry == NULL) {
+			D_ERROR("psr %d not in attach info of group %s.\n",
+				psr_rank, grp_priv->gp_pub.cg_grpid);
+			D_GOTO(out, rc = -DER_INVAL);
+		}
+	}
+
+	D_STRNDUP(addr_str, (char *)hdr + entry->aie_uri_off,
+		  CRT_ADDR_STR_MAX_LEN);
+	if (addr_str == NULL)
+		D_GOTO(out, rc = -DER_NOMEM);
+
+	D_DEBUG(DB_TRACE, "grp %s selected psr_rank %d, uri %s.\n",
+		grp_priv->gp_pub.cg_grpid, entry->aie_rank, addr_str);
+	crt_grp_psr_set(grp_priv, entry->aie_rank, addr_str);
+
+out:
+	/* on attach the mapping is kept to fill the lookup cache */
+	if (rc != 0 || grp_priv->gp_lookup_cache != NULL)
+		crt_grp_config_bin_unmap(grp_priv);
+	return rc;
+}
+
+/*
+ * Fill all the URIs of the mapped binary attach info in the lookup cache of
+ * grp_priv, then drop the mapping.
+ */
+int
+crt_grp_config_lc_fill(struct crt_grp_priv *grp_priv)
+{
+	struct crt_ai_hdr	*hdr;
+	struct crt_ai_entry	*entries;
+	uint32_t		 i;
+	int			 rc = 0;
+
+	hdr = grp_priv->gp_ai_map;
+	if (hdr == NULL)
+		return 0;
+
+	entries = (struct crt_ai_entry *)(hdr + 1);
+	for (i = 0; i < hdr->aih_entry_num; i++) {
+		rc = crt_grp_lc_uri_insert(grp_priv, entries[i].aie_rank, 0,
+					   (char *)hdr + entries[i].aie_uri_off);
+		if (rc != 0) {
+			D_ERROR("crt_grp_lc_uri_insert(rank %d) failed, "
+				"rc: %d.\n", entries[i].aie_rank, rc);
+			break;
+		}
+	}
+	D_DEBUG(DB_TRACE, "group %s, %d URIs loaded from attach info.\n",
+		grp_priv->gp_pub.cg_grpid, i);
 
+	crt_grp_config_bin_unmap(grp_priv);
 	return rc;
 }
 
@@ -2833,6 +3934,16 @@ crt_grp_config_psr_load(struct crt_grp_priv *grp_priv, d_rank_t psr_rank)
 	D_ASSERT(grp_priv != NULL);
 
 	grpid = grp_priv->gp_pub.cg_grpid;
+
+	/* prefer the binary file, fall back to the text one */
+	rc = crt_grp_config_bin_psr_load(grp_priv, psr_rank);
+	if (rc == 0)
+		return 0;
+	if (rc != -DER_NONEXIST)
+		D_WARN("crt_grp_config_bin_psr_load (grpid %s) failed, rc: %d, "
+		       "retry with the text attach info.\n", grpid, rc);
+	rc = 0;
+
 	filename = crt_grp_attach_info_filename(grp_priv);
 	if (filename == NULL)
 		D_GOTO(out, rc = -DER_NOMEM);
@@ -2954,68 +4065,29 @@ out:
 }
 
 /*
- * mark rank as evicted in every crt_context's address lookup cache.
+ * mark rank as evicted in the address lookup cache.
  */
 static int
 crt_grp_lc_mark_evicted(struct crt_grp_priv *grp_priv, d_rank_t rank)
 {
-	int				 ctx_idx;
-	d_list_t			*rlink;
 	struct crt_lookup_item		*li;
-	struct d_hash_table		*htable;
 	int				 rc = 0;
 
 	D_ASSERT(grp_priv != NULL);
 	D_ASSERT(rank < grp_priv->gp_size);
 
-	for (ctx_idx = 0; ctx_idx < CRT_SRV_CONTEXT_NUM; ctx_idx++) {
-		htable = &grp_priv->gp_lookup_cache[ctx_idx];
-		D_RWLOCK_RDLOCK(&grp_priv->gp_rwlock);
-		rlink = d_hash_rec_find(htable, &rank, sizeof(rank));
-		if (rlink == NULL) {
-			D_RWLOCK_UNLOCK(&grp_priv->gp_rwlock);
-			D_ALLOC_PTR(li);
-			if (li == NULL)
-				D_GOTO(out, rc = -DER_NOMEM);
-			D_INIT_LIST_HEAD(&li->li_link);
-			li->li_grp_priv = grp_priv;
-			li->li_rank = rank;
-			D_STRNDUP(li->li_base_phy_addr, "evicted", 32);
-			li->li_initialized = 1;
-			li->li_evicted = 1;
-			rc = D_MUTEX_INIT(&li->li_mutex, NULL);
-			if (rc != 0) {
-				crt_li_destroy(li);
-				D_GOTO(out, rc);
-			}
+	D_RWLOCK_WRLOCK(&grp_priv->gp_rwlock);
+	rc = crt_grp_lc_get(grp_priv, rank, &li);
+	D_RWLOCK_UNLOCK(&grp_priv->gp_rwlock);
+	if (rc != 0)
+		return rc;
 
-			D_RWLOCK_WRLOCK(&grp_priv->gp_rwlock);
-			rc = d_hash_rec_insert(htable, &rank, sizeof(rank),
-					       &li->li_link, true);
-			if (rc == 0) {
-				D_RWLOCK_UNLOCK(&grp_priv->gp_rwlock);
-				continue;
-			}
-			/* insert failed */
-			crt_li_destroy(li);
-			D_DEBUG(DB_TRACE, "entry already exists, "
-				"group %s, rank %d, context id %d\n",
-				grp_priv->gp_pub.cg_grpid, rank, ctx_idx);
-			rlink = d_hash_rec_find(htable, (void *) &rank,
-						sizeof(rank));
-			D_ASSERT(rlink != NULL);
-		}
-		li = crt_li_link2ptr(rlink);
-		D_ASSERT(li->li_grp_priv == grp_priv);
-		D_ASSERT(li->li_rank == rank);
-		D_MUTEX_LOCK(&li->li_mutex);
-		li->li_evicted = 1;
-		D_MUTEX_UNLOCK(&li->li_mutex);
-		d_hash_rec_decref(htable, rlink);
-		D_RWLOCK_UNLOCK(&grp_priv->gp_rwlock);
-	}
+	D_ASSERT(li->li_grp_priv == grp_priv);
+	D_ASSERT(li->li_rank == rank);
+	D_MUTEX_LOCK(&li->li_mutex);
+	__atomic_store_n(&li->li_evicted, 1, __ATOMIC_RELEASE);
+	D_MUTEX_UNLOCK(&li->li_mutex);
 
-out:
 	return rc;
 }
 
@@ -3126,12 +4198,14 @@ crt_rank_evict(crt_group_t *grp, d_rank_t rank)
 	}
 
 	grp_priv->gp_membs_ver++;
+	crt_tree_topo_changed(grp_priv);
 	/* remove rank from sub groups */
 	d_list_for_each_entry(curr_entry, &crt_grp_list, gp_link) {
 		tmp_live_ranks = grp_priv_get_live_ranks(curr_entry);
 
 		d_rank_list_filter(&tmp_rank_list, tmp_live_ranks,
 				   true /* exclude */);
+		crt_tree_topo_changed(curr_entry);
 	}
 
 	D_RWLOCK_UNLOCK(grp_priv->gp_rwlock_ft);
@@ -3145,8 +4219,10 @@ crt_rank_evict(crt_group_t *grp, d_rank_t rank)
 		grp_priv->gp_pub.cg_grpid, rank);
 
 out_cb:
-	if (grp_priv->gp_local)
+	if (grp_priv->gp_local) {
 		crt_barrier_handle_eviction(grp_priv);
+		crt_coll_handle_eviction(grp_priv, rank);
+	}
 
 	crt_exec_eviction_cb(&grp_priv->gp_pub, rank);
 	tgt_ep.ep_grp = grp;
@@ -3335,6 +4411,7 @@ grp_regen_linear_list(struct crt_grp_priv *grp_priv)
 
 	membs = grp_priv->gp_membs.cgm_list;
 	linear_list = grp_priv->gp_membs.cgm_linear_list;
+	crt_tree_topo_changed(grp_priv);
 
 	/* If group size changed - reallocate the list */
 	if (!linear_list->rl_ranks ||
@@ -3430,14 +4507,65 @@ out:
 }
 
 
-int
-crt_group_node_add(crt_group_t *group, d_rank_t rank, int tag,
-		crt_node_info_t info)
+/*
+ * Record a change of the group info, gp_rwlock held for write. tag is the tag
+ * whose URI was added, or CRT_GRP_INFO_REMOVED if the rank was removed.
+ */
+static void
+crt_grp_info_log(struct crt_grp_priv *grp_priv, d_rank_t rank, uint32_t tag)
 {
-	struct crt_grp_priv	*grp_priv;
-	int			rc = 0;
+	struct crt_grp_info_rec	*rec;
 
-	if (CRT_PMIX_ENABLED()) {
+	grp_priv->gp_info_ver++;
+
+	if (grp_priv->gp_info_log == NULL) {
+		D_ALLOC_ARRAY(grp_priv->gp_info_log, CRT_GRP_INFO_LOG_SIZE);
+		/* without the log deltas fall back to snapshots */
+		if (grp_priv->gp_info_log == NULL)
+			return;
+	}
+
+	rec = &grp_priv->gp_info_log[grp_priv->gp_info_ver %
+				     CRT_GRP_INFO_LOG_SIZE];
+	rec->gir_ver = grp_priv->gp_info_ver;
+	rec->gir_rank = rank;
+	rec->gir_tag = tag;
+	if (grp_priv->gp_info_log_num < CRT_GRP_INFO_LOG_SIZE)
+		grp_priv->gp_info_log_num++;
+}
+
+static int
+crt_grp_node_add(struct crt_grp_priv *grp_priv, d_rank_t rank, uint32_t tag,
+		 const char *uri, bool log)
+{
+	int	rc;
+
+	rc = crt_grp_lc_uri_insert_all(&grp_priv->gp_pub, rank, tag, uri);
+	if (rc != 0) {
+		D_ERROR("crt_grp_lc_uri_insert_all() failed; rc=%d\n", rc);
+		return rc;
+	}
+
+	D_RWLOCK_WRLOCK(&grp_priv->gp_rwlock);
+	/* Only add node to membership list once, for tag 0 */
+	/* TODO: This logic needs to be refactored as part of CART-517 */
+	if (tag == 0)
+		rc = grp_add_to_membs_list(grp_priv, rank);
+	if (rc == 0 && log)
+		crt_grp_info_log(grp_priv, rank, tag);
+	D_RWLOCK_UNLOCK(&grp_priv->gp_rwlock);
+
+	return rc;
+}
+
+int
+crt_group_node_add(crt_group_t *group, d_rank_t rank, int tag,
+		crt_node_info_t info)
+{
+	struct crt_grp_priv	*grp_priv;
+	int			rc = 0;
+
+	if (CRT_PMIX_ENABLED()) {
 		D_ERROR("This api only avaialble when PMIX is disabled\n");
 		D_GOTO(out, rc = -DER_INVAL);
 	}
@@ -3454,24 +4582,371 @@ crt_group_node_add(crt_group_t *group, d_rank_t rank, int tag,
 		D_GOTO(out, rc = -DER_INVAL);
 	}
 
-	rc = crt_grp_lc_uri_insert_all(group, rank, tag, info.uri);
+	D_MUTEX_LOCK(&grp_priv->gp_info_mutex);
+	rc = crt_grp_node_add(grp_priv, rank, tag, info.uri, true);
+	D_MUTEX_UNLOCK(&grp_priv->gp_info_mutex);
+
+out:
+	return rc;
+}
+
+
+/*
+ * Expand the template for (host, port) into buf, returns the length of the URI
+ * or -DER_OVERFLOW if it does not fit in size bytes.
+ */
+static int
+crt_uri_tmpl_expand(struct crt_uri_tmpl *tmpl, const char *host,
+		    uint32_t port, char *buf, size_t size)
+{
+	const char	*p;
+	size_t		 len = 0;
+	int		 n;
+
+	for (p = tmpl->ut_fmt; *p != '\0'; p++) {
+		if (*p != '%') {
+			n = 1;
+			if (len + n < size)
+				buf[len] = *p;
+		} else if (*(++p) == 'h') {
+			n = snprintf(buf + len, size - len, "%s", host);
+		} else if (*p == 'p') {
+			n = snprintf(buf + len, size - len, "%u", port);
+		} else {
+			/* "%%", other conversions are refused at set time */
+			n = 1;
+			if (len + n < size)
+				buf[len] = '%';
+		}
+		len += n;
+		if (len >= size)
+			return -DER_OVERFLOW;
+	}
+	buf[len] = '\0';
+
+	return len;
+}
+
+int
+crt_group_uri_template_set(crt_group_t *group, const crt_uri_template_t *tmpl)
+{
+	struct crt_grp_priv	*grp_priv;
+	struct crt_uri_tmpl	*ut = NULL;
+	char			 uri[CRT_ADDR_STR_MAX_LEN];
+	const char		*p;
+	uint64_t		 port_max;
+	uint32_t		 i;
+	int			 rc = 0;
+
+	if (CRT_PMIX_ENABLED()) {
+		D_ERROR("This api only avaialble when PMIX is disabled\n");
+		D_GOTO(out, rc = -DER_INVAL);
+	}
+
+	if (group == NULL || tmpl == NULL) {
+		D_ERROR("Invalid argument, group %p, tmpl %p\n", group, tmpl);
+		D_GOTO(out, rc = -DER_INVAL);
+	}
+
+	grp_priv = crt_grp_pub2priv(group);
+	if (!grp_priv->gp_primary) {
+		D_ERROR("Only available for primary groups\n");
+		D_GOTO(out, rc = -DER_INVAL);
+	}
+
+	if (tmpl->ut_fmt == NULL || tmpl->ut_hosts == NULL ||
+	    tmpl->ut_host_num == 0 || tmpl->ut_ranks_per_host == 0 ||
+	    tmpl->ut_ports_per_rank == 0 ||
+	    tmpl->ut_ports_per_rank > CRT_SRV_CONTEXT_NUM) {
+		D_ERROR("Invalid URI template\n");
+		D_GOTO(out, rc = -DER_INVAL);
+	}
+
+	port_max = (uint64_t)tmpl->ut_port_base +
+		   (uint64_t)tmpl->ut_ranks_per_host *
+		   tmpl->ut_ports_per_rank - 1;
+	if (port_max > UINT16_MAX) {
+		D_ERROR("Port range [%u, "DF_U64"] is invalid\n",
+			tmpl->ut_port_base, port_max);
+		D_GOTO(out, rc = -DER_INVAL);
+	}
+
+	for (p = tmpl->ut_fmt; *p != '\0'; p++) {
+		if (*p != '%')
+			continue;
+		p++;
+		if (*p != 'h' && *p != 'p' && *p != '%') {
+			D_ERROR("Invalid URI template format %s\n",
+				tmpl->ut_fmt);
+			D_GOTO(out, rc = -DER_INVAL);
+		}
+	}
+
+	D_ALLOC_PTR(ut);
+	if (ut == NULL)
+		D_GOTO(out, rc = -DER_NOMEM);
+
+	D_STRNDUP(ut->ut_fmt, tmpl->ut_fmt, CRT_ADDR_STR_MAX_LEN);
+	if (ut->ut_fmt == NULL)
+		D_GOTO(out, rc = -DER_NOMEM);
+
+	D_ALLOC_ARRAY(ut->ut_hosts, tmpl->ut_host_num);
+	if (ut->ut_hosts == NULL)
+		D_GOTO(out, rc = -DER_NOMEM);
+	ut->ut_host_num = tmpl->ut_host_num;
+
+	for (i = 0; i < tmpl->ut_host_num; i++) {
+		if (tmpl->ut_hosts[i] == NULL) {
+			D_ERROR("Host %d of URI template is NULL\n", i);
+			D_GOTO(out, rc = -DER_INVAL);
+		}
+		D_STRNDUP(ut->ut_hosts[i], tmpl->ut_hosts[i],
+			  CRT_ADDR_STR_MAX_LEN);
+		if (ut->ut_hosts[i] == NULL)
+			D_GOTO(out, rc = -DER_NOMEM);
+
+		/* catch the URIs too long for the cache up front */
+		rc = crt_uri_tmpl_expand(ut, ut->ut_hosts[i], port_max,
+					 uri, sizeof(uri));
+		if (rc < 0) {
+			D_ERROR("URI of host %s too long\n", ut->ut_hosts[i]);
+			D_GOTO(out, rc = -DER_INVAL);
+		}
+		rc = 0;
+	}
+
+	ut->ut_ranks_per_host = tmpl->ut_ranks_per_host;
+	ut->ut_port_base = tmpl->ut_port_base;
+	ut->ut_ports_per_rank = tmpl->ut_ports_per_rank;
+
+	/* set once, readers load it without the lock */
+	D_RWLOCK_WRLOCK(&grp_priv->gp_rwlock);
+	if (grp_priv->gp_uri_tmpl != NULL) {
+		rc = -DER_EXIST;
+	} else {
+		__atomic_store_n(&grp_priv->gp_uri_tmpl, ut, __ATOMIC_RELEASE);
+		/* the template gives the locality of the ranks */
+		crt_tree_topo_changed(grp_priv);
+	}
+	D_RWLOCK_UNLOCK(&grp_priv->gp_rwlock);
 	if (rc != 0) {
-		D_ERROR("crt_grp_lc_uri_insert_all() failed; rc=%d\n", rc);
+		D_ERROR("Group %s already has a URI template\n",
+			group->cg_grpid);
 		D_GOTO(out, rc);
 	}
 
-	/* Only add node to membership list once, for tag 0 */
-	/* TODO: This logic needs to be refactored as part of CART-517 */
-	if (tag == 0) {
-		D_RWLOCK_WRLOCK(&grp_priv->gp_rwlock);
-		rc = grp_add_to_membs_list(grp_priv, rank);
-		D_RWLOCK_UNLOCK(&grp_priv->gp_rwlock);
+	D_DEBUG(DB_TRACE, "group %s URI template %s, %u hosts, %u ranks per "
+		"host, ports %u-%u\n", group->cg_grpid, ut->ut_fmt,
+		ut->ut_host_num, ut->ut_ranks_per_host, ut->ut_port_base,
+		(uint32_t)port_max);
+	ut = NULL;
+
+out:
+	crt_uri_tmpl_free(ut);
+	return rc;
+}
+
+/*
+ * Compute the URI of (rank, tag) from the group's URI template and fill it in
+ * the lookup cache. *uri is set to a copy the caller frees, or to NULL if the
+ * group has no template or (rank, tag) is not covered by it.
+ */
+int
+crt_grp_uri_tmpl_lookup(struct crt_grp_priv *grp_priv, d_rank_t rank,
+			uint32_t tag, crt_phy_addr_t *uri)
+{
+	struct crt_grp_priv	*default_grp_priv;
+	struct crt_uri_tmpl	*tmpl;
+	char			 buf[CRT_ADDR_STR_MAX_LEN];
+	uint32_t		 host_idx;
+	uint32_t		 port;
+	int			 rc;
+
+	D_ASSERT(grp_priv != NULL);
+	D_ASSERT(uri != NULL);
+	*uri = NULL;
+
+	if (crt_gdata.cg_share_na == true)
+		tag = 0;
+
+	default_grp_priv = grp_priv;
+	if (grp_priv->gp_primary == 0) {
+		default_grp_priv = crt_grp_pub2priv(NULL);
+		D_ASSERT(default_grp_priv != NULL);
+		rank = grp_priv_get_primary_rank(grp_priv, rank);
 	}
 
+	tmpl = __atomic_load_n(&default_grp_priv->gp_uri_tmpl,
+			       __ATOMIC_ACQUIRE);
+	if (tmpl == NULL)
+		return 0;
+
+	host_idx = rank / tmpl->ut_ranks_per_host;
+	if (host_idx >= tmpl->ut_host_num || tag >= tmpl->ut_ports_per_rank)
+		return 0;
+
+	port = tmpl->ut_port_base +
+	       (rank % tmpl->ut_ranks_per_host) * tmpl->ut_ports_per_rank + tag;
+	rc = crt_uri_tmpl_expand(tmpl, tmpl->ut_hosts[host_idx], port,
+				 buf, sizeof(buf));
+	D_ASSERT(rc > 0);
+
+	rc = crt_grp_lc_uri_insert(default_grp_priv, rank, tag, buf);
+	if (rc != 0) {
+		D_ERROR("crt_grp_lc_uri_insert() failed, rc: %d\n", rc);
+		return rc;
+	}
+
+	D_STRNDUP(*uri, buf, CRT_ADDR_STR_MAX_LEN);
+	if (*uri == NULL)
+		return -DER_NOMEM;
+
+	D_DEBUG(DB_TRACE, "rank %d tag %d URI %s from template\n",
+		rank, tag, buf);
+
+	return 0;
+}
+
+
+int
+crt_group_locality_set(crt_group_t *group, const uint32_t *locality,
+		       uint32_t nr)
+{
+	struct crt_grp_priv	*grp_priv;
+	uint32_t		*loc_map = NULL;
+	int			 rc = 0;
+
+	if (group == NULL || (locality == NULL && nr != 0)) {
+		D_ERROR("Invalid argument, group %p, locality %p, nr %u\n",
+			group, locality, nr);
+		D_GOTO(out, rc = -DER_INVAL);
+	}
+
+	grp_priv = crt_grp_pub2priv(group);
+	if (!grp_priv->gp_primary || !grp_priv->gp_service) {
+		D_ERROR("Only available for primary service groups\n");
+		D_GOTO(out, rc = -DER_INVAL);
+	}
+
+	if (locality != NULL && nr > 0) {
+		D_ALLOC_ARRAY(loc_map, nr);
+		if (loc_map == NULL)
+			D_GOTO(out, rc = -DER_NOMEM);
+		memcpy(loc_map, locality, nr * sizeof(*loc_map));
+	} else {
+		nr = 0;
+	}
+
+	D_RWLOCK_WRLOCK(grp_priv->gp_rwlock_ft);
+	D_FREE(grp_priv->gp_loc_map);
+	grp_priv->gp_loc_map = loc_map;
+	grp_priv->gp_loc_map_nr = nr;
+	crt_tree_topo_changed(grp_priv);
+	D_RWLOCK_UNLOCK(grp_priv->gp_rwlock_ft);
+
 out:
 	return rc;
 }
 
+/* FNV-1a hash of the host of uri, i.e. between "://" and the port */
+static uint32_t
+crt_uri_host_hash(const char *uri)
+{
+	const char	*host;
+	const char	*end;
+	uint32_t	 hash = 2166136261U;
+
+	host = strstr(uri, "://");
+	host = (host == NULL) ? uri : host + 3;
+	end = strrchr(host, ':');
+	if (end == NULL)
+		end = host + strlen(host);
+
+	for (; host < end; host++) {
+		hash ^= (unsigned char)*host;
+		hash *= 16777619U;
+	}
+
+	return hash == CRT_LOC_NONE ? 0 : hash;
+}
+
+/*
+ * Locality of primary rank, from the locality map if set, else from the URI
+ * template if set, else from the host of its tag 0 URI. The URIs are only
+ * used with PMIX disabled, where all the ranks learn them with the
+ * membership, PMIX fills the cache lazily and differently on each rank.
+ */
+static uint32_t
+crt_grp_rank_locality(struct crt_grp_priv *grp_priv, d_rank_t rank)
+{
+	struct crt_uri_tmpl	*tmpl;
+	struct crt_lookup_item	*li;
+	struct crt_lookup_tag	*lt;
+	crt_phy_addr_t		 uri;
+
+	if (grp_priv->gp_loc_map != NULL)
+		return rank < grp_priv->gp_loc_map_nr ?
+		       grp_priv->gp_loc_map[rank] : CRT_LOC_NONE;
+
+	tmpl = __atomic_load_n(&grp_priv->gp_uri_tmpl, __ATOMIC_ACQUIRE);
+	if (tmpl != NULL) {
+		rank /= tmpl->ut_ranks_per_host;
+		return rank < tmpl->ut_host_num ? rank : CRT_LOC_NONE;
+	}
+
+	if (CRT_PMIX_ENABLED() || grp_priv->gp_lookup_cache == NULL)
+		return CRT_LOC_NONE;
+
+	li = crt_grp_lc_find(grp_priv, rank);
+	if (li == NULL)
+		return CRT_LOC_NONE;
+	lt = crt_li_tag_find(li, 0);
+	if (lt == NULL)
+		return CRT_LOC_NONE;
+	uri = __atomic_load_n(&lt->lt_uri, __ATOMIC_ACQUIRE);
+	if (uri == NULL)
+		return CRT_LOC_NONE;
+
+	return crt_uri_host_hash(uri);
+}
+
+/*
+ * Returns in *grp_loc the locality of each rank of rank_list (primary ranks),
+ * NULL if the locality of any of them is unknown. gp_rwlock_ft held.
+ */
+int
+crt_grp_locality_get(struct crt_grp_priv *grp_priv, d_rank_list_t *rank_list,
+		     uint32_t **grp_loc)
+{
+	uint32_t	*loc;
+	uint32_t	 i;
+
+	*grp_loc = NULL;
+	if (!grp_priv->gp_primary) {
+		grp_priv = crt_grp_pub2priv(NULL);
+		D_ASSERT(grp_priv != NULL);
+	}
+
+	D_ALLOC_ARRAY(loc, rank_list->rl_nr);
+	if (loc == NULL)
+		return -DER_NOMEM;
+
+	for (i = 0; i < rank_list->rl_nr; i++) {
+		loc[i] = crt_grp_rank_locality(grp_priv,
+					       rank_list->rl_ranks[i]);
+		if (loc[i] == CRT_LOC_NONE) {
+			D_DEBUG(DB_TRACE, "group %s rank %d has no locality\n",
+				grp_priv->gp_pub.cg_grpid,
+				rank_list->rl_ranks[i]);
+			D_FREE(loc);
+			return 0;
+		}
+	}
+
+	*grp_loc = loc;
+	return 0;
+}
+
 
 
 int
@@ -3508,6 +4983,7 @@ crt_rank_self_set(d_rank_t rank)
 		D_GOTO(out, rc);
 	}
 
+	D_MUTEX_LOCK(&default_grp_priv->gp_info_mutex);
 	D_RWLOCK_RDLOCK(&crt_gdata.cg_rwlock);
 	d_list_for_each_entry(ctx, &crt_gdata.cg_ctx_list, cc_link) {
 		na_class =  ctx->cc_hg_ctx.chc_nacla;
@@ -3526,10 +5002,15 @@ crt_rank_self_set(d_rank_t rank)
 			D_GOTO(unlock, rc);
 		}
 
+		D_RWLOCK_WRLOCK(&default_grp_priv->gp_rwlock);
+		crt_grp_info_log(default_grp_priv, rank, ctx->cc_idx);
+		D_RWLOCK_UNLOCK(&default_grp_priv->gp_rwlock);
+
 	}
 
 unlock:
 	D_RWLOCK_UNLOCK(&crt_gdata.cg_rwlock);
+	D_MUTEX_UNLOCK(&default_grp_priv->gp_info_mutex);
 out:
 	return rc;
 }
@@ -3586,32 +5067,14 @@ out:
 	return rc;
 }
 
-int crt_group_rank_remove(crt_group_t *group, d_rank_t rank)
+static int
+crt_grp_rank_remove(struct crt_grp_priv *grp_priv, d_rank_t rank, bool log)
 {
-	struct crt_grp_priv	*grp_priv;
 	d_rank_list_t		*membs;
 	int			i;
 	int			rc = -DER_OOG;
 
-	if (CRT_PMIX_ENABLED()) {
-		D_ERROR("This api only avaialble when PMIX is disabled\n");
-		D_GOTO(out, rc = -DER_INVAL);
-	}
-
-	if (group == NULL) {
-		D_ERROR("Passed group is NULL\n");
-		D_GOTO(out, rc = -DER_INVAL);
-	}
-
-	grp_priv = crt_grp_pub2priv(group);
-
-	if (!grp_priv->gp_primary) {
-		D_ERROR("Only available for primary groups\n");
-		D_GOTO(out, rc = -DER_INVAL);
-	}
-
-	for (i = 0; i < CRT_SRV_CONTEXT_NUM; i++)
-		crt_grp_lc_uri_remove(grp_priv, i, rank);
+	crt_grp_lc_uri_remove(grp_priv, rank);
 
 	D_RWLOCK_WRLOCK(&grp_priv->gp_rwlock);
 	membs = grp_priv->gp_membs.cgm_list;
@@ -3624,6 +5087,9 @@ int crt_group_rank_remove(crt_group_t *group, d_rank_t rank)
 				&grp_priv->gp_membs.cgm_free_indices,
 				i, false);
 			grp_regen_linear_list(grp_priv);
+			if (log)
+				crt_grp_info_log(grp_priv, rank,
+						 CRT_GRP_INFO_REMOVED);
 			rc = 0;
 			break;
 		}
@@ -3631,24 +5097,13 @@ int crt_group_rank_remove(crt_group_t *group, d_rank_t rank)
 	}
 	D_RWLOCK_UNLOCK(&grp_priv->gp_rwlock);
 
-out:
 	return rc;
 }
 
-
-int crt_group_info_get(crt_group_t *group, d_iov_t *grp_info)
+int crt_group_rank_remove(crt_group_t *group, d_rank_t rank)
 {
 	struct crt_grp_priv	*grp_priv;
-	d_rank_list_t		*membs;
-	int			i;
-	int			rc = 0;
-	d_rank_t		rank;
-	struct crt_lookup_item	*li;
-	d_list_t		*rlink;
-	int			x;
-	int			total_size = 0;
-	char			*ptr;
-	int			uri_size;
+	int			rc;
 
 	if (CRT_PMIX_ENABLED()) {
 		D_ERROR("This api only avaialble when PMIX is disabled\n");
@@ -3667,97 +5122,497 @@ int crt_group_info_get(crt_group_t *group, d_iov_t *grp_info)
 		D_GOTO(out, rc = -DER_INVAL);
 	}
 
-	D_RWLOCK_WRLOCK(&grp_priv->gp_rwlock);
-	membs = grp_priv->gp_membs.cgm_linear_list;
+	D_MUTEX_LOCK(&grp_priv->gp_info_mutex);
+	rc = crt_grp_rank_remove(grp_priv, rank, true);
+	D_MUTEX_UNLOCK(&grp_priv->gp_info_mutex);
 
-	/* First calculate total size required to store all group info */
-	total_size = 0;
-	/* TODO Phase2: total size need to include group identifier */
-	for (i = 0; i < membs->rl_nr; i++) {
-		rank = membs->rl_ranks[i];
+out:
+	return rc;
+}
+
+/*
+ * Group info buffer, see crt_group_info_get():
+ *   struct crt_grp_info_hdr
+ *   entries of d_rank_t rank, uint32_t tag, uint32_t uri_size, char uri[]
+ * uri_size includes the NUL, 0 means the rank was removed (delta only). A
+ * snapshot lists all the URIs of the group, grouped by rank. A delta lists the
+ * changes from gih_base_ver to gih_ver in order.
+ */
+#define CRT_GRP_INFO_MAGIC	(0x43524749) /* "CRGI" */
+#define CRT_GRP_INFO_VERSION	(1)
+#define CRT_GRP_INFO_DELTA	(1U << 0)
+
+struct crt_grp_info_hdr {
+	uint32_t	gih_magic;
+	uint16_t	gih_version;
+	uint16_t	gih_flags;
+	uint64_t	gih_base_ver;
+	uint64_t	gih_ver;
+};
+
+#define CRT_GRP_INFO_ENTRY_HDR_SIZE	(sizeof(d_rank_t) + 2 * sizeof(uint32_t))
+
+/* an unpacked entry, ge_uri points into the buffer */
+struct crt_grp_info_entry {
+	d_rank_t	 ge_rank;
+	uint32_t	 ge_tag;
+	const char	*ge_uri;
+};
+
+/* append an entry to the buffer, growing it as needed */
+static int
+crt_grp_info_pack(d_iov_t *grp_info, d_rank_t rank, uint32_t tag,
+		  const char *uri)
+{
+	char		*ptr;
+	size_t		 len;
+	uint32_t	 uri_size;
+
+	uri_size = uri == NULL ? 0 : strlen(uri) + 1;
+	len = CRT_GRP_INFO_ENTRY_HDR_SIZE + uri_size;
+	if (grp_info->iov_len + len > grp_info->iov_buf_len) {
+		size_t	 buf_len;
+		void	*buf;
+
+		buf_len = max(grp_info->iov_buf_len * 2,
+			      grp_info->iov_len + len);
+		D_REALLOC(buf, grp_info->iov_buf, buf_len);
+		if (buf == NULL)
+			return -DER_NOMEM;
+		grp_info->iov_buf = buf;
+		grp_info->iov_buf_len = buf_len;
+	}
+
+	ptr = (char *)grp_info->iov_buf + grp_info->iov_len;
+
+	/* Pack rank */
+	*((d_rank_t *)ptr) = rank;
+	ptr += sizeof(d_rank_t);
+
+	/* Pack tag */
+	*((uint32_t *)ptr) = tag;
+	ptr += sizeof(uint32_t);
+
+	/* Pack uri size */
+	*((uint32_t *)ptr) = uri_size;
+	ptr += sizeof(uint32_t);
+
+	/* Pack uri */
+	if (uri_size != 0)
+		memcpy(ptr, uri, uri_size);
 
-		rlink = d_hash_rec_find(&grp_priv->gp_lookup_cache[0],
-					(void *)&rank, sizeof(rank));
+	grp_info->iov_len += len;
 
-		if (rlink == NULL) {
-			D_ERROR("No record found for rank=%d\n", rank);
+	D_DEBUG(DB_ALL, "Rank=%d tag=%d uri=%s\n", rank, tag,
+		uri == NULL ? "(removed)" : uri);
+
+	return 0;
+}
+
+/* append the URIs of rank, or of its (rank, tag) only if tag is not -1 */
+static int
+crt_grp_info_pack_rank(d_iov_t *grp_info, struct crt_grp_priv *grp_priv,
+		       d_rank_t rank, int tag)
+{
+	struct crt_lookup_item	*li;
+	struct crt_lookup_tag	*lt;
+	int			 x;
+	int			 rc = 0;
+
+	li = crt_grp_lc_find(grp_priv, rank);
+	if (li == NULL) {
+		D_DEBUG(DB_TRACE, "No record found for rank=%d\n", rank);
+		return 0;
+	}
+
+	D_MUTEX_LOCK(&li->li_mutex);
+	for (x = 0 ; li->li_tags != NULL && x < li->li_tags->lts_num; x++) {
+		lt = &li->li_tags->lts_tag[x];
+		if (lt->lt_uri == NULL || (tag != -1 && lt->lt_tag != tag))
 			continue;
-		}
 
-		li = crt_li_link2ptr(rlink);
+		rc = crt_grp_info_pack(grp_info, rank, lt->lt_tag, lt->lt_uri);
+		if (rc != 0)
+			break;
+	}
+	D_MUTEX_UNLOCK(&li->li_mutex);
 
-		for (x = 0 ; x < CRT_SRV_CONTEXT_NUM; x++) {
-			if (li->li_uri[x] != NULL) {
-				/* Allocate space for rank:tag:uri_size:uri */
-				total_size += sizeof(d_rank_t);
-				total_size += sizeof(uint32_t);
-				total_size += sizeof(uint32_t);
-				total_size += strlen(li->li_uri[x]) + 1;
-			}
+	return rc;
+}
+
+/*
+ * Export the group info, a delta from since_ver if the change log still holds
+ * it, a snapshot otherwise.
+ */
+static int
+crt_grp_info_export(crt_group_t *group, uint64_t since_ver, bool delta,
+		    d_iov_t *grp_info)
+{
+	struct crt_grp_priv	*grp_priv;
+	struct crt_grp_info_hdr	*hdr;
+	struct crt_grp_info_rec	*rec;
+	d_rank_list_t		*membs;
+	uint64_t		 ver;
+	int			 i;
+	int			 rc = 0;
+
+	if (CRT_PMIX_ENABLED()) {
+		D_ERROR("This api only avaialble when PMIX is disabled\n");
+		return -DER_INVAL;
+	}
+
+	if (group == NULL || grp_info == NULL) {
+		D_ERROR("Passed group or grp_info is NULL\n");
+		return -DER_INVAL;
+	}
+
+	grp_priv = crt_grp_pub2priv(group);
+
+	if (!grp_priv->gp_primary) {
+		D_ERROR("Only available for primary groups\n");
+		return -DER_INVAL;
+	}
+
+	memset(grp_info, 0, sizeof(*grp_info));
+
+	/* changes lock gp_rwlock for write, readers share the buffer walk */
+	D_RWLOCK_RDLOCK(&grp_priv->gp_rwlock);
+	if (delta && (since_ver > grp_priv->gp_info_ver ||
+		      grp_priv->gp_info_ver - since_ver >
+		      grp_priv->gp_info_log_num))
+		delta = false;
+
+	D_ALLOC_PTR(hdr);
+	if (hdr == NULL)
+		D_GOTO(unlock, rc = -DER_NOMEM);
+	hdr->gih_magic = CRT_GRP_INFO_MAGIC;
+	hdr->gih_version = CRT_GRP_INFO_VERSION;
+	hdr->gih_flags = delta ? CRT_GRP_INFO_DELTA : 0;
+	hdr->gih_base_ver = delta ? since_ver : 0;
+	hdr->gih_ver = grp_priv->gp_info_ver;
+	grp_info->iov_buf = hdr;
+	grp_info->iov_buf_len = sizeof(*hdr);
+	grp_info->iov_len = sizeof(*hdr);
+
+	if (delta) {
+		/* Fill in the changes, with the current URI of added tags */
+		for (ver = since_ver + 1; ver <= grp_priv->gp_info_ver; ver++) {
+			rec = &grp_priv->gp_info_log[ver %
+						     CRT_GRP_INFO_LOG_SIZE];
+			D_ASSERT(rec->gir_ver == ver);
+			if (rec->gir_tag == CRT_GRP_INFO_REMOVED)
+				rc = crt_grp_info_pack(grp_info, rec->gir_rank,
+						       0, NULL);
+			else
+				rc = crt_grp_info_pack_rank(grp_info, grp_priv,
+							    rec->gir_rank,
+							    rec->gir_tag);
+			if (rc != 0)
+				D_GOTO(unlock, rc);
+		}
+	} else {
+		/* Fill in iov buffer with rank:tag:uri tuples */
+		membs = grp_priv->gp_membs.cgm_linear_list;
+		for (i = 0; i < membs->rl_nr; i++) {
+			rc = crt_grp_info_pack_rank(grp_info, grp_priv,
+						    membs->rl_ranks[i], -1);
+			if (rc != 0)
+				D_GOTO(unlock, rc);
 		}
 	}
 
+unlock:
+	D_RWLOCK_UNLOCK(&grp_priv->gp_rwlock);
+	if (rc != 0) {
+		D_FREE(grp_info->iov_buf);
+		grp_info->iov_buf_len = 0;
+		grp_info->iov_len = 0;
+	}
+	return rc;
+}
 
-	/* Allocate memory for the group info buffer */
-	D_ALLOC(grp_info->iov_buf, total_size);
-	if (grp_info->iov_buf == NULL) {
-		D_ERROR("Failed to allocate grp_info buffer of size %d\n",
-			total_size);
-		D_RWLOCK_UNLOCK(&grp_priv->gp_rwlock);
-		D_GOTO(out, rc = -DER_NOMEM);
+int crt_group_info_get(crt_group_t *group, d_iov_t *grp_info)
+{
+	return crt_grp_info_export(group, 0, false, grp_info);
+}
+
+int crt_group_info_delta_get(crt_group_t *group, uint64_t since_ver,
+			     d_iov_t *grp_info)
+{
+	return crt_grp_info_export(group, since_ver, true, grp_info);
+}
+
+int crt_group_info_ver_get(crt_group_t *group, uint64_t *ver)
+{
+	struct crt_grp_priv	*grp_priv;
+
+	if (group == NULL || ver == NULL) {
+		D_ERROR("Passed group or ver is NULL\n");
+		return -DER_INVAL;
 	}
 
-	ptr = grp_info->iov_buf;
-	grp_info->iov_buf_len = total_size;
-	grp_info->iov_len = total_size;
+	grp_priv = crt_grp_pub2priv(group);
+	D_RWLOCK_RDLOCK(&grp_priv->gp_rwlock);
+	*ver = grp_priv->gp_info_ver;
+	D_RWLOCK_UNLOCK(&grp_priv->gp_rwlock);
 
-	/* Fill in iov buffer with rank:tag:uri tuples */
-	for (i = 0; i < membs->rl_nr; i++) {
-		rank = membs->rl_ranks[i];
+	return 0;
+}
 
-		rlink = d_hash_rec_find(&grp_priv->gp_lookup_cache[0],
-					&rank, sizeof(rank));
+/* Unpack the entries after the header, pointing into the buffer */
+static int
+crt_grp_info_unpack(d_iov_t *grp_info, struct crt_grp_info_entry **entries,
+		    uint32_t *entry_num)
+{
+	struct crt_grp_info_entry	*ents = NULL;
+	uint32_t			 num = 0;
+	uint32_t			 cap = 0;
+	uint32_t			 uri_size;
+	char				*ptr;
+	size_t				 size;
+	int				 rc = 0;
 
-		if (rlink == NULL) {
-			D_ERROR("No record found for rank=%d\n", rank);
-			continue;
+	ptr = (char *)grp_info->iov_buf + sizeof(struct crt_grp_info_hdr);
+	size = grp_info->iov_len - sizeof(struct crt_grp_info_hdr);
+
+	while (size > 0) {
+		if (size < CRT_GRP_INFO_ENTRY_HDR_SIZE)
+			D_GOTO(out, rc = -DER_INVAL);
+
+		if (num == cap) {
+			struct crt_grp_info_entry *tmp;
+
+			cap = max(cap * 2, 64);
+			D_REALLOC_ARRAY(tmp, ents, cap);
+			if (tmp == NULL)
+				D_GOTO(out, rc = -DER_NOMEM);
+			ents = tmp;
 		}
 
-		li = crt_li_link2ptr(rlink);
+		/* Unpack rank, tag and size of uri string */
+		ents[num].ge_rank = *((d_rank_t *)ptr);
+		ptr += sizeof(d_rank_t);
+		ents[num].ge_tag = *((uint32_t *)ptr);
+		ptr += sizeof(uint32_t);
+		uri_size = *((uint32_t *)ptr);
+		ptr += sizeof(uint32_t);
+		size -= CRT_GRP_INFO_ENTRY_HDR_SIZE;
 
-		for (x = 0 ; x < CRT_SRV_CONTEXT_NUM; x++) {
-			if (li->li_uri[x] == NULL)
-				continue;
+		/* Unpack uri */
+		if (uri_size > size || uri_size > CRT_ADDR_STR_MAX_LEN ||
+		    (uri_size != 0 && ptr[uri_size - 1] != '\0'))
+			D_GOTO(out, rc = -DER_INVAL);
+		ents[num].ge_uri = uri_size == 0 ? NULL : ptr;
+		ptr += uri_size;
+		size -= uri_size;
+		num++;
+	}
 
-			/* Pack rank */
-			*((d_rank_t *)ptr) = rank;
-			ptr += sizeof(d_rank_t);
+out:
+	if (rc != 0) {
+		D_ERROR("Bad group info entry %d, rc: %d\n", num, rc);
+		D_FREE(ents);
+		num = 0;
+	}
+	*entries = ents;
+	*entry_num = num;
+	return rc;
+}
 
-			/* Pack tag */
-			*((uint32_t *)ptr) = x;
-			ptr += sizeof(uint32_t);
+/* true if the cache holds another URI for the (rank, tag) of ent */
+static bool
+crt_grp_info_uri_changed(struct crt_grp_priv *grp_priv,
+			 struct crt_grp_info_entry *ent)
+{
+	struct crt_lookup_item	*li;
+	struct crt_lookup_tag	*lt;
+	char			*uri;
+
+	li = crt_grp_lc_find(grp_priv, ent->ge_rank);
+	if (li == NULL)
+		return false;
+	lt = crt_li_tag_find(li, ent->ge_tag);
+	if (lt == NULL)
+		return false;
+	uri = __atomic_load_n(&lt->lt_uri, __ATOMIC_ACQUIRE);
+
+	return uri != NULL && strcmp(uri, ent->ge_uri) != 0;
+}
 
-			/* Pack uri size */
-			uri_size = strlen(li->li_uri[x]) + 1;
-			*((uint32_t *)ptr) = uri_size;
-			ptr += sizeof(uint32_t);
+/*
+ * Apply the entries of one rank. Unchanged URIs are kept, along with the
+ * addresses resolved for them, a rank with a changed URI is replaced.
+ */
+static int
+crt_grp_info_rank_apply(struct crt_grp_priv *grp_priv,
+			struct crt_grp_info_entry *ents, uint32_t num)
+{
+	struct crt_lookup_item	*li;
+	struct crt_lookup_tag	*lt;
+	d_rank_t		 rank = ents[0].ge_rank;
+	uint32_t		 i;
+	int			 rc = 0;
 
-			/* Pack uri */
-			memcpy(ptr, li->li_uri[x], uri_size);
-			ptr += uri_size;
+	/* the rank restarted at a new address, unless removed first */
+	for (i = 0; i < num && ents[i].ge_uri != NULL; i++) {
+		if (!crt_grp_info_uri_changed(grp_priv, &ents[i]))
+			continue;
 
-			D_DEBUG(DB_ALL, "Rank=%d tag=%d uri=%s\n",
-					rank, x, li->li_uri[x]);
+		D_DEBUG(DB_TRACE, "rank %d tag %d uri changed to %s\n",
+			rank, ents[i].ge_tag, ents[i].ge_uri);
+		rc = crt_grp_rank_remove(grp_priv, rank, false);
+		if (rc != 0)
+			return rc;
+		break;
+	}
+
+	for (i = 0; i < num; i++) {
+		if (ents[i].ge_uri == NULL) {
+			/* removed, a later entry may add it back */
+			rc = crt_grp_rank_remove(grp_priv, rank, false);
+			if (rc != 0 && rc != -DER_OOG)
+				return rc;
+			continue;
+		}
+
+		/* unchanged, checked above */
+		li = crt_grp_lc_find(grp_priv, rank);
+		lt = li == NULL ? NULL : crt_li_tag_find(li, ents[i].ge_tag);
+		if (lt != NULL && lt->lt_uri != NULL)
+			continue;
+
+		rc = crt_grp_node_add(grp_priv, rank, ents[i].ge_tag,
+				      ents[i].ge_uri, false);
+		if (rc != 0) {
+			D_ERROR("Cant add rank=%d:%d uri='%s' rc=%d\n",
+				rank, ents[i].ge_tag, ents[i].ge_uri, rc);
+			return rc;
 		}
 	}
 
+	return 0;
+}
+
+/* remove the ranks of grp_priv which are not in the snapshot */
+static int
+crt_grp_info_prune(struct crt_grp_priv *grp_priv,
+		   struct crt_grp_info_entry *ents, uint32_t num)
+{
+	d_rank_list_t	*membs = NULL;
+	d_rank_t	*ranks = NULL;
+	uint32_t	 i;
+	int		 rc;
+
+	D_ALLOC_ARRAY(ranks, num);
+	if (ranks == NULL && num != 0)
+		D_GOTO(out, rc = -DER_NOMEM);
+	for (i = 0; i < num; i++)
+		ranks[i] = ents[i].ge_rank;
+	qsort(ranks, num, sizeof(*ranks), crt_rank_cmp);
+
+	D_RWLOCK_RDLOCK(&grp_priv->gp_rwlock);
+	rc = d_rank_list_dup(&membs, grp_priv->gp_membs.cgm_linear_list);
 	D_RWLOCK_UNLOCK(&grp_priv->gp_rwlock);
+	if (rc != 0)
+		D_GOTO(out, rc);
+
+	for (i = 0; membs != NULL && i < membs->rl_nr; i++) {
+		if (membs->rl_ranks[i] == grp_priv->gp_self ||
+		    bsearch(&membs->rl_ranks[i], ranks, num, sizeof(*ranks),
+			    crt_rank_cmp) != NULL)
+			continue;
+
+		D_DEBUG(DB_TRACE, "rank %d not in group info, removed\n",
+			membs->rl_ranks[i]);
+		rc = crt_grp_rank_remove(grp_priv, membs->rl_ranks[i], false);
+		if (rc == -DER_OOG)
+			rc = 0;
+		if (rc != 0)
+			break;
+	}
 
 out:
+	d_rank_list_free(membs);
+	D_FREE(ranks);
 	return rc;
 }
 
-int crt_group_info_set(d_iov_t *grp_info)
+static int
+crt_grp_info_apply(struct crt_grp_priv *grp_priv, d_iov_t *grp_info)
+{
+	struct crt_grp_info_hdr		*hdr = grp_info->iov_buf;
+	struct crt_grp_info_entry	*ents = NULL;
+	uint32_t			 num = 0;
+	uint32_t			 i;
+	uint32_t			 j;
+	uint64_t			 ver;
+	bool				 delta;
+	int				 rc;
+
+	if (hdr->gih_version != CRT_GRP_INFO_VERSION) {
+		D_ERROR("Group info version %d, expecting %d\n",
+			hdr->gih_version, CRT_GRP_INFO_VERSION);
+		return -DER_MISMATCH;
+	}
+
+	rc = crt_grp_info_unpack(grp_info, &ents, &num);
+	if (rc != 0)
+		return rc;
+
+	/*
+	 * no other change of the group info from the check of the base
+	 * version to the adoption of the new one
+	 */
+	D_MUTEX_LOCK(&grp_priv->gp_info_mutex);
+	delta = hdr->gih_flags & CRT_GRP_INFO_DELTA;
+	D_RWLOCK_RDLOCK(&grp_priv->gp_rwlock);
+	ver = grp_priv->gp_info_ver;
+	D_RWLOCK_UNLOCK(&grp_priv->gp_rwlock);
+	if (delta && hdr->gih_base_ver != ver) {
+		D_ERROR("Group info delta from version "DF_U64", group at "
+			"version "DF_U64"\n", hdr->gih_base_ver, ver);
+		D_GOTO(out, rc = -DER_MISMATCH);
+	}
+
+	/* apply the runs of entries of a same rank */
+	for (i = 0; i < num; i = j) {
+		for (j = i + 1; j < num && ents[j].ge_rank == ents[i].ge_rank;
+		     j++)
+			;
+		if (ents[i].ge_rank == grp_priv->gp_self)
+			continue;
+
+		rc = crt_grp_info_rank_apply(grp_priv, &ents[i], j - i);
+		if (rc != 0)
+			D_GOTO(out, rc);
+	}
+
+	if (!delta) {
+		rc = crt_grp_info_prune(grp_priv, ents, num);
+		if (rc != 0)
+			D_GOTO(out, rc);
+	}
+
+	D_RWLOCK_WRLOCK(&grp_priv->gp_rwlock);
+	/* the log no longer matches the adopted version */
+	grp_priv->gp_info_ver = hdr->gih_ver;
+	grp_priv->gp_info_log_num = 0;
+	D_RWLOCK_UNLOCK(&grp_priv->gp_rwlock);
+
+	D_DEBUG(DB_TRACE, "Applied group info %s version "DF_U64", %d "
+		"entries\n", delta ? "delta to" : "snapshot", hdr->gih_ver,
+		num);
+
+out:
+	D_MUTEX_UNLOCK(&grp_priv->gp_info_mutex);
+	D_FREE(ents);
+	return rc;
+}
+
+/* Set group info from a buffer without header, as packed by older versions */
+static int
+crt_grp_info_legacy_set(struct crt_grp_priv *default_grp_priv,
+			d_iov_t *grp_info)
 {
 	char			*ptr;
 	d_rank_t		rank;
@@ -3766,16 +5621,10 @@ int crt_group_info_set(d_iov_t *grp_info)
 	int			size = 0;
 	int			uri_size;
 	crt_node_info_t		node_info;
-	struct crt_grp_priv	*default_grp_priv;
 	int			rc = 0;
 
 	ptr = grp_info->iov_buf;
 
-	/* TODO: Phase1 assumes default primary group. In phase2
-	 * add group name to the grp_info iov buffer
-	 */
-	default_grp_priv = crt_gdata.cg_grp->gg_srv_pri_grp;
-
 	size = 0;
 	while (size < grp_info->iov_buf_len) {
 		/* Unpack rank */
@@ -3823,6 +5672,30 @@ out:
 }
 
 
+int crt_group_info_set(d_iov_t *grp_info)
+{
+	struct crt_grp_info_hdr	*hdr;
+	struct crt_grp_priv	*default_grp_priv;
+
+	if (grp_info == NULL || grp_info->iov_buf == NULL) {
+		D_ERROR("Passed grp_info is NULL\n");
+		return -DER_INVAL;
+	}
+
+	/* TODO: Phase1 assumes default primary group. In phase2
+	 * add group name to the grp_info iov buffer
+	 */
+	default_grp_priv = crt_gdata.cg_grp->gg_srv_pri_grp;
+
+	hdr = grp_info->iov_buf;
+	if (grp_info->iov_len >= sizeof(*hdr) &&
+	    hdr->gih_magic == CRT_GRP_INFO_MAGIC)
+		return crt_grp_info_apply(default_grp_priv, grp_info);
+
+	return crt_grp_info_legacy_set(default_grp_priv, grp_info);
+}
+
+
 int crt_group_ranks_get(crt_group_t *group, d_rank_list_t **list)
 {
 	d_rank_list_t		*membs;
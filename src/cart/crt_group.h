@@ -43,6 +43,7 @@
 #define __CRT_GROUP_H__
 
 #include "crt_barrier.h"
+#include "crt_coll.h"
 #include "crt_pmix.h"
 
 enum crt_grp_status {
@@ -63,8 +64,9 @@ struct crt_rank_map {
 	enum crt_rank_status	rm_status; /* health status */
 };
 
-/* (1 << CRT_LOOKUP_CACHE_BITS) is the number of buckets of lookup hash table */
-#define CRT_LOOKUP_CACHE_BITS	(4)
+/* (1 << CRT_LOOKUP_CACHE_PAGE_BITS) is the number of ranks per cache page */
+#define CRT_LOOKUP_CACHE_PAGE_BITS	(10)
+#define CRT_LOOKUP_CACHE_PAGE_SIZE	(1U << CRT_LOOKUP_CACHE_PAGE_BITS)
 
 
 #define RANK_LIST_REALLOC_SIZE 32
@@ -119,6 +121,13 @@ struct crt_grp_priv {
 	 * for primary groups, a subgroup references its parent group's lock
 	 */
 	pthread_rwlock_t	*gp_rwlock_ft;
+	/*
+	 * bumped by every change of the member or live rank list, tags the
+	 * memoized tree topologies in gp_tree_cache
+	 */
+	uint32_t		 gp_topo_gen;
+	/* memoized tree topologies, see crt_tree.c, allocated on first use */
+	struct crt_tree_cache	*gp_tree_cache;
 	/* the priv pointer user passed in for crt_group_create */
 	void			*gp_priv;
 	/* CaRT context only for sending sub-grp create/destroy RPCs */
@@ -147,7 +156,29 @@ struct crt_grp_priv {
 	/* PSR phy addr address in attached group */
 	crt_phy_addr_t		 gp_psr_phy_addr;
 	/* address lookup cache, only valid for primary group */
-	struct d_hash_table	 *gp_lookup_cache;
+	struct crt_lookup_cache	 *gp_lookup_cache;
+	/* URI template, set once, only valid for primary group */
+	struct crt_uri_tmpl	 *gp_uri_tmpl;
+	/* locality of the ranks, see crt_group_locality_set() */
+	uint32_t		*gp_loc_map;
+	uint32_t		 gp_loc_map_nr;
+	/* mapped binary attach info, until it fills the lookup cache */
+	void			*gp_ai_map;
+	size_t			 gp_ai_map_size;
+	/*
+	 * version of the group info exported by crt_group_info_get(), bumped
+	 * by every change, or adopted from the applied crt_group_info_set()
+	 */
+	uint64_t		 gp_info_ver;
+	/* ring of the last gp_info_log_num changes, indexed by version */
+	struct crt_grp_info_rec	*gp_info_log;
+	uint32_t		 gp_info_log_num;
+	/*
+	 * serializes the changes of the group info, so that an applied delta
+	 * is checked and adopted against the same gp_info_ver, taken before
+	 * crt_gdata.cg_rwlock and gp_rwlock
+	 */
+	pthread_mutex_t		 gp_info_mutex;
 	enum crt_grp_status	 gp_status; /* group status */
 	/* set of variables only valid in primary service groups */
 	uint32_t		 gp_primary:1, /* flag of primary group */
@@ -166,6 +197,8 @@ struct crt_grp_priv {
 	size_t			 gp_errhdlr_ref;
 	/* Barrier information.  Only used in local service groups */
 	struct crt_barrier_info	 gp_barrier_info;
+	/* Data movement collectives. Only used in local service groups */
+	struct crt_coll_info	 gp_coll_info;
 
 	/* temporary return code for group creation */
 	int			 gp_rc;
@@ -336,26 +369,129 @@ grp_priv_set_default_failed_ranks(struct crt_grp_priv *priv,
 	priv->gp_failed_ranks = def->gp_failed_ranks;
 }
 
-/* lookup cache item for one target */
+/*
+ * The address lookup cache is read without lock: readers only follow
+ * pointers published with release stores. A block which grows is copied,
+ * the copy published and the old block retired to crt_lookup_cache, where
+ * it stays until the cache is destroyed as a reader may still walk it.
+ *
+ * There is no reader count to tell when a retired block is free, so the
+ * bound is kept by how the blocks grow instead: the tags and the page
+ * directory double, and the HG addrs of a tag grow only when a context
+ * index above crt_gdata.cg_ctx_num connects. The retired blocks of a cache
+ * thus stay below the size of the live ones, plus one addrs block per
+ * context created after the first connect.
+ *
+ * The URI strings escape to the callers of crt_grp_lc_lookup(), so they are
+ * never freed before the cache either. An item removed by
+ * crt_group_node_remove() is parked on lc_removed with its URIs moved to
+ * li_old_uris, and is published again when the rank is added back, taking
+ * back the old string of a URI it had before. So under rank churn the cache
+ * holds one item per rank ever added, and one string per distinct URI of
+ * each tag.
+ */
+struct crt_lookup_retired {
+	struct crt_lookup_retired	*lr_next;
+};
+
+/* connected HG addrs of one tag, indexed by crt_context::cc_idx */
+struct crt_lookup_addrs {
+	struct crt_lookup_retired	 la_retired;
+	uint32_t			 la_num;
+	hg_addr_t			 la_addr[0];
+};
+
+/* lookup cache entry for one tag of a target */
+struct crt_lookup_tag {
+	uint32_t		 lt_tag;
+	/* set once, freed with the cache item */
+	crt_phy_addr_t		 lt_uri;
+	struct crt_lookup_addrs	*lt_addrs;
+};
+
+/*
+ * tags of a target, in the order they were first used and scanned
+ * linearly, a target only has a few. Entries below lts_num never move.
+ */
+struct crt_lookup_tags {
+	struct crt_lookup_retired	 lts_retired;
+	uint32_t			 lts_num;
+	uint32_t			 lts_cap;
+	struct crt_lookup_tag		 lts_tag[0];
+};
+
+/* lookup cache item for one target, shared by all contexts */
 struct crt_lookup_item {
-	/* link to crt_grp_priv::gp_lookup_cache[ctx_idx] */
+	/* link to crt_lookup_cache::lc_removed once removed */
 	d_list_t		 li_link;
 	/* point back to grp_priv */
 	struct crt_grp_priv	*li_grp_priv;
 	/* rank of the target */
 	d_rank_t		 li_rank;
-	/* base phy addr published through PMIx */
-	crt_phy_addr_t		 li_base_phy_addr;
-	/* connected HG addr */
-	hg_addr_t		 li_tag_addr[CRT_SRV_CONTEXT_NUM];
-	crt_phy_addr_t		 li_uri[CRT_SRV_CONTEXT_NUM];
-	/* reference count */
-	uint32_t		 li_ref;
-	uint32_t		 li_initialized:1,
-				 li_evicted:1;
+	uint32_t		 li_evicted;
+	struct crt_lookup_tags	*li_tags;
+	/* URIs dropped by crt_grp_lc_uri_remove(), see crt_lookup_retired */
+	char			**li_old_uris;
+	uint32_t		 li_old_nr;
+	/* serializes the updates of the item */
 	pthread_mutex_t		 li_mutex;
 };
 
+/* page directory of the lookup cache */
+struct crt_lookup_dir {
+	struct crt_lookup_retired	  ld_retired;
+	uint32_t			  ld_num;
+	struct crt_lookup_item		**ld_pages[0];
+};
+
+/*
+ * Address lookup cache of a primary group, the items are indexed by rank in
+ * pages of CRT_LOOKUP_CACHE_PAGE_SIZE, allocated for the ranks in use. The
+ * pages and items are added with crt_grp_priv::gp_rwlock held for write,
+ * the items are updated with li_mutex held.
+ */
+struct crt_lookup_cache {
+	struct crt_lookup_dir		*lc_dir;
+	/* number of items in cache */
+	uint32_t			 lc_item_num;
+	/* items removed from cache, reused if their rank is added back */
+	d_list_t			 lc_removed;
+	/* blocks replaced by a copy, freed with the cache */
+	struct crt_lookup_retired	*lc_retired;
+	pthread_spinlock_t		 lc_lock;
+};
+
+/*
+ * URI template of a primary group, see crt_group_uri_template_set(). Ranks are
+ * laid out on ut_hosts in blocks of ut_ranks_per_host, each rank listens on
+ * ut_ports_per_rank consecutive ports, one per tag.
+ */
+struct crt_uri_tmpl {
+	/* "%h" expands to the host, "%p" to the port */
+	char				*ut_fmt;
+	char				**ut_hosts;
+	uint32_t			 ut_host_num;
+	uint32_t			 ut_ranks_per_host;
+	uint32_t			 ut_port_base;
+	uint32_t			 ut_ports_per_rank;
+};
+
+/* unknown locality of a rank, see crt_grp_locality_get() */
+#define CRT_LOC_NONE			((uint32_t)-1)
+
+/* number of group info changes kept for crt_group_info_delta_get() */
+#define CRT_GRP_INFO_LOG_SIZE		(8192)
+/* gir_tag of a removed rank */
+#define CRT_GRP_INFO_REMOVED		((uint32_t)-1)
+
+/* a change of the group info, see crt_grp_priv::gp_info_log */
+struct crt_grp_info_rec {
+	uint64_t			 gir_ver;
+	d_rank_t			 gir_rank;
+	/* tag whose URI was added, CRT_GRP_INFO_REMOVED if rank removed */
+	uint32_t			 gir_tag;
+};
+
 /* structure of global group data */
 struct crt_grp_gdata {
 	/* PMIx related global data */
@@ -384,13 +520,18 @@ struct crt_grp_gdata {
 void crt_hdlr_grp_create(crt_rpc_t *rpc_req);
 void crt_hdlr_grp_destroy(crt_rpc_t *rpc_req);
 void crt_hdlr_uri_lookup(crt_rpc_t *rpc_req);
+void crt_hdlr_uri_lookup_batch(crt_rpc_t *rpc_req);
 int crt_grp_attach(crt_group_id_t srv_grpid, crt_group_t **attached_grp);
 int crt_grp_detach(crt_group_t *attached_grp);
 int crt_grp_lc_lookup(struct crt_grp_priv *grp_priv, int ctx_idx,
 		      d_rank_t rank, uint32_t tag, crt_phy_addr_t *base_addr,
 		      hg_addr_t *hg_addr);
-int crt_grp_lc_uri_insert(struct crt_grp_priv *grp_priv, int ctx_idx,
-			  d_rank_t rank, uint32_t tag, const char *uri);
+int crt_grp_uri_tmpl_lookup(struct crt_grp_priv *grp_priv, d_rank_t rank,
+			    uint32_t tag, crt_phy_addr_t *uri);
+int crt_grp_locality_get(struct crt_grp_priv *grp_priv,
+			 d_rank_list_t *rank_list, uint32_t **grp_loc);
+int crt_grp_lc_uri_insert(struct crt_grp_priv *grp_priv, d_rank_t rank,
+			  uint32_t tag, const char *uri);
 int crt_grp_lc_addr_insert(struct crt_grp_priv *grp_priv,
 			   struct crt_context *ctx_idx,
 			   d_rank_t rank, uint32_t tag, hg_addr_t *hg_addr);
@@ -403,6 +544,7 @@ int crt_grp_failed_ranks_dup(crt_group_t *grp, d_rank_list_t **failed_ranks);
 void crt_grp_priv_destroy(struct crt_grp_priv *grp_priv);
 
 int crt_grp_config_load(struct crt_grp_priv *grp_priv);
+int crt_grp_config_lc_fill(struct crt_grp_priv *grp_priv);
 
 static inline bool crt_grp_is_subgrp_id(uint64_t grp_id)
 {
@@ -434,8 +576,6 @@ crt_ep_copy(crt_endpoint_t *dst_ep, crt_endpoint_t *src_ep)
 	dst_ep->ep_tag = src_ep->ep_tag;
 }
 
-struct crt_lookup_item *crt_li_link2ptr(d_list_t *rlink);
-
 static inline uint64_t
 crt_get_subgrp_id()
 {
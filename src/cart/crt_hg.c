@@ -78,8 +78,9 @@ struct crt_na_dict crt_na_dict[] = {
 
 /**
  * Enable the HG handle pool, can change/tune the max_num and prepost_num.
- * This allows the pool be enabled/re-enabled and be tunable at runtime
- * automatically based on workload or manually by cart_ctl.
+ * This allows the pool be enabled/re-enabled. Afterwards the max_num follows
+ * the workload, see crt_hg_pool_tune(), or is set by cart_ctl through
+ * crt_hg_pool_resize().
  */
 static inline int
 crt_hg_pool_enable(struct crt_hg_context *hg_ctx, int32_t max_num,
@@ -137,25 +138,12 @@ out:
 }
 
 static inline void
-crt_hg_pool_disable(struct crt_hg_context *hg_ctx)
+crt_hg_hdl_list_destroy(d_list_t *destroy_list)
 {
-	struct crt_hg_pool	*hg_pool = &hg_ctx->chc_hg_pool;
 	struct crt_hg_hdl	*hdl;
-	d_list_t		 destroy_list;
 	hg_return_t		 hg_ret = HG_SUCCESS;
 
-	D_INIT_LIST_HEAD(&destroy_list);
-
-	D_SPIN_LOCK(&hg_pool->chp_lock);
-	hg_pool->chp_num = 0;
-	hg_pool->chp_max_num = 0;
-	hg_pool->chp_enabled = false;
-	d_list_splice_init(&hg_pool->chp_list, &destroy_list);
-	D_DEBUG(DB_NET, "hg_pool %p disabled and become empty (chp_num 0).\n",
-		hg_pool);
-	D_SPIN_UNLOCK(&hg_pool->chp_lock);
-
-	while ((hdl = d_list_pop_entry(&destroy_list,
+	while ((hdl = d_list_pop_entry(destroy_list,
 				       struct crt_hg_hdl,
 				       chh_link))) {
 		D_ASSERT(hdl->chh_hdl != HG_HANDLE_NULL);
@@ -169,6 +157,91 @@ crt_hg_pool_disable(struct crt_hg_context *hg_ctx)
 	}
 }
 
+/*
+ * Move the handles above chp_max_num to destroy_list, they are destroyed
+ * by the caller after releasing chp_lock.
+ */
+static inline void
+crt_hg_pool_trim(struct crt_hg_pool *hg_pool, d_list_t *destroy_list)
+{
+	struct crt_hg_hdl	*hdl;
+
+	while (hg_pool->chp_num > hg_pool->chp_max_num) {
+		hdl = d_list_entry(hg_pool->chp_list.prev, struct crt_hg_hdl,
+				   chh_link);
+		d_list_move(&hdl->chh_link, destroy_list);
+		hg_pool->chp_num--;
+	}
+}
+
+/*
+ * Size the pool after the number of concurrent requests, called with
+ * chp_lock held on each get. The pool grows as soon as the requests in
+ * flight exceed it, so that the handles created for the burst are kept by
+ * crt_hg_pool_put(), and shrinks at the end of a tune window when the peak
+ * of that window is well below its size.
+ */
+static inline void
+crt_hg_pool_tune(struct crt_hg_pool *hg_pool, d_list_t *destroy_list)
+{
+	int32_t	target;
+
+	if (hg_pool->chp_inflight > hg_pool->chp_window_hwm)
+		hg_pool->chp_window_hwm = hg_pool->chp_inflight;
+	if (hg_pool->chp_inflight > hg_pool->chp_hwm)
+		hg_pool->chp_hwm = hg_pool->chp_inflight;
+
+	if (!hg_pool->chp_auto)
+		return;
+
+	if (hg_pool->chp_inflight > hg_pool->chp_max_num) {
+		target = hg_pool->chp_inflight + hg_pool->chp_inflight / 4;
+		target = min(target, CRT_HG_POOL_LIMIT);
+		if (target > hg_pool->chp_max_num) {
+			D_DEBUG(DB_NET, "hg_pool %p, grow max_num %d -> %d.\n",
+				hg_pool, hg_pool->chp_max_num, target);
+			hg_pool->chp_max_num = target;
+		}
+	}
+
+	if (++hg_pool->chp_window_gets < CRT_HG_POOL_TUNE_WINDOW)
+		return;
+
+	/* keep a quarter of headroom above the peak of the window */
+	target = hg_pool->chp_window_hwm + hg_pool->chp_window_hwm / 4;
+	target = max(target, CRT_HG_POOL_PREPOST_NUM);
+	if (target * 2 < hg_pool->chp_max_num) {
+		D_DEBUG(DB_NET, "hg_pool %p, shrink max_num %d -> %d.\n",
+			hg_pool, hg_pool->chp_max_num, target);
+		hg_pool->chp_max_num = target;
+		crt_hg_pool_trim(hg_pool, destroy_list);
+	}
+	hg_pool->chp_window_gets = 0;
+	hg_pool->chp_window_hwm = hg_pool->chp_inflight;
+}
+
+static inline void
+crt_hg_pool_disable(struct crt_hg_context *hg_ctx)
+{
+	struct crt_hg_pool	*hg_pool = &hg_ctx->chc_hg_pool;
+	d_list_t		 destroy_list;
+
+	D_INIT_LIST_HEAD(&destroy_list);
+
+	D_SPIN_LOCK(&hg_pool->chp_lock);
+	hg_pool->chp_num = 0;
+	hg_pool->chp_max_num = 0;
+	hg_pool->chp_enabled = false;
+	d_list_splice_init(&hg_pool->chp_list, &destroy_list);
+	D_DEBUG(DB_NET, "hg_pool %p disabled and become empty (chp_num 0), "
+		"hit "DF_U64", miss "DF_U64", drop "DF_U64", hwm %d.\n",
+		hg_pool, hg_pool->chp_hit, hg_pool->chp_miss,
+		hg_pool->chp_drop, hg_pool->chp_hwm);
+	D_SPIN_UNLOCK(&hg_pool->chp_lock);
+
+	crt_hg_hdl_list_destroy(&destroy_list);
+}
+
 static inline int
 crt_hg_pool_init(struct crt_hg_context *hg_ctx)
 {
@@ -182,6 +255,14 @@ crt_hg_pool_init(struct crt_hg_context *hg_ctx)
 	hg_pool->chp_num = 0;
 	hg_pool->chp_max_num = 0;
 	hg_pool->chp_enabled = false;
+	hg_pool->chp_auto = true;
+	hg_pool->chp_inflight = 0;
+	hg_pool->chp_window_hwm = 0;
+	hg_pool->chp_window_gets = 0;
+	hg_pool->chp_hwm = 0;
+	hg_pool->chp_hit = 0;
+	hg_pool->chp_miss = 0;
+	hg_pool->chp_drop = 0;
 	D_INIT_LIST_HEAD(&hg_pool->chp_list);
 
 	rc = crt_hg_pool_enable(hg_ctx, CRT_HG_POOL_MAX_NUM,
@@ -202,11 +283,56 @@ crt_hg_pool_fini(struct crt_hg_context *hg_ctx)
 	D_SPIN_DESTROY(&hg_pool->chp_lock);
 }
 
+int
+crt_hg_pool_resize(struct crt_hg_context *hg_ctx, int32_t max_num)
+{
+	struct crt_hg_pool	*hg_pool = &hg_ctx->chc_hg_pool;
+	d_list_t		 destroy_list;
+	int			 rc = 0;
+
+	if (max_num < 0 || max_num > CRT_HG_POOL_LIMIT) {
+		D_ERROR("Invalid max_num %d, should be within [0, %d].\n",
+			max_num, CRT_HG_POOL_LIMIT);
+		return -DER_INVAL;
+	}
+
+	D_INIT_LIST_HEAD(&destroy_list);
+
+	D_SPIN_LOCK(&hg_pool->chp_lock);
+	if (!hg_pool->chp_enabled) {
+		D_ERROR("hg_pool %p is not enabled, cannot resize.\n",
+			hg_pool);
+		D_GOTO(unlock, rc = -DER_UNINIT);
+	}
+	if (max_num == 0) {
+		/* hand the sizing back to crt_hg_pool_tune() */
+		hg_pool->chp_auto = true;
+		hg_pool->chp_window_gets = 0;
+		hg_pool->chp_window_hwm = hg_pool->chp_inflight;
+	} else {
+		hg_pool->chp_auto = false;
+		hg_pool->chp_max_num = max_num;
+		crt_hg_pool_trim(hg_pool, &destroy_list);
+	}
+	D_DEBUG(DB_NET, "hg_pool %p, max_num %d, auto %d.\n", hg_pool,
+		hg_pool->chp_max_num, hg_pool->chp_auto);
+
+unlock:
+	D_SPIN_UNLOCK(&hg_pool->chp_lock);
+	crt_hg_hdl_list_destroy(&destroy_list);
+	return rc;
+}
+
+/* \a counted is set when the request is counted in chp_inflight */
 static inline struct crt_hg_hdl *
-crt_hg_pool_get(struct crt_hg_context *hg_ctx)
+crt_hg_pool_get(struct crt_hg_context *hg_ctx, bool *counted)
 {
 	struct crt_hg_pool	*hg_pool = &hg_ctx->chc_hg_pool;
 	struct crt_hg_hdl	*hdl = NULL;
+	d_list_t		 destroy_list;
+
+	D_INIT_LIST_HEAD(&destroy_list);
+	*counted = false;
 
 	D_SPIN_LOCK(&hg_pool->chp_lock);
 	if (!hg_pool->chp_enabled) {
@@ -214,17 +340,25 @@ crt_hg_pool_get(struct crt_hg_context *hg_ctx)
 			"hg_pool %p is not enabled cannot get.\n", hg_pool);
 		D_GOTO(unlock, hdl);
 	}
+
+	/* released by crt_hg_pool_done() */
+	hg_pool->chp_inflight++;
+	*counted = true;
+	crt_hg_pool_tune(hg_pool, &destroy_list);
+
 	hdl = d_list_pop_entry(&hg_pool->chp_list,
 			       struct crt_hg_hdl,
 			       chh_link);
 
 	if (hdl == NULL) {
+		hg_pool->chp_miss++;
 		D_DEBUG(DB_NET,
 			"hg_pool %p is empty, cannot get.\n", hg_pool);
 		D_GOTO(unlock, hdl);
 	}
 
 	D_ASSERT(hdl->chh_hdl != HG_HANDLE_NULL);
+	hg_pool->chp_hit++;
 	hg_pool->chp_num--;
 	D_ASSERT(hg_pool->chp_num >= 0);
 	D_DEBUG(DB_NET, "hg_pool %p, remove, chp_num %d.\n",
@@ -232,9 +366,22 @@ crt_hg_pool_get(struct crt_hg_context *hg_ctx)
 
 unlock:
 	D_SPIN_UNLOCK(&hg_pool->chp_lock);
+	crt_hg_hdl_list_destroy(&destroy_list);
 	return hdl;
 }
 
+/* the request counted by crt_hg_pool_get() is done */
+static inline void
+crt_hg_pool_done(struct crt_hg_context *hg_ctx)
+{
+	struct crt_hg_pool	*hg_pool = &hg_ctx->chc_hg_pool;
+
+	D_SPIN_LOCK(&hg_pool->chp_lock);
+	if (hg_pool->chp_inflight > 0)
+		hg_pool->chp_inflight--;
+	D_SPIN_UNLOCK(&hg_pool->chp_lock);
+}
+
 /* returns true on success */
 static inline bool
 crt_hg_pool_put(struct crt_rpc_priv *rpc_priv)
@@ -267,6 +414,7 @@ crt_hg_pool_put(struct crt_rpc_priv *rpc_priv)
 		rc = true;
 	} else {
 		D_FREE_PTR(hdl);
+		hg_pool->chp_drop++;
 		D_DEBUG(DB_NET, "hg_pool %p, chp_num %d, max_num %d, "
 			"enabled %d, cannot put.\n", hg_pool, hg_pool->chp_num,
 			hg_pool->chp_max_num, hg_pool->chp_enabled);
@@ -892,7 +1040,6 @@ crt_rpc_handler_common(hg_handle_t hg_hdl)
 	crt_proc_t		 proc = NULL;
 	struct crt_opc_info	*opc_info = NULL;
 	hg_return_t		 hg_ret = HG_SUCCESS;
-	bool			 is_coll_req = false;
 	int			 rc = 0;
 	struct crt_rpc_priv	 rpc_tmp = {0};
 
@@ -953,7 +1100,8 @@ crt_rpc_handler_common(hg_handle_t hg_hdl)
 	}
 	D_ASSERT(opc_info->coi_opc == opc);
 
-	D_ALLOC(rpc_priv, opc_info->coi_rpc_size);
+	rpc_priv = crt_rpc_cache_get(crt_ctx->cc_rpc_cache,
+				     opc_info->coi_rpc_size);
 	if (rpc_priv == NULL) {
 		crt_hg_reply_error_send(&rpc_tmp, -DER_DOS);
 		crt_hg_unpack_cleanup(proc);
@@ -963,10 +1111,8 @@ crt_rpc_handler_common(hg_handle_t hg_hdl)
 	crt_hg_header_copy(&rpc_tmp, rpc_priv);
 	rpc_pub = &rpc_priv->crp_pub;
 
-	if (rpc_priv->crp_flags & CRT_RPC_FLAG_COLL) {
-		is_coll_req = true;
+	if (rpc_priv->crp_flags & CRT_RPC_FLAG_COLL)
 		rpc_priv->crp_input_got = 1;
-	}
 
 	rpc_priv->crp_opc_info = opc_info;
 
@@ -1005,13 +1151,45 @@ crt_rpc_handler_common(hg_handle_t hg_hdl)
 		crt_hg_unpack_cleanup(proc);
 	}
 
+	crt_rpc_handler_invoke(rpc_priv);
+	D_GOTO(out, hg_ret = HG_SUCCESS);
+
+decref:
+	RPC_DECREF(rpc_priv);
+out:
+	return hg_ret;
+}
+
+/*
+ * Invoke the handler of a received request whose input is unpacked. If some
+ * crt_iov_auto_t input came by bulk it is pulled first and the handler is
+ * called from the completion of the last transfer.
+ */
+void
+crt_rpc_handler_invoke(struct crt_rpc_priv *rpc_priv)
+{
+	if (rpc_priv->crp_iov_auto_num > 0 &&
+	    rpc_priv->crp_opc_info->coi_rpc_cb != NULL)
+		crt_iov_auto_pull(rpc_priv);
+	else
+		crt_rpc_handler_call(rpc_priv);
+}
+
+/* call the handler of a received request, consumes the reference of caller */
+void
+crt_rpc_handler_call(struct crt_rpc_priv *rpc_priv)
+{
+	struct crt_opc_info	*opc_info = rpc_priv->crp_opc_info;
+	crt_opcode_t		 opc = opc_info->coi_opc;
+	int			 rc = 0;
+
 	if (opc_info->coi_rpc_cb == NULL) {
 		D_ERROR("NULL crp_hg_hdl, opc: %#x.\n", opc);
 		crt_hg_reply_error_send(rpc_priv, -DER_UNREG);
-		D_GOTO(decref, hg_ret = HG_SUCCESS);
+		D_GOTO(decref, rc = -DER_UNREG);
 	}
 
-	if (!is_coll_req)
+	if (!(rpc_priv->crp_flags & CRT_RPC_FLAG_COLL))
 		rc = crt_rpc_common_hdlr(rpc_priv);
 	else
 		rc = crt_corpc_common_hdlr(rpc_priv);
@@ -1027,10 +1205,9 @@ decref:
 	 * asynchronously, Let's hold the RPC, and the real handler
 	 * (crt_handle_rpc())will release it
 	 */
-	if (rc != 0 || !crt_rpc_cb_customized(crt_ctx, &rpc_priv->crp_pub))
+	if (rc != 0 || !crt_rpc_cb_customized(rpc_priv->crp_pub.cr_ctx,
+					      &rpc_priv->crp_pub))
 		RPC_DECREF(rpc_priv);
-out:
-	return hg_ret;
 }
 
 int
@@ -1039,6 +1216,7 @@ crt_hg_req_create(struct crt_hg_context *hg_ctx, struct crt_rpc_priv *rpc_priv)
 	hg_id_t		rpcid;
 	hg_return_t	hg_ret = HG_SUCCESS;
 	bool		hg_created = false;
+	bool		counted;
 	int		rc = 0;
 
 	D_ASSERT(hg_ctx != NULL && hg_ctx->chc_hgcla != NULL &&
@@ -1048,7 +1226,8 @@ crt_hg_req_create(struct crt_hg_context *hg_ctx, struct crt_rpc_priv *rpc_priv)
 
 	if (!rpc_priv->crp_opc_info->coi_no_reply) {
 		rpcid = CRT_HG_RPCID;
-		rpc_priv->crp_hdl_reuse = crt_hg_pool_get(hg_ctx);
+		rpc_priv->crp_hdl_reuse = crt_hg_pool_get(hg_ctx, &counted);
+		rpc_priv->crp_hg_pool_inflight = counted;
 	} else {
 		rpcid = CRT_HG_ONEWAY_RPCID;
 	}
@@ -1095,9 +1274,21 @@ crt_hg_req_create(struct crt_hg_context *hg_ctx, struct crt_rpc_priv *rpc_priv)
 void
 crt_hg_req_destroy(struct crt_rpc_priv *rpc_priv)
 {
-	hg_return_t hg_ret;
+	struct crt_context	*ctx;
+	hg_return_t		 hg_ret;
 
 	D_ASSERT(rpc_priv != NULL);
+	if (rpc_priv->crp_hg_pool_inflight) {
+		ctx = rpc_priv->crp_pub.cr_ctx;
+		crt_hg_pool_done(&ctx->cc_hg_ctx);
+		rpc_priv->crp_hg_pool_inflight = 0;
+	}
+	if (rpc_priv->crp_batched) {
+		/* no HG handle, input/output decoded by crt_batch.c */
+		crt_batch_req_fini(rpc_priv);
+		D_GOTO(mem_free, 0);
+	}
+
 	if (rpc_priv->crp_output_got != 0) {
 		hg_ret = HG_Free_output(rpc_priv->crp_hg_hdl,
 					&rpc_priv->crp_pub.cr_output);
@@ -1351,6 +1542,9 @@ crt_hg_reply_send(struct crt_rpc_priv *rpc_priv)
 
 	D_ASSERT(rpc_priv != NULL);
 
+	if (rpc_priv->crp_batched)
+		return crt_batch_reply(rpc_priv);
+
 	RPC_ADDREF(rpc_priv);
 	hg_ret = HG_Respond(rpc_priv->crp_hg_hdl, crt_hg_reply_send_cb,
 			    rpc_priv, &rpc_priv->crp_pub.cr_output);
@@ -1378,6 +1572,10 @@ crt_hg_reply_error_send(struct crt_rpc_priv *rpc_priv, int error_code)
 
 	hg_out_struct = &rpc_priv->crp_pub.cr_output;
 	rpc_priv->crp_reply_hdr.cch_rc = error_code;
+	if (rpc_priv->crp_batched) {
+		crt_batch_reply(rpc_priv);
+		return;
+	}
 	hg_ret = HG_Respond(rpc_priv->crp_hg_hdl, NULL, NULL, hg_out_struct);
 	if (hg_ret != HG_SUCCESS) {
 		RPC_ERROR(rpc_priv,
@@ -1454,6 +1652,24 @@ out:
 	return rc;
 }
 
+/* the fd becoming readable when the HG context has work, -1 if none */
+int
+crt_hg_get_wait_fd(struct crt_hg_context *hg_ctx)
+{
+	D_ASSERT(hg_ctx != NULL && hg_ctx->chc_hgctx != NULL);
+
+	return HG_Event_get_wait_fd(hg_ctx->chc_hgctx);
+}
+
+/* if the HG context has events to process, which may not signal the wait fd */
+bool
+crt_hg_event_ready(struct crt_hg_context *hg_ctx)
+{
+	D_ASSERT(hg_ctx != NULL && hg_ctx->chc_hgctx != NULL);
+
+	return HG_Event_ready(hg_ctx->chc_hgctx);
+}
+
 #define CRT_HG_IOVN_STACK	(8)
 int
 crt_hg_bulk_create(struct crt_hg_context *hg_ctx, d_sg_list_t *sgl,
@@ -60,6 +60,10 @@
 #define CRT_HG_POOL_MAX_NUM	(512)
 /** number of prepost HG handles when enable pool */
 #define CRT_HG_POOL_PREPOST_NUM	(16)
+/** upper bound of the automatically tuned pool size */
+#define CRT_HG_POOL_LIMIT	(8192)
+/** number of pool gets between two automatic resizes */
+#define CRT_HG_POOL_TUNE_WINDOW	(1024)
 
 struct crt_rpc_priv;
 struct crt_common_hdr;
@@ -107,6 +111,20 @@ struct crt_hg_pool {
 	/* HG handle list */
 	d_list_t		chp_list;
 	bool			chp_enabled;
+	/* max_num follows the workload, false once resized by cart_ctl */
+	bool			chp_auto;
+	/* number of requests holding a pool or a non-pool HG handle */
+	int32_t			chp_inflight;
+	/* high-water mark of chp_inflight in the current tune window */
+	int32_t			chp_window_hwm;
+	/* number of gets in the current tune window */
+	int32_t			chp_window_gets;
+	/* high-water mark of chp_inflight since the pool was created */
+	int32_t			chp_hwm;
+	/* counters, gets served from / missed by the pool, puts dropped */
+	uint64_t		chp_hit;
+	uint64_t		chp_miss;
+	uint64_t		chp_drop;
 };
 
 /** HG context */
@@ -139,6 +157,7 @@ int crt_hg_init(crt_phy_addr_t *addr, bool server);
 int crt_hg_fini(void);
 int crt_hg_ctx_init(struct crt_hg_context *hg_ctx, int idx);
 int crt_hg_ctx_fini(struct crt_hg_context *hg_ctx);
+int crt_hg_pool_resize(struct crt_hg_context *hg_ctx, int32_t max_num);
 int crt_hg_req_create(struct crt_hg_context *hg_ctx,
 		      struct crt_rpc_priv *rpc_priv);
 void crt_hg_req_destroy(struct crt_rpc_priv *rpc_priv);
@@ -147,15 +166,20 @@ int crt_hg_reply_send(struct crt_rpc_priv *rpc_priv);
 void crt_hg_reply_error_send(struct crt_rpc_priv *rpc_priv, int error_code);
 int crt_hg_req_cancel(struct crt_rpc_priv *rpc_priv);
 int crt_hg_progress(struct crt_hg_context *hg_ctx, int64_t timeout);
+int crt_hg_get_wait_fd(struct crt_hg_context *hg_ctx);
+bool crt_hg_event_ready(struct crt_hg_context *hg_ctx);
 int crt_hg_addr_lookup(struct crt_hg_context *hg_ctx, const char *name,
 		       crt_hg_addr_lookup_cb_t complete_cb, void *arg);
 int crt_hg_addr_free(struct crt_hg_context *hg_ctx, hg_addr_t addr);
 int crt_hg_get_addr(hg_class_t *hg_class, char *addr_str, size_t *str_size);
 
 int crt_rpc_handler_common(hg_handle_t hg_hdl);
+void crt_rpc_handler_invoke(struct crt_rpc_priv *rpc_priv);
+void crt_rpc_handler_call(struct crt_rpc_priv *rpc_priv);
 
 /* crt_hg_proc.c */
 int crt_proc_corpc_hdr(crt_proc_t proc, struct crt_corpc_hdr *hdr);
+int crt_proc_common_hdr(crt_proc_t proc, struct crt_common_hdr *hdr);
 int crt_hg_unpack_header(hg_handle_t hg_hdl, struct crt_rpc_priv *rpc_priv,
 			 crt_proc_t *proc);
 void crt_hg_header_copy(struct crt_rpc_priv *in, struct crt_rpc_priv *out);
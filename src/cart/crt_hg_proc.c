@@ -45,6 +45,12 @@
 
 #define CRT_PROC_NULL (NULL)
 
+/*
+ * The RPC owning the input processed by crt_proc_input() on this thread, NULL
+ * when processing anything else.
+ */
+static __thread struct crt_rpc_priv *crt_proc_input_rpc;
+
 int
 crt_proc_get_op(crt_proc_t proc, crt_proc_op_t *proc_op)
 {
@@ -380,6 +386,158 @@ crt_proc_d_iov_t(crt_proc_t proc, d_iov_t *div)
 	return 0;
 }
 
+/* how a crt_iov_auto_t is carried in the message */
+enum {
+	CRT_IOV_AUTO_INLINE	= 0,
+	CRT_IOV_AUTO_BULK	= 1,
+};
+
+/* eager buffer room left for the input fields following a crt_iov_auto_t */
+#define CRT_IOV_AUTO_SLACK	(256)
+
+static bool
+crt_iov_auto_inline(crt_proc_t proc, d_iov_t *iov)
+{
+	hg_class_t	*hg_class = hg_proc_get_class(proc);
+
+	/* only RPC input can be pulled by the target */
+	if (crt_proc_input_rpc == NULL || hg_class == NULL)
+		return true;
+
+	return hg_proc_get_size_used(proc) + iov->iov_len +
+	       CRT_IOV_AUTO_SLACK <= HG_Class_get_input_eager_size(hg_class);
+}
+
+static int
+crt_iov_auto_bulk_create(struct crt_rpc_priv *rpc_priv, crt_iov_auto_t *data)
+{
+	d_sg_list_t	sgl;
+	crt_bulk_t	bulk_hdl;
+	int		rc;
+
+	sgl.sg_nr = 1;
+	sgl.sg_nr_out = 0;
+	sgl.sg_iovs = &data->ia_iov;
+	rc = crt_bulk_create(rpc_priv->crp_pub.cr_ctx, &sgl, CRT_BULK_RO,
+			     &bulk_hdl);
+	if (rc != 0) {
+		RPC_ERROR(rpc_priv, "crt_bulk_create failed, rc: %d\n", rc);
+		return rc;
+	}
+	/* forwarded corpc requests are pulled from here by any rank */
+	rc = crt_bulk_bind(bulk_hdl, rpc_priv->crp_pub.cr_ctx);
+	if (rc != 0) {
+		RPC_ERROR(rpc_priv, "crt_bulk_bind failed, rc: %d\n", rc);
+		crt_bulk_free(bulk_hdl);
+		return rc;
+	}
+
+	D_SPIN_LOCK(&rpc_priv->crp_lock);
+	/* the input of a corpc can be encoded for several children at once */
+	if (data->ia_bulk == CRT_BULK_NULL) {
+		rc = crt_iov_auto_track(rpc_priv, data);
+		if (rc == 0) {
+			data->ia_bulk = bulk_hdl;
+			bulk_hdl = CRT_BULK_NULL;
+		}
+	}
+	D_SPIN_UNLOCK(&rpc_priv->crp_lock);
+
+	if (bulk_hdl != CRT_BULK_NULL)
+		crt_bulk_free(bulk_hdl);
+
+	return rc;
+}
+
+int
+crt_proc_crt_iov_auto_t(crt_proc_t proc, crt_iov_auto_t *data)
+{
+	struct crt_rpc_priv	*rpc_priv = crt_proc_input_rpc;
+	crt_proc_op_t		 proc_op;
+	d_iov_t			*iov;
+	uint8_t			 mode = CRT_IOV_AUTO_INLINE;
+	int			 rc;
+
+	if (data == NULL) {
+		D_ERROR("invalid parameter, NULL data.\n");
+		return -DER_INVAL;
+	}
+
+	rc = crt_proc_get_op(proc, &proc_op);
+	if (rc != 0)
+		return -DER_HG;
+
+	iov = &data->ia_iov;
+	if (proc_op == CRT_PROC_FREE) {
+		if (data->ia_bulk != CRT_BULK_NULL) {
+			rc = crt_proc_crt_bulk_t(proc, &data->ia_bulk);
+			data->ia_bulk = CRT_BULK_NULL;
+		}
+		crt_proc_d_iov_t(proc, iov);
+		return rc;
+	}
+
+	if (proc_op == CRT_PROC_ENCODE) {
+		/* once sent by bulk, always sent by bulk */
+		if (data->ia_bulk == CRT_BULK_NULL &&
+		    !crt_iov_auto_inline(proc, iov)) {
+			rc = crt_iov_auto_bulk_create(rpc_priv, data);
+			if (rc != 0)
+				return rc;
+		}
+		mode = data->ia_bulk == CRT_BULK_NULL ? CRT_IOV_AUTO_INLINE :
+							CRT_IOV_AUTO_BULK;
+	}
+
+	rc = crt_proc_uint8_t(proc, &mode);
+	if (rc != 0)
+		return -DER_HG;
+
+	if (mode == CRT_IOV_AUTO_INLINE) {
+		if (proc_op == CRT_PROC_DECODE)
+			data->ia_bulk = CRT_BULK_NULL;
+		return crt_proc_d_iov_t(proc, iov);
+	}
+
+	if (mode != CRT_IOV_AUTO_BULK || rpc_priv == NULL) {
+		D_ERROR("invalid crt_iov_auto_t mode %u.\n", mode);
+		return -DER_PROTO;
+	}
+
+	rc = crt_proc_uint64_t(proc, &iov->iov_len);
+	if (rc != 0)
+		return -DER_HG;
+
+	if (proc_op == CRT_PROC_DECODE)
+		data->ia_bulk = CRT_BULK_NULL;
+	rc = crt_proc_crt_bulk_t(proc, &data->ia_bulk);
+	if (rc != 0 || proc_op == CRT_PROC_ENCODE)
+		return rc;
+
+	/* the payload is pulled by crt_iov_auto_pull() */
+	iov->iov_buf = NULL;
+	iov->iov_buf_len = iov->iov_len;
+	if (iov->iov_len > 0) {
+		D_ALLOC(iov->iov_buf, iov->iov_len);
+		if (iov->iov_buf == NULL)
+			D_GOTO(err, rc = -DER_NOMEM);
+	}
+
+	rc = crt_iov_auto_track(rpc_priv, data);
+	if (rc != 0)
+		D_GOTO(err, rc);
+
+	return 0;
+
+err:
+	D_FREE(iov->iov_buf);
+	iov->iov_buf_len = 0;
+	iov->iov_len = 0;
+	crt_bulk_free(data->ia_bulk);
+	data->ia_bulk = CRT_BULK_NULL;
+	return rc;
+}
+
 /**
  * CMF_OF_xxx is used to obtain the CMF name of a data type in the RPC
  * registration macro
@@ -444,7 +602,12 @@ crt_proc_corpc_hdr(crt_proc_t proc, struct crt_corpc_hdr *hdr)
 		D_ERROR("hg proc error, hg_ret: %d.\n", hg_ret);
 		D_GOTO(out, rc = -DER_HG);
 	}
-	hg_ret = hg_proc_hg_uint32_t(hg_proc, &hdr->coh_padding);
+	hg_ret = hg_proc_hg_uint32_t(hg_proc, &hdr->coh_bulk_seg);
+	if (hg_ret != HG_SUCCESS) {
+		D_ERROR("hg proc error, hg_ret: %d.\n", hg_ret);
+		D_GOTO(out, rc = -DER_HG);
+	}
+	hg_ret = hg_proc_hg_uint64_t(hg_proc, &hdr->coh_bulk_pipe);
 	if (hg_ret != HG_SUCCESS) {
 		D_ERROR("hg proc error, hg_ret: %d.\n", hg_ret);
 		rc = -DER_HG;
@@ -661,11 +824,22 @@ out:
 int
 crt_proc_input(struct crt_rpc_priv *rpc_priv, crt_proc_t proc)
 {
-	struct crt_req_format *crf = rpc_priv->crp_opc_info->coi_crf;
+	struct crt_req_format	*crf = rpc_priv->crp_opc_info->coi_crf;
+	struct crt_rpc_priv	*saved = crt_proc_input_rpc;
+	int			 rc;
 
 	D_ASSERT(crf != NULL);
-	return crt_proc_internal(&crf->crf_in,
-				 proc, rpc_priv->crp_pub.cr_input);
+	/*
+	 * forwarded corpc requests share the input of their parent, see
+	 * corpc_add_child_rpc(), which then owns crt_iov_auto_t bulk handles
+	 */
+	crt_proc_input_rpc = rpc_priv->crp_forward ? rpc_priv->crp_arg :
+						     rpc_priv;
+	rc = crt_proc_internal(&crf->crf_in,
+			       proc, rpc_priv->crp_pub.cr_input);
+	crt_proc_input_rpc = saved;
+
+	return rc;
 }
 
 int
@@ -678,22 +852,58 @@ crt_proc_output(struct crt_rpc_priv *rpc_priv, crt_proc_t proc)
 				 proc, rpc_priv->crp_pub.cr_output);
 }
 
+/*
+ * Remember where the encoded input of corpc @rpc_priv lies in its HG input
+ * buffer, between offsets @start and @end. The children then get it copied
+ * as is behind their own headers instead of the decoded input being encoded
+ * again for each of them, see crt_proc_in_common().
+ */
+static void
+crt_hg_in_body_save(struct crt_rpc_priv *rpc_priv, hg_size_t start,
+		    hg_size_t end)
+{
+	struct crt_corpc_ops	*co_ops = rpc_priv->crp_opc_info->coi_co_ops;
+	void			*in_buf;
+	hg_size_t		 in_buf_size;
+	hg_return_t		 hg_ret;
+
+	/*
+	 * co_pre_forward can change the input, and crt_iov_auto_t fields are
+	 * forwarded from the local copy once pulled.
+	 */
+	if ((co_ops != NULL && co_ops->co_pre_forward != NULL) ||
+	    rpc_priv->crp_iov_auto_num != 0 || end <= start)
+		return;
+
+	hg_ret = HG_Get_input_buf(rpc_priv->crp_hg_hdl, &in_buf, &in_buf_size);
+	if (hg_ret != HG_SUCCESS || end > in_buf_size)
+		return;
+
+	rpc_priv->crp_in_body = (char *)in_buf + start;
+	rpc_priv->crp_in_body_len = end - start;
+}
+
 int
 crt_hg_unpack_body(struct crt_rpc_priv *rpc_priv, crt_proc_t proc)
 {
 	int	rc = 0;
 
 	hg_return_t	hg_ret;
+	hg_size_t	body_start;
 
 	D_ASSERT(rpc_priv != NULL && proc != HG_PROC_NULL);
 
 	/* Decode input parameters */
+	body_start = hg_proc_get_size_used(proc);
 	rc = crt_proc_input(rpc_priv, proc);
 	if (rc != 0) {
 		D_ERROR("crt_hg_unpack_body failed, rc: %d, opc: %#x.\n",
 			rc, rpc_priv->crp_pub.cr_opc);
 		D_GOTO(out, rc);
 	}
+	if (rpc_priv->crp_flags & CRT_RPC_FLAG_COLL && !rpc_priv->crp_batched)
+		crt_hg_in_body_save(rpc_priv, body_start,
+				    hg_proc_get_size_used(proc));
 
 	/* Flush proc */
 	hg_ret = hg_proc_flush(proc);
@@ -712,7 +922,9 @@ int
 crt_proc_in_common(crt_proc_t proc, crt_rpc_input_t *data)
 {
 	struct crt_rpc_priv	*rpc_priv;
+	struct crt_rpc_priv	*parent;
 	crt_proc_op_t		 proc_op;
+	hg_return_t		 hg_ret;
 	int			 rc = 0;
 
 	if (proc == CRT_PROC_NULL)
@@ -756,6 +968,22 @@ crt_proc_in_common(crt_proc_t proc, crt_rpc_input_t *data)
 		D_GOTO(out, rc);
 	}
 
+	if (proc_op == CRT_PROC_ENCODE && rpc_priv->crp_forward) {
+		/* the parent corpc, see crt_proc_input() */
+		parent = rpc_priv->crp_arg;
+		if (parent->crp_in_body != NULL) {
+			hg_ret = hg_proc_memcpy(proc, parent->crp_in_body,
+						parent->crp_in_body_len);
+			if (hg_ret != HG_SUCCESS) {
+				D_ERROR("hg_proc_memcpy failed, hg_ret: %d, "
+					"opc: %#x.\n", hg_ret,
+					rpc_priv->crp_pub.cr_opc);
+				rc = -DER_HG;
+			}
+			D_GOTO(out, rc);
+		}
+	}
+
 	rc = crt_proc_input(rpc_priv, proc);
 	if (rc != 0) {
 		D_ERROR("unpack input fails for opc: %#x\n",
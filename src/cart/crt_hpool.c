@@ -0,0 +1,407 @@
+/* Copyright (C) 2018 Intel Corporation
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted for any purpose (including commercial purposes)
+ * provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions, and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions, and the following disclaimer in the
+ *    documentation and/or materials provided with the distribution.
+ *
+ * 3. In addition, redistributions of modified forms of the source or binary
+ *    code must carry prominent notices stating that the original code was
+ *    changed and the date of the change.
+ *
+ *  4. All publications or advertising materials mentioning features or use of
+ *     this software are asked, but not required, to acknowledge that it was
+ *     developed by Intel Corporation and credit the contributors.
+ *
+ * 5. Neither the name of Intel Corporation, nor the name of any Contributor
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+/**
+ * This file is part of CaRT. It implements the optional per-context pool of
+ * worker threads running the RPC handlers, see
+ * crt_context_handler_pool_create().
+ *
+ * The pool hooks in as the context's crt_rpc_task_t. Received RPCs are queued
+ * round-robin to the workers, a worker with an empty queue steals the newest
+ * RPC of the most loaded one. Replies sent from a worker are queued to the
+ * pool and sent by the thread progressing the context.
+ */
+#define D_LOGFAC	DD_FAC(rpc)
+
+#include "crt_internal.h"
+
+#define CRT_HPOOL_MAX_WORKERS	(256)
+
+/* the pool of the calling thread if it is a worker, NULL otherwise */
+static __thread struct crt_hpool *crt_hpool_self;
+
+static struct crt_rpc_priv *
+crt_hpool_dequeue(struct crt_hpool_worker *worker, bool steal)
+{
+	struct crt_rpc_priv	*rpc_priv = NULL;
+
+	D_SPIN_LOCK(&worker->hw_lock);
+	if (!d_list_empty(&worker->hw_queue)) {
+		/* the owner takes the oldest RPC, thieves the newest */
+		if (steal)
+			rpc_priv = d_list_entry(worker->hw_queue.prev,
+						struct crt_rpc_priv,
+						crp_hpool_link);
+		else
+			rpc_priv = d_list_entry(worker->hw_queue.next,
+						struct crt_rpc_priv,
+						crp_hpool_link);
+		d_list_del_init(&rpc_priv->crp_hpool_link);
+		worker->hw_queue_len--;
+	}
+	D_SPIN_UNLOCK(&worker->hw_lock);
+
+	return rpc_priv;
+}
+
+static struct crt_rpc_priv *
+crt_hpool_get(struct crt_hpool_worker *worker)
+{
+	struct crt_hpool	*pool = worker->hw_pool;
+	struct crt_hpool_worker	*victim = NULL;
+	struct crt_rpc_priv	*rpc_priv;
+	uint32_t		 len;
+	uint32_t		 max_len = 0;
+	int			 i;
+
+	rpc_priv = crt_hpool_dequeue(worker, false);
+	if (rpc_priv == NULL) {
+		/* lockless peek, a wrong guess only costs a retry */
+		for (i = 0; i < pool->hp_worker_num; i++) {
+			len = pool->hp_workers[i].hw_queue_len;
+			if (len > max_len) {
+				max_len = len;
+				victim = &pool->hp_workers[i];
+			}
+		}
+		if (victim == NULL)
+			return NULL;
+
+		rpc_priv = crt_hpool_dequeue(victim, true);
+		if (rpc_priv == NULL)
+			return NULL;
+		/* read by crt_context_handler_pool_stats() */
+		__atomic_add_fetch(&worker->hw_stolen, 1, __ATOMIC_RELAXED);
+	}
+
+	__atomic_sub_fetch(&pool->hp_pending, 1, __ATOMIC_RELAXED);
+	return rpc_priv;
+}
+
+static void *
+crt_hpool_worker_main(void *arg)
+{
+	struct crt_hpool_worker	*worker = arg;
+	struct crt_hpool	*pool = worker->hw_pool;
+	struct crt_rpc_priv	*rpc_priv;
+	bool			 stop = false;
+
+	crt_hpool_self = pool;
+
+	while (!stop) {
+		rpc_priv = crt_hpool_get(worker);
+		if (rpc_priv != NULL) {
+			crt_handle_rpc(&rpc_priv->crp_pub);
+			__atomic_add_fetch(&worker->hw_executed, 1,
+					   __ATOMIC_RELAXED);
+			continue;
+		}
+
+		D_MUTEX_LOCK(&pool->hp_mutex);
+		if (__atomic_load_n(&pool->hp_pending, __ATOMIC_RELAXED) == 0) {
+			/* queued RPCs are all handled before stopping */
+			if (pool->hp_stop) {
+				stop = true;
+			} else {
+				pool->hp_idle++;
+				pthread_cond_wait(&pool->hp_cond,
+						  &pool->hp_mutex);
+				pool->hp_idle--;
+			}
+		}
+		D_MUTEX_UNLOCK(&pool->hp_mutex);
+	}
+
+	crt_hpool_self = NULL;
+	return NULL;
+}
+
+/* crt_rpc_task_t of a context with a handler pool */
+static int
+crt_hpool_rpc_task(crt_context_t *ctx, crt_rpc_t *rpc,
+		   void (*rpc_hdlr)(void *), void *arg)
+{
+	struct crt_hpool	*pool = arg;
+	struct crt_hpool_worker	*worker;
+	struct crt_rpc_priv	*rpc_priv;
+	uint32_t		 idx;
+
+	D_ASSERT(pool != NULL && rpc != NULL);
+	D_ASSERT(rpc_hdlr == crt_handle_rpc);
+	rpc_priv = container_of(rpc, struct crt_rpc_priv, crp_pub);
+
+	idx = __atomic_fetch_add(&pool->hp_next, 1, __ATOMIC_RELAXED);
+	worker = &pool->hp_workers[idx % pool->hp_worker_num];
+
+	D_SPIN_LOCK(&worker->hw_lock);
+	d_list_add_tail(&rpc_priv->crp_hpool_link, &worker->hw_queue);
+	worker->hw_queue_len++;
+	worker->hw_queued++;
+	if (worker->hw_queue_len > worker->hw_queue_hwm)
+		worker->hw_queue_hwm = worker->hw_queue_len;
+	D_SPIN_UNLOCK(&worker->hw_lock);
+
+	D_MUTEX_LOCK(&pool->hp_mutex);
+	__atomic_add_fetch(&pool->hp_pending, 1, __ATOMIC_RELAXED);
+	if (pool->hp_idle > 0)
+		pthread_cond_signal(&pool->hp_cond);
+	D_MUTEX_UNLOCK(&pool->hp_mutex);
+
+	return 0;
+}
+
+bool
+crt_hpool_reply_defer(struct crt_rpc_priv *rpc_priv)
+{
+	struct crt_hpool	*pool = crt_hpool_self;
+
+	if (pool == NULL || pool->hp_ctx != rpc_priv->crp_pub.cr_ctx)
+		return false;
+
+	/* released by crt_hpool_progress() once the reply is sent */
+	RPC_ADDREF(rpc_priv);
+	D_SPIN_LOCK(&pool->hp_reply_lock);
+	d_list_add_tail(&rpc_priv->crp_hpool_link, &pool->hp_reply_q);
+	D_SPIN_UNLOCK(&pool->hp_reply_lock);
+	crt_context_signal(pool->hp_ctx);
+
+	return true;
+}
+
+/* send the replies queued by the workers, called by the progressing thread */
+void
+crt_hpool_progress(struct crt_context *ctx)
+{
+	struct crt_hpool	*pool = ctx->cc_hpool;
+	struct crt_rpc_priv	*rpc_priv;
+	d_list_t		 replies;
+	int			 rc;
+
+	if (pool == NULL || d_list_empty(&pool->hp_reply_q))
+		return;
+
+	D_INIT_LIST_HEAD(&replies);
+	D_SPIN_LOCK(&pool->hp_reply_lock);
+	d_list_splice_init(&pool->hp_reply_q, &replies);
+	D_SPIN_UNLOCK(&pool->hp_reply_lock);
+
+	while ((rpc_priv = d_list_pop_entry(&replies, struct crt_rpc_priv,
+					    crp_hpool_link))) {
+		rc = crt_reply_send(&rpc_priv->crp_pub);
+		if (rc != 0)
+			RPC_ERROR(rpc_priv, "crt_reply_send failed, rc: %d.\n",
+				  rc);
+		RPC_DECREF(rpc_priv);
+	}
+}
+
+/* stop the started workers once they handled all queued RPCs */
+static void
+crt_hpool_stop(struct crt_hpool *pool)
+{
+	int	i;
+
+	D_MUTEX_LOCK(&pool->hp_mutex);
+	pool->hp_stop = true;
+	pthread_cond_broadcast(&pool->hp_cond);
+	D_MUTEX_UNLOCK(&pool->hp_mutex);
+
+	for (i = 0; i < pool->hp_worker_num; i++)
+		pthread_join(pool->hp_workers[i].hw_thread, NULL);
+}
+
+static void
+crt_hpool_free(struct crt_hpool *pool, int nworkers)
+{
+	int	i;
+
+	for (i = 0; i < nworkers; i++)
+		D_SPIN_DESTROY(&pool->hp_workers[i].hw_lock);
+	D_SPIN_DESTROY(&pool->hp_reply_lock);
+	pthread_cond_destroy(&pool->hp_cond);
+	D_MUTEX_DESTROY(&pool->hp_mutex);
+	D_FREE(pool);
+}
+
+int
+crt_context_handler_pool_create(crt_context_t crt_ctx, unsigned int nworkers)
+{
+	struct crt_context	*ctx = crt_ctx;
+	struct crt_hpool	*pool;
+	struct crt_hpool_worker	*worker;
+	int			 i;
+	int			 rc;
+
+	if (ctx == CRT_CONTEXT_NULL || nworkers == 0 ||
+	    nworkers > CRT_HPOOL_MAX_WORKERS) {
+		D_ERROR("invalid parameter, crt_ctx: %p, nworkers: %u.\n",
+			crt_ctx, nworkers);
+		D_GOTO(out, rc = -DER_INVAL);
+	}
+	if (ctx->cc_hpool != NULL || ctx->cc_rpc_cb != NULL) {
+		D_ERROR("context %d already has an RPC task callback.\n",
+			ctx->cc_idx);
+		D_GOTO(out, rc = -DER_ALREADY);
+	}
+
+	D_ALLOC(pool, offsetof(struct crt_hpool, hp_workers[nworkers]));
+	if (pool == NULL)
+		D_GOTO(out, rc = -DER_NOMEM);
+
+	pool->hp_ctx = ctx;
+	D_INIT_LIST_HEAD(&pool->hp_reply_q);
+	rc = D_MUTEX_INIT(&pool->hp_mutex, NULL);
+	if (rc != 0) {
+		D_FREE(pool);
+		D_GOTO(out, rc);
+	}
+	rc = pthread_cond_init(&pool->hp_cond, NULL);
+	if (rc != 0) {
+		D_MUTEX_DESTROY(&pool->hp_mutex);
+		D_FREE(pool);
+		D_GOTO(out, rc = d_errno2der(rc));
+	}
+	rc = D_SPIN_INIT(&pool->hp_reply_lock, PTHREAD_PROCESS_PRIVATE);
+	if (rc != 0) {
+		pthread_cond_destroy(&pool->hp_cond);
+		D_MUTEX_DESTROY(&pool->hp_mutex);
+		D_FREE(pool);
+		D_GOTO(out, rc);
+	}
+
+	for (i = 0; i < nworkers; i++) {
+		worker = &pool->hp_workers[i];
+		worker->hw_pool = pool;
+		D_INIT_LIST_HEAD(&worker->hw_queue);
+		rc = D_SPIN_INIT(&worker->hw_lock, PTHREAD_PROCESS_PRIVATE);
+		if (rc != 0) {
+			crt_hpool_free(pool, i);
+			D_GOTO(out, rc);
+		}
+	}
+
+	/* hp_worker_num counts the started workers */
+	for (i = 0; i < nworkers; i++) {
+		rc = pthread_create(&pool->hp_workers[i].hw_thread, NULL,
+				    crt_hpool_worker_main,
+				    &pool->hp_workers[i]);
+		if (rc != 0) {
+			D_ERROR("pthread_create failed, rc: %d.\n", rc);
+			crt_hpool_stop(pool);
+			crt_hpool_free(pool, nworkers);
+			D_GOTO(out, rc = d_errno2der(rc));
+		}
+		pool->hp_worker_num++;
+	}
+
+	ctx->cc_hpool = pool;
+	ctx->cc_rpc_cb = crt_hpool_rpc_task;
+	ctx->cc_rpc_cb_arg = pool;
+	D_DEBUG(DB_TRACE, "context %d, started %u RPC handler workers.\n",
+		ctx->cc_idx, nworkers);
+
+out:
+	return rc;
+}
+
+int
+crt_context_handler_pool_stats(crt_context_t crt_ctx,
+			       struct crt_handler_pool_stats *stats,
+			       unsigned int *nr)
+{
+	struct crt_context	*ctx = crt_ctx;
+	struct crt_hpool	*pool;
+	struct crt_hpool_worker	*worker;
+	int			 i;
+
+	if (ctx == CRT_CONTEXT_NULL || nr == NULL ||
+	    (stats == NULL && *nr > 0)) {
+		D_ERROR("invalid parameter, crt_ctx: %p, stats: %p, nr: %p.\n",
+			crt_ctx, stats, nr);
+		return -DER_INVAL;
+	}
+
+	pool = ctx->cc_hpool;
+	if (pool == NULL)
+		return -DER_NONEXIST;
+
+	for (i = 0; i < pool->hp_worker_num && i < *nr; i++) {
+		worker = &pool->hp_workers[i];
+		D_SPIN_LOCK(&worker->hw_lock);
+		stats[i].hps_queued = worker->hw_queued;
+		stats[i].hps_executed = __atomic_load_n(&worker->hw_executed,
+							__ATOMIC_RELAXED);
+		stats[i].hps_stolen = __atomic_load_n(&worker->hw_stolen,
+						      __ATOMIC_RELAXED);
+		stats[i].hps_queue_len = worker->hw_queue_len;
+		stats[i].hps_queue_hwm = worker->hw_queue_hwm;
+		D_SPIN_UNLOCK(&worker->hw_lock);
+	}
+	*nr = pool->hp_worker_num;
+
+	return 0;
+}
+
+/* called by crt_context_destroy() */
+void
+crt_hpool_destroy(struct crt_context *ctx)
+{
+	struct crt_hpool	*pool = ctx->cc_hpool;
+	struct crt_hpool_worker	*worker;
+	int			 i;
+
+	if (pool == NULL)
+		return;
+
+	crt_hpool_stop(pool);
+	/* send the replies of the last handlers */
+	crt_hpool_progress(ctx);
+
+	ctx->cc_rpc_cb = NULL;
+	ctx->cc_rpc_cb_arg = NULL;
+	ctx->cc_hpool = NULL;
+
+	for (i = 0; i < pool->hp_worker_num; i++) {
+		worker = &pool->hp_workers[i];
+		D_DEBUG(DB_TRACE, "context %d, worker %d: queued "DF_U64
+			", executed "DF_U64", stolen "DF_U64
+			", max queue length %u.\n", ctx->cc_idx, i,
+			worker->hw_queued, worker->hw_executed,
+			worker->hw_stolen, worker->hw_queue_hwm);
+	}
+	crt_hpool_free(pool, pool->hp_worker_num);
+}
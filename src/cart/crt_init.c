@@ -51,6 +51,12 @@ static int data_init(crt_init_options_t *opt)
 {
 	uint32_t	timeout;
 	uint32_t	credits;
+	uint32_t	rpc_cache_max;
+	bool		credit_adaptive = true;
+	uint32_t	batch_max = 0;
+	bool		progress_blocking = false;
+	bool		attach_prefetch = false;
+	uint32_t	corpc_bulk_seg = 0;
 	bool		share_addr = false;
 	uint32_t	ctx_num = 1;
 	int		rc = 0;
@@ -110,6 +116,48 @@ static int data_init(crt_init_options_t *opt)
 	crt_gdata.cg_credit_ep_ctx = credits;
 	D_ASSERT(crt_gdata.cg_credit_ep_ctx <= CRT_MAX_CREDITS_PER_EP_CTX);
 
+	d_getenv_bool("CRT_CREDIT_ADAPTIVE", &credit_adaptive);
+	crt_gdata.cg_credit_adaptive = credit_adaptive;
+	if (credits != 0)
+		D_DEBUG(DB_ALL, "%s credits per EP CTX.\n", credit_adaptive ?
+			"adaptive" : "static");
+
+	d_getenv_int("CRT_BATCH_MAX", &batch_max);
+	if (batch_max > CRT_BATCH_MAX_NUM)
+		batch_max = CRT_BATCH_MAX_NUM;
+	if (batch_max == 1 || credits == 0)
+		batch_max = 0;
+	crt_gdata.cg_batch_max = batch_max;
+	if (batch_max != 0)
+		D_DEBUG(DB_ALL, "CRT_BATCH_MAX set as %d, up to %d queued RPCs "
+			"packed into one message.\n", batch_max, batch_max);
+
+	d_getenv_bool("CRT_PROGRESS_BLOCKING", &progress_blocking);
+	crt_gdata.cg_progress_blocking = progress_blocking;
+	if (progress_blocking)
+		D_DEBUG(DB_ALL, "CRT_PROGRESS_BLOCKING set, crt_progress() "
+			"sleeps on the context wait fd.\n");
+
+	d_getenv_bool("CRT_ATTACH_PREFETCH", &attach_prefetch);
+	crt_gdata.cg_attach_prefetch = attach_prefetch;
+	if (attach_prefetch)
+		D_DEBUG(DB_ALL, "CRT_ATTACH_PREFETCH set, URIs of attached "
+			"service groups are prefetched.\n");
+
+	d_getenv_int("CRT_CORPC_BULK_SEG", &corpc_bulk_seg);
+	if (corpc_bulk_seg != 0 && corpc_bulk_seg < CRT_CORPC_BULK_SEG_MIN)
+		corpc_bulk_seg = CRT_CORPC_BULK_SEG_MIN;
+	crt_gdata.cg_corpc_bulk_seg = corpc_bulk_seg;
+	if (corpc_bulk_seg != 0)
+		D_DEBUG(DB_ALL, "CRT_CORPC_BULK_SEG set as %u, corpc bulk is "
+			"forwarded in segments.\n", corpc_bulk_seg);
+
+	rpc_cache_max = CRT_RPC_CACHE_DEFAULT_MAX;
+	d_getenv_int("CRT_RPC_CACHE_MAX", &rpc_cache_max);
+	crt_gdata.cg_rpc_cache_max = rpc_cache_max;
+	D_DEBUG(DB_ALL, "CRT_RPC_CACHE_MAX set as %d%s.\n", rpc_cache_max,
+		rpc_cache_max == 0 ? ", RPC descriptor cache disabled" : "");
+
 	if (opt && opt->cio_sep_override) {
 		if (opt->cio_use_sep) {
 			crt_gdata.cg_share_na = true;
@@ -78,6 +78,19 @@ void crt_rpc_complete(struct crt_rpc_priv *rpc_priv, int rc);
 int crt_req_timeout_track(struct crt_rpc_priv *rpc_priv);
 void crt_req_timeout_untrack(struct crt_rpc_priv *rpc_priv);
 void crt_req_force_timeout(struct crt_rpc_priv *rpc_priv);
+void crt_context_signal(struct crt_context *ctx);
+
+/* return value of crt_req_lookup_park, the RPC waits for another lookup */
+#define CRT_LOOKUP_PARKED	(1)
+
+int crt_req_lookup_park(struct crt_rpc_priv *rpc_priv);
+void crt_req_lookup_done(struct crt_rpc_priv *rpc_priv, int rc);
+bool crt_req_lookup_cancel(struct crt_rpc_priv *rpc_priv);
+
+/** crt_hpool.c */
+void crt_hpool_destroy(struct crt_context *ctx);
+bool crt_hpool_reply_defer(struct crt_rpc_priv *rpc_priv);
+void crt_hpool_progress(struct crt_context *ctx);
 
 /** some simple helper functions */
 
@@ -50,7 +50,8 @@
 
 #include <gurt/list.h>
 #include <gurt/hash.h>
-#include <gurt/heap.h>
+#include <gurt/timewheel.h>
+#include <gurt/rankmap.h>
 
 struct crt_hg_gdata;
 struct crt_grp_gdata;
@@ -73,6 +74,18 @@ struct crt_gdata {
 	uint32_t		cg_timeout;
 	/* credits limitation for #inflight RPCs per target EP CTX */
 	uint32_t		cg_credit_ep_ctx;
+	/* adapt the credits per EP CTX in [1, CRT_MAX_CREDITS_PER_EP_CTX] */
+	bool			cg_credit_adaptive;
+	/* max number of queued RPCs packed into one message, 0 to disable */
+	uint32_t		cg_batch_max;
+	/* max number of cached RPC descriptors per context and size class */
+	uint32_t		cg_rpc_cache_max;
+	/* sleep on the context wait fd when progressing with a cond_cb */
+	bool			cg_progress_blocking;
+	/* prefetch the URIs of a service group when attaching to it */
+	bool			cg_attach_prefetch;
+	/* segment size of the pipelined corpc bulk, 0 to disable */
+	uint32_t		cg_corpc_bulk_seg;
 
 	/* CaRT contexts list */
 	d_list_t		cg_ctx_list;
@@ -158,12 +171,71 @@ extern struct crt_plugin_gdata		crt_plugin_gdata;
 # define CRT_SRV_CONTEXT_NUM		(256)
 #endif
 
+/* tick length of the RPC timeout timing wheel, in micro-seconds */
+#define CRT_TIMEOUT_TICK_US		(1000)
+/* max sleep of a blocking progress without any timer or network activity */
+#define CRT_PROGRESS_IDLE_MAX_US	(1000 * 1000)
+/* max number of contexts of a progress set using its epoll fd */
+#define CRT_PROGRESS_SET_EVENTS		(256)
+/* wait per context of a progress set which has to poll, in micro-seconds */
+#define CRT_PROGRESS_SET_SLICE_US	(1000)
+
 /* (1 << CRT_EPI_TABLE_BITS) is the number of buckets of epi hash table */
-#define CRT_EPI_TABLE_BITS		(3)
+#define CRT_EPI_TABLE_BITS		(8)
+/* ranks below it are indexed by the lockless epi rank map */
+#define CRT_EPI_MAP_MAX			(1U << 20)
+/* (1 << CRT_LOOKUP_TABLE_BITS) is the number of buckets of lookup table */
+#define CRT_LOOKUP_TABLE_BITS		(8)
+/* (1 << CRT_PIPE_TABLE_BITS) is the number of buckets of the pipe table */
+#define CRT_PIPE_TABLE_BITS		(8)
+/* backoff before looking up again an address that failed to resolve */
+#define CRT_LOOKUP_BACKOFF_MIN_US	(10000)
+#define CRT_LOOKUP_BACKOFF_MAX_US	(5000000)
+/* a failed lookup not retried that long after its backoff is forgotten */
+#define CRT_LOOKUP_EXPIRE_US		(CRT_LOOKUP_BACKOFF_MAX_US)
 #define CRT_DEFAULT_CREDITS_PER_EP_CTX	(32)
 #define CRT_MAX_CREDITS_PER_EP_CTX	(256)
+#define CRT_MIN_CREDITS_PER_EP_CTX	(1)
+#define CRT_BATCH_MAX_NUM		(64)
+/* max encoded size of a request that can be packed into a batch */
+#define CRT_BATCH_REQ_SIZE		(512)
+/* min segment size of the pipelined corpc bulk, see CRT_CORPC_BULK_SEG */
+#define CRT_CORPC_BULK_SEG_MIN		(4096)
 
 /* crt_context */
+/*
+ * RPC descriptor size classes of the per-context cache, power of two sizes
+ * from 512 bytes up to 64KB. Larger descriptors bypass the cache.
+ */
+#define CRT_RPC_CACHE_CLASS_SHIFT	(9)
+#define CRT_RPC_CACHE_CLASS_NUM		(8)
+#define CRT_RPC_CACHE_DEFAULT_MAX	(256)
+
+/*
+ * per-context cache of struct crt_rpc_priv, one free list per size class. It
+ * is freed with the context or the last descriptor allocated from it, which
+ * can be released after the context is destroyed.
+ */
+struct crt_rpc_cache {
+	/*
+	 * protects the free lists and counters, an RPC can be released from
+	 * any thread, not only the one progressing the owning context
+	 */
+	pthread_spinlock_t	 crc_lock;
+	d_list_t		 crc_free[CRT_RPC_CACHE_CLASS_NUM];
+	uint32_t		 crc_free_num[CRT_RPC_CACHE_CLASS_NUM];
+	/* max number of cached descriptors per size class */
+	uint32_t		 crc_max_num;
+	/* one for the context, one per descriptor allocated from the cache */
+	uint32_t		 crc_ref;
+	bool			 crc_enabled;
+	/* statistics */
+	uint64_t		 crc_hit; /* allocation served from cache */
+	uint64_t		 crc_miss; /* allocation fell back to D_ALLOC */
+	uint64_t		 crc_recycled; /* descriptor put back to cache */
+	uint64_t		 crc_released; /* cache full, descriptor freed */
+};
+
 struct crt_context {
 	d_list_t		 cc_link; /* link to gdata.cg_ctx_list */
 	int			 cc_idx; /* context index */
@@ -172,12 +244,83 @@ struct crt_context {
 	crt_rpc_task_t		cc_rpc_cb; /* rpc callback */
 	/* in-flight endpoint tracking hash table */
 	struct d_hash_table	 cc_epi_table;
-	/* binheap for inflight RPC timeout tracking */
-	struct d_binheap	 cc_bh_timeout;
-	/* mutex to protect cc_epi_table and timeout binheap */
+	/* rank indexed epis of cc_epi_table, for the lockless lookup */
+	struct d_rank_map	 cc_epi_map;
+	/* mutex to protect cc_epi_table and updates of cc_epi_map */
 	pthread_mutex_t		 cc_mutex;
+	/* address lookups in flight or failed, see crt_req_lookup_park() */
+	struct d_hash_table	 cc_lookup_table;
+	/* mutex to protect cc_lookup_table and its records */
+	pthread_mutex_t		 cc_lookup_mutex;
+	/* time of the next expiry of the failed lookups, in micro-seconds */
+	uint64_t		 cc_lookup_expire_ts;
+	/* pipelined bulks of the corpcs received, see crt_corpc_pipe */
+	struct d_hash_table	 cc_pipe_table;
+	/* timing wheel for inflight RPC timeout tracking */
+	struct d_timewheel	 cc_tw_timeout;
+	/* spinlock to protect cc_tw_timeout */
+	pthread_spinlock_t	 cc_tw_lock;
 	/* timeout per-context */
 	uint32_t		 cc_timeout_sec;
+	/* RPC descriptor cache */
+	struct crt_rpc_cache	*cc_rpc_cache;
+	/* RPC handler pool, NULL if handlers run in the progress thread */
+	struct crt_hpool	*cc_hpool;
+	/*
+	 * epoll fd polling the HG context and cc_event_fd, see
+	 * crt_context_get_wait_fd(), -1 if the transport has no wait fd
+	 */
+	int			 cc_wait_fd;
+	/* eventfd to wake up a thread sleeping on cc_wait_fd */
+	int			 cc_event_fd;
+	/* cc_event_fd has been written and not read yet */
+	uint32_t		 cc_event_pending;
+	/* reply aggregation of corpcs, see crt_context_corpc_stats() */
+	struct crt_corpc_stats	 cc_corpc_stats;
+};
+
+/* contexts progressed together, see crt_progress_set() */
+struct crt_progress_set {
+	struct crt_context	**ps_ctxs;
+	uint32_t		  ps_num;
+	/* the context progressed first in the next round */
+	uint32_t		  ps_next;
+	/* epoll fd over the wait fds of the contexts which have one */
+	int			  ps_wait_fd;
+	/* number of contexts without a wait fd */
+	uint32_t		  ps_nowait_num;
+};
+
+/* worker thread of a crt_hpool */
+struct crt_hpool_worker {
+	struct crt_hpool	*hw_pool;
+	pthread_t		 hw_thread;
+	/* queued RPCs, linked by crp_hpool_link */
+	pthread_spinlock_t	 hw_lock;
+	d_list_t		 hw_queue;
+	uint32_t		 hw_queue_len;
+	/* statistics, hw_executed and hw_stolen are atomic, not under hw_lock */
+	uint32_t		 hw_queue_hwm;
+	uint64_t		 hw_queued;
+	uint64_t		 hw_executed;
+	uint64_t		 hw_stolen;
+};
+
+/* RPC handler pool, see crt_context_handler_pool_create() */
+struct crt_hpool {
+	struct crt_context	*hp_ctx;
+	/* idle workers wait on hp_cond until hp_pending is non-zero */
+	pthread_mutex_t		 hp_mutex;
+	pthread_cond_t		 hp_cond;
+	uint32_t		 hp_pending; /* RPCs queued to all workers */
+	uint32_t		 hp_idle; /* number of waiting workers */
+	uint32_t		 hp_next; /* worker to queue the next RPC to */
+	bool			 hp_stop;
+	/* replies sent by handlers, sent by the progressing thread */
+	pthread_spinlock_t	 hp_reply_lock;
+	d_list_t		 hp_reply_q;
+	uint32_t		 hp_worker_num;
+	struct crt_hpool_worker	 hp_workers[0];
 };
 
 /* in-flight RPC req list, be tracked per endpoint for every crt_context */
@@ -197,6 +340,17 @@ struct crt_ep_inflight {
 	d_list_t		 epi_req_waitq;
 	int64_t			 epi_req_wait_num;
 
+	/* adaptive flow control, see crt_epi_credit_update() */
+	uint32_t		 epi_credits; /* max number of inflight req */
+	uint32_t		 epi_credit_acc; /* replies since last increase */
+	uint64_t		 epi_send_seq; /* seq of the last req inflight */
+	uint64_t		 epi_credit_dec_seq; /* seq at last decrease */
+	/* statistics */
+	uint64_t		 epi_credit_inc_num;
+	uint64_t		 epi_credit_dec_num;
+	int64_t			 epi_inflight_hwm; /* max inflight req */
+	int64_t			 epi_req_wait_hwm; /* max waitq depth */
+
 	unsigned int		 epi_ref;
 	unsigned int		 epi_initialized:1;
 
@@ -204,6 +358,32 @@ struct crt_ep_inflight {
 	pthread_mutex_t		 epi_mutex;
 };
 
+struct crt_ep_lookup_key {
+	struct crt_grp_priv	*elk_grp_priv;
+	d_rank_t		 elk_rank;
+	uint32_t		 elk_tag;
+};
+
+/*
+ * Address lookup of an endpoint by a context. The first RPC to an unresolved
+ * endpoint does the lookup, the others wait for it. A failed lookup is not
+ * retried before el_retry_ts, RPCs to the endpoint fail with el_rc until
+ * then.
+ */
+struct crt_ep_lookup {
+	/* link to crt_context::cc_lookup_table */
+	d_list_t		 el_link;
+	struct crt_ep_lookup_key el_key;
+	/* the RPC doing the lookup, NULL if none in flight */
+	struct crt_rpc_priv	*el_leader;
+	/* RPCs waiting for the lookup, linked by crp_lookup_link */
+	d_list_t		 el_waitq;
+	/* consecutive failed lookups */
+	uint32_t		 el_fail_num;
+	uint64_t		 el_retry_ts;
+	int			 el_rc;
+};
+
 #define CRT_UNLOCK			(0)
 #define CRT_LOCKED			(1)
 #define CRT_ADDR_STR_MAX_LEN		(128)
@@ -0,0 +1,250 @@
+/* Copyright (C) 2018 Intel Corporation
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted for any purpose (including commercial purposes)
+ * provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions, and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions, and the following disclaimer in the
+ *    documentation and/or materials provided with the distribution.
+ *
+ * 3. In addition, redistributions of modified forms of the source or binary
+ *    code must carry prominent notices stating that the original code was
+ *    changed and the date of the change.
+ *
+ *  4. All publications or advertising materials mentioning features or use of
+ *     this software are asked, but not required, to acknowledge that it was
+ *     developed by Intel Corporation and credit the contributors.
+ *
+ * 5. Neither the name of Intel Corporation, nor the name of any Contributor
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+/**
+ * This file is part of CaRT. It implements the built-in reductions of the
+ * collective RPC replies, see crt_corpc_ops::co_reduce_op.
+ *
+ * The kernels are plain loops left to the compiler to vectorize. On x86_64
+ * with GCC they are built for AVX-512, AVX2 and the baseline, the best one
+ * for the CPU is picked when the library is loaded.
+ */
+#define D_LOGFAC	DD_FAC(corpc)
+
+#include "crt_internal.h"
+
+#if defined(__x86_64__) && defined(__GNUC__) && !defined(__clang__) && \
+	__GNUC__ >= 6
+#define CRT_REDUCE_KERNEL_ATTR						\
+	__attribute__((target_clones("avx512f", "avx2", "default"),	\
+		       optimize("tree-vectorize")))
+#else
+#define CRT_REDUCE_KERNEL_ATTR
+#endif
+
+typedef void (*crt_reduce_kernel_t)(void *result, const void *source,
+				    size_t nr);
+
+/* the reduction operators, applied to an element of result and of source */
+#define CRT_RED_OP_SUM(r, s)	((r) + (s))
+#define CRT_RED_OP_MIN(r, s)	((s) < (r) ? (s) : (r))
+#define CRT_RED_OP_MAX(r, s)	((s) > (r) ? (s) : (r))
+#define CRT_RED_OP_BAND(r, s)	((r) & (s))
+#define CRT_RED_OP_BOR(r, s)	((r) | (s))
+
+/* defines crt_reduce_<opname>_<name>() applying operator op to type */
+#define CRT_REDUCE_KERNEL(opname, op, name, type)			\
+	static CRT_REDUCE_KERNEL_ATTR void				\
+	crt_reduce_##opname##_##name(void *result, const void *source,	\
+				     size_t nr)				\
+	{								\
+		type *restrict		 r = result;			\
+		const type *restrict	 s = source;			\
+		size_t			 i;				\
+									\
+		for (i = 0; i < nr; i++)				\
+			r[i] = op(r[i], s[i]);				\
+	}
+
+#define CRT_REDUCE_KERNELS(opname, op)					\
+	CRT_REDUCE_KERNEL(opname, op, int32, int32_t)			\
+	CRT_REDUCE_KERNEL(opname, op, int64, int64_t)			\
+	CRT_REDUCE_KERNEL(opname, op, uint64, uint64_t)
+
+CRT_REDUCE_KERNELS(sum, CRT_RED_OP_SUM)
+CRT_REDUCE_KERNELS(min, CRT_RED_OP_MIN)
+CRT_REDUCE_KERNELS(max, CRT_RED_OP_MAX)
+CRT_REDUCE_KERNELS(band, CRT_RED_OP_BAND)
+CRT_REDUCE_KERNELS(bor, CRT_RED_OP_BOR)
+CRT_REDUCE_KERNEL(sum, CRT_RED_OP_SUM, double, double)
+CRT_REDUCE_KERNEL(min, CRT_RED_OP_MIN, double, double)
+CRT_REDUCE_KERNEL(max, CRT_RED_OP_MAX, double, double)
+
+#define CRT_REDUCE_ROW(op, opname, dbl)					\
+	[op] = {							\
+		[CRT_REDUCE_INT32] = crt_reduce_##opname##_int32,	\
+		[CRT_REDUCE_INT64] = crt_reduce_##opname##_int64,	\
+		[CRT_REDUCE_UINT64] = crt_reduce_##opname##_uint64,	\
+		[CRT_REDUCE_DOUBLE] = dbl,				\
+	}
+
+/* indexed by enum crt_reduce_op then enum crt_reduce_type */
+static const crt_reduce_kernel_t
+crt_reduce_kernels[CRT_REDUCE_OP_MAX + 1][CRT_REDUCE_TYPE_MAX + 1] = {
+	CRT_REDUCE_ROW(CRT_REDUCE_SUM, sum, crt_reduce_sum_double),
+	CRT_REDUCE_ROW(CRT_REDUCE_MIN, min, crt_reduce_min_double),
+	CRT_REDUCE_ROW(CRT_REDUCE_MAX, max, crt_reduce_max_double),
+	CRT_REDUCE_ROW(CRT_REDUCE_BAND, band, NULL),
+	CRT_REDUCE_ROW(CRT_REDUCE_BOR, bor, NULL),
+};
+
+static const size_t crt_reduce_type_sizes[CRT_REDUCE_TYPE_MAX + 1] = {
+	[CRT_REDUCE_INT32]	= sizeof(int32_t),
+	[CRT_REDUCE_INT64]	= sizeof(int64_t),
+	[CRT_REDUCE_UINT64]	= sizeof(uint64_t),
+	[CRT_REDUCE_DOUBLE]	= sizeof(double),
+};
+
+static inline crt_reduce_kernel_t
+crt_reduce_kernel(enum crt_reduce_op op, enum crt_reduce_type type)
+{
+	if (op <= CRT_REDUCE_NONE || op > CRT_REDUCE_OP_MAX ||
+	    (int)type < 0 || type > CRT_REDUCE_TYPE_MAX)
+		return NULL;
+
+	return crt_reduce_kernels[op][type];
+}
+
+/*
+ * Element size of @type, 0 if reduction @op is not supported for @type.
+ */
+size_t
+crt_reduce_size(enum crt_reduce_op op, enum crt_reduce_type type)
+{
+	if (crt_reduce_kernel(op, type) == NULL)
+		return 0;
+
+	return crt_reduce_type_sizes[type];
+}
+
+int
+crt_reduce(enum crt_reduce_op op, enum crt_reduce_type type, void *result,
+	   const void *source, size_t nr)
+{
+	crt_reduce_kernel_t	kernel;
+
+	kernel = crt_reduce_kernel(op, type);
+	if (kernel == NULL) {
+		D_ERROR("reduction op %d not supported for type %d.\n",
+			op, type);
+		return -DER_INVAL;
+	}
+	if (nr == 0)
+		return 0;
+	if (result == NULL || source == NULL) {
+		D_ERROR("invalid parameter, result: %p, source: %p.\n",
+			result, source);
+		return -DER_INVAL;
+	}
+
+	kernel(result, source, nr);
+	return 0;
+}
+
+/*
+ * Check the built-in reduction of @co_ops registered for @opc, which has an
+ * output struct of @output_size bytes.
+ */
+int
+crt_corpc_reduce_check(crt_opcode_t opc, struct crt_corpc_ops *co_ops,
+		       size_t output_size)
+{
+	if (co_ops == NULL || co_ops->co_aggregate != NULL ||
+	    co_ops->co_reduce_op == CRT_REDUCE_NONE)
+		return 0;
+
+	if (crt_reduce_kernel(co_ops->co_reduce_op,
+			      co_ops->co_reduce_type) == NULL) {
+		D_ERROR("opc %#x, reduction op %d not supported for type %d.\n",
+			opc, co_ops->co_reduce_op, co_ops->co_reduce_type);
+		return -DER_INVAL;
+	}
+	if (co_ops->co_reduce_off + sizeof(d_iov_t) > output_size) {
+		D_ERROR("opc %#x, reduction field offset %u out of the output "
+			"(%zu bytes).\n", opc, co_ops->co_reduce_off,
+			output_size);
+		return -DER_INVAL;
+	}
+
+	return 0;
+}
+
+/*
+ * Reduce the output of @source into the one of @result, the result of corpc
+ * @rpc_priv. If @first, @source is its first reply, already copied into it.
+ *
+ * The array is reduced into co_reduce_buf, a copy of the array of the local
+ * reply (or of the first reply) owned by the corpc, not into the buffer of
+ * the local RPC handler or of a child RPC.
+ */
+int
+crt_corpc_reduce(struct crt_rpc_priv *rpc_priv, crt_rpc_t *source, bool first)
+{
+	struct crt_corpc_info	*co_info = rpc_priv->crp_corpc_info;
+	struct crt_corpc_ops	*co_ops = rpc_priv->crp_opc_info->coi_co_ops;
+	size_t			 size;
+	d_iov_t			*src;
+	d_iov_t			*res;
+	void			*buf;
+
+	size = crt_reduce_type_sizes[co_ops->co_reduce_type];
+	src = (d_iov_t *)((char *)source->cr_output + co_ops->co_reduce_off);
+	res = (d_iov_t *)((char *)rpc_priv->crp_pub.cr_output +
+			  co_ops->co_reduce_off);
+
+	/* an empty local reply takes the first array it is reduced with */
+	if (co_info->co_reduce_buf == NULL && res->iov_len == 0) {
+		*res = *src;
+		first = true;
+	}
+
+	if (co_info->co_reduce_buf == NULL && res->iov_len > 0) {
+		if (res->iov_len % size != 0) {
+			RPC_ERROR(rpc_priv, "reduction array of %zu bytes not "
+				  "of %zu bytes elements\n", res->iov_len,
+				  size);
+			return -DER_INVAL;
+		}
+		D_ALLOC(buf, res->iov_len);
+		if (buf == NULL)
+			return -DER_NOMEM;
+		memcpy(buf, res->iov_buf, res->iov_len);
+		d_iov_set(res, buf, res->iov_len);
+		co_info->co_reduce_buf = buf;
+	}
+	if (first)
+		return 0;
+
+	if (src->iov_len != res->iov_len) {
+		RPC_ERROR(rpc_priv, "reduction array of %zu bytes, expecting "
+			  "%zu\n", src->iov_len, res->iov_len);
+		return -DER_MISMATCH;
+	}
+
+	return crt_reduce(co_ops->co_reduce_op, co_ops->co_reduce_type,
+			  res->iov_buf, src->iov_buf, res->iov_len / size);
+}
@@ -603,6 +603,10 @@ crt_rpc_reg_internal_legacy(crt_opcode_t opc, uint32_t flags,
 	}
 
 reg_opc:
+	rc = crt_corpc_reduce_check(opc, co_ops, output_size);
+	if (rc != 0)
+		D_GOTO(out, rc);
+
 	rc = crt_opc_reg_legacy(crt_gdata.cg_opc_map_legacy, opc, flags, crf,
 				input_size, output_size, rpc_handler, co_ops,
 				CRT_UNLOCK);
@@ -654,6 +658,10 @@ crt_opc_reg_internal(struct crt_opc_info *opc_info, crt_opcode_t opc,
 	}
 
 reg_opc:
+	rc = crt_corpc_reduce_check(opc, prf->prf_co_ops, output_size);
+	if (rc != 0)
+		D_GOTO(out, rc);
+
 	rc = crt_opc_reg(opc_info, opc, prf->prf_flags, crf, input_size,
 			 output_size, prf->prf_hdlr, prf->prf_co_ops);
 	if (rc != 0)
@@ -61,6 +61,8 @@ static struct crt_corpc_ops crt_grp_destroy_co_ops = {
 
 /* uri lookup */
 CRT_RPC_DEFINE(crt_uri_lookup, CRT_ISEQ_URI_LOOKUP, CRT_OSEQ_URI_LOOKUP)
+CRT_RPC_DEFINE(crt_uri_lookup_batch, CRT_ISEQ_URI_LOOKUP_BATCH,
+	       CRT_OSEQ_URI_LOOKUP_BATCH)
 
 /* for self-test service */
 CRT_RPC_DEFINE(crt_st_send_id_reply_iov,
@@ -117,16 +119,28 @@ CRT_RPC_DEFINE(crt_lm_evict, CRT_ISEQ_LM_EVICT, CRT_OSEQ_LM_EVICT)
 CRT_RPC_DEFINE(crt_lm_memb_sample,
 		CRT_ISEQ_LM_MEMB_SAMPLE, CRT_OSEQ_LM_MEMB_SAMPLE)
 
-/* !! All of three following RPC definition should have the same input fields !!
+/* !! All of four following RPC definition should have the same input fields !!
  * All of them are verified in one function:
  * int verify_ctl_in_args(struct crt_ctl_ep_ls_in *in_args)
  */
 CRT_RPC_DEFINE(crt_ctl_ep_ls,    CRT_ISEQ_CTL, CRT_OSEQ_CTL_EP_LS)
 CRT_RPC_DEFINE(crt_ctl_get_host, CRT_ISEQ_CTL, CRT_OSEQ_CTL_GET_HOST)
 CRT_RPC_DEFINE(crt_ctl_get_pid,  CRT_ISEQ_CTL, CRT_OSEQ_CTL_GET_PID)
+CRT_RPC_DEFINE(crt_ctl_rpc_cache, CRT_ISEQ_CTL, CRT_OSEQ_CTL_RPC_CACHE)
+/* starts with the CRT_ISEQ_CTL fields, verified the same way */
+CRT_RPC_DEFINE(crt_ctl_hg_pool, CRT_ISEQ_CTL_HG_POOL, CRT_OSEQ_CTL_HG_POOL)
 
 CRT_RPC_DEFINE(crt_proto_query, CRT_ISEQ_PROTO_QUERY, CRT_OSEQ_PROTO_QUERY)
 
+/* small requests packed into one message, see crt_batch.c */
+CRT_RPC_DEFINE(crt_batch, CRT_ISEQ_BATCH, CRT_OSEQ_BATCH)
+
+CRT_RPC_DEFINE(crt_corpc_seg_wait, CRT_ISEQ_CORPC_SEG_WAIT,
+	       CRT_OSEQ_CORPC_SEG_WAIT)
+
+/* data movement collectives, see crt_coll.c */
+CRT_RPC_DEFINE(crt_coll_xfer, CRT_ISEQ_COLL_XFER, CRT_OSEQ_COLL_XFER)
+
 /* Define for crt_internal_rpcs[] array population below.
  * See CRT_INTERNAL_RPCS_LIST macro definition
  */
@@ -165,13 +179,201 @@ crt_internal_rpc_register(void)
 }
 
 int
-crt_rpc_priv_alloc(crt_opcode_t opc, struct crt_rpc_priv **priv_allocated,
-		   bool forward)
+crt_rpc_cache_init(struct crt_rpc_cache **cachep, uint32_t max_num)
+{
+	struct crt_rpc_cache	*cache;
+	int			 i;
+	int			 rc;
+
+	D_ASSERT(cachep != NULL);
+
+	D_ALLOC_PTR(cache);
+	if (cache == NULL)
+		D_GOTO(out, rc = -DER_NOMEM);
+
+	rc = D_SPIN_INIT(&cache->crc_lock, PTHREAD_PROCESS_PRIVATE);
+	if (rc != 0) {
+		D_FREE_PTR(cache);
+		D_GOTO(out, rc);
+	}
+
+	for (i = 0; i < CRT_RPC_CACHE_CLASS_NUM; i++) {
+		D_INIT_LIST_HEAD(&cache->crc_free[i]);
+		cache->crc_free_num[i] = 0;
+	}
+	cache->crc_max_num = max_num;
+	cache->crc_ref = 1;
+	cache->crc_enabled = (max_num > 0);
+	*cachep = cache;
+
+out:
+	return rc;
+}
+
+static void
+crt_rpc_cache_free(struct crt_rpc_cache *cache)
+{
+	uint64_t	alloc_num;
+
+	alloc_num = cache->crc_hit + cache->crc_miss;
+	D_DEBUG(DB_TRACE, "rpc cache %p, hit "DF_U64", miss "DF_U64
+		" (hit rate %d%%), recycled "DF_U64", released "DF_U64".\n",
+		cache, cache->crc_hit, cache->crc_miss,
+		alloc_num == 0 ? 0 : (int)(cache->crc_hit * 100 / alloc_num),
+		cache->crc_recycled, cache->crc_released);
+
+	D_SPIN_DESTROY(&cache->crc_lock);
+	D_FREE_PTR(cache);
+}
+
+void
+crt_rpc_cache_fini(struct crt_rpc_cache *cache)
 {
+	struct crt_rpc_priv	*rpc_priv;
+	d_list_t		 free_list;
+	bool			 last;
+	int			 i;
+
+	D_ASSERT(cache != NULL);
+
+	D_INIT_LIST_HEAD(&free_list);
+
+	/* the descriptors still in use are freed by crt_rpc_cache_put() */
+	D_SPIN_LOCK(&cache->crc_lock);
+	cache->crc_enabled = false;
+	for (i = 0; i < CRT_RPC_CACHE_CLASS_NUM; i++) {
+		d_list_splice_init(&cache->crc_free[i], &free_list);
+		cache->crc_free_num[i] = 0;
+	}
+	last = (--cache->crc_ref == 0);
+	D_SPIN_UNLOCK(&cache->crc_lock);
+
+	while ((rpc_priv = d_list_pop_entry(&free_list, struct crt_rpc_priv,
+					    crp_epi_link)))
+		D_FREE(rpc_priv);
+
+	if (last)
+		crt_rpc_cache_free(cache);
+}
+
+/* returns the size class index, or CRT_RPC_CACHE_CLASS_NUM if too large */
+static inline int
+crt_rpc_cache_class(size_t size)
+{
+	int	idx;
+
+	for (idx = 0; idx < CRT_RPC_CACHE_CLASS_NUM; idx++) {
+		if (((size_t)1 << (idx + CRT_RPC_CACHE_CLASS_SHIFT)) >= size)
+			break;
+	}
+
+	return idx;
+}
+
+/*
+ * Allocate a zeroed RPC descriptor of \a size bytes, recycling a cached one
+ * of the same size class if available.
+ */
+struct crt_rpc_priv *
+crt_rpc_cache_get(struct crt_rpc_cache *cache, size_t size)
+{
+	struct crt_rpc_priv	*rpc_priv = NULL;
+	size_t			 class_size;
+	bool			 last;
+	int			 idx;
+
+	D_ASSERT(cache != NULL);
+	D_ASSERT(size >= sizeof(*rpc_priv));
+
+	idx = crt_rpc_cache_class(size);
+	if (!cache->crc_enabled || idx == CRT_RPC_CACHE_CLASS_NUM) {
+		D_ALLOC(rpc_priv, size);
+		return rpc_priv;
+	}
+
+	D_SPIN_LOCK(&cache->crc_lock);
+	if (!cache->crc_enabled) {
+		/* finalized meanwhile, the context is being destroyed */
+		D_SPIN_UNLOCK(&cache->crc_lock);
+		D_ALLOC(rpc_priv, size);
+		return rpc_priv;
+	}
+	rpc_priv = d_list_pop_entry(&cache->crc_free[idx],
+				    struct crt_rpc_priv, crp_epi_link);
+	if (rpc_priv != NULL) {
+		cache->crc_free_num[idx]--;
+		cache->crc_hit++;
+	} else {
+		cache->crc_miss++;
+	}
+	/* dropped by crt_rpc_cache_put(), or below if D_ALLOC fails */
+	cache->crc_ref++;
+	D_SPIN_UNLOCK(&cache->crc_lock);
+
+	if (rpc_priv != NULL) {
+		memset(rpc_priv, 0, size);
+	} else {
+		/* allocate the full class size so it can be reused */
+		class_size = (size_t)1 << (idx + CRT_RPC_CACHE_CLASS_SHIFT);
+		D_ALLOC(rpc_priv, class_size);
+		if (rpc_priv == NULL) {
+			D_SPIN_LOCK(&cache->crc_lock);
+			last = (--cache->crc_ref == 0);
+			D_SPIN_UNLOCK(&cache->crc_lock);
+			if (last)
+				crt_rpc_cache_free(cache);
+			return NULL;
+		}
+	}
+
+	rpc_priv->crp_cache = cache;
+	rpc_priv->crp_cache_class = idx;
+
+	return rpc_priv;
+}
+
+static void
+crt_rpc_cache_put(struct crt_rpc_priv *rpc_priv)
+{
+	struct crt_rpc_cache	*cache = rpc_priv->crp_cache;
+	int			 idx = rpc_priv->crp_cache_class;
+	bool			 cached = false;
+	bool			 last = false;
+
+	if (cache != NULL) {
+		D_ASSERT(idx >= 0 && idx < CRT_RPC_CACHE_CLASS_NUM);
+		D_SPIN_LOCK(&cache->crc_lock);
+		if (cache->crc_enabled &&
+		    cache->crc_free_num[idx] < cache->crc_max_num) {
+			/* LIFO, the most recently freed one is cache-hot */
+			d_list_add(&rpc_priv->crp_epi_link,
+				   &cache->crc_free[idx]);
+			cache->crc_free_num[idx]++;
+			cache->crc_recycled++;
+			cached = true;
+		} else {
+			cache->crc_released++;
+		}
+		last = (--cache->crc_ref == 0);
+		D_SPIN_UNLOCK(&cache->crc_lock);
+	}
+
+	if (!cached)
+		D_FREE(rpc_priv);
+	if (last)
+		crt_rpc_cache_free(cache);
+}
+
+int
+crt_rpc_priv_alloc(crt_context_t crt_ctx, crt_opcode_t opc,
+		   struct crt_rpc_priv **priv_allocated, bool forward)
+{
+	struct crt_context	*ctx = crt_ctx;
 	struct crt_rpc_priv	*rpc_priv;
 	struct crt_opc_info	*opc_info;
 	int			rc = 0;
 
+	D_ASSERT(ctx != NULL);
 	D_ASSERT(priv_allocated != NULL);
 
 	D_DEBUG(DB_TRACE, "entering (opc: %#x)\n", opc);
@@ -187,9 +389,11 @@ crt_rpc_priv_alloc(crt_opcode_t opc, struct crt_rpc_priv **priv_allocated,
 		 opc_info->coi_output_size <= CRT_MAX_OUTPUT_SIZE);
 
 	if (forward)
-		D_ALLOC(rpc_priv, opc_info->coi_input_offset);
+		rpc_priv = crt_rpc_cache_get(ctx->cc_rpc_cache,
+					     opc_info->coi_input_offset);
 	else
-		D_ALLOC(rpc_priv, opc_info->coi_rpc_size);
+		rpc_priv = crt_rpc_cache_get(ctx->cc_rpc_cache,
+					     opc_info->coi_rpc_size);
 	if (rpc_priv == NULL)
 		D_GOTO(out, rc = -DER_NOMEM);
 
@@ -219,7 +423,7 @@ crt_rpc_priv_free(struct crt_rpc_priv *rpc_priv)
 
 	D_SPIN_DESTROY(&rpc_priv->crp_lock);
 
-	D_FREE(rpc_priv);
+	crt_rpc_cache_put(rpc_priv);
 }
 
 static inline void
@@ -245,7 +449,7 @@ crt_req_create_internal(crt_context_t crt_ctx, crt_endpoint_t *tgt_ep,
 
 	D_ASSERT(crt_ctx != CRT_CONTEXT_NULL && req != NULL);
 
-	rc = crt_rpc_priv_alloc(opc, &rpc_priv, forward);
+	rc = crt_rpc_priv_alloc(crt_ctx, opc, &rpc_priv, forward);
 	if (rc != 0) {
 		D_ERROR("crt_rpc_priv_alloc, rc: %d, opc: %#x.\n", rc, opc);
 		D_GOTO(out, rc);
@@ -512,48 +716,6 @@ crt_req_get_tgt_uri(struct crt_rpc_priv *rpc_priv, crt_phy_addr_t base_uri)
 	return DER_SUCCESS;
 }
 
-static int
-crt_req_uri_lookup_retry(struct crt_grp_priv *grp_priv,
-			 struct crt_rpc_priv *rpc_priv)
-{
-	struct crt_context	*crt_ctx;
-	crt_rpc_t		*rpc_pub = &rpc_priv->crp_pub;
-	int			 rc;
-
-	/* destroy previous URI_LOOKUP req, addref in crt_req_uri_lookup_psr */
-	RPC_PUB_DECREF(rpc_priv->crp_ul_req);
-	rpc_priv->crp_ul_req = NULL;
-
-	rc = crt_grp_psr_reload(grp_priv);
-	if (rc != 0) {
-		RPC_ERROR(rpc_priv,
-			  "crt_grp_psr_reload(grp %s) failed, rc: %d\n",
-			  grp_priv->gp_pub.cg_grpid, rc);
-		D_GOTO(out, rc);
-	}
-
-	crt_ctx = rpc_pub->cr_ctx;
-
-	D_MUTEX_LOCK(&crt_ctx->cc_mutex);
-	if (!crt_req_timedout(rpc_priv))
-		crt_req_timeout_untrack(rpc_priv);
-	rpc_priv->crp_timeout_ts = crt_get_timeout(rpc_priv);
-	rc = crt_req_timeout_track(rpc_priv);
-	D_MUTEX_UNLOCK(&crt_ctx->cc_mutex);
-	if (rc != 0) {
-		RPC_ERROR(rpc_priv,
-			  "crt_req_timeout_track failed, rc: %d\n",
-			  rc);
-		D_GOTO(out, rc);
-	}
-
-	rpc_priv->crp_state = RPC_STATE_INITED;
-	rc = crt_req_send_internal(rpc_priv);
-
-out:
-	return rc;
-}
-
 static void
 crt_req_uri_lookup_by_rpc_cb(const struct crt_cb_info *cb_info)
 {
@@ -562,10 +724,8 @@ crt_req_uri_lookup_by_rpc_cb(const struct crt_cb_info *cb_info)
 	crt_endpoint_t			*tgt_ep;
 	struct crt_rpc_priv		*rpc_priv;
 	struct crt_grp_priv		*grp_priv;
-	struct crt_context		*crt_ctx;
 	struct crt_uri_lookup_out	*ul_out;
 	char				*uri = NULL;
-	bool				 ul_retried = false;
 	int				 rc = 0;
 
 	rpc_priv = cb_info->cci_arg;
@@ -578,21 +738,21 @@ crt_req_uri_lookup_by_rpc_cb(const struct crt_cb_info *cb_info)
 
 	grp_priv = crt_grp_pub2priv(tgt_ep->ep_grp);
 
-	crt_ctx = rpc_priv->crp_pub.cr_ctx;
-
 	if (cb_info->cci_rc != 0) {
 		RPC_ERROR(rpc_priv,
 			  "failed cci_rc: %d\n",
 			  cb_info->cci_rc);
-		if (cb_info->cci_rc == -DER_OOG)
-			D_GOTO(out, rc = -DER_OOG);
-
-		if (rpc_priv->crp_ul_retry++ < CRT_URI_LOOKUP_RETRY_MAX) {
-			rc = crt_req_uri_lookup_retry(grp_priv, rpc_priv);
-			ul_retried = true;
-		} else {
-			rc = cb_info->cci_rc;
-		}
+		rc = cb_info->cci_rc;
+		/*
+		 * the RPC fails and the rank is not looked up again before a
+		 * backoff, see crt_req_lookup_done(). Go through another PSR
+		 * next time unless the rank does not exist.
+		 */
+		if (rc != -DER_OOG && grp_priv->gp_local == 0 &&
+		    crt_grp_psr_reload(grp_priv) != 0)
+			RPC_ERROR(rpc_priv,
+				  "crt_grp_psr_reload(grp %s) failed\n",
+				  grp_priv->gp_pub.cg_grpid);
 		D_GOTO(out, rc);
 	}
 
@@ -601,8 +761,8 @@ crt_req_uri_lookup_by_rpc_cb(const struct crt_cb_info *cb_info)
 	D_ASSERT(ul_out != NULL);
 	uri = ul_out->ul_uri;
 
-	/* insert uri to hash table */
-	rc = crt_grp_lc_uri_insert(grp_priv, crt_ctx->cc_idx, rank, tag, uri);
+	/* insert uri to lookup cache */
+	rc = crt_grp_lc_uri_insert(grp_priv, rank, tag, uri);
 	if (rc != 0) {
 		D_ERROR("crt_grp_lc_uri_insert() failed, rc %d\n", rc);
 		D_GOTO(out, rc);
@@ -628,7 +788,7 @@ out:
 		RPC_DECREF(rpc_priv); /* destroy */
 	}
 
-	if (!ul_retried && rpc_priv->crp_ul_req != NULL) {
+	if (rpc_priv->crp_ul_req != NULL) {
 		/* addref in crt_req_uri_lookup_by_rpc */
 		RPC_PUB_DECREF(rpc_priv->crp_ul_req);
 		rpc_priv->crp_ul_req = NULL;
@@ -752,6 +912,26 @@ crt_req_ep_lc_lookup(struct crt_rpc_priv *rpc_priv, crt_phy_addr_t *base_addr)
 		D_GOTO(out, rc);
 	}
 
+	/* derive the URI from the group's URI template if it has one */
+	if (base_addr != NULL && *base_addr == NULL &&
+	    rpc_priv->crp_hg_addr == NULL) {
+		rc = crt_grp_uri_tmpl_lookup(grp_priv, tgt_ep->ep_rank,
+					     tgt_ep->ep_tag, &uri);
+		if (rc != 0) {
+			D_ERROR("crt_grp_uri_tmpl_lookup() failed, rc: %d, "
+				"opc: %#x.\n", rc, req->cr_opc);
+			D_GOTO(out, rc);
+		}
+		if (uri != NULL) {
+			*base_addr = uri;
+			rc = crt_req_get_tgt_uri(rpc_priv, uri);
+			if (rc != 0)
+				D_ERROR("crt_req_get_tgt_uri failed, "
+					"opc: %#x.\n", req->cr_opc);
+			D_GOTO(out, rc);
+		}
+	}
+
 	/*
 	 * If the target endpoint is the PSR and it's not already in the address
 	 * cache, insert the URI of the PSR to the address cache.
@@ -769,8 +949,8 @@ crt_req_ep_lc_lookup(struct crt_rpc_priv *rpc_priv, crt_phy_addr_t *base_addr)
 			if (uri == NULL)
 				D_GOTO(out, rc = -DER_NOMEM);
 
-			rc = crt_grp_lc_uri_insert(grp_priv, ctx->cc_idx,
-						   tgt_ep->ep_rank, 0, uri);
+			rc = crt_grp_lc_uri_insert(grp_priv, tgt_ep->ep_rank,
+						   0, uri);
 			if (rc != 0) {
 				D_ERROR("crt_grp_lc_uri_insert() failed, "
 					"rc: %d\n", rc);
@@ -825,7 +1005,6 @@ crt_req_uri_lookup(struct crt_rpc_priv *rpc_priv)
 	struct crt_grp_priv	*default_grp_priv;
 	char			*uri = NULL;
 	crt_group_id_t		 grp_id;
-	struct crt_context	*crt_ctx;
 	d_rank_list_t		*membs;
 	bool			 naked_free = false;
 	int			 rc = 0;
@@ -855,7 +1034,6 @@ crt_req_uri_lookup(struct crt_rpc_priv *rpc_priv)
 	}
 
 	/* this is a local group */
-	crt_ctx = rpc_priv->crp_pub.cr_ctx;
 	rank = tgt_ep->ep_rank;
 	tag = tgt_ep->ep_tag;
 	membs = grp_priv_get_membs(grp_priv);
@@ -898,8 +1076,7 @@ crt_req_uri_lookup(struct crt_rpc_priv *rpc_priv)
 		D_GOTO(out, rc);
 	}
 
-	rc = crt_grp_lc_uri_insert(default_grp_priv, crt_ctx->cc_idx,
-			rank, tag, uri);
+	rc = crt_grp_lc_uri_insert(default_grp_priv, rank, tag, uri);
 	if (rc != 0) {
 		D_ERROR("crt_grp_lc_uri_insert() failed, rc %d\n", rc);
 		D_GOTO(out, rc);
@@ -1007,7 +1184,19 @@ crt_req_send_internal(struct crt_rpc_priv *rpc_priv)
 		if (rpc_priv->crp_hg_addr != NULL) {
 			/* send the RPC if the local cache has the HG_Addr */
 			rc = crt_req_send_immediately(rpc_priv);
-		} else if (base_addr != NULL) {
+			break;
+		}
+
+		/* only one RPC per target looks it up */
+		rc = crt_req_lookup_park(rpc_priv);
+		if (rc == CRT_LOOKUP_PARKED) {
+			rc = 0;
+			break;
+		} else if (rc != 0) {
+			D_GOTO(out, rc);
+		}
+
+		if (base_addr != NULL) {
 			/* send addr lookup req */
 			rpc_priv->crp_state = RPC_STATE_ADDR_LOOKUP;
 			rc = crt_req_hg_addr_lookup(rpc_priv);
@@ -1031,6 +1220,8 @@ crt_req_send_internal(struct crt_rpc_priv *rpc_priv)
 			D_GOTO(out, rc);
 		}
 		if (rpc_priv->crp_hg_addr != NULL) {
+			if (rpc_priv->crp_lookup_leader)
+				crt_req_lookup_done(rpc_priv, 0);
 			rc = crt_req_send_immediately(rpc_priv);
 		} else {
 			/* send addr lookup req */
@@ -1042,6 +1233,9 @@ crt_req_send_internal(struct crt_rpc_priv *rpc_priv)
 		}
 		break;
 	case RPC_STATE_ADDR_LOOKUP:
+		/* the address is cached, release the RPCs waiting for it */
+		if (rpc_priv->crp_lookup_leader)
+			crt_req_lookup_done(rpc_priv, 0);
 		rc = crt_req_send_immediately(rpc_priv);
 		break;
 	default:
@@ -1157,6 +1351,10 @@ crt_reply_send(crt_rpc_t *req)
 
 	rpc_priv = container_of(req, struct crt_rpc_priv, crp_pub);
 
+	/* the progressing thread sends the replies of handler pool workers */
+	if (crt_hpool_reply_defer(rpc_priv))
+		D_GOTO(out, rc = 0);
+
 	if (rpc_priv->crp_coll == 1) {
 		struct crt_cb_info	cb_info;
 
@@ -1202,6 +1400,20 @@ crt_req_abort(crt_rpc_t *req)
 		D_GOTO(out, rc);
 	}
 
+	if (rpc_priv->crp_batched) {
+		RPC_TRACE(DB_NET, rpc_priv,
+			  "packed in a batch, completes with the batch.\n");
+		D_GOTO(out, rc);
+	}
+
+	/* no HG handle yet, unless it was resumed meanwhile */
+	if (rpc_priv->crp_state == RPC_STATE_LOOKUP_WAIT &&
+	    crt_req_lookup_cancel(rpc_priv)) {
+		RPC_TRACE(DB_NET, rpc_priv,
+			  "aborted while waiting for an address lookup.\n");
+		D_GOTO(out, rc);
+	}
+
 	rc = crt_hg_req_cancel(rpc_priv);
 	if (rc != 0) {
 		D_ERROR("crt_hg_req_cancel failed, rc: %d, opc: %#x.\n",
@@ -1276,7 +1488,9 @@ crt_rpc_priv_init(struct crt_rpc_priv *rpc_priv, crt_context_t crt_ctx,
 
 	D_INIT_LIST_HEAD(&rpc_priv->crp_epi_link);
 	D_INIT_LIST_HEAD(&rpc_priv->crp_tmp_link);
+	D_INIT_LIST_HEAD(&rpc_priv->crp_hpool_link);
 	D_INIT_LIST_HEAD(&rpc_priv->crp_parent_link);
+	D_INIT_LIST_HEAD(&rpc_priv->crp_lookup_link);
 	rpc_priv->crp_complete_cb = NULL;
 	rpc_priv->crp_arg = NULL;
 	if (!srv_flag) {
@@ -1286,7 +1500,8 @@ crt_rpc_priv_init(struct crt_rpc_priv *rpc_priv, crt_context_t crt_ctx,
 	rpc_priv->crp_state = RPC_STATE_INITED;
 	rpc_priv->crp_hdl_reuse = NULL;
 	rpc_priv->crp_srv = srv_flag;
-	rpc_priv->crp_ul_retry = 0;
+	rpc_priv->crp_iov_auto = NULL;
+	rpc_priv->crp_iov_auto_num = 0;
 	/* initialize as 1, so user can cal crt_req_decref to destroy new req */
 	rpc_priv->crp_refcount = 1;
 
@@ -1304,10 +1519,11 @@ void
 crt_rpc_priv_fini(struct crt_rpc_priv *rpc_priv)
 {
 	D_ASSERT(rpc_priv != NULL);
+	crt_iov_auto_fini(rpc_priv);
 	crt_rpc_inout_buff_fini(rpc_priv);
 }
 
-static void
+void
 crt_handle_rpc(void *arg)
 {
 	crt_rpc_t		*rpc_pub = arg;
@@ -1362,54 +1578,3 @@ crt_rpc_common_hdlr(struct crt_rpc_priv *rpc_priv)
 
 	return rc;
 }
-
-static int
-timeout_bp_node_enter(struct d_binheap *h, struct d_binheap_node *e)
-{
-	struct crt_rpc_priv	*rpc_priv;
-
-	D_ASSERT(h != NULL);
-	D_ASSERT(e != NULL);
-
-	rpc_priv = container_of(e, struct crt_rpc_priv, crp_timeout_bp_node);
-
-	RPC_TRACE(DB_NET, rpc_priv, "entering the timeout binheap.\n");
-
-	return 0;
-}
-
-static int
-timeout_bp_node_exit(struct d_binheap *h, struct d_binheap_node *e)
-{
-	struct crt_rpc_priv	*rpc_priv;
-
-	D_ASSERT(h != NULL);
-	D_ASSERT(e != NULL);
-
-	rpc_priv = container_of(e, struct crt_rpc_priv, crp_timeout_bp_node);
-
-	RPC_TRACE(DB_NET, rpc_priv, "exiting the timeout binheap.\n");
-
-	return 0;
-}
-
-static bool
-timeout_bp_node_cmp(struct d_binheap_node *a, struct d_binheap_node *b)
-{
-	struct crt_rpc_priv	*rpc_priv_a;
-	struct crt_rpc_priv	*rpc_priv_b;
-
-	D_ASSERT(a != NULL);
-	D_ASSERT(b != NULL);
-
-	rpc_priv_a = container_of(a, struct crt_rpc_priv, crp_timeout_bp_node);
-	rpc_priv_b = container_of(b, struct crt_rpc_priv, crp_timeout_bp_node);
-
-	return rpc_priv_a->crp_timeout_ts < rpc_priv_b->crp_timeout_ts;
-}
-
-struct d_binheap_ops crt_timeout_bh_ops = {
-	.hop_enter	= timeout_bp_node_enter,
-	.hop_exit	= timeout_bp_node_exit,
-	.hop_compare	= timeout_bp_node_cmp
-};
@@ -43,17 +43,18 @@
 #ifndef __CRT_RPC_H__
 #define __CRT_RPC_H__
 
-#include <gurt/heap.h>
+#include <gurt/timewheel.h>
 #include "gurt/common.h"
 
 /* default RPC timeout 60 seconds */
 #define CRT_DEFAULT_TIMEOUT_S	(60) /* second */
 #define CRT_DEFAULT_TIMEOUT_US	(CRT_DEFAULT_TIMEOUT_S * 1e6) /* micro-second */
 
-/* uri lookup max retry times */
-#define CRT_URI_LOOKUP_RETRY_MAX	(8)
+/* max size of the URIs inlined in a CRT_OPC_URI_LOOKUP_BATCH reply */
+#define CRT_URI_LOOKUP_BATCH_INLINE	(2048)
+/* number of ranks asked per CRT_OPC_URI_LOOKUP_BATCH by the prefetch */
+#define CRT_URI_LOOKUP_BATCH_RANKS	(1024)
 
-extern struct d_binheap_ops crt_timeout_bh_ops;
 void crt_hdlr_rank_evict(crt_rpc_t *rpc_req);
 extern struct crt_corpc_ops crt_rank_evict_co_ops;
 extern void crt_hdlr_memb_sample(crt_rpc_t *rpc_req);
@@ -82,7 +83,13 @@ struct crt_corpc_hdr {
 	uint32_t		 coh_tree_topo;
 	/* root rank of the tree, it is the logical rank within the group */
 	uint32_t		 coh_root;
-	uint32_t		 coh_padding;
+	/* segment size of the pipelined bulk, 0 if not pipelined */
+	uint32_t		 coh_bulk_seg;
+	/*
+	 * the sender's pipe of coh_bulk_hdl to wait for the segments with
+	 * CRT_OPC_CORPC_SEG_WAIT, 0 if coh_bulk_hdl is complete
+	 */
+	uint64_t		 coh_bulk_pipe;
 };
 
 /* CaRT layer common header */
@@ -107,6 +114,8 @@ typedef enum {
 	RPC_STATE_ADDR_LOOKUP,
 	RPC_STATE_URI_LOOKUP,
 	RPC_STATE_FWD_UNREACH,
+	/* waiting for the address lookup of another RPC */
+	RPC_STATE_LOOKUP_WAIT,
 } crt_rpc_state_t;
 
 /* corpc info to track the tree topo and child RPCs info */
@@ -121,23 +130,40 @@ struct crt_corpc_info {
 	/* child RPCs list */
 	d_list_t		 co_child_rpcs;
 	/*
-	 * replied child RPC list, when a child RPC being replied and parent
-	 * RPC has not been locally handled, we can not aggregate the reply
-	 * as it possibly be over-written by local RPC handler. So when child
-	 * RPC being replied and parent RPC not finished, the child RPC is
-	 * queued at co_replied_rpcs.
+	 * replies not aggregated yet, pushed lock-free by the reply handlers
+	 * and folded by the one that raised co_agg_pending from zero, see
+	 * crt_corpc_reply_hdlr().
+	 */
+	struct crt_rpc_priv	*co_agg_stack;
+	uint32_t		 co_agg_pending;
+	/*
+	 * replied child RPCs, when a child RPC being replied and parent RPC has
+	 * not been locally handled, we can not aggregate the reply as it
+	 * possibly be over-written by local RPC handler. So it is queued here
+	 * until the local reply. Only accessed by the folding thread.
 	 */
-	d_list_t		 co_replied_rpcs;
+	struct crt_rpc_priv	*co_agg_deferred;
 	uint32_t		 co_child_num;
+	/* replies aggregated, only accessed by the folding thread */
 	uint32_t		 co_child_ack_num;
 	uint32_t		 co_child_failed_num;
+	/* co_child_ack_num + co_child_failed_num, updated atomically */
+	uint32_t		 co_done_num;
+	/* aggregation time, number of replies folded for another thread */
+	uint64_t		 co_agg_ns;
+	uint32_t		 co_agg_combined;
+	/* pipe filling the chained bulk, NULL if not pipelined */
+	struct crt_corpc_pipe	*co_pipe;
+	/* array the built-in reduction reduces into, see crt_corpc_reduce() */
+	void			*co_reduce_buf;
 	/*
-	 * co_local_done is the flag of local RPC finish handling
-	 * (local reply ready).
+	 * flag of local RPC finish handling (local reply ready), accessed
+	 * atomically as the folding thread and the RANK_EVICT forwarding
+	 * race on it, so kept out of the bitfield below.
 	 */
-	uint32_t		 co_local_done:1,
+	uint32_t		 co_local_done;
 	/* co_root_excluded is the flag of root in excluded rank list */
-				 co_root_excluded:1,
+	uint32_t		 co_root_excluded:1,
 	/* flag of if refcount taken for co_grp_priv */
 				 co_grp_ref_taken:1;
 	int			 co_rc;
@@ -148,17 +174,22 @@ struct crt_rpc_priv {
 	d_list_t			crp_epi_link;
 	/* tmp_link used in crt_context_req_untrack */
 	d_list_t			crp_tmp_link;
-	/* link to parent RPC crp_opc_info->co_child_rpcs/co_replied_rpcs */
+	/* link to crt_hpool_worker::hw_queue or crt_hpool::hp_reply_q */
+	d_list_t			crp_hpool_link;
+	/* link to parent RPC crp_opc_info->co_child_rpcs */
 	d_list_t			crp_parent_link;
-	/* binheap node for timeout management, in crt_context::cc_bh_timeout */
-	struct d_binheap_node	crp_timeout_bp_node;
+	/* next in parent RPC crp_corpc_info->co_agg_stack/co_agg_deferred */
+	struct crt_rpc_priv		*crp_agg_next;
+	/* timing wheel node for timeout management, in cc_tw_timeout */
+	struct d_tw_node	crp_timeout_tw_node;
 	/* the timeout in seconds set by user */
 	uint32_t		crp_timeout_sec;
-	/* time stamp to be timeout, the key of timeout binheap */
+	/* time stamp to be timeout, the expiry time in timing wheel */
 	uint64_t		crp_timeout_ts;
 	crt_cb_t		crp_complete_cb;
 	void			*crp_arg; /* argument for crp_complete_cb */
 	struct crt_ep_inflight	*crp_epi; /* point back to inflight ep */
+	uint64_t		crp_epi_seq; /* crt_ep_inflight::epi_send_seq */
 
 	crt_rpc_t		crp_pub; /* public part */
 	crt_rpc_state_t		crp_state; /* RPC state */
@@ -167,7 +198,10 @@ struct crt_rpc_priv {
 	struct crt_hg_hdl	*crp_hdl_reuse; /* reused hg_hdl */
 	crt_phy_addr_t		crp_tgt_uri; /* target uri address */
 	crt_rpc_t		*crp_ul_req; /* uri lookup request */
-	uint32_t		crp_ul_retry; /* uri lookup retry counter */
+	/* address lookup it does or waits for, see crt_req_lookup_park() */
+	struct crt_ep_lookup	*crp_lookup;
+	/* link to crt_ep_lookup::el_waitq */
+	d_list_t		crp_lookup_link;
 
 	/*
 	 * RPC request flag, see enum crt_rpc_flags/crt_rpc_flags_internal,
@@ -183,19 +217,48 @@ struct crt_rpc_priv {
 				crp_uri_free:1,
 				/* flag of forwarded rpc for corpc */
 				crp_forward:1,
-				/* flag of in timeout binheap */
-				crp_in_binheap:1,
+				/* flag of in timeout timing wheel */
+				crp_in_timewheel:1,
 				/* set if a call to crt_req_reply pending */
 				crp_reply_pending:1,
 				/* set to 1 if target ep is set */
 				crp_have_ep:1,
 				/* 1 if RPC is succesfully put on the wire */
-				crp_on_wire:1;
+				crp_on_wire:1,
+				/* 1 if aborted due to timeout on the wire */
+				crp_timedout:1,
+				/* 1 if packed in a CRT_OPC_BATCH request */
+				crp_batched:1,
+				/* 1 if counted in chp_inflight of HG pool */
+				crp_hg_pool_inflight:1,
+				/* 1 if doing the lookup of crp_lookup */
+				crp_lookup_leader:1;
 	uint32_t		crp_refcount;
 	struct crt_opc_info	*crp_opc_info;
 	/* corpc info, only valid when (crp_coll == 1) */
 	struct crt_corpc_info	*crp_corpc_info;
+	/* batch info, only valid when (crp_batched == 1) */
+	struct crt_batch	*crp_batch;
+	uint32_t		crp_batch_idx; /* index in crp_batch */
+	/*
+	 * crt_iov_auto_t input fields sent by bulk, the handles created for
+	 * them on the client or the fields to pull on the server.
+	 */
+	crt_iov_auto_t		**crp_iov_auto;
+	uint32_t		crp_iov_auto_num;
+	uint32_t		crp_iov_auto_pending; /* pulls in flight */
+	int			crp_iov_auto_rc; /* first pull failure */
+	/*
+	 * encoded input of a received corpc in its HG input buffer, forwarded
+	 * as is to the children, see crt_hg_in_body_save().
+	 */
+	void			*crp_in_body;
+	size_t			crp_in_body_len;
 	pthread_spinlock_t	crp_lock;
+	/* descriptor cache it is allocated from, NULL if not cached */
+	struct crt_rpc_cache	*crp_cache;
+	/* size class index in crp_cache */
+	int			crp_cache_class;
 	struct crt_common_hdr	crp_reply_hdr; /* common header for reply */
 	struct crt_common_hdr	crp_req_hdr; /* common header for request */
 	struct crt_corpc_hdr	crp_coreq_hdr; /* collective request header */
@@ -273,7 +336,22 @@ struct crt_rpc_priv {
 	X(CRT_OPC_CTL_GET_PID,						\
 		0, &CQF_crt_ctl_get_pid, crt_hdlr_ctl_get_pid, NULL),	\
 	X(CRT_OPC_PROTO_QUERY,						\
-		0, &CQF_crt_proto_query, crt_hdlr_proto_query, NULL)
+		0, &CQF_crt_proto_query, crt_hdlr_proto_query, NULL),	\
+	X(CRT_OPC_BATCH,						\
+		0, &CQF_crt_batch, crt_hdlr_batch, NULL),		\
+	X(CRT_OPC_CTL_HG_POOL,						\
+		0, &CQF_crt_ctl_hg_pool, crt_hdlr_ctl_hg_pool, NULL),	\
+	X(CRT_OPC_URI_LOOKUP_BATCH,					\
+		0, &CQF_crt_uri_lookup_batch,				\
+		crt_hdlr_uri_lookup_batch, NULL),			\
+	X(CRT_OPC_CORPC_SEG_WAIT,					\
+		0, &CQF_crt_corpc_seg_wait,				\
+		crt_hdlr_corpc_seg_wait, NULL),				\
+	X(CRT_OPC_COLL_XFER,						\
+		0, &CQF_crt_coll_xfer, crt_hdlr_coll_xfer, NULL),	\
+	X(CRT_OPC_CTL_RPC_CACHE,					\
+		0, &CQF_crt_ctl_rpc_cache,				\
+		crt_hdlr_ctl_rpc_cache, NULL)
 
 /* Define for RPC enum population below */
 #define X(a, b, c, d, e) a
@@ -332,6 +410,28 @@ CRT_RPC_DECLARE(crt_grp_destroy, CRT_ISEQ_GRP_DESTROY, CRT_OSEQ_GRP_DESTROY)
 
 CRT_RPC_DECLARE(crt_uri_lookup, CRT_ISEQ_URI_LOOKUP, CRT_OSEQ_URI_LOOKUP)
 
+#define CRT_ISEQ_URI_LOOKUP_BATCH /* input fields */		 \
+	((crt_group_id_t)	(ulb_grp_id)		CRT_VAR) \
+	/* ranks to look up, the range below if empty */	 \
+	((d_rank_t)		(ulb_ranks)		CRT_ARRAY) \
+	((d_rank_t)		(ulb_rank_start)	CRT_VAR) \
+	((uint32_t)		(ulb_rank_num)		CRT_VAR) \
+	((uint32_t)		(ulb_tag)		CRT_VAR) \
+	/* optional buffer the URIs are PUT to if they don't fit inline */ \
+	((crt_bulk_t)		(ulb_bulk)		CRT_VAR)
+
+#define CRT_OSEQ_URI_LOOKUP_BATCH /* output fields */		 \
+	/* packed rank:tag:uri_size:uri of the ranks with a known URI */ \
+	((d_iov_t)		(ulb_uris)		CRT_VAR) \
+	/* size of the packed URIs PUT to ulb_bulk, 0 if inlined */ \
+	((uint64_t)		(ulb_bulk_size)		CRT_VAR) \
+	/* number of input ranks processed, the rest needs another RPC */ \
+	((uint32_t)		(ulb_rank_done)		CRT_VAR) \
+	((int32_t)		(ulb_rc)		CRT_VAR)
+
+CRT_RPC_DECLARE(crt_uri_lookup_batch, CRT_ISEQ_URI_LOOKUP_BATCH,
+		CRT_OSEQ_URI_LOOKUP_BATCH)
+
 #define CRT_ISEQ_ST_SEND_ID	/* input fields */		 \
 	((uint64_t)		(unused1)		CRT_VAR)
 
@@ -517,6 +617,27 @@ CRT_RPC_DECLARE(crt_ctl_get_host, CRT_ISEQ_CTL, CRT_OSEQ_CTL_GET_HOST)
 
 CRT_RPC_DECLARE(crt_ctl_get_pid, CRT_ISEQ_CTL, CRT_OSEQ_CTL_GET_PID)
 
+#define CRT_ISEQ_CTL_HG_POOL	/* input fields */		 \
+	CRT_ISEQ_CTL						 \
+	/* <0 query only, 0 sized by workload, >0 fixed size */	 \
+	((int32_t)		(chpi_max_num)		CRT_VAR)
+
+#define CRT_OSEQ_CTL_HG_POOL	/* output fields */		 \
+	/* CRT_CTL_HGP_NR counters per context */		 \
+	((uint64_t)		(chpo_stats)		CRT_ARRAY) \
+	((int32_t)		(chpo_ctx_num)		CRT_VAR) \
+	((int32_t)		(chpo_rc)		CRT_VAR)
+
+CRT_RPC_DECLARE(crt_ctl_hg_pool, CRT_ISEQ_CTL_HG_POOL, CRT_OSEQ_CTL_HG_POOL)
+
+#define CRT_OSEQ_CTL_RPC_CACHE	/* output fields */		 \
+	/* CRT_CTL_RPCC_NR counters per context */		 \
+	((uint64_t)		(crco_stats)		CRT_ARRAY) \
+	((int32_t)		(crco_ctx_num)		CRT_VAR) \
+	((int32_t)		(crco_rc)		CRT_VAR)
+
+CRT_RPC_DECLARE(crt_ctl_rpc_cache, CRT_ISEQ_CTL, CRT_OSEQ_CTL_RPC_CACHE)
+
 #define CRT_ISEQ_PROTO_QUERY	/* input fields */		 \
 	((d_iov_t)		(pq_ver)		CRT_VAR) \
 	((int32_t)		(pq_ver_count)		CRT_VAR) \
@@ -528,6 +649,45 @@ CRT_RPC_DECLARE(crt_ctl_get_pid, CRT_ISEQ_CTL, CRT_OSEQ_CTL_GET_PID)
 
 CRT_RPC_DECLARE(crt_proto_query, CRT_ISEQ_PROTO_QUERY, CRT_OSEQ_PROTO_QUERY)
 
+#define CRT_ISEQ_BATCH		/* input fields */		 \
+	/* packed requests, each as uint32_t length + encoded req */ \
+	((d_iov_t)		(bi_reqs)		CRT_VAR) \
+	((uint32_t)		(bi_num)		CRT_VAR)
+
+#define CRT_OSEQ_BATCH		/* output fields */		 \
+	/* packed replies, in the same order as bi_reqs */	 \
+	((d_iov_t)		(bo_replies)		CRT_VAR) \
+	((uint32_t)		(bo_num)		CRT_VAR) \
+	((int32_t)		(bo_rc)			CRT_VAR)
+
+CRT_RPC_DECLARE(crt_batch, CRT_ISEQ_BATCH, CRT_OSEQ_BATCH)
+
+#define CRT_ISEQ_CORPC_SEG_WAIT	/* input fields */		 \
+	/* crt_corpc_hdr::coh_bulk_pipe of the forwarded corpc */ \
+	((uint64_t)		(sw_pipe)		CRT_VAR) \
+	/* wait until this many segments are ready */		 \
+	((uint32_t)		(sw_seg_num)		CRT_VAR)
+
+#define CRT_OSEQ_CORPC_SEG_WAIT	/* output fields */		 \
+	/* number of leading segments ready, >= sw_seg_num */	 \
+	((uint32_t)		(sw_seg_ready)		CRT_VAR) \
+	((int32_t)		(sw_rc)			CRT_VAR)
+
+CRT_RPC_DECLARE(crt_corpc_seg_wait, CRT_ISEQ_CORPC_SEG_WAIT,
+		CRT_OSEQ_CORPC_SEG_WAIT)
+
+#define CRT_ISEQ_COLL_XFER	/* input fields */		 \
+	/* sequence number of the collective in the group */	 \
+	((uint64_t)		(cx_seq)		CRT_VAR) \
+	/* step of the target the payload is for */		 \
+	((uint32_t)		(cx_tag)		CRT_VAR) \
+	((crt_iov_auto_t)	(cx_data)		CRT_VAR)
+
+#define CRT_OSEQ_COLL_XFER	/* output fields */		 \
+	((int32_t)		(cx_rc)			CRT_VAR)
+
+CRT_RPC_DECLARE(crt_coll_xfer, CRT_ISEQ_COLL_XFER, CRT_OSEQ_COLL_XFER)
+
 /* CRT internal RPC format definitions */
 struct crt_internal_rpc {
 	/* Name of the RPC */
@@ -608,8 +768,12 @@ crt_rpc_cb_customized(struct crt_context *crt_ctx,
 }
 
 /* crt_rpc.c */
-int crt_rpc_priv_alloc(crt_opcode_t opc, struct crt_rpc_priv **priv_allocated,
-		       bool forward);
+int crt_rpc_cache_init(struct crt_rpc_cache **cachep, uint32_t max_num);
+void crt_rpc_cache_fini(struct crt_rpc_cache *cache);
+struct crt_rpc_priv *crt_rpc_cache_get(struct crt_rpc_cache *cache,
+				       size_t size);
+int crt_rpc_priv_alloc(crt_context_t crt_ctx, crt_opcode_t opc,
+		       struct crt_rpc_priv **priv_allocated, bool forward);
 void crt_rpc_priv_free(struct crt_rpc_priv *rpc_priv);
 int crt_rpc_priv_init(struct crt_rpc_priv *rpc_priv, crt_context_t crt_ctx,
 		      bool srv_flag);
@@ -618,6 +782,7 @@ int crt_req_create_internal(crt_context_t crt_ctx, crt_endpoint_t *tgt_ep,
 			    crt_opcode_t opc, bool forward, crt_rpc_t **req);
 int crt_internal_rpc_register(void);
 int crt_rpc_common_hdlr(struct crt_rpc_priv *rpc_priv);
+void crt_handle_rpc(void *arg);
 int crt_req_send_internal(struct crt_rpc_priv *rpc_priv);
 
 static inline bool
@@ -626,9 +791,10 @@ crt_req_timedout(struct crt_rpc_priv *rpc_priv)
 	return (rpc_priv->crp_state == RPC_STATE_REQ_SENT ||
 		rpc_priv->crp_state == RPC_STATE_URI_LOOKUP ||
 		rpc_priv->crp_state == RPC_STATE_ADDR_LOOKUP ||
+		rpc_priv->crp_state == RPC_STATE_LOOKUP_WAIT ||
 		rpc_priv->crp_state == RPC_STATE_TIMEOUT ||
 		rpc_priv->crp_state == RPC_STATE_FWD_UNREACH) &&
-	       !rpc_priv->crp_in_binheap;
+	       !rpc_priv->crp_in_timewheel;
 }
 
 static inline uint64_t
@@ -642,11 +808,51 @@ crt_get_timeout(struct crt_rpc_priv *rpc_priv)
 	return d_timeus_secdiff(timeout_sec);
 }
 
+/* crt_batch.c */
+
+/* requests packed into one CRT_OPC_BATCH request */
+struct crt_batch {
+	/* the CRT_OPC_BATCH request */
+	struct crt_rpc_priv	*cb_rpc;
+	uint32_t		 cb_num;
+	/* server side, number of replies not packed yet */
+	uint32_t		 cb_pending;
+	struct crt_batch_req {
+		/* client side, the packed request */
+		struct crt_rpc_priv	*cbr_rpc;
+		/* client side the encoded request, server side the reply */
+		d_iov_t			 cbr_buf;
+		/* server side, error encoding the reply */
+		int			 cbr_rc;
+	}			 cb_reqs[0];
+};
+
+struct crt_rpc_priv *crt_batch_pack(struct crt_ep_inflight *epi,
+				    struct crt_rpc_priv *rpc_priv);
+int crt_batch_reply(struct crt_rpc_priv *rpc_priv);
+void crt_batch_req_fini(struct crt_rpc_priv *rpc_priv);
+
+/* crt_bulk.c */
+int crt_iov_auto_track(struct crt_rpc_priv *rpc_priv, crt_iov_auto_t *field);
+void crt_iov_auto_pull(struct crt_rpc_priv *rpc_priv);
+void crt_iov_auto_fini(struct crt_rpc_priv *rpc_priv);
+void crt_hdlr_batch(crt_rpc_t *rpc_req);
+
 /* crt_corpc.c */
 int crt_corpc_req_hdlr(struct crt_rpc_priv *rpc_priv);
 void crt_corpc_reply_hdlr(const struct crt_cb_info *cb_info);
 int crt_corpc_common_hdlr(struct crt_rpc_priv *rpc_priv);
 void crt_corpc_info_fini(struct crt_rpc_priv *rpc_priv);
+void crt_hdlr_corpc_seg_wait(crt_rpc_t *rpc_req);
+int crt_corpc_pipe_table_init(struct crt_context *ctx);
+void crt_corpc_pipe_table_fini(struct crt_context *ctx);
+
+/* crt_reduce.c */
+size_t crt_reduce_size(enum crt_reduce_op op, enum crt_reduce_type type);
+int crt_corpc_reduce_check(crt_opcode_t opc, struct crt_corpc_ops *co_ops,
+			   size_t output_size);
+int crt_corpc_reduce(struct crt_rpc_priv *rpc_priv, crt_rpc_t *source,
+		     bool first);
 
 /* crt_iv.c */
 void crt_hdlr_iv_fetch(crt_rpc_t *rpc_req);
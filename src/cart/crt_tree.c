@@ -139,38 +139,160 @@ out:
 	} while (0)
 
 /*
- * query number of children.
- *
- * rank number of grp_priv->gp_membs, grp_priv->gp_live_ranks and exclude_ranks
- * are primary rank.  grp_root and grp_self are logical rank number within the
- * group.
+ * Topology of one tree, i.e. the result of the tree calculation for one
+ * (tree_topo, root, self, exclude_ranks) of a group. Ranks are primary ranks.
  */
-int
-crt_tree_get_nchildren(struct crt_grp_priv *grp_priv, uint32_t grp_ver,
-		       d_rank_list_t *exclude_ranks, int tree_topo,
-		       d_rank_t root, d_rank_t self, uint32_t *nchildren)
+struct crt_tree_topo {
+	/* the filtered group is empty */
+	bool			 tt_empty;
+	uint32_t		 tt_nchildren;
+	d_rank_t		*tt_children;
+	/* to_get_parent() result, -DER_INVAL for the root */
+	int			 tt_parent_rc;
+	d_rank_t		 tt_parent;
+};
+
+struct crt_tree_cache_ent {
+	bool			 tce_valid;
+	/* gp_topo_gen when the topology was calculated */
+	uint32_t		 tce_gen;
+	int			 tce_topo;
+	d_rank_t		 tce_root;
+	d_rank_t		 tce_self;
+	uint64_t		 tce_excl_hash;
+	/* copy of the exclude ranks, NULL if none */
+	d_rank_list_t		*tce_excl;
+	struct crt_tree_topo	 tce_tt;
+};
+
+/*
+ * Memoized tree topologies of a group. It is direct-mapped, a colliding or
+ * stale entry is simply recalculated and replaced.
+ */
+#define CRT_TREE_CACHE_SIZE	(64)
+
+struct crt_tree_cache {
+	pthread_mutex_t			tc_mutex;
+	struct crt_tree_cache_ent	tc_ents[CRT_TREE_CACHE_SIZE];
+};
+
+static inline uint64_t
+crt_tree_excl_hash(d_rank_list_t *exclude_ranks)
+{
+	uint64_t	hash = 0xcbf29ce484222325ULL;
+	int		i;
+
+	if (exclude_ranks == NULL)
+		return 0;
+
+	for (i = 0; i < exclude_ranks->rl_nr; i++) {
+		hash ^= exclude_ranks->rl_ranks[i];
+		hash *= 0x100000001b3ULL;
+	}
+
+	return hash;
+}
+
+static bool
+crt_tree_excl_equal(d_rank_list_t *a, d_rank_list_t *b)
+{
+	uint32_t	a_nr = (a == NULL) ? 0 : a->rl_nr;
+	uint32_t	b_nr = (b == NULL) ? 0 : b->rl_nr;
+
+	if (a_nr != b_nr)
+		return false;
+	if (a_nr == 0)
+		return true;
+
+	return memcmp(a->rl_ranks, b->rl_ranks,
+		      a_nr * sizeof(*a->rl_ranks)) == 0;
+}
+
+static void
+crt_tree_cache_ent_fini(struct crt_tree_cache_ent *ent)
+{
+	if (ent->tce_excl != NULL)
+		d_rank_list_free(ent->tce_excl);
+	ent->tce_excl = NULL;
+	D_FREE(ent->tce_tt.tt_children);
+	ent->tce_valid = false;
+}
+
+static struct crt_tree_cache *
+crt_tree_cache_get(struct crt_grp_priv *grp_priv)
+{
+	struct crt_tree_cache	*cache;
+	struct crt_tree_cache	*expected = NULL;
+	int			 rc;
+
+	cache = __atomic_load_n(&grp_priv->gp_tree_cache, __ATOMIC_ACQUIRE);
+	if (cache != NULL)
+		return cache;
+
+	D_ALLOC_PTR(cache);
+	if (cache == NULL)
+		return NULL;
+	rc = D_MUTEX_INIT(&cache->tc_mutex, NULL);
+	if (rc != 0) {
+		D_FREE_PTR(cache);
+		return NULL;
+	}
+
+	if (!__atomic_compare_exchange_n(&grp_priv->gp_tree_cache, &expected,
+					 cache, false, __ATOMIC_ACQ_REL,
+					 __ATOMIC_ACQUIRE)) {
+		/* lost the race, use the winner's */
+		D_MUTEX_DESTROY(&cache->tc_mutex);
+		D_FREE_PTR(cache);
+		cache = expected;
+	}
+
+	return cache;
+}
+
+void
+crt_tree_cache_destroy(struct crt_grp_priv *grp_priv)
+{
+	struct crt_tree_cache	*cache = grp_priv->gp_tree_cache;
+	int			 i;
+
+	if (cache == NULL)
+		return;
+
+	for (i = 0; i < CRT_TREE_CACHE_SIZE; i++)
+		crt_tree_cache_ent_fini(&cache->tc_ents[i]);
+	D_MUTEX_DESTROY(&cache->tc_mutex);
+	D_FREE_PTR(cache);
+	grp_priv->gp_tree_cache = NULL;
+}
+
+/*
+ * Calculate the topology, called with gp_rwlock_ft held. tt->tt_children is
+ * allocated if tt->tt_nchildren > 0.
+ */
+static int
+crt_tree_topo_calc(struct crt_grp_priv *grp_priv, d_rank_list_t *exclude_ranks,
+		   int tree_topo, d_rank_t root, d_rank_t self,
+		   struct crt_tree_topo *tt)
 {
 	d_rank_list_t		*grp_rank_list = NULL;
 	d_rank_t		 grp_root, grp_self;
 	bool			 allocated = false;
 	uint32_t		 tree_type, tree_ratio;
-	uint32_t		 grp_size;
+	uint32_t		 grp_size, tree_parent;
+	uint32_t		*tree_children = NULL;
+	uint32_t		*grp_loc = NULL;
 	struct crt_topo_ops	*tops;
-	int			 rc = 0;
-
-	D_RWLOCK_RDLOCK(grp_priv->gp_rwlock_ft);
+	int			 i, rc = 0;
 
 	CRT_TREE_PARAMETER_CHECKING(grp_priv, tree_topo, root, self);
-	if (nchildren == NULL) {
-		D_ERROR("invalid parameter of NULL nchildren.\n");
-		D_GOTO(out, rc = -DER_INVAL);
-	}
+	memset(tt, 0, sizeof(*tt));
 
 	/*
 	 * grp_rank_list is the target group (filtered out the excluded ranks)
 	 * for building the tree, rank number in it is for primary group.
 	 */
-	rc = crt_get_filtered_grp_rank_list(grp_priv, grp_ver, exclude_ranks,
+	rc = crt_get_filtered_grp_rank_list(grp_priv, 0, exclude_ranks,
 					    root, self, &grp_size, &grp_root,
 					    &grp_self, &grp_rank_list,
 					    &allocated);
@@ -181,26 +303,190 @@ crt_tree_get_nchildren(struct crt_grp_priv *grp_priv, uint32_t grp_ver,
 		D_GOTO(out, rc);
 	}
 	if (grp_rank_list == NULL) {
-		D_ERROR("crt_get_filtered_grp_rank_list(group %s) get empty.\n",
-			grp_priv->gp_pub.cg_grpid);
-		D_GOTO(out, rc = -DER_INVAL);
+		D_DEBUG(DB_TRACE, "crt_get_filtered_grp_rank_list(group %s) "
+			"get empty.\n", grp_priv->gp_pub.cg_grpid);
+		tt->tt_empty = true;
+		D_GOTO(out, rc = 0);
+	}
+
+	if (tree_type == CRT_TREE_LOCALITY) {
+		rc = crt_grp_locality_get(grp_priv, grp_rank_list, &grp_loc);
+		if (rc != 0)
+			D_GOTO(out, rc);
 	}
 
 	tops = crt_tops[tree_type];
+
+	tt->tt_parent_rc = tops->to_get_parent(grp_size, tree_ratio, grp_root,
+					       grp_self, &tree_parent, grp_loc);
+	if (tt->tt_parent_rc == 0)
+		tt->tt_parent = grp_rank_list->rl_ranks[tree_parent];
+
 	rc = tops->to_get_children_cnt(grp_size, tree_ratio, grp_root, grp_self,
-				       nchildren);
-	if (rc != 0)
+				       &tt->tt_nchildren, grp_loc);
+	if (rc != 0) {
 		D_ERROR("to_get_children_cnt (group %s, root %d, self %d) "
 			"failed, rc: %d.\n", grp_priv->gp_pub.cg_grpid,
 			root, self, rc);
+		D_GOTO(out, rc);
+	}
+	if (tt->tt_nchildren == 0)
+		D_GOTO(out, rc = 0);
+
+	D_ALLOC_ARRAY(tree_children, tt->tt_nchildren);
+	if (tree_children == NULL)
+		D_GOTO(out, rc = -DER_NOMEM);
+	rc = tops->to_get_children(grp_size, tree_ratio, grp_root, grp_self,
+				   tree_children, grp_loc);
+	if (rc != 0) {
+		D_ERROR("to_get_children (group %s, root %d, self %d) "
+			"failed, rc: %d.\n", grp_priv->gp_pub.cg_grpid,
+			root, self, rc);
+		D_GOTO(out, rc);
+	}
+
+	/* convert the group indexes to primary ranks in place */
+	D_CASSERT(sizeof(*tree_children) == sizeof(d_rank_t));
+	for (i = 0; i < tt->tt_nchildren; i++)
+		tree_children[i] = grp_rank_list->rl_ranks[tree_children[i]];
+	tt->tt_children = tree_children;
+	tree_children = NULL;
 
 out:
-	D_RWLOCK_UNLOCK(grp_priv->gp_rwlock_ft);
+	D_FREE(grp_loc);
+	D_FREE(tree_children);
 	if (allocated)
 		d_rank_list_free(grp_rank_list);
 	return rc;
 }
 
+/*
+ * Look up the topology in the group's tree cache, calculate and insert it on a
+ * miss. Called with gp_rwlock_ft held. The result is copied to tt, with
+ * tt->tt_children allocated only if with_children is true (caller frees).
+ */
+static int
+crt_tree_topo_lookup(struct crt_grp_priv *grp_priv,
+		     d_rank_list_t *exclude_ranks, int tree_topo,
+		     d_rank_t root, d_rank_t self, bool with_children,
+		     struct crt_tree_topo *tt)
+{
+	struct crt_tree_cache		*cache;
+	struct crt_tree_cache_ent	*ent;
+	struct crt_tree_topo		 calc;
+	d_rank_list_t			*excl_copy = NULL;
+	uint64_t			 excl_hash;
+	uint64_t			 slot;
+	uint32_t			 gen;
+	int				 rc = 0;
+
+	/*
+	 * a subgroup's trees also depend on the primary group, i.e. on the
+	 * locality of its ranks. Both generations only grow, so does the sum.
+	 */
+	gen = __atomic_load_n(&grp_priv->gp_topo_gen, __ATOMIC_ACQUIRE);
+	if (!grp_priv->gp_primary)
+		gen += __atomic_load_n(&crt_grp_pub2priv(NULL)->gp_topo_gen,
+				       __ATOMIC_ACQUIRE);
+	excl_hash = crt_tree_excl_hash(exclude_ranks);
+
+	cache = crt_tree_cache_get(grp_priv);
+	if (cache == NULL) {
+		/* no cache, calculate directly */
+		rc = crt_tree_topo_calc(grp_priv, exclude_ranks, tree_topo,
+					root, self, tt);
+		if (rc == 0 && !with_children)
+			D_FREE(tt->tt_children);
+		return rc;
+	}
+
+	slot = excl_hash ^ ((uint64_t)tree_topo << 48) ^
+	       ((uint64_t)root << 24) ^ self;
+	slot = (slot ^ (slot >> 29)) % CRT_TREE_CACHE_SIZE;
+	ent = &cache->tc_ents[slot];
+
+	D_MUTEX_LOCK(&cache->tc_mutex);
+	if (!ent->tce_valid || ent->tce_gen != gen ||
+	    ent->tce_topo != tree_topo || ent->tce_root != root ||
+	    ent->tce_self != self || ent->tce_excl_hash != excl_hash ||
+	    !crt_tree_excl_equal(ent->tce_excl, exclude_ranks)) {
+		rc = crt_tree_topo_calc(grp_priv, exclude_ranks, tree_topo,
+					root, self, &calc);
+		if (rc != 0)
+			D_GOTO(out, rc);
+		if (exclude_ranks != NULL && exclude_ranks->rl_nr > 0) {
+			rc = d_rank_list_dup(&excl_copy, exclude_ranks);
+			if (rc != 0) {
+				D_FREE(calc.tt_children);
+				D_GOTO(out, rc);
+			}
+		}
+
+		crt_tree_cache_ent_fini(ent);
+		ent->tce_gen = gen;
+		ent->tce_topo = tree_topo;
+		ent->tce_root = root;
+		ent->tce_self = self;
+		ent->tce_excl_hash = excl_hash;
+		ent->tce_excl = excl_copy;
+		ent->tce_tt = calc;
+		ent->tce_valid = true;
+	}
+
+	*tt = ent->tce_tt;
+	tt->tt_children = NULL;
+	if (with_children && tt->tt_nchildren > 0) {
+		D_ALLOC_ARRAY(tt->tt_children, tt->tt_nchildren);
+		if (tt->tt_children == NULL)
+			D_GOTO(out, rc = -DER_NOMEM);
+		memcpy(tt->tt_children, ent->tce_tt.tt_children,
+		       tt->tt_nchildren * sizeof(*tt->tt_children));
+	}
+
+out:
+	D_MUTEX_UNLOCK(&cache->tc_mutex);
+	return rc;
+}
+
+/*
+ * query number of children.
+ *
+ * rank number of grp_priv->gp_membs, grp_priv->gp_live_ranks and exclude_ranks
+ * are primary rank.  grp_root and grp_self are logical rank number within the
+ * group.
+ */
+int
+crt_tree_get_nchildren(struct crt_grp_priv *grp_priv, uint32_t grp_ver,
+		       d_rank_list_t *exclude_ranks, int tree_topo,
+		       d_rank_t root, d_rank_t self, uint32_t *nchildren)
+{
+	struct crt_tree_topo	tt;
+	int			rc = 0;
+
+	D_RWLOCK_RDLOCK(grp_priv->gp_rwlock_ft);
+
+	if (nchildren == NULL) {
+		D_ERROR("invalid parameter of NULL nchildren.\n");
+		D_GOTO(out, rc = -DER_INVAL);
+	}
+
+	rc = crt_tree_topo_lookup(grp_priv, exclude_ranks, tree_topo, root,
+				  self, false /* with_children */, &tt);
+	if (rc != 0)
+		D_GOTO(out, rc);
+	if (tt.tt_empty) {
+		D_ERROR("crt_get_filtered_grp_rank_list(group %s) get empty.\n",
+			grp_priv->gp_pub.cg_grpid);
+		D_GOTO(out, rc = -DER_INVAL);
+	}
+
+	*nchildren = tt.tt_nchildren;
+
+out:
+	D_RWLOCK_UNLOCK(grp_priv->gp_rwlock_ft);
+	return rc;
+}
+
 /*
  * query children rank list (rank number in primary group).
  *
@@ -214,17 +500,10 @@ crt_tree_get_children(struct crt_grp_priv *grp_priv, uint32_t grp_ver,
 		      d_rank_t root, d_rank_t self,
 		      d_rank_list_t **children_rank_list, bool *ver_match)
 {
-	d_rank_list_t		*grp_rank_list = NULL;
 	d_rank_list_t		*result_rank_list = NULL;
-	d_rank_t		 grp_root, grp_self;
-	bool			 allocated = false;
-	uint32_t		 tree_type, tree_ratio;
-	uint32_t		 grp_size, nchildren;
-	uint32_t		 *tree_children;
-	struct crt_topo_ops	*tops;
+	struct crt_tree_topo	 tt;
 	struct crt_grp_priv	*default_grp_priv;
-	int			 i, rc = 0;
-
+	int			 rc = 0;
 
 	default_grp_priv = crt_grp_pub2priv(NULL);
 	D_ASSERT(default_grp_priv != NULL);
@@ -234,77 +513,32 @@ crt_tree_get_children(struct crt_grp_priv *grp_priv, uint32_t grp_ver,
 		*ver_match = (grp_ver == default_grp_priv->gp_membs_ver ?
 			      true : false);
 
-	CRT_TREE_PARAMETER_CHECKING(grp_priv, tree_topo, root, self);
 	if (children_rank_list == NULL) {
 		D_ERROR("invalid parameter of NULL children_rank_list.\n");
 		D_GOTO(out, rc = -DER_INVAL);
 	}
 
-	/*
-	 * grp_rank_list is the target group (filtered out the excluded ranks)
-	 * for building the tree, rank number in it is for primary group.
-	 */
-	rc = crt_get_filtered_grp_rank_list(grp_priv, grp_ver, exclude_ranks,
-					    root, self, &grp_size, &grp_root,
-					    &grp_self, &grp_rank_list,
-					    &allocated);
-	if (rc != 0) {
-		D_ERROR("crt_get_filtered_grp_rank_list(group %s, root %d, "
-			"self %d) failed, rc: %d.\n", grp_priv->gp_pub.cg_grpid,
-			root, self, rc);
-		D_GOTO(out, rc);
-	}
-	if (grp_rank_list == NULL) {
-		D_DEBUG(DB_TRACE, "crt_get_filtered_grp_rank_list(group %s) "
-			"get empty.\n", grp_priv->gp_pub.cg_grpid);
-		*children_rank_list = NULL;
-		D_GOTO(out, rc);
-	}
-
-	tops = crt_tops[tree_type];
-
-	rc = tops->to_get_children_cnt(grp_size, tree_ratio, grp_root, grp_self,
-				       &nchildren);
-	if (rc != 0) {
-		D_ERROR("to_get_children_cnt (group %s, root %d, self %d) "
-			"failed, rc: %d.\n", grp_priv->gp_pub.cg_grpid,
-			root, self, rc);
+	rc = crt_tree_topo_lookup(grp_priv, exclude_ranks, tree_topo, root,
+				  self, true /* with_children */, &tt);
+	if (rc != 0)
 		D_GOTO(out, rc);
-	}
-	if (nchildren == 0) {
+	if (tt.tt_empty || tt.tt_nchildren == 0) {
 		*children_rank_list = NULL;
 		D_GOTO(out, rc = 0);
 	}
-	result_rank_list = d_rank_list_alloc(nchildren);
-	if (result_rank_list == NULL)
-		D_GOTO(out, rc = -DER_NOMEM);
-	D_ALLOC_ARRAY(tree_children, nchildren);
-	if (tree_children == NULL) {
-		d_rank_list_free(result_rank_list);
+
+	/* hand the copied children array over to the rank list */
+	D_ALLOC_PTR(result_rank_list);
+	if (result_rank_list == NULL) {
+		D_FREE(tt.tt_children);
 		D_GOTO(out, rc = -DER_NOMEM);
 	}
-	rc = tops->to_get_children(grp_size, tree_ratio, grp_root, grp_self,
-				   tree_children);
-	if (rc != 0) {
-		D_ERROR("to_get_children (group %s, root %d, self %d) "
-			"failed, rc: %d.\n", grp_priv->gp_pub.cg_grpid,
-			root, self, rc);
-		d_rank_list_free(result_rank_list);
-		D_FREE(tree_children);
-		D_GOTO(out, rc);
-	}
-
-	for (i = 0; i < nchildren; i++)
-		result_rank_list->rl_ranks[i] =
-			grp_rank_list->rl_ranks[tree_children[i]];
-
-	D_FREE(tree_children);
+	result_rank_list->rl_nr = tt.tt_nchildren;
+	result_rank_list->rl_ranks = tt.tt_children;
 	*children_rank_list = result_rank_list;
 
 out:
 	D_RWLOCK_UNLOCK(grp_priv->gp_rwlock_ft);
-	if (allocated)
-		d_rank_list_free(grp_rank_list);
 	return rc;
 }
 
@@ -313,56 +547,37 @@ crt_tree_get_parent(struct crt_grp_priv *grp_priv, uint32_t grp_ver,
 		    d_rank_list_t *exclude_ranks, int tree_topo,
 		    d_rank_t root, d_rank_t self, d_rank_t *parent_rank)
 {
-	d_rank_list_t		*grp_rank_list = NULL;
-	d_rank_t		 grp_root, grp_self;
-	bool			 allocated = false;
-	uint32_t		 tree_type, tree_ratio;
-	uint32_t		 grp_size, tree_parent;
-	struct crt_topo_ops	*tops;
-	int			 rc = 0;
+	struct crt_tree_topo	tt;
+	int			rc = 0;
 
 	D_RWLOCK_RDLOCK(grp_priv->gp_rwlock_ft);
 
-	CRT_TREE_PARAMETER_CHECKING(grp_priv, tree_topo, root, self);
 	if (parent_rank == NULL) {
 		D_ERROR("invalid parameter of NULL parent_rank.\n");
 		D_GOTO(out, rc = -DER_INVAL);
 	}
 
-	/*
-	 * grp_rank_list is the target group (filtered out the excluded ranks)
-	 * for building the tree, rank number in it is for primary group.
-	 */
-	rc = crt_get_filtered_grp_rank_list(grp_priv, grp_ver, exclude_ranks,
-					    root, self, &grp_size, &grp_root,
-					    &grp_self, &grp_rank_list,
-					    &allocated);
-	if (rc != 0) {
-		D_ERROR("crt_get_filtered_grp_rank_list(group %s, root %d, "
-			"self %d) failed, rc: %d.\n", grp_priv->gp_pub.cg_grpid,
-			root, self, rc);
+	rc = crt_tree_topo_lookup(grp_priv, exclude_ranks, tree_topo, root,
+				  self, false /* with_children */, &tt);
+	if (rc != 0)
 		D_GOTO(out, rc);
-	}
-	if (grp_rank_list == NULL) {
+	if (tt.tt_empty) {
 		D_DEBUG(DB_TRACE, "crt_get_filtered_grp_rank_list(group %s) "
 			"get empty.\n", grp_priv->gp_pub.cg_grpid);
 		D_GOTO(out, rc = -DER_INVAL);
 	}
 
-	tops = crt_tops[tree_type];
-	rc = tops->to_get_parent(grp_size, tree_ratio, grp_root, grp_self,
-				 &tree_parent);
+	rc = tt.tt_parent_rc;
 	if (rc != 0) {
 		D_ERROR("to_get_parent (group %s, root %d, self %d) failed, "
 			"rc: %d.\n", grp_priv->gp_pub.cg_grpid, root, self, rc);
+		D_GOTO(out, rc);
 	}
 
-	*parent_rank = grp_rank_list->rl_ranks[tree_parent];
+	*parent_rank = tt.tt_parent;
 
 out:
 	D_RWLOCK_UNLOCK(grp_priv->gp_rwlock_ft);
-	if (allocated)
-		d_rank_list_free(grp_rank_list);
 	return rc;
 }
 
@@ -371,4 +586,5 @@ struct crt_topo_ops *crt_tops[] = {
 	&crt_flat_ops,		/* CRT_TREE_FLAT */
 	&crt_kary_ops,		/* CRT_TREE_KARY */
 	&crt_knomial_ops,	/* CRT_TREE_KNOMIAL */
+	&crt_locality_ops,	/* CRT_TREE_LOCALITY */
 };
@@ -59,6 +59,15 @@ int crt_tree_get_parent(struct crt_grp_priv *grp_priv, uint32_t grp_ver,
 			d_rank_list_t *exclude_ranks, int tree_topo,
 			d_rank_t grp_root, d_rank_t grp_self,
 			d_rank_t *parent_rank);
+/* free the memoized tree topologies of the group */
+void crt_tree_cache_destroy(struct crt_grp_priv *grp_priv);
+
+/* invalidate the memoized tree topologies after a membership change */
+static inline void
+crt_tree_topo_changed(struct crt_grp_priv *grp_priv)
+{
+	__atomic_add_fetch(&grp_priv->gp_topo_gen, 1, __ATOMIC_RELEASE);
+}
 
 /*
  * all specific tree type's calculations are based on group rank number.
@@ -76,18 +85,23 @@ int crt_tree_get_parent(struct crt_grp_priv *grp_priv, uint32_t grp_ver,
  *    assume group_root is the group rank of the root in the tree topo, then:
  *    tree_rank  = (group_rank - group_root + group_size) % (group_size)
  *    group_rank = (tree_rank + group_root) % (group_size)
+ *
+ * grp_loc is NULL or the locality (node) of each group rank, see
+ * crt_grp_rank_locality(). Only CRT_TREE_LOCALITY uses it.
  */
 typedef int (*crt_topo_get_children_cnt_t)(uint32_t grp_size,
 					   uint32_t branch_ratio,
 					   uint32_t grp_root,
 					   uint32_t grp_self,
-					   uint32_t *nchildren);
+					   uint32_t *nchildren,
+					   const uint32_t *grp_loc);
 typedef int (*crt_topo_get_children_t)(uint32_t grp_size, uint32_t branch_ratio,
 				       uint32_t grp_root, uint32_t grp_self,
-				       uint32_t *children);
+				       uint32_t *children,
+				       const uint32_t *grp_loc);
 typedef int (*crt_topo_get_parent_t)(uint32_t grp_size, uint32_t branch_ratio,
 				     uint32_t grp_root, uint32_t grp_self,
-				     uint32_t *parent);
+				     uint32_t *parent, const uint32_t *grp_loc);
 
 struct crt_topo_ops {
 	crt_topo_get_children_cnt_t	to_get_children_cnt;
@@ -98,6 +112,7 @@ struct crt_topo_ops {
 extern struct crt_topo_ops	 crt_flat_ops;
 extern struct crt_topo_ops	 crt_kary_ops;
 extern struct crt_topo_ops	 crt_knomial_ops;
+extern struct crt_topo_ops	 crt_locality_ops;
 
 extern struct crt_topo_ops	*crt_tops[];
 
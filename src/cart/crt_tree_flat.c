@@ -46,7 +46,8 @@
 int
 crt_flat_get_children_cnt(uint32_t grp_size, uint32_t branch_ratio,
 			  uint32_t grp_root, uint32_t grp_self,
-			  uint32_t *nchildren)
+			  uint32_t *nchildren,
+			  const uint32_t *grp_loc)
 {
 	D_ASSERT(grp_size > 0);
 	if (CRT_PMIX_ENABLED())
@@ -63,7 +64,8 @@ crt_flat_get_children_cnt(uint32_t grp_size, uint32_t branch_ratio,
 
 int
 crt_flat_get_children(uint32_t grp_size, uint32_t branch_ratio,
-		      uint32_t grp_root, uint32_t grp_self, uint32_t *children)
+		      uint32_t grp_root, uint32_t grp_self, uint32_t *children,
+		      const uint32_t *grp_loc)
 {
 	int	i, j;
 
@@ -85,7 +87,8 @@ crt_flat_get_children(uint32_t grp_size, uint32_t branch_ratio,
 
 int
 crt_flat_get_parent(uint32_t grp_size, uint32_t branch_ratio, uint32_t grp_root,
-		    uint32_t grp_self, uint32_t *parent)
+		    uint32_t grp_self, uint32_t *parent,
+		    const uint32_t *grp_loc)
 {
 	D_ASSERT(grp_size > 0);
 	if (CRT_PMIX_ENABLED())
@@ -134,7 +134,8 @@ knomial_get_parent(uint32_t self, uint32_t ratio)
 int
 crt_knomial_get_children_cnt(uint32_t grp_size, uint32_t tree_ratio,
 			     uint32_t grp_root, uint32_t grp_self,
-			     uint32_t *nchildren)
+			     uint32_t *nchildren,
+			     const uint32_t *grp_loc)
 {
 	uint32_t	tree_self;
 
@@ -156,7 +157,8 @@ crt_knomial_get_children_cnt(uint32_t grp_size, uint32_t tree_ratio,
 int
 crt_knomial_get_children(uint32_t grp_size, uint32_t tree_ratio,
 			 uint32_t grp_root, uint32_t grp_self,
-			 uint32_t *children)
+			 uint32_t *children,
+			 const uint32_t *grp_loc)
 {
 	uint32_t	nchildren;
 	uint32_t	tree_self;
@@ -182,7 +184,8 @@ crt_knomial_get_children(uint32_t grp_size, uint32_t tree_ratio,
 
 int
 crt_knomial_get_parent(uint32_t grp_size, uint32_t tree_ratio,
-		       uint32_t grp_root, uint32_t grp_self, uint32_t *parent)
+		       uint32_t grp_root, uint32_t grp_self, uint32_t *parent,
+		       const uint32_t *grp_loc)
 {
 	uint32_t	tree_self, tree_parent;
 
@@ -0,0 +1,290 @@
+/* Copyright (C) 2018 Intel Corporation
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted for any purpose (including commercial purposes)
+ * provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions, and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions, and the following disclaimer in the
+ *    documentation and/or materials provided with the distribution.
+ *
+ * 3. In addition, redistributions of modified forms of the source or binary
+ *    code must carry prominent notices stating that the original code was
+ *    changed and the date of the change.
+ *
+ *  4. All publications or advertising materials mentioning features or use of
+ *     this software are asked, but not required, to acknowledge that it was
+ *     developed by Intel Corporation and credit the contributors.
+ *
+ * 5. Neither the name of Intel Corporation, nor the name of any Contributor
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+/**
+ * This file is part of CaRT. It gives out the locality aware tree topo related
+ * function implementation.
+ *
+ * The group ranks are grouped by locality (node). Each node has a leader, the
+ * root on its own node and the lowest group rank on the others. A knomial tree
+ * over the leaders fans out across the nodes first, then a knomial tree rooted
+ * at the leader fans out within each node. Without the locality of the ranks
+ * it is a plain knomial tree.
+ */
+#define D_LOGFAC	DD_FAC(grp)
+
+#include "crt_internal.h"
+
+struct loc_ent {
+	uint32_t	le_loc;
+	uint32_t	le_idx;
+};
+
+struct loc_tree {
+	/* group ranks sorted by locality, then group rank */
+	struct loc_ent	*lt_ents;
+	/* group rank of the leader of each node */
+	uint32_t	*lt_leaders;
+	uint32_t	 lt_nleaders;
+	/* position of grp_root in lt_leaders */
+	uint32_t	 lt_root_pos;
+	/* position of grp_self in lt_leaders, if it is a leader */
+	uint32_t	 lt_self_pos;
+	bool		 lt_self_leader;
+	/* the ranks on grp_self's node, lt_ents[lt_local_start, +lt_nlocal) */
+	uint32_t	 lt_local_start;
+	uint32_t	 lt_nlocal;
+	/* positions of the node's leader and of grp_self in them */
+	uint32_t	 lt_local_root;
+	uint32_t	 lt_local_self;
+};
+
+static int
+loc_ent_cmp(const void *a, const void *b)
+{
+	const struct loc_ent	*ea = a;
+	const struct loc_ent	*eb = b;
+
+	if (ea->le_loc != eb->le_loc)
+		return ea->le_loc < eb->le_loc ? -1 : 1;
+	if (ea->le_idx != eb->le_idx)
+		return ea->le_idx < eb->le_idx ? -1 : 1;
+	return 0;
+}
+
+static void
+loc_tree_fini(struct loc_tree *lt)
+{
+	D_FREE(lt->lt_ents);
+	D_FREE(lt->lt_leaders);
+}
+
+static int
+loc_tree_init(uint32_t grp_size, uint32_t grp_root, uint32_t grp_self,
+	      const uint32_t *grp_loc, struct loc_tree *lt)
+{
+	struct loc_ent	*ents;
+	uint32_t	 leader;
+	uint32_t	 i, j, k;
+
+	D_ASSERT(grp_root < grp_size && grp_self < grp_size);
+	memset(lt, 0, sizeof(*lt));
+
+	D_ALLOC_ARRAY(lt->lt_ents, grp_size);
+	D_ALLOC_ARRAY(lt->lt_leaders, grp_size);
+	if (lt->lt_ents == NULL || lt->lt_leaders == NULL) {
+		loc_tree_fini(lt);
+		return -DER_NOMEM;
+	}
+	ents = lt->lt_ents;
+
+	for (i = 0; i < grp_size; i++) {
+		ents[i].le_loc = grp_loc[i];
+		ents[i].le_idx = i;
+	}
+	qsort(ents, grp_size, sizeof(*ents), loc_ent_cmp);
+
+	for (i = 0; i < grp_size; i = j) {
+		for (j = i + 1; j < grp_size; j++)
+			if (ents[j].le_loc != ents[i].le_loc)
+				break;
+
+		leader = ents[i].le_idx;
+		if (ents[i].le_loc == grp_loc[grp_root]) {
+			leader = grp_root;
+			lt->lt_root_pos = lt->lt_nleaders;
+		}
+		if (leader == grp_self) {
+			lt->lt_self_pos = lt->lt_nleaders;
+			lt->lt_self_leader = true;
+		}
+		lt->lt_leaders[lt->lt_nleaders++] = leader;
+
+		if (ents[i].le_loc != grp_loc[grp_self])
+			continue;
+		lt->lt_local_start = i;
+		lt->lt_nlocal = j - i;
+		for (k = i; k < j; k++) {
+			if (ents[k].le_idx == leader)
+				lt->lt_local_root = k - i;
+			if (ents[k].le_idx == grp_self)
+				lt->lt_local_self = k - i;
+		}
+	}
+
+	return 0;
+}
+
+/* fills children (if not NULL) and returns the number of children */
+static uint32_t
+loc_tree_children(struct loc_tree *lt, uint32_t tree_ratio, uint32_t *children)
+{
+	uint32_t	nchildren = 0;
+	uint32_t	nlocal;
+	uint32_t	i;
+
+	/* across the nodes first, the remote subtrees are the deepest */
+	if (lt->lt_self_leader) {
+		crt_knomial_ops.to_get_children_cnt(lt->lt_nleaders, tree_ratio,
+						    lt->lt_root_pos,
+						    lt->lt_self_pos,
+						    &nchildren, NULL);
+		if (children != NULL && nchildren > 0) {
+			crt_knomial_ops.to_get_children(lt->lt_nleaders,
+							tree_ratio,
+							lt->lt_root_pos,
+							lt->lt_self_pos,
+							children, NULL);
+			for (i = 0; i < nchildren; i++)
+				children[i] = lt->lt_leaders[children[i]];
+		}
+	}
+
+	crt_knomial_ops.to_get_children_cnt(lt->lt_nlocal, tree_ratio,
+					    lt->lt_local_root,
+					    lt->lt_local_self, &nlocal, NULL);
+	if (children != NULL && nlocal > 0) {
+		children += nchildren;
+		crt_knomial_ops.to_get_children(lt->lt_nlocal, tree_ratio,
+						lt->lt_local_root,
+						lt->lt_local_self, children,
+						NULL);
+		for (i = 0; i < nlocal; i++)
+			children[i] = lt->lt_ents[lt->lt_local_start +
+						  children[i]].le_idx;
+	}
+
+	return nchildren + nlocal;
+}
+
+int
+crt_locality_get_children_cnt(uint32_t grp_size, uint32_t tree_ratio,
+			      uint32_t grp_root, uint32_t grp_self,
+			      uint32_t *nchildren, const uint32_t *grp_loc)
+{
+	struct loc_tree	lt;
+	int		rc;
+
+	D_ASSERT(nchildren != NULL);
+
+	if (grp_loc == NULL)
+		return crt_knomial_ops.to_get_children_cnt(grp_size, tree_ratio,
+							   grp_root, grp_self,
+							   nchildren, NULL);
+
+	rc = loc_tree_init(grp_size, grp_root, grp_self, grp_loc, &lt);
+	if (rc != 0)
+		return rc;
+
+	*nchildren = loc_tree_children(&lt, tree_ratio, NULL);
+
+	loc_tree_fini(&lt);
+	return 0;
+}
+
+int
+crt_locality_get_children(uint32_t grp_size, uint32_t tree_ratio,
+			  uint32_t grp_root, uint32_t grp_self,
+			  uint32_t *children, const uint32_t *grp_loc)
+{
+	struct loc_tree	lt;
+	int		rc;
+
+	D_ASSERT(children != NULL);
+
+	if (grp_loc == NULL)
+		return crt_knomial_ops.to_get_children(grp_size, tree_ratio,
+						       grp_root, grp_self,
+						       children, NULL);
+
+	rc = loc_tree_init(grp_size, grp_root, grp_self, grp_loc, &lt);
+	if (rc != 0)
+		return rc;
+
+	loc_tree_children(&lt, tree_ratio, children);
+
+	loc_tree_fini(&lt);
+	return 0;
+}
+
+int
+crt_locality_get_parent(uint32_t grp_size, uint32_t tree_ratio,
+			uint32_t grp_root, uint32_t grp_self,
+			uint32_t *parent, const uint32_t *grp_loc)
+{
+	struct loc_tree	lt;
+	uint32_t	pos;
+	int		rc;
+
+	D_ASSERT(parent != NULL);
+
+	if (grp_loc == NULL)
+		return crt_knomial_ops.to_get_parent(grp_size, tree_ratio,
+						     grp_root, grp_self,
+						     parent, NULL);
+
+	if (grp_self == grp_root)
+		return -DER_INVAL;
+
+	rc = loc_tree_init(grp_size, grp_root, grp_self, grp_loc, &lt);
+	if (rc != 0)
+		return rc;
+
+	if (lt.lt_self_leader) {
+		rc = crt_knomial_ops.to_get_parent(lt.lt_nleaders, tree_ratio,
+						   lt.lt_root_pos,
+						   lt.lt_self_pos, &pos, NULL);
+		if (rc == 0)
+			*parent = lt.lt_leaders[pos];
+	} else {
+		rc = crt_knomial_ops.to_get_parent(lt.lt_nlocal, tree_ratio,
+						   lt.lt_local_root,
+						   lt.lt_local_self, &pos,
+						   NULL);
+		if (rc == 0)
+			*parent = lt.lt_ents[lt.lt_local_start + pos].le_idx;
+	}
+
+	loc_tree_fini(&lt);
+	return rc;
+}
+
+struct crt_topo_ops crt_locality_ops = {
+	.to_get_children_cnt	= crt_locality_get_children_cnt,
+	.to_get_children	= crt_locality_get_children,
+	.to_get_parent		= crt_locality_get_parent
+};
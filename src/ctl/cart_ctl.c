@@ -61,6 +61,8 @@ enum cmd_t {
 	CMD_LIST_CTX,
 	CMD_GET_HOSTNAME,
 	CMD_GET_PID,
+	CMD_HG_POOL,
+	CMD_RPC_CACHE,
 };
 
 struct cmd_info {
@@ -76,6 +78,8 @@ struct cmd_info cmds[] = {
 	DEF_CMD(CMD_LIST_CTX, CRT_OPC_CTL_LS),
 	DEF_CMD(CMD_GET_HOSTNAME, CRT_OPC_CTL_GET_HOSTNAME),
 	DEF_CMD(CMD_GET_PID, CRT_OPC_CTL_GET_PID),
+	DEF_CMD(CMD_HG_POOL, CRT_OPC_CTL_HG_POOL),
+	DEF_CMD(CMD_RPC_CACHE, CRT_OPC_CTL_RPC_CACHE),
 };
 
 static char *cmd2str(enum cmd_t cmd)
@@ -114,6 +118,7 @@ struct ctl_g {
 	crt_group_t	*cg_target_group;
 	int		 cg_num_ranks;
 	d_rank_t	 cg_ranks[CRT_CTL_MAX];
+	int32_t		 cg_hg_pool_max;
 	crt_context_t	 cg_crt_ctx;
 	pthread_t	 cg_tid;
 	int		 cg_complete;
@@ -211,13 +216,19 @@ print_usage_msg(const char *msg)
 		printf("\nERROR: %s\n", msg);
 	printf("Usage: cart_ctl <cmd> --group-name name --rank "
 	       "start-end,start-end,rank,rank\n");
-	printf("cmds: list_ctx, get_hostname, get_pid\n");
+	printf("cmds: list_ctx, get_hostname, get_pid, hg_pool, rpc_cache\n");
 	printf("\nlist_ctx:\n");
 	printf("\tPrint # of contexts on each rank and uri for each context\n");
 	printf("\nget_hostname:\n");
 	printf("\tPrint hostnames of specified ranks\n");
 	printf("\nget_pid:\n");
 	printf("\tReturn pids of the specified ranks\n");
+	printf("\nhg_pool [--max num]:\n");
+	printf("\tPrint HG handle pool counters of each context, with --max\n"
+	       "\tresize the pools to num handles, or 0 to size them after\n"
+	       "\tthe workload\n");
+	printf("\nrpc_cache:\n");
+	printf("\tPrint RPC descriptor cache counters of each context\n");
 }
 
 static int
@@ -238,20 +249,26 @@ parse_args(int argc, char **argv)
 		ctl_gdata.cg_cmd_code = CMD_GET_HOSTNAME;
 	else if (strcmp(argv[1], "get_pid") == 0)
 		ctl_gdata.cg_cmd_code = CMD_GET_PID;
+	else if (strcmp(argv[1], "hg_pool") == 0)
+		ctl_gdata.cg_cmd_code = CMD_HG_POOL;
+	else if (strcmp(argv[1], "rpc_cache") == 0)
+		ctl_gdata.cg_cmd_code = CMD_RPC_CACHE;
 	else {
 		print_usage_msg("Invalid command\n");
 		D_GOTO(out, rc = -DER_INVAL);
 	}
 
+	ctl_gdata.cg_hg_pool_max = -1;
 	optind = 2;
 	while (1) {
 		static struct option long_options[] = {
 			{"group-name", required_argument, 0, 'g'},
 			{"rank", required_argument, 0, 'r'},
+			{"max", required_argument, 0, 'm'},
 			{0, 0, 0, 0},
 		};
 
-		opt = getopt_long(argc, argv, "g:r:", long_options, NULL);
+		opt = getopt_long(argc, argv, "g:r:m:", long_options, NULL);
 		if (opt == -1)
 			break;
 		switch (opt) {
@@ -264,6 +281,23 @@ parse_args(int argc, char **argv)
 		case 'r':
 			parse_rank_string(optarg, ctl_gdata.cg_ranks,
 					  &ctl_gdata.cg_num_ranks);
+			break;
+		case 'm': {
+			unsigned long	 nr;
+			char		*end;
+
+			errno = 0;
+			nr = strtoul(optarg, &end, 10);
+			if (errno != 0 || end == optarg || *end != '\0' ||
+			    optarg[0] == '-' || nr > CRT_HG_POOL_LIMIT) {
+				fprintf(stderr, "--max should be within "
+					"[0, %d]\n", CRT_HG_POOL_LIMIT);
+				print_usage_msg("Invalid --max value\n");
+				D_GOTO(out, rc = -DER_INVAL);
+			}
+			ctl_gdata.cg_hg_pool_max = nr;
+			break;
+		}
 		}
 	}
 
@@ -278,6 +312,9 @@ ctl_client_cb(const struct crt_cb_info *cb_info)
 	struct crt_ctl_ep_ls_out	*out_ls_args;
 	struct crt_ctl_get_host_out	*out_get_host_args;
 	struct crt_ctl_get_pid_out	*out_get_pid_args;
+	struct crt_ctl_hg_pool_out	*out_hg_pool_args;
+	struct crt_ctl_rpc_cache_out	*out_rpc_cache_args;
+	uint64_t			*stats;
 	char				*addr_str;
 	int				 i;
 	struct cb_info			*info;
@@ -312,6 +349,50 @@ ctl_client_cb(const struct crt_cb_info *cb_info)
 
 			fprintf(stdout, "pid: %d\n",
 				out_get_pid_args->cgp_pid);
+		} else if (info->cmd == CMD_HG_POOL) {
+			out_hg_pool_args = crt_reply_get(cb_info->cci_rpc);
+			stats = out_hg_pool_args->chpo_stats.ca_arrays;
+			fprintf(stdout, "ctx_num: %d, rc: %d\n",
+				out_hg_pool_args->chpo_ctx_num,
+				out_hg_pool_args->chpo_rc);
+			for (i = 0; i < out_hg_pool_args->chpo_ctx_num; i++) {
+				fprintf(stdout, "    ctx %d: max_num "DF_U64
+					", num "DF_U64", auto "DF_U64
+					", inflight "DF_U64", hwm "DF_U64
+					", hit "DF_U64", miss "DF_U64
+					", drop "DF_U64"\n", i,
+					stats[CRT_CTL_HGP_MAX_NUM],
+					stats[CRT_CTL_HGP_NUM],
+					stats[CRT_CTL_HGP_AUTO],
+					stats[CRT_CTL_HGP_INFLIGHT],
+					stats[CRT_CTL_HGP_HWM],
+					stats[CRT_CTL_HGP_HIT],
+					stats[CRT_CTL_HGP_MISS],
+					stats[CRT_CTL_HGP_DROP]);
+				stats += CRT_CTL_HGP_NR;
+			}
+		} else if (info->cmd == CMD_RPC_CACHE) {
+			out_rpc_cache_args = crt_reply_get(cb_info->cci_rpc);
+			stats = out_rpc_cache_args->crco_stats.ca_arrays;
+			fprintf(stdout, "ctx_num: %d, rc: %d\n",
+				out_rpc_cache_args->crco_ctx_num,
+				out_rpc_cache_args->crco_rc);
+			for (i = 0; i < out_rpc_cache_args->crco_ctx_num;
+			     i++) {
+				fprintf(stdout, "    ctx %d: max_num "DF_U64
+					", num "DF_U64", in_use "DF_U64
+					", hit "DF_U64", miss "DF_U64
+					", recycled "DF_U64", released "
+					DF_U64"\n", i,
+					stats[CRT_CTL_RPCC_MAX_NUM],
+					stats[CRT_CTL_RPCC_NUM],
+					stats[CRT_CTL_RPCC_INUSE],
+					stats[CRT_CTL_RPCC_HIT],
+					stats[CRT_CTL_RPCC_MISS],
+					stats[CRT_CTL_RPCC_RECYCLED],
+					stats[CRT_CTL_RPCC_RELEASED]);
+				stats += CRT_CTL_RPCC_NR;
+			}
 		}
 
 	} else {
@@ -329,6 +410,7 @@ ctl_issue_cmd(void)
 	int				 i;
 	crt_rpc_t			*rpc_req;
 	struct crt_ctl_ep_ls_in		*in_args;
+	struct crt_ctl_hg_pool_in	*in_hg_pool_args;
 	crt_endpoint_t			 ep;
 	struct cb_info			 info;
 	int				 rc = 0;
@@ -348,9 +430,19 @@ ctl_issue_cmd(void)
 			D_GOTO(out, rc);
 		}
 
-		in_args = crt_req_get(rpc_req);
-		in_args->cel_grp_id = ctl_gdata.cg_target_group->cg_grpid;
-		in_args->cel_rank = ctl_gdata.cg_ranks[i];
+		if (info.cmd == CMD_HG_POOL) {
+			in_hg_pool_args = crt_req_get(rpc_req);
+			in_hg_pool_args->cel_grp_id =
+				ctl_gdata.cg_target_group->cg_grpid;
+			in_hg_pool_args->cel_rank = ctl_gdata.cg_ranks[i];
+			in_hg_pool_args->chpi_max_num =
+				ctl_gdata.cg_hg_pool_max;
+		} else {
+			in_args = crt_req_get(rpc_req);
+			in_args->cel_grp_id =
+				ctl_gdata.cg_target_group->cg_grpid;
+			in_args->cel_rank = ctl_gdata.cg_ranks[i];
+		}
 
 		D_DEBUG(DB_NET, "rpc_req %p rank %d tag %d seq %d\n",
 			rpc_req, ep.ep_rank, ep.ep_tag, i);
@@ -42,6 +42,10 @@
 #define D_LOGFAC	DD_FAC(misc)
 
 #include <gurt/common.h>
+#include <gurt/rankset.h>
+
+/* longest rank list d_rank_list_filter() scans, larger ones go to a set */
+#define D_RANK_LIST_SCAN_MAX	(16)
 
 int
 d_rank_list_dup(d_rank_list_t **dst, const d_rank_list_t *src)
@@ -84,7 +88,6 @@ int
 d_rank_list_dup_sort_uniq(d_rank_list_t **dst, const d_rank_list_t *src)
 {
 	d_rank_list_t		*rank_list;
-	d_rank_t		rank_tmp;
 	uint32_t		rank_num, identical_num;
 	int			i, j;
 	int			rc = 0;
@@ -101,24 +104,16 @@ d_rank_list_dup_sort_uniq(d_rank_list_t **dst, const d_rank_list_t *src)
 
 	d_rank_list_sort(rank_list);
 
-	/* uniq - remove same rank number in the list */
+	/* uniq - remove same rank number in the list, in one pass */
 	rank_num = src->rl_nr;
 	if (rank_num <= 1)
 		D_GOTO(out, 0);
-	identical_num = 0;
-	rank_tmp = rank_list->rl_ranks[0];
-	for (i = 1; i < rank_num - identical_num; i++) {
-		if (rank_tmp == rank_list->rl_ranks[i]) {
-			identical_num++;
-			for (j = i; j < rank_num; j++)
-				rank_list->rl_ranks[j - 1] =
-					rank_list->rl_ranks[j];
-			D_DEBUG(DB_TRACE, "%s:%d, rank_list %p, removed "
-				"identical rank[%d](%d).\n", __FILE__, __LINE__,
-				rank_list, i, rank_tmp);
-		}
-		rank_tmp = rank_list->rl_ranks[i];
+	for (i = 1, j = 1; i < rank_num; i++) {
+		if (rank_list->rl_ranks[i] == rank_list->rl_ranks[j - 1])
+			continue;
+		rank_list->rl_ranks[j++] = rank_list->rl_ranks[i];
 	}
+	identical_num = rank_num - j;
 	if (identical_num != 0) {
 		rank_list->rl_nr -= identical_num;
 		D_DEBUG(DB_TRACE, "%s:%d, rank_list %p, removed %d ranks.\n",
@@ -141,9 +136,11 @@ void
 d_rank_list_filter(d_rank_list_t *src_set, d_rank_list_t *dst_set,
 		   bool exclude)
 {
-	d_rank_t	rank;
-	uint32_t	rank_num, filter_num;
-	int		i, j;
+	struct d_rank_set	rs;
+	bool			use_set;
+	d_rank_t		rank;
+	uint32_t		rank_num, filter_num;
+	int			i, j;
 
 	if (src_set == NULL || dst_set == NULL)
 		return;
@@ -154,20 +151,33 @@ d_rank_list_filter(d_rank_list_t *src_set, d_rank_list_t *dst_set,
 	if (rank_num == 0)
 		return;
 
-	filter_num = 0;
-	for (i = 0; i < rank_num - filter_num; i++) {
+	/*
+	 * Test the membership in a rank set unless src_set is short, falls
+	 * back to the scans if the set cannot be built.
+	 */
+	use_set = src_set->rl_nr > D_RANK_LIST_SCAN_MAX &&
+		  d_rank_set_init(&rs, 0) == 0;
+	if (use_set && d_rank_set_add_list(&rs, src_set) != 0) {
+		d_rank_set_fini(&rs);
+		use_set = false;
+	}
+
+	/* keep the ranks in place, in one pass */
+	for (i = 0, j = 0; i < rank_num; i++) {
 		rank = dst_set->rl_ranks[i];
-		if (d_rank_in_rank_list(src_set, rank) != exclude)
+		if ((use_set ? d_rank_set_has(&rs, rank) :
+			       d_rank_in_rank_list(src_set, rank)) == exclude) {
+			D_DEBUG(DB_TRACE, "%s:%d, rank_list %p, filter "
+				"rank[%d](%d).\n", __FILE__, __LINE__,
+				dst_set, i, rank);
 			continue;
-		filter_num++;
-		for (j = i; j < rank_num - 1; j++)
-			dst_set->rl_ranks[j] =
-				dst_set->rl_ranks[j + 1];
-		D_DEBUG(DB_TRACE, "%s:%d, rank_list %p, filter rank[%d](%d).\n",
-			__FILE__, __LINE__, dst_set, i, rank);
-		/* as dst_set moved one item ahead */
-		i--;
+		}
+		dst_set->rl_ranks[j++] = rank;
 	}
+	if (use_set)
+		d_rank_set_fini(&rs);
+
+	filter_num = rank_num - j;
 	if (filter_num != 0) {
 		dst_set->rl_nr -= filter_num;
 		D_DEBUG(DB_TRACE, "%s:%d, rank_list %p, filter %d ranks.\n",
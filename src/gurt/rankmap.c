@@ -0,0 +1,133 @@
+/* Copyright (C) 2018 Intel Corporation
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted for any purpose (including commercial purposes)
+ * provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions, and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions, and the following disclaimer in the
+ *    documentation and/or materials provided with the distribution.
+ *
+ * 3. In addition, redistributions of modified forms of the source or binary
+ *    code must carry prominent notices stating that the original code was
+ *    changed and the date of the change.
+ *
+ *  4. All publications or advertising materials mentioning features or use of
+ *     this software are asked, but not required, to acknowledge that it was
+ *     developed by Intel Corporation and credit the contributors.
+ *
+ * 5. Neither the name of Intel Corporation, nor the name of any Contributor
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+/**
+ * This file is part of gurt, it implements the gurt rank map functions.
+ */
+
+#include <gurt/common.h>
+#include <gurt/rankmap.h>
+
+/* the initial # slots */
+#define D_RANK_MAP_MIN_SIZE	(64)
+
+int
+d_rank_map_init(struct d_rank_map *rm, uint32_t max)
+{
+	if (rm == NULL || max == 0) {
+		D_ERROR("invalid parameter, rm %p, max %u.\n", rm, max);
+		return -DER_INVAL;
+	}
+
+	rm->rm_array = NULL;
+	D_INIT_LIST_HEAD(&rm->rm_retired);
+	rm->rm_max = max;
+
+	return 0;
+}
+
+void
+d_rank_map_fini(struct d_rank_map *rm)
+{
+	struct d_rank_map_array	*rma;
+
+	if (rm == NULL) {
+		D_ERROR("ignore invalid parameter of NULL rank map.\n");
+		return;
+	}
+
+	while ((rma = d_list_pop_entry(&rm->rm_retired,
+				       struct d_rank_map_array, rma_link)))
+		D_FREE(rma);
+	D_FREE(rm->rm_array);
+}
+
+static int
+d_rank_map_grow(struct d_rank_map *rm, d_rank_t rank)
+{
+	struct d_rank_map_array	*old = rm->rm_array;
+	struct d_rank_map_array	*rma;
+	uint64_t		 size;
+
+	size = (old == NULL) ? D_RANK_MAP_MIN_SIZE : (uint64_t)old->rma_size;
+	while (size <= rank)
+		size <<= 1;
+	if (size > rm->rm_max)
+		size = rm->rm_max;
+	D_ASSERT(size > rank);
+
+	D_ALLOC(rma, sizeof(*rma) + size * sizeof(rma->rma_ptrs[0]));
+	if (rma == NULL)
+		return -DER_NOMEM;
+
+	D_INIT_LIST_HEAD(&rma->rma_link);
+	rma->rma_size = size;
+	if (old != NULL) {
+		memcpy(rma->rma_ptrs, old->rma_ptrs,
+		       old->rma_size * sizeof(old->rma_ptrs[0]));
+		/* lockless lookups may still be reading it */
+		d_list_add(&old->rma_link, &rm->rm_retired);
+	}
+
+	/* publish the copied slots along with the new array */
+	__atomic_store_n(&rm->rm_array, rma, __ATOMIC_RELEASE);
+
+	return 0;
+}
+
+int
+d_rank_map_set(struct d_rank_map *rm, d_rank_t rank, void *ptr)
+{
+	int	rc;
+
+	D_ASSERT(rm != NULL);
+
+	if (rank >= rm->rm_max)
+		return -DER_OVERFLOW;
+
+	if (rm->rm_array == NULL || rank >= rm->rm_array->rma_size) {
+		if (ptr == NULL)
+			return 0;
+		rc = d_rank_map_grow(rm, rank);
+		if (rc != 0)
+			return rc;
+	}
+
+	__atomic_store_n(&rm->rm_array->rma_ptrs[rank], ptr, __ATOMIC_RELEASE);
+
+	return 0;
+}
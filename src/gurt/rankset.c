@@ -0,0 +1,383 @@
+/* Copyright (C) 2018 Intel Corporation
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted for any purpose (including commercial purposes)
+ * provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions, and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions, and the following disclaimer in the
+ *    documentation and/or materials provided with the distribution.
+ *
+ * 3. In addition, redistributions of modified forms of the source or binary
+ *    code must carry prominent notices stating that the original code was
+ *    changed and the date of the change.
+ *
+ *  4. All publications or advertising materials mentioning features or use of
+ *     this software are asked, but not required, to acknowledge that it was
+ *     developed by Intel Corporation and credit the contributors.
+ *
+ * 5. Neither the name of Intel Corporation, nor the name of any Contributor
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+/**
+ * This file is part of gurt, it implements the gurt rank set functions.
+ */
+
+#include <gurt/common.h>
+#include <gurt/rankset.h>
+
+/* the initial # words */
+#define D_RANK_SET_MIN_WORDS	(4)
+
+#define D_RANK_SET_WORDS(size)	(((size) + 63) / 64)
+
+int
+d_rank_set_init(struct d_rank_set *rs, uint32_t size)
+{
+	if (rs == NULL || size > D_RANK_SET_MAX) {
+		D_ERROR("invalid parameter, rs %p, size %u.\n", rs, size);
+		return -DER_INVAL;
+	}
+
+	memset(rs, 0, sizeof(*rs));
+	if (size == 0)
+		return 0;
+
+	rs->rs_nwords = D_RANK_SET_WORDS(size);
+	D_ALLOC_ARRAY(rs->rs_bits, rs->rs_nwords);
+	if (rs->rs_bits == NULL) {
+		rs->rs_nwords = 0;
+		return -DER_NOMEM;
+	}
+
+	return 0;
+}
+
+void
+d_rank_set_fini(struct d_rank_set *rs)
+{
+	if (rs == NULL) {
+		D_ERROR("ignore invalid parameter of NULL rank set.\n");
+		return;
+	}
+
+	D_FREE(rs->rs_bits);
+	D_FREE(rs->rs_idx);
+	rs->rs_nwords = 0;
+	rs->rs_nr = 0;
+	rs->rs_idx_valid = false;
+}
+
+/* grow the bitmap to hold nwords words */
+static int
+d_rank_set_grow(struct d_rank_set *rs, uint32_t nwords)
+{
+	uint64_t	*bits;
+	uint32_t	 size;
+
+	if (nwords <= rs->rs_nwords)
+		return 0;
+
+	size = max(rs->rs_nwords, D_RANK_SET_MIN_WORDS);
+	while (size < nwords)
+		size <<= 1;
+	size = min(size, D_RANK_SET_WORDS(D_RANK_SET_MAX));
+
+	D_REALLOC_ARRAY(bits, rs->rs_bits, size);
+	if (bits == NULL)
+		return -DER_NOMEM;
+	memset(bits + rs->rs_nwords, 0,
+	       (size - rs->rs_nwords) * sizeof(*bits));
+
+	rs->rs_bits = bits;
+	rs->rs_nwords = size;
+	/* reallocated on the next index query */
+	D_FREE(rs->rs_idx);
+	rs->rs_idx_valid = false;
+
+	return 0;
+}
+
+int
+d_rank_set_add(struct d_rank_set *rs, d_rank_t rank)
+{
+	uint64_t	bit;
+	int		rc;
+
+	D_ASSERT(rs != NULL);
+
+	if (rank >= D_RANK_SET_MAX)
+		return -DER_OVERFLOW;
+
+	rc = d_rank_set_grow(rs, rank / 64 + 1);
+	if (rc != 0)
+		return rc;
+
+	bit = 1ULL << (rank % 64);
+	if (rs->rs_bits[rank / 64] & bit)
+		return 0;
+
+	rs->rs_bits[rank / 64] |= bit;
+	rs->rs_nr++;
+	rs->rs_idx_valid = false;
+
+	return 0;
+}
+
+void
+d_rank_set_del(struct d_rank_set *rs, d_rank_t rank)
+{
+	uint64_t	bit;
+
+	D_ASSERT(rs != NULL);
+
+	if (!d_rank_set_has(rs, rank))
+		return;
+
+	bit = 1ULL << (rank % 64);
+	rs->rs_bits[rank / 64] &= ~bit;
+	rs->rs_nr--;
+	rs->rs_idx_valid = false;
+}
+
+/* rebuild the per-word prefix count if a change invalidated it */
+static int
+d_rank_set_idx_build(struct d_rank_set *rs)
+{
+	uint32_t	count = 0;
+	uint32_t	i;
+
+	if (rs->rs_idx_valid)
+		return 0;
+
+	if (rs->rs_idx == NULL && rs->rs_nwords != 0) {
+		D_ALLOC_ARRAY(rs->rs_idx, rs->rs_nwords);
+		if (rs->rs_idx == NULL)
+			return -DER_NOMEM;
+	}
+
+	for (i = 0; i < rs->rs_nwords; i++) {
+		rs->rs_idx[i] = count;
+		count += __builtin_popcountll(rs->rs_bits[i]);
+	}
+	D_ASSERT(count == rs->rs_nr);
+	rs->rs_idx_valid = true;
+
+	return 0;
+}
+
+int
+d_rank_set_idx(struct d_rank_set *rs, d_rank_t rank, uint32_t *idx)
+{
+	uint64_t	mask;
+	int		rc;
+
+	D_ASSERT(rs != NULL && idx != NULL);
+
+	if (!d_rank_set_has(rs, rank))
+		return -DER_NONEXIST;
+
+	rc = d_rank_set_idx_build(rs);
+	if (rc != 0)
+		return rc;
+
+	mask = (1ULL << (rank % 64)) - 1;
+	*idx = rs->rs_idx[rank / 64] +
+	       __builtin_popcountll(rs->rs_bits[rank / 64] & mask);
+
+	return 0;
+}
+
+int
+d_rank_set_nth(struct d_rank_set *rs, uint32_t idx, d_rank_t *rank)
+{
+	uint64_t	word;
+	uint32_t	lo, hi, mid;
+	uint32_t	n;
+	int		rc;
+
+	D_ASSERT(rs != NULL && rank != NULL);
+
+	if (idx >= rs->rs_nr)
+		return -DER_NONEXIST;
+
+	rc = d_rank_set_idx_build(rs);
+	if (rc != 0)
+		return rc;
+
+	/* the last word whose prefix count is <= idx */
+	lo = 0;
+	hi = rs->rs_nwords - 1;
+	while (lo < hi) {
+		mid = lo + (hi - lo + 1) / 2;
+		if (rs->rs_idx[mid] <= idx)
+			lo = mid;
+		else
+			hi = mid - 1;
+	}
+
+	/* clear the lower set bits until the one at idx */
+	word = rs->rs_bits[lo];
+	for (n = idx - rs->rs_idx[lo]; n > 0; n--)
+		word &= word - 1;
+	D_ASSERT(word != 0);
+	*rank = lo * 64 + __builtin_ctzll(word);
+
+	return 0;
+}
+
+/* recount after a set operation */
+static void
+d_rank_set_recount(struct d_rank_set *rs)
+{
+	uint32_t	count = 0;
+	uint32_t	i;
+
+	for (i = 0; i < rs->rs_nwords; i++)
+		count += __builtin_popcountll(rs->rs_bits[i]);
+	rs->rs_nr = count;
+	rs->rs_idx_valid = false;
+}
+
+/*
+ * The set operations below run on whole words, 64 ranks at a time, in simple
+ * loops the compiler can vectorize.
+ */
+int
+d_rank_set_union(struct d_rank_set *dst, const struct d_rank_set *src)
+{
+	uint64_t	*restrict d;
+	const uint64_t	*restrict s;
+	uint32_t	 nwords;
+	uint32_t	 i;
+	int		 rc;
+
+	D_ASSERT(dst != NULL && src != NULL && dst != src);
+
+	/* ignore the trailing empty words of src */
+	for (nwords = src->rs_nwords; nwords > 0; nwords--)
+		if (src->rs_bits[nwords - 1] != 0)
+			break;
+
+	rc = d_rank_set_grow(dst, nwords);
+	if (rc != 0)
+		return rc;
+
+	d = dst->rs_bits;
+	s = src->rs_bits;
+	for (i = 0; i < nwords; i++)
+		d[i] |= s[i];
+	d_rank_set_recount(dst);
+
+	return 0;
+}
+
+void
+d_rank_set_diff(struct d_rank_set *dst, const struct d_rank_set *src)
+{
+	uint64_t	*restrict d;
+	const uint64_t	*restrict s;
+	uint32_t	 nwords;
+	uint32_t	 i;
+
+	D_ASSERT(dst != NULL && src != NULL && dst != src);
+
+	d = dst->rs_bits;
+	s = src->rs_bits;
+	nwords = min(dst->rs_nwords, src->rs_nwords);
+	for (i = 0; i < nwords; i++)
+		d[i] &= ~s[i];
+	d_rank_set_recount(dst);
+}
+
+void
+d_rank_set_intersect(struct d_rank_set *dst, const struct d_rank_set *src)
+{
+	uint64_t	*restrict d;
+	const uint64_t	*restrict s;
+	uint32_t	 nwords;
+	uint32_t	 i;
+
+	D_ASSERT(dst != NULL && src != NULL && dst != src);
+
+	d = dst->rs_bits;
+	s = src->rs_bits;
+	nwords = min(dst->rs_nwords, src->rs_nwords);
+	for (i = 0; i < nwords; i++)
+		d[i] &= s[i];
+	if (dst->rs_nwords > nwords)
+		memset(d + nwords, 0,
+		       (dst->rs_nwords - nwords) * sizeof(*d));
+	d_rank_set_recount(dst);
+}
+
+int
+d_rank_set_add_list(struct d_rank_set *rs, const d_rank_list_t *list)
+{
+	d_rank_t	max_rank = 0;
+	uint32_t	i;
+	int		rc;
+
+	D_ASSERT(rs != NULL);
+
+	if (list == NULL || list->rl_nr == 0)
+		return 0;
+
+	/* grow once */
+	for (i = 0; i < list->rl_nr; i++)
+		max_rank = max(max_rank, list->rl_ranks[i]);
+	if (max_rank >= D_RANK_SET_MAX)
+		return -DER_OVERFLOW;
+	rc = d_rank_set_grow(rs, max_rank / 64 + 1);
+	if (rc != 0)
+		return rc;
+
+	for (i = 0; i < list->rl_nr; i++) {
+		rc = d_rank_set_add(rs, list->rl_ranks[i]);
+		D_ASSERT(rc == 0);
+	}
+
+	return 0;
+}
+
+int
+d_rank_set_to_list(const struct d_rank_set *rs, d_rank_list_t **list)
+{
+	d_rank_list_t	*rank_list;
+	uint64_t	 word;
+	uint32_t	 n = 0;
+	uint32_t	 i;
+
+	D_ASSERT(rs != NULL && list != NULL);
+
+	rank_list = d_rank_list_alloc(rs->rs_nr);
+	if (rank_list == NULL)
+		return -DER_NOMEM;
+
+	for (i = 0; i < rs->rs_nwords && n < rs->rs_nr; i++) {
+		/* walk the set bits only */
+		for (word = rs->rs_bits[i]; word != 0; word &= word - 1)
+			rank_list->rl_ranks[n++] = i * 64 +
+						   __builtin_ctzll(word);
+	}
+	D_ASSERT(n == rs->rs_nr);
+
+	*list = rank_list;
+	return 0;
+}
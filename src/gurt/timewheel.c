@@ -0,0 +1,258 @@
+/* Copyright (C) 2018 Intel Corporation
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted for any purpose (including commercial purposes)
+ * provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions, and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions, and the following disclaimer in the
+ *    documentation and/or materials provided with the distribution.
+ *
+ * 3. In addition, redistributions of modified forms of the source or binary
+ *    code must carry prominent notices stating that the original code was
+ *    changed and the date of the change.
+ *
+ *  4. All publications or advertising materials mentioning features or use of
+ *     this software are asked, but not required, to acknowledge that it was
+ *     developed by Intel Corporation and credit the contributors.
+ *
+ * 5. Neither the name of Intel Corporation, nor the name of any Contributor
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+/**
+ * This file is part of gurt, it implements the gurt timing wheel functions.
+ */
+
+#include <gurt/common.h>
+#include <gurt/timewheel.h>
+
+int
+d_timewheel_create_inplace(uint64_t tick_us, uint64_t now,
+			   struct d_timewheel *tw)
+{
+	int	i, j;
+
+	if (tw == NULL) {
+		D_ERROR("invalid parameter of NULL timing wheel pointer.\n");
+		return -DER_INVAL;
+	}
+	if (tick_us == 0) {
+		D_ERROR("invalid parameter of zero tick length.\n");
+		return -DER_INVAL;
+	}
+
+	for (i = 0; i < DTW_LEVELS; i++)
+		for (j = 0; j < DTW_LEVEL_SIZE; j++)
+			D_INIT_LIST_HEAD(&tw->tw_slots[i][j]);
+	D_INIT_LIST_HEAD(&tw->tw_expired);
+	D_INIT_LIST_HEAD(&tw->tw_overflow);
+	tw->tw_tick_us = tick_us;
+	tw->tw_cur = now / tick_us;
+	tw->tw_count = 0;
+
+	return 0;
+}
+
+void
+d_timewheel_destroy_inplace(struct d_timewheel *tw)
+{
+	d_list_t	expired_list;
+
+	if (tw == NULL) {
+		D_ERROR("ignore invalid parameter of NULL timing wheel.\n");
+		return;
+	}
+
+	if (tw->tw_count != 0) {
+		D_DEBUG(DB_TRACE, "timing wheel %p destroyed with %u nodes.\n",
+			tw, tw->tw_count);
+		/* detach all the remaining nodes */
+		D_INIT_LIST_HEAD(&expired_list);
+		d_timewheel_expire(tw, UINT64_MAX, &expired_list);
+		while (!d_list_empty(&expired_list))
+			d_list_del_init(expired_list.next);
+	}
+
+	tw->tw_count = 0;
+}
+
+/* place the node in the slot covering its expiry tick */
+static void
+dtw_node_add(struct d_timewheel *tw, struct d_tw_node *n)
+{
+	uint64_t	tick = n->tn_tick;
+	uint32_t	slot;
+	int		shift;
+	int		lvl;
+
+	if (tick <= tw->tw_cur) {
+		d_list_add_tail(&n->tn_link, &tw->tw_expired);
+		return;
+	}
+
+	for (lvl = 0; lvl < DTW_LEVELS; lvl++) {
+		shift = DTW_LEVEL_BITS * (lvl + 1);
+		if ((tick >> shift) != (tw->tw_cur >> shift))
+			continue;
+
+		slot = (tick >> (DTW_LEVEL_BITS * lvl)) & DTW_LEVEL_MASK;
+		d_list_add_tail(&n->tn_link, &tw->tw_slots[lvl][slot]);
+		return;
+	}
+
+	d_list_add_tail(&n->tn_link, &tw->tw_overflow);
+}
+
+/* re-place all nodes of \a list, they move to the lower levels */
+static void
+dtw_cascade(struct d_timewheel *tw, d_list_t *list)
+{
+	struct d_tw_node	*n;
+	d_list_t		 tmp_list;
+
+	if (d_list_empty(list))
+		return;
+
+	D_INIT_LIST_HEAD(&tmp_list);
+	d_list_splice_init(list, &tmp_list);
+	while ((n = d_list_pop_entry(&tmp_list, struct d_tw_node, tn_link)))
+		dtw_node_add(tw, n);
+}
+
+void
+d_timewheel_insert(struct d_timewheel *tw, struct d_tw_node *n,
+		   uint64_t expire)
+{
+	D_ASSERT(tw != NULL && n != NULL);
+
+	/* round up, so the node never expires before \a expire */
+	n->tn_tick = expire / tw->tw_tick_us;
+	if (expire % tw->tw_tick_us != 0)
+		n->tn_tick++;
+
+	dtw_node_add(tw, n);
+	tw->tw_count++;
+}
+
+void
+d_timewheel_remove(struct d_timewheel *tw, struct d_tw_node *n)
+{
+	D_ASSERT(tw != NULL && n != NULL);
+	D_ASSERT(tw->tw_count > 0);
+
+	d_list_del_init(&n->tn_link);
+	tw->tw_count--;
+}
+
+static inline int
+dtw_expire_list(struct d_timewheel *tw, d_list_t *list, d_list_t *expired_list)
+{
+	int	count = 0;
+
+	while (!d_list_empty(list)) {
+		d_list_move_tail(list->next, expired_list);
+		count++;
+	}
+	D_ASSERT(tw->tw_count >= count);
+	tw->tw_count -= count;
+
+	return count;
+}
+
+int
+d_timewheel_expire(struct d_timewheel *tw, uint64_t now,
+		   d_list_t *expired_list)
+{
+	uint64_t	now_tick;
+	uint64_t	cur;
+	uint32_t	slot;
+	int		lvl;
+	int		count = 0;
+
+	D_ASSERT(tw != NULL && expired_list != NULL);
+
+	count += dtw_expire_list(tw, &tw->tw_expired, expired_list);
+
+	now_tick = now / tw->tw_tick_us;
+	while (tw->tw_cur < now_tick) {
+		/* nothing to cascade or expire, jump to now */
+		if (tw->tw_count == 0) {
+			tw->tw_cur = now_tick;
+			break;
+		}
+
+		cur = ++tw->tw_cur;
+
+		/* crossed the span of the top level */
+		if ((cur & ((1ULL << (DTW_LEVEL_BITS * DTW_LEVELS)) - 1)) == 0)
+			dtw_cascade(tw, &tw->tw_overflow);
+
+		for (lvl = DTW_LEVELS - 1; lvl > 0; lvl--) {
+			if ((cur & ((1ULL << (DTW_LEVEL_BITS * lvl)) - 1)) != 0)
+				continue;
+			slot = (cur >> (DTW_LEVEL_BITS * lvl)) & DTW_LEVEL_MASK;
+			dtw_cascade(tw, &tw->tw_slots[lvl][slot]);
+		}
+
+		count += dtw_expire_list(tw, &tw->tw_slots[0][cur &
+							   DTW_LEVEL_MASK],
+					 expired_list);
+		/* cascaded nodes expiring right at cur */
+		count += dtw_expire_list(tw, &tw->tw_expired, expired_list);
+	}
+
+	return count;
+}
+
+uint64_t
+d_timewheel_next(struct d_timewheel *tw)
+{
+	uint64_t	tick;
+	uint32_t	slot;
+	int		shift;
+	int		lvl;
+
+	D_ASSERT(tw != NULL);
+
+	if (tw->tw_count == 0)
+		return UINT64_MAX;
+	if (!d_list_empty(&tw->tw_expired))
+		return tw->tw_cur * tw->tw_tick_us;
+
+	/*
+	 * the nodes of a level are beyond the slots of the current tick in that
+	 * level, and before any node of the upper levels
+	 */
+	for (lvl = 0; lvl < DTW_LEVELS; lvl++) {
+		shift = DTW_LEVEL_BITS * lvl;
+		for (slot = ((tw->tw_cur >> shift) & DTW_LEVEL_MASK) + 1;
+		     slot < DTW_LEVEL_SIZE; slot++) {
+			if (d_list_empty(&tw->tw_slots[lvl][slot]))
+				continue;
+			tick = (tw->tw_cur >> (shift + DTW_LEVEL_BITS)) <<
+			       (shift + DTW_LEVEL_BITS);
+			return (tick | ((uint64_t)slot << shift)) *
+			       tw->tw_tick_us;
+		}
+	}
+
+	/* only overflow nodes, they are beyond the span of the top level */
+	shift = DTW_LEVEL_BITS * DTW_LEVELS;
+	return ((tw->tw_cur >> shift) + 1) * (1ULL << shift) * tw->tw_tick_us;
+}
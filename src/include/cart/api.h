@@ -46,6 +46,7 @@
 #ifndef __CRT_API_H__
 #define __CRT_API_H__
 
+#include <stddef.h>
 #include <stdint.h>
 #include <string.h>
 #include <stdbool.h>
@@ -250,6 +251,120 @@ int
 crt_progress(crt_context_t crt_ctx, int64_t timeout,
 	     crt_progress_cond_cb_t cond_cb, void *arg);
 
+/**
+ * Create an empty set of contexts to be progressed together by one thread with
+ * crt_progress_set().
+ *
+ * \param[out] set             the created set
+ *
+ * \return                     DER_SUCCESS on success, negative value if error
+ */
+int
+crt_progress_set_create(crt_progress_set_t *set);
+
+/**
+ * Destroy a progress set, the contexts in it are not affected.
+ *
+ * \param[in] set              the set
+ *
+ * \return                     DER_SUCCESS on success, negative value if error
+ */
+int
+crt_progress_set_destroy(crt_progress_set_t set);
+
+/**
+ * Add a context to a progress set. A set is not thread-safe, it should only
+ * be changed while no thread is progressing it.
+ *
+ * \param[in] set              the set
+ * \param[in] crt_ctx          the context to add
+ *
+ * \return                     DER_SUCCESS on success, -DER_EXIST if already
+ *                             in the set, negative value if other error
+ */
+int
+crt_progress_set_add(crt_progress_set_t set, crt_context_t crt_ctx);
+
+/**
+ * Remove a context from a progress set, e.g. before destroying the context.
+ *
+ * \param[in] set              the set
+ * \param[in] crt_ctx          the context to remove
+ *
+ * \return                     DER_SUCCESS on success, -DER_NONEXIST if not in
+ *                             the set, negative value if other error
+ */
+int
+crt_progress_set_del(crt_progress_set_t set, crt_context_t crt_ctx);
+
+/**
+ * Progress all the contexts of a set from the calling thread. Every round
+ * checks the RPC timeouts of each context once and progresses the network of
+ * the contexts with pending work, starting from a different context in each
+ * round so that none of them is favoured. When all the contexts provide a
+ * wait fd (see crt_context_get_wait_fd()) the idle ones are skipped and the
+ * thread sleeps until one of them has work, otherwise all of them are polled
+ * and the wait is spent on each context in turn.
+ *
+ * \param[in] set              the set
+ * \param[in] timeout          same as for crt_progress()
+ * \param[in] cond_cb          optional progress condition callback, called
+ *                             once per round
+ * \param[in] arg              argument to cond_cb
+ *
+ * \return                     DER_SUCCESS on success, -DER_TIMEDOUT if
+ *                             nothing progressed before \a timeout, negative
+ *                             value if other error
+ */
+int
+crt_progress_set(crt_progress_set_t set, int64_t timeout,
+		 crt_progress_cond_cb_t cond_cb, void *arg);
+
+/**
+ * Get a file descriptor which becomes readable when the context has work to
+ * progress, to integrate CaRT into an external poll/epoll loop. Once it is
+ * readable the caller should call crt_progress() with a zero timeout. The fd
+ * must not be read or closed by the caller. As RPC timeouts are not
+ * signalled through the fd, the caller should not wait longer than returned
+ * by crt_context_get_wait_timeout().
+ *
+ * When the env CRT_PROGRESS_BLOCKING is set, crt_progress() with a cond_cb
+ * sleeps on this fd instead of polling when there is nothing to progress.
+ *
+ * \param[in] crt_ctx          CRT transport context
+ * \param[out] fd              the wait fd
+ *
+ * \return                     DER_SUCCESS on success, -DER_NOSYS if the
+ *                             transport provides no wait fd
+ */
+int
+crt_context_get_wait_fd(crt_context_t crt_ctx, int *fd);
+
+/**
+ * Get the time until the next RPC timeout of the context, or for context 0 of
+ * a server, the next step deadline of a collective (see crt_allgather()).
+ *
+ * \param[in] crt_ctx          CRT transport context
+ * \param[out] timeout         micro-seconds until the next timeout (a lower
+ *                             bound), -1 if none
+ *
+ * \return                     DER_SUCCESS on success, negative value if error
+ */
+int
+crt_context_get_wait_timeout(crt_context_t crt_ctx, int64_t *timeout);
+
+/**
+ * Make the wait fd of the context readable, waking up a thread sleeping on
+ * it, e.g. after changing the state checked by the cond_cb of a blocking
+ * crt_progress() call. Can be called from any thread.
+ *
+ * \param[in] crt_ctx          CRT transport context
+ *
+ * \return                     DER_SUCCESS on success, negative value if error
+ */
+int
+crt_context_wakeup(crt_context_t crt_ctx);
+
 /**
  * Create an RPC request.
  *
@@ -666,6 +781,52 @@ int
 crt_context_register_rpc_task(crt_context_t crt_ctx,
 			      crt_rpc_task_t rpc_cb, void *arg);
 
+/**
+ * Run the RPC handlers of this context in a pool of worker threads instead of
+ * the thread calling crt_progress(), so that a slow handler does not stall
+ * the network progress. RPCs are spread over per-worker queues and idle
+ * workers steal from the busiest ones. Replies sent by the handlers through
+ * crt_reply_send() are passed back to and sent by the progressing thread.
+ * Internal RPCs are still handled inline. Cannot be combined with
+ * crt_context_register_rpc_task(), and should be called before progressing
+ * the context. The pool is stopped by crt_context_destroy().
+ *
+ * \param[in] crt_ctx          The context.
+ * \param[in] nworkers         Number of worker threads.
+ *
+ * \return                     DER_SUCCESS on success, negative value if error.
+ */
+int
+crt_context_handler_pool_create(crt_context_t crt_ctx, unsigned int nworkers);
+
+/**
+ * Query the per-worker statistics of the handler pool of a context.
+ *
+ * \param[in] crt_ctx          The context.
+ * \param[out] stats           Array of \a nr entries filled in per worker.
+ * \param[in,out] nr           Size of \a stats on input, number of workers on
+ *                             output.
+ *
+ * \return                     DER_SUCCESS on success, -DER_NONEXIST if the
+ *                             context has no handler pool.
+ */
+int
+crt_context_handler_pool_stats(crt_context_t crt_ctx,
+			       struct crt_handler_pool_stats *stats,
+			       unsigned int *nr);
+
+/**
+ * Query the reply aggregation statistics of the collective RPCs handled by a
+ * context, i.e. the time spent in the co_aggregate callbacks.
+ *
+ * \param[in] crt_ctx          The context.
+ * \param[out] stats           The statistics.
+ *
+ * \return                     DER_SUCCESS on success, negative value if error.
+ */
+int
+crt_context_corpc_stats(crt_context_t crt_ctx, struct crt_corpc_stats *stats);
+
 /**
  * Dynamically register an RPC with features at server-side.
  *
@@ -867,7 +1028,12 @@ enum crt_tree_type {
 	CRT_TREE_FLAT		= 1,
 	CRT_TREE_KARY		= 2,
 	CRT_TREE_KNOMIAL	= 3,
-	CRT_TREE_MAX		= 3,
+	/*
+	 * knomial tree over one leader per node, then a knomial tree within
+	 * each node, see crt_group_locality_set()
+	 */
+	CRT_TREE_LOCALITY	= 4,
+	CRT_TREE_MAX		= 4,
 };
 
 #define CRT_TREE_TYPE_SHIFT	(16U)
@@ -897,6 +1063,28 @@ crt_tree_topo(enum crt_tree_type tree_type, uint32_t branch_ratio)
 	       (branch_ratio & ((1U << CRT_TREE_TYPE_SHIFT) - 1));
 }
 
+/** built-in reduction operations, see crt_reduce() */
+enum crt_reduce_op {
+	CRT_REDUCE_NONE		= 0,
+	CRT_REDUCE_SUM		= 1,
+	CRT_REDUCE_MIN		= 2,
+	CRT_REDUCE_MAX		= 3,
+	/** bitwise and, integer types only */
+	CRT_REDUCE_BAND		= 4,
+	/** bitwise or, integer types only */
+	CRT_REDUCE_BOR		= 5,
+	CRT_REDUCE_OP_MAX	= 5,
+};
+
+/** element types of the built-in reductions */
+enum crt_reduce_type {
+	CRT_REDUCE_INT32	= 0,
+	CRT_REDUCE_INT64	= 1,
+	CRT_REDUCE_UINT64	= 2,
+	CRT_REDUCE_DOUBLE	= 3,
+	CRT_REDUCE_TYPE_MAX	= 3,
+};
+
 struct crt_corpc_ops {
 	/**
 	 * collective RPC reply aggregating callback.
@@ -928,8 +1116,53 @@ struct crt_corpc_ops {
 	 *				cause CORPC to abort.
 	 */
 	int (*co_pre_forward)(crt_rpc_t *rpc, void *arg);
+
+	/**
+	 * Built-in reduction used as the aggregating callback when
+	 * co_aggregate is NULL, set by CRT_CORPC_REDUCE().
+	 *
+	 * The d_iov_t output field at offset co_reduce_off holds an array of
+	 * co_reduce_type elements, the array of each reply is reduced with
+	 * co_reduce_op into the one of the result. All replies should carry
+	 * arrays of the same length.
+	 */
+	enum crt_reduce_op	co_reduce_op;
+	enum crt_reduce_type	co_reduce_type;
+	uint32_t		co_reduce_off;
 };
 
+/**
+ * Initializer of the built-in reduction of a crt_corpc_ops, e.g.
+ *
+ *	struct crt_corpc_ops sum_ops = {
+ *		CRT_CORPC_REDUCE(CRT_REDUCE_SUM, CRT_REDUCE_DOUBLE, my_rpc, vec)
+ *	};
+ *
+ * reduces the d_iov_t field vec of struct my_rpc_out (see CRT_RPC_DECLARE)
+ * as arrays of double by sum.
+ */
+#define CRT_CORPC_REDUCE(op, type, rpc_name, field)			\
+	.co_reduce_op = (op),						\
+	.co_reduce_type = (type),					\
+	.co_reduce_off = offsetof(struct rpc_name##_out, field)
+
+/**
+ * Reduce an array into another one element-wise, with SIMD instructions
+ * where the CPU supports them.
+ *
+ * \param[in] op               reduction operation
+ * \param[in] type             element type
+ * \param[in,out] result       array reduced into
+ * \param[in] source           array reduced from
+ * \param[in] nr               number of elements of both arrays
+ *
+ * \return                     DER_SUCCESS on success, -DER_INVAL if the
+ *                             operation is not supported for the type.
+ */
+int
+crt_reduce(enum crt_reduce_op op, enum crt_reduce_type type, void *result,
+	   const void *source, size_t nr);
+
 /**
  * Group create completion callback
  *
@@ -1044,6 +1277,30 @@ crt_group_destroy(crt_group_t *grp, crt_grp_destroy_cb_t grp_destroy_cb,
 int
 crt_group_attach(crt_group_id_t srv_grpid, crt_group_t **attached_grp);
 
+/**
+ * Prefetch the URIs of all ranks of an attached service group into the
+ * address cache.
+ *
+ * The URIs are fetched from the PSR of the group, up to 1024 ranks per RPC,
+ * so that sending to a rank for the first time does not need to look up its
+ * URI. Ranks whose URI the PSR does not know are still looked up on first
+ * contact. It is done automatically by crt_group_attach() if the
+ * CRT_ATTACH_PREFETCH environment variable is set.
+ *
+ * \param[in] crt_ctx          CaRT context to send the lookup RPCs through
+ * \param[in] grp              attached service group
+ * \param[in] tag              tag of the URIs to prefetch
+ * \param[in] complete_cb      optional completion callback, called with
+ *                             crt_cb_info::cci_rpc as NULL once all ranks
+ *                             were looked up or the prefetch failed
+ * \param[in] arg              optional arg for \a complete_cb
+ *
+ * \return                     DER_SUCCESS on success, negative value if error
+ */
+int
+crt_group_uri_prefetch(crt_context_t crt_ctx, crt_group_t *grp, uint32_t tag,
+		       crt_cb_t complete_cb, void *arg);
+
 /**
  * Set an alternative directory to store/retrieve group attach info
  *
@@ -1062,6 +1319,8 @@ crt_group_config_path_set(const char *path);
  * Dump the attach info for the specified group to a file. If not the local
  * primary service group, it must be an attached service group.
  * This must be invoked before any singleton can attach to the specified group.
+ * Along with the text file, a binary copy of the rank/URI table is saved which
+ * singletons map at attach time to fill their address cache.
  *
  * \param[in] grp              Primary service group attach info to save,
  *                             NULL indicates local primary group.
@@ -1209,6 +1468,99 @@ crt_corpc_register(crt_opcode_t opc, struct crt_req_format *drf,
 int
 crt_barrier(crt_group_t *grp, crt_barrier_cb_t complete_cb, void *cb_arg);
 
+/**
+ * Gather \a size bytes from every rank of the group into the receive buffer
+ * of every rank. Can only be called on the server side.
+ *
+ * All ranks of the group have to call it with the same \a size, in the same
+ * order relative to the other calls of crt_allgather(), crt_allreduce() and
+ * crt_reduce_scatter(). The buffers must stay valid until \a complete_cb is
+ * executed. The collective fails with -DER_TIMEDOUT if a step of it gets no
+ * payload within the RPC timeout, and with -DER_EVICTED if a member rank is
+ * evicted before it completes.
+ *
+ * \param[in] grp              CRT group handle. Only the primary service
+ *                             group is presently supported and it may be
+ *                             indicated by passing NULL.
+ * \param[in] alg              algorithm, see \a crt_coll_alg.
+ * \param[in] sendbuf          \a size bytes contributed by the caller
+ * \param[out] recvbuf         size * group size bytes, the contribution of
+ *                             the i-th live rank of the group in rank order
+ *                             (ranks can be sparse, see
+ *                             crt_group_node_add()) is stored at offset
+ *                             i * size
+ * \param[in] size             bytes contributed by each rank
+ * \param[in] complete_cb      Required callback to be executed when the
+ *                             collective is complete
+ * \param[in] cb_arg           Optional argument passed to completion callback
+ *
+ * \return                     DER_SUCCESS on success, negative value if error.
+ *                             If the collective fails after it is started,
+ *                             the completion callback is invoked with the
+ *                             error.
+ */
+int
+crt_allgather(crt_group_t *grp, enum crt_coll_alg alg, const void *sendbuf,
+	      void *recvbuf, size_t size, crt_coll_cb_t complete_cb,
+	      void *cb_arg);
+
+/**
+ * Reduce an array of \a nr elements element-wise over all ranks of the group,
+ * every rank gets the result. Can only be called on the server side.
+ *
+ * See crt_allgather() for the ordering and the buffer requirements.
+ *
+ * \param[in] grp              CRT group handle. Only the primary service
+ *                             group is presently supported and it may be
+ *                             indicated by passing NULL.
+ * \param[in] alg              algorithm, see \a crt_coll_alg.
+ * \param[in] op               reduction operation, see crt_reduce()
+ * \param[in] type             element type
+ * \param[in] sendbuf          array contributed by the caller
+ * \param[out] recvbuf         reduced array, can be \a sendbuf
+ * \param[in] nr               number of elements of the arrays
+ * \param[in] complete_cb      Required callback to be executed when the
+ *                             collective is complete
+ * \param[in] cb_arg           Optional argument passed to completion callback
+ *
+ * \return                     DER_SUCCESS on success, negative value if error
+ */
+int
+crt_allreduce(crt_group_t *grp, enum crt_coll_alg alg, enum crt_reduce_op op,
+	      enum crt_reduce_type type, const void *sendbuf, void *recvbuf,
+	      size_t nr, crt_coll_cb_t complete_cb, void *cb_arg);
+
+/**
+ * Reduce an array of nr * group size elements element-wise over all ranks of
+ * the group and scatter the result, the i-th live rank of the group in rank
+ * order gets the \a nr elements starting at element i * nr. Can only be
+ * called on the server side.
+ *
+ * See crt_allgather() for the ordering and the buffer requirements.
+ *
+ * \param[in] grp              CRT group handle. Only the primary service
+ *                             group is presently supported and it may be
+ *                             indicated by passing NULL.
+ * \param[in] alg              algorithm, see \a crt_coll_alg.
+ * \param[in] op               reduction operation, see crt_reduce()
+ * \param[in] type             element type
+ * \param[in] sendbuf          array of nr * group size elements contributed
+ *                             by the caller
+ * \param[out] recvbuf         \a nr elements, the caller's block of the
+ *                             reduced array
+ * \param[in] nr               number of elements of each block
+ * \param[in] complete_cb      Required callback to be executed when the
+ *                             collective is complete
+ * \param[in] cb_arg           Optional argument passed to completion callback
+ *
+ * \return                     DER_SUCCESS on success, negative value if error
+ */
+int
+crt_reduce_scatter(crt_group_t *grp, enum crt_coll_alg alg,
+		   enum crt_reduce_op op, enum crt_reduce_type type,
+		   const void *sendbuf, void *recvbuf, size_t nr,
+		   crt_coll_cb_t complete_cb, void *cb_arg);
+
 /**
  * Query the caller's rank number within group.
  *
@@ -1469,6 +1821,21 @@ crt_proc_d_rank_list_t(crt_proc_t proc, d_rank_list_t **data);
 int
 crt_proc_d_iov_t(crt_proc_t proc, d_iov_t *data);
 
+/**
+ * Processing routine of crt_iov_auto_t. On encoding the payload is inlined if
+ * it fits in the eager size of the transport, otherwise a bulk handle to it is
+ * sent instead and the target pulls the data before invoking the RPC handler.
+ * The bulk handle is created on the first encoding and released when the RPC
+ * is destroyed.
+ *
+ * \param[in,out] proc         abstract processor object
+ * \param[in,out] data         pointer to data
+ *
+ * \return                     DER_SUCCESS on success, negative value if error
+ */
+int
+crt_proc_crt_iov_auto_t(crt_proc_t proc, crt_iov_auto_t *data);
+
 /**
  * Local operation. Evict rank from the local membership list of grp.
  * \param[in] grp              Must be a primary service group. Can be local or
@@ -1691,6 +2058,57 @@ int
 crt_group_node_add(crt_group_t *group, d_rank_t rank, int tag,
 		crt_node_info_t info);
 
+/**
+ * Describe how the URIs of the ranks of a group derive from rank and tag.
+ * When a rank has no URI in the address cache, its URI is computed from the
+ * template instead of being looked up by RPC, so that contacting any rank of
+ * the group for the first time does not need a URI lookup. Ranks outside of
+ * the host table, and tags beyond ut_ports_per_rank, are looked up as usual.
+ * URIs added by \a crt_group_node_add() take precedence over the template.
+ *
+ * \param[in] group             The group handle
+ * \param[in] tmpl              The URI template, copied internally
+ *
+ * \return                      DER_SUCCESS on success, negative value on
+ *                              failure. -DER_EXIST if the group already has a
+ *                              template.
+ *
+ * \note                        This API is only available if PMIX is disabled.
+ *                              See CRT_FLAG_BIT_PMIX_DISABLE flag.
+ *
+ * \note                        Currently only primary group is supported
+ */
+int
+crt_group_uri_template_set(crt_group_t *group,
+			   const crt_uri_template_t *tmpl);
+
+/**
+ * Set the locality (node) of the ranks of a group, used to build the
+ * CRT_TREE_LOCALITY trees. Ranks with the same locality share a node.
+ * Without a locality map the node of a rank is taken from the URI template
+ * (see \a crt_group_uri_template_set()), or else from the host of its URI
+ * (PMIX disabled only). If the locality of any rank of a tree is unknown the
+ * tree is a plain knomial tree.
+ *
+ * The locality map must be the same on all ranks of the group, like the
+ * membership.
+ *
+ * \param[in] group             The group handle
+ * \param[in] locality          locality[i] is the locality of rank i,
+ *                              (uint32_t)-1 if unknown. Copied internally,
+ *                              NULL to clear the locality map.
+ * \param[in] nr                Number of entries in \a locality
+ *
+ * \return                      DER_SUCCESS on success, negative value on
+ *                              failure.
+ *
+ * \note                        Currently only primary service group is
+ *                              supported
+ */
+int
+crt_group_locality_set(crt_group_t *group, const uint32_t *locality,
+		       uint32_t nr);
+
 /**
  * Set self rank. This API is only available when PMIX is disabled. See \a
  * CRT_FLAG_BIT_PMIX_DISABLE for more details.
@@ -1757,6 +2175,9 @@ int crt_self_uri_get(int tag, char **uri);
  * Returned data in \a grp_info can be passed to crt_group_info_set
  * call in order to setup group on a different node.
  *
+ * The returned data is a snapshot of the group at its current version, see
+ * \a crt_group_info_ver_get().
+ *
  * \param[in] group             Group identifier
  * \param[in] grp_info          group info to be filled.
  *
@@ -1765,15 +2186,53 @@ int crt_self_uri_get(int tag, char **uri);
  */
 int crt_group_info_get(crt_group_t *group, d_iov_t *grp_info);
 
+/**
+ * Retrieve the changes of a group since version \a since_ver, to be passed to
+ * crt_group_info_set on a node which applied group info at that version.
+ *
+ * If the changes are too old to be known anymore, a snapshot is returned as
+ * by \a crt_group_info_get(), which crt_group_info_set applies as well.
+ *
+ * This call will allocate memory for buffers in passed \a grp_info.
+ * User is responsible for freeing the memory once not needed anymore.
+ *
+ * \param[in] group             Group identifier
+ * \param[in] since_ver         Version of the group info on the target node
+ * \param[in] grp_info          group info to be filled.
+ *
+ * \return                      DER_SUCCESS on success, negative value
+ *                              on failure.
+ */
+int crt_group_info_delta_get(crt_group_t *group, uint64_t since_ver,
+			     d_iov_t *grp_info);
+
+/**
+ * Retrieve the version of the group info. It is bumped by every rank or uri
+ * added or removed, and set to the version of the group info applied by
+ * crt_group_info_set.
+ *
+ * \param[in] group             Group identifier
+ * \param[out] ver              Returned version
+ *
+ * \return                      DER_SUCCESS on success, negative value
+ *                              on failure.
+ */
+int crt_group_info_ver_get(crt_group_t *group, uint64_t *ver);
+
 /**
  * Sets group info (nodes and associated uris) baesd on passed
  * grp_info data. \a grp_info is to be retrieved via \a crt_group_info_get
- * call.
+ * or \a crt_group_info_delta_get call.
+ *
+ * The group is updated in place: unchanged ranks keep their resolved
+ * addresses, and for a snapshot the ranks missing from it are removed.
  *
  * \param[in] grp_info          Group information to set
  *
  * \return                      DER_SUCCESS on success, negative value
- *                              on failure.
+ *                              on failure. -DER_MISMATCH if \a grp_info is a
+ *                              delta from another version than the group's,
+ *                              a snapshot is needed then.
  */
 int crt_group_info_set(d_iov_t *grp_info);
 
@@ -122,6 +122,9 @@ typedef struct {
 /** CaRT context handle */
 typedef void *crt_context_t;
 
+/** set of contexts progressed together, see crt_progress_set() */
+typedef void *crt_progress_set_t;
+
 /** Physical address string, e.g., "bmi+tcp://localhost:3344". */
 typedef d_string_t crt_phy_addr_t;
 #define CRT_PHY_ADDR_ENV	"CRT_PHY_ADDR_STR"
@@ -156,6 +159,19 @@ typedef void *crt_bulk_t; /**< abstract bulk handle */
 typedef void *crt_bulk_array_t; /**< abstract bulk array handle */
 
 #define CRT_BULK_NULL            (NULL)
+
+/**
+ * "Auto" iov RPC input field. The payload described by \a ia_iov is inlined
+ * into the request when it fits in the transport's eager message, otherwise
+ * CaRT exposes it through a bulk handle on the sender and pulls it on the
+ * target before the RPC handler is invoked. The handler only ever sees a
+ * local buffer in \a ia_iov. \a ia_bulk is managed by CaRT and should be
+ * left NULL by the user. Only supported in RPC input.
+ */
+typedef struct {
+	d_iov_t		ia_iov; /**< payload */
+	crt_bulk_t	ia_bulk; /**< internal bulk handle */
+} crt_iov_auto_t;
 /**
  * max size of input/output parameters defined as 64M bytes, for larger length
  * the user should transfer by bulk.
@@ -163,6 +179,25 @@ typedef void *crt_bulk_array_t; /**< abstract bulk array handle */
 #define CRT_MAX_INPUT_SIZE	(0x4000000)
 #define CRT_MAX_OUTPUT_SIZE	(0x4000000)
 
+/** statistics of one worker of a context's RPC handler pool */
+struct crt_handler_pool_stats {
+	uint64_t	hps_queued; /**< RPCs queued to the worker */
+	uint64_t	hps_executed; /**< RPC handlers run by the worker */
+	uint64_t	hps_stolen; /**< handlers taken from other workers */
+	uint32_t	hps_queue_len; /**< current queue length */
+	uint32_t	hps_queue_hwm; /**< max queue length */
+};
+
+/** statistics of the reply aggregation of the collective RPCs of a context */
+struct crt_corpc_stats {
+	uint64_t	cs_corpc_num; /**< collective RPCs completed */
+	uint64_t	cs_reply_num; /**< replies aggregated */
+	/** replies aggregated by another thread than the one receiving them */
+	uint64_t	cs_combined;
+	uint64_t	cs_agg_ns; /**< total aggregation time in ns */
+	uint64_t	cs_agg_max_ns; /**< max aggregation time of one RPC */
+};
+
 /** RPC flags enumeration */
 enum crt_rpc_flags {
 	/**
@@ -364,7 +399,8 @@ typedef void (*crt_proto_query_cb_t)(struct crt_proto_query_cb_info *cb_info);
 	TYPE_ACTION(ACTION, CMF_RANK_LIST, 0, d_rank_list_ptr_t)	\
 	ACTION(CMF_BULK_ARRAY, CMF_ARRAY_FLAG, crt_bulk_array_t,	\
 	       crt_bulk_t)						\
-	TYPE_ACTION(ACTION, CMF_IOVEC, 0, d_iov_t)
+	TYPE_ACTION(ACTION, CMF_IOVEC, 0, d_iov_t)			\
+	TYPE_ACTION(ACTION, CMF_IOV_AUTO, 0, crt_iov_auto_t)
 
 #define CRT_DECLARE_ONE_FIELD(cmf_name, flags, type, proc_base)		\
 	extern struct crt_msg_field cmf_name;				\
@@ -507,6 +543,40 @@ struct crt_barrier_cb_info {
  */
 typedef void (*crt_barrier_cb_t)(struct crt_barrier_cb_info *info);
 
+/**
+ * Algorithm of a data movement collective, see crt_allgather(),
+ * crt_allreduce() and crt_reduce_scatter().
+ */
+enum crt_coll_alg {
+	/** picked after the payload size and the group size */
+	CRT_COLL_AUTO	= 0,
+	/**
+	 * gather up and broadcast down the knomial tree rooted at the lowest
+	 * live rank, for small payloads
+	 */
+	CRT_COLL_TREE	= 1,
+	/**
+	 * recursive doubling, with recursive halving for the reductions of
+	 * large arrays. Only for groups of a power of two size.
+	 */
+	CRT_COLL_RD	= 2,
+	/** ring, bandwidth optimal for large payloads */
+	CRT_COLL_RING	= 3,
+};
+
+struct crt_coll_cb_info {
+	void	*ccb_arg;  /**< optional argument passed by user */
+	int	ccb_rc;    /**< return code of the collective */
+};
+
+/**
+ * completion callback for crt_allgather(), crt_allreduce() and
+ * crt_reduce_scatter()
+ *
+ * \param[in] info	Callback info structure
+ */
+typedef void (*crt_coll_cb_t)(struct crt_coll_cb_info *info);
+
 /** completion callback for bulk transferring, i.e. crt_bulk_transfer()
  *
  * \param[in] cb_info	Callback info structure
@@ -569,6 +639,29 @@ typedef union {
 	char		*uri;	/**< URI string */
 } crt_node_info_t;
 
+/**
+ * URI template of a group, see \a crt_group_uri_template_set(). Rank r of the
+ * group runs on ut_hosts[r / ut_ranks_per_host], its context \a tag listens
+ * on port ut_port_base + (r % ut_ranks_per_host) * ut_ports_per_rank + tag.
+ */
+typedef struct {
+	/**
+	 * URI format, "%h" expands to the host, "%p" to the port and "%%" to
+	 * a '%', e.g. "ofi+sockets://%h:%p".
+	 */
+	const char	 *ut_fmt;
+	/** host table */
+	const char	**ut_hosts;
+	/** number of entries in ut_hosts */
+	uint32_t	  ut_host_num;
+	/** number of ranks on each host */
+	uint32_t	  ut_ranks_per_host;
+	/** port of tag 0 of the first rank on each host */
+	uint32_t	  ut_port_base;
+	/** number of ports (tags) reserved for each rank */
+	uint32_t	  ut_ports_per_rank;
+} crt_uri_template_t;
+
 
 /** @}
  */
@@ -0,0 +1,156 @@
+/* Copyright (C) 2018 Intel Corporation
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted for any purpose (including commercial purposes)
+ * provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions, and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions, and the following disclaimer in the
+ *    documentation and/or materials provided with the distribution.
+ *
+ * 3. In addition, redistributions of modified forms of the source or binary
+ *    code must carry prominent notices stating that the original code was
+ *    changed and the date of the change.
+ *
+ *  4. All publications or advertising materials mentioning features or use of
+ *     this software are asked, but not required, to acknowledge that it was
+ *     developed by Intel Corporation and credit the contributors.
+ *
+ * 5. Neither the name of Intel Corporation, nor the name of any Contributor
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/* GURT rank map APIs. */
+
+#ifndef __GURT_RANKMAP_H__
+#define __GURT_RANKMAP_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include <gurt/common.h>
+#include <gurt/list.h>
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+/**
+ * \file
+ *
+ * Rank map
+ *
+ * The rank map is a dense, rank indexed array of pointers for maps keyed by
+ * rank (such as per-peer state), it gives O(1) lookup without lock.
+ *
+ * The array grows on demand when a rank beyond its size is set. Lookups do
+ * not take any lock, the updates (d_rank_map_set()) should be serialized by
+ * an external lock. Because a lookup can still access the array being
+ * replaced by a concurrent growing, the replaced arrays are retained until
+ * d_rank_map_fini(), so the memory used is at most twice the final array.
+ *
+ * Ranks are supposed to be dense, d_rank_map_set() fails with -DER_OVERFLOW
+ * for a rank larger than the max size passed to d_rank_map_init(), user should
+ * fall back to another lookup structure (a hash table for example) for those.
+ */
+
+/** @addtogroup GURT
+ * @{
+ */
+
+/** The array of the rank map, replaced by a larger one when growing */
+struct d_rank_map_array {
+	/** link to d_rank_map::rm_retired after being replaced */
+	d_list_t		 rma_link;
+	/** # slots */
+	uint32_t		 rma_size;
+	/** the slots, indexed by rank */
+	void			*rma_ptrs[0];
+};
+
+/** Rank map */
+struct d_rank_map {
+	/** the current array, NULL if nothing set yet */
+	struct d_rank_map_array	*rm_array;
+	/** the replaced arrays */
+	d_list_t		 rm_retired;
+	/** max # slots, ranks >= rm_max cannot be set */
+	uint32_t		 rm_max;
+};
+
+/**
+ * Initializes a rank map.
+ *
+ * \param[in] rm	The rank map
+ * \param[in] max	The max number of slots, ranks beyond it cannot be
+ *			set
+ *
+ * \return		zero on success, negative value if error
+ */
+int d_rank_map_init(struct d_rank_map *rm, uint32_t max);
+
+/**
+ * Finalizes a rank map, and releases all the arrays. The pointers in the map
+ * are owned by the user and not freed.
+ *
+ * \param[in] rm	The rank map
+ */
+void d_rank_map_fini(struct d_rank_map *rm);
+
+/**
+ * Sets the pointer of a rank, grows the array if needed. It should be called
+ * with the external lock held.
+ *
+ * \param[in] rm	The rank map
+ * \param[in] rank	The rank
+ * \param[in] ptr	The pointer, NULL to clear the rank
+ *
+ * \return		zero on success,
+ *			-DER_OVERFLOW if \a rank is beyond the max size,
+ *			-DER_NOMEM on allocation failure
+ */
+int d_rank_map_set(struct d_rank_map *rm, d_rank_t rank, void *ptr);
+
+/**
+ * Looks up the pointer of a rank, it does not need any lock.
+ *
+ * \param[in] rm	The rank map
+ * \param[in] rank	The rank
+ *
+ * \return		the pointer set for \a rank, or NULL if not set
+ */
+static inline void *
+d_rank_map_lookup(struct d_rank_map *rm, d_rank_t rank)
+{
+	struct d_rank_map_array	*rma;
+
+	rma = __atomic_load_n(&rm->rm_array, __ATOMIC_ACQUIRE);
+	if (rma == NULL || rank >= rma->rma_size)
+		return NULL;
+
+	return __atomic_load_n(&rma->rma_ptrs[rank], __ATOMIC_ACQUIRE);
+}
+
+#if defined(__cplusplus)
+}
+#endif
+
+/** @}
+ */
+#endif /* __GURT_RANKMAP_H__ */
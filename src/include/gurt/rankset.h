@@ -0,0 +1,240 @@
+/* Copyright (C) 2018 Intel Corporation
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted for any purpose (including commercial purposes)
+ * provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions, and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions, and the following disclaimer in the
+ *    documentation and/or materials provided with the distribution.
+ *
+ * 3. In addition, redistributions of modified forms of the source or binary
+ *    code must carry prominent notices stating that the original code was
+ *    changed and the date of the change.
+ *
+ *  4. All publications or advertising materials mentioning features or use of
+ *     this software are asked, but not required, to acknowledge that it was
+ *     developed by Intel Corporation and credit the contributors.
+ *
+ * 5. Neither the name of Intel Corporation, nor the name of any Contributor
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/* GURT rank set APIs. */
+
+#ifndef __GURT_RANKSET_H__
+#define __GURT_RANKSET_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include <gurt/common.h>
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+/**
+ * \file
+ *
+ * Rank set
+ *
+ * The rank set is a bitmap of ranks for the set algebra on group members
+ * (live ranks, excluded ranks, ...). Compared to a d_rank_list_t it gives O(1)
+ * membership test and rank to index, and unions/differences working on 64
+ * ranks per operation, at the cost of one bit per rank up to the largest one,
+ * i.e. 12.5KB for 100k ranks.
+ *
+ * The rank to index translation uses a per-word prefix count which is rebuilt
+ * on the first query after a change, in O(largest rank / 64).
+ *
+ * A rank set is not thread safe, the user should serialize the accesses.
+ */
+
+/** @addtogroup GURT
+ * @{
+ */
+
+/** the largest rank + 1 of a rank set, 2MB of bitmap */
+#define D_RANK_SET_MAX		(1U << 24)
+
+/** Rank set */
+struct d_rank_set {
+	/** bit (r % 64) of word (r / 64) is set if rank r is in the set */
+	uint64_t	*rs_bits;
+	/** # ranks in the words before each word, if rs_idx_valid */
+	uint32_t	*rs_idx;
+	/** # words of rs_bits and rs_idx */
+	uint32_t	 rs_nwords;
+	/** # ranks in the set */
+	uint32_t	 rs_nr;
+	/** rs_idx is up to date */
+	bool		 rs_idx_valid;
+};
+
+/**
+ * Initializes an empty rank set.
+ *
+ * \param[in] rs	The rank set
+ * \param[in] size	The expected largest rank + 1, the set grows beyond
+ *			it as needed
+ *
+ * \return		zero on success, negative value if error
+ */
+int d_rank_set_init(struct d_rank_set *rs, uint32_t size);
+
+/**
+ * Finalizes a rank set and releases its memory.
+ *
+ * \param[in] rs	The rank set
+ */
+void d_rank_set_fini(struct d_rank_set *rs);
+
+/**
+ * Adds a rank to the set.
+ *
+ * \param[in] rs	The rank set
+ * \param[in] rank	The rank
+ *
+ * \return		zero on success,
+ *			-DER_OVERFLOW if \a rank is not below D_RANK_SET_MAX,
+ *			-DER_NOMEM on allocation failure
+ */
+int d_rank_set_add(struct d_rank_set *rs, d_rank_t rank);
+
+/**
+ * Removes a rank from the set, nothing is done if it is not in the set.
+ *
+ * \param[in] rs	The rank set
+ * \param[in] rank	The rank
+ */
+void d_rank_set_del(struct d_rank_set *rs, d_rank_t rank);
+
+/**
+ * Tests if a rank is in the set.
+ *
+ * \param[in] rs	The rank set
+ * \param[in] rank	The rank
+ *
+ * \return		true if \a rank is in the set
+ */
+static inline bool
+d_rank_set_has(const struct d_rank_set *rs, d_rank_t rank)
+{
+	if (rank / 64 >= rs->rs_nwords)
+		return false;
+
+	return (rs->rs_bits[rank / 64] >> (rank % 64)) & 1;
+}
+
+/**
+ * Returns the number of ranks in the set.
+ *
+ * \param[in] rs	The rank set
+ *
+ * \return		the number of ranks
+ */
+static inline uint32_t
+d_rank_set_nr(const struct d_rank_set *rs)
+{
+	return rs->rs_nr;
+}
+
+/**
+ * Gets the index of a rank in the set, i.e. its position in the sorted list
+ * of the ranks of the set.
+ *
+ * \param[in] rs	The rank set
+ * \param[in] rank	The rank
+ * \param[out] idx	The index of \a rank
+ *
+ * \return		zero on success,
+ *			-DER_NONEXIST if \a rank is not in the set,
+ *			-DER_NOMEM on allocation failure
+ */
+int d_rank_set_idx(struct d_rank_set *rs, d_rank_t rank, uint32_t *idx);
+
+/**
+ * Gets the rank at an index of the set, the reverse of d_rank_set_idx(). It
+ * takes O(log(largest rank / 64)).
+ *
+ * \param[in] rs	The rank set
+ * \param[in] idx	The index
+ * \param[out] rank	The rank at \a idx
+ *
+ * \return		zero on success,
+ *			-DER_NONEXIST if \a idx is not below the set size,
+ *			-DER_NOMEM on allocation failure
+ */
+int d_rank_set_nth(struct d_rank_set *rs, uint32_t idx, d_rank_t *rank);
+
+/**
+ * Adds the ranks of \a src to \a dst.
+ *
+ * \param[in,out] dst	The rank set to update
+ * \param[in] src	The rank set to add
+ *
+ * \return		zero on success, -DER_NOMEM on allocation failure
+ */
+int d_rank_set_union(struct d_rank_set *dst, const struct d_rank_set *src);
+
+/**
+ * Removes the ranks of \a src from \a dst.
+ *
+ * \param[in,out] dst	The rank set to update
+ * \param[in] src	The rank set to remove
+ */
+void d_rank_set_diff(struct d_rank_set *dst, const struct d_rank_set *src);
+
+/**
+ * Removes the ranks not in \a src from \a dst.
+ *
+ * \param[in,out] dst	The rank set to update
+ * \param[in] src	The rank set to intersect with
+ */
+void d_rank_set_intersect(struct d_rank_set *dst,
+			  const struct d_rank_set *src);
+
+/**
+ * Adds the ranks of a rank list to the set.
+ *
+ * \param[in] rs	The rank set
+ * \param[in] list	The rank list, in any order and with duplicates
+ *
+ * \return		zero on success, negative value if error
+ */
+int d_rank_set_add_list(struct d_rank_set *rs, const d_rank_list_t *list);
+
+/**
+ * Allocates a rank list with the ranks of the set, sorted.
+ *
+ * \param[in] rs	The rank set
+ * \param[out] list	The rank list, to be freed by d_rank_list_free()
+ *
+ * \return		zero on success, -DER_NOMEM on allocation failure
+ */
+int d_rank_set_to_list(const struct d_rank_set *rs, d_rank_list_t **list);
+
+#if defined(__cplusplus)
+}
+#endif
+
+/** @}
+ */
+#endif /* __GURT_RANKSET_H__ */
@@ -0,0 +1,218 @@
+/* Copyright (C) 2018 Intel Corporation
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted for any purpose (including commercial purposes)
+ * provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions, and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions, and the following disclaimer in the
+ *    documentation and/or materials provided with the distribution.
+ *
+ * 3. In addition, redistributions of modified forms of the source or binary
+ *    code must carry prominent notices stating that the original code was
+ *    changed and the date of the change.
+ *
+ *  4. All publications or advertising materials mentioning features or use of
+ *     this software are asked, but not required, to acknowledge that it was
+ *     developed by Intel Corporation and credit the contributors.
+ *
+ * 5. Neither the name of Intel Corporation, nor the name of any Contributor
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/* GURT timing wheel APIs. */
+
+#ifndef __GURT_TIMEWHEEL_H__
+#define __GURT_TIMEWHEEL_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include <gurt/common.h>
+#include <gurt/list.h>
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+/**
+ * \file
+ *
+ * Hierarchical timing wheel
+ *
+ * The timing wheel tracks a large set of objects by expiry time with O(1)
+ * insert and remove, which makes it suitable for timers that are usually
+ * cancelled before they fire (such as RPC timeouts).
+ *
+ * Time is split into ticks of a fixed length. The wheel has DTW_LEVELS levels
+ * of DTW_LEVEL_SIZE slots each, a node is placed on the lowest level whose
+ * slot span covers its expiry tick, and is cascaded down to the lower levels
+ * as time advances. Expiry is accurate to one tick, a node never expires
+ * before its expiry time.
+ *
+ * Users of the wheel should embed a struct d_tw_node in every object to be
+ * tracked. The wheel has no internal lock, it should be protected by an
+ * external lock or only be accessed by a single thread.
+ */
+
+/** @addtogroup GURT
+ * @{
+ */
+
+#define DTW_LEVEL_BITS		(8)
+#define DTW_LEVEL_SIZE		(1U << DTW_LEVEL_BITS)	/* #slots per level */
+#define DTW_LEVEL_MASK		(DTW_LEVEL_SIZE - 1)
+#define DTW_LEVELS		(4)
+
+/**
+ * Timing wheel node.
+ *
+ * Objects of this type are embedded into objects to be tracked by a struct
+ * d_timewheel instance.
+ */
+struct d_tw_node {
+	/** link to the wheel slot, or to the expired list */
+	d_list_t	tn_link;
+	/** the expiry tick */
+	uint64_t	tn_tick;
+};
+
+/**
+ * Timing wheel.
+ */
+struct d_timewheel {
+	/** slots of all levels */
+	d_list_t	tw_slots[DTW_LEVELS][DTW_LEVEL_SIZE];
+	/** nodes already expired when being inserted */
+	d_list_t	tw_expired;
+	/** nodes beyond the span of the top level */
+	d_list_t	tw_overflow;
+	/** length of one tick, in micro-seconds */
+	uint64_t	tw_tick_us;
+	/** the last processed tick */
+	uint64_t	tw_cur;
+	/** # nodes in the wheel */
+	uint32_t	tw_count;
+};
+
+/**
+ * Initializes a timing wheel instance inplace.
+ *
+ * \param[in] tick_us	The length of one tick in micro-seconds
+ * \param[in] now	The current time in micro-seconds, it is the start
+ *			time of the wheel
+ * \param[in,out] tw	The pointer of timing wheel
+ *
+ * \return		zero on success, negative value if error
+ */
+int d_timewheel_create_inplace(uint64_t tick_us, uint64_t now,
+			       struct d_timewheel *tw);
+
+/**
+ * Finalizes a timing wheel instance inplace. The nodes still in the wheel are
+ * detached but not freed, they are owned by the user.
+ *
+ * \param[in] tw	The timing wheel
+ */
+void d_timewheel_destroy_inplace(struct d_timewheel *tw);
+
+/**
+ * Inserts a node into the timing wheel.
+ *
+ * \param[in] tw	The timing wheel
+ * \param[in] n		The node, should not be in the wheel
+ * \param[in] expire	The expiry time in micro-seconds, the node will be
+ *			returned by the next d_timewheel_expire() call if it
+ *			is already in the past.
+ */
+void d_timewheel_insert(struct d_timewheel *tw, struct d_tw_node *n,
+			uint64_t expire);
+
+/**
+ * Removes a node from the timing wheel.
+ *
+ * \param[in] tw	The timing wheel
+ * \param[in] n		The node, should be in the wheel
+ */
+void d_timewheel_remove(struct d_timewheel *tw, struct d_tw_node *n);
+
+/**
+ * Advances the timing wheel to \a now and moves all the expired nodes to the
+ * tail of \a expired_list, linked by d_tw_node::tn_link. The nodes are not in
+ * the wheel anymore after that.
+ *
+ * \param[in] tw		The timing wheel
+ * \param[in] now		The current time in micro-seconds
+ * \param[in,out] expired_list	The list to collect the expired nodes
+ *
+ * \return			number of expired nodes
+ */
+int d_timewheel_expire(struct d_timewheel *tw, uint64_t now,
+		       d_list_t *expired_list);
+
+/**
+ * Queries the earliest time the next node can expire at. The result is a lower
+ * bound, exact for the nodes expiring within DTW_LEVEL_SIZE ticks, it can be
+ * used to bound the time to sleep before calling d_timewheel_expire().
+ *
+ * \param[in] tw	The timing wheel
+ *
+ * \return		the time in micro-seconds, UINT64_MAX if the wheel is
+ *			empty, not later than the current tick if some node
+ *			has already expired
+ */
+uint64_t d_timewheel_next(struct d_timewheel *tw);
+
+/**
+ * Queries if there is possibly any node expired at \a now. It only reads the
+ * wheel's current tick and can be used as a hint without the external lock.
+ *
+ * \param[in] tw	The timing wheel
+ * \param[in] now	The current time in micro-seconds
+ *
+ * \retval		true	d_timewheel_expire() should be called
+ * \retval		false	no node expires at \a now
+ */
+static inline bool
+d_timewheel_pending(struct d_timewheel *tw, uint64_t now)
+{
+	return now / tw->tw_tick_us > tw->tw_cur ||
+	       !d_list_empty(&tw->tw_expired);
+}
+
+/**
+ * Queries the number of nodes in the timing wheel.
+ *
+ * \param[in] tw	The timing wheel
+ *
+ * \return		number of nodes
+ */
+static inline uint32_t
+d_timewheel_size(struct d_timewheel *tw)
+{
+	return tw->tw_count;
+}
+
+#if defined(__cplusplus)
+}
+#endif
+
+/** @}
+ */
+#endif /* __GURT_TIMEWHEEL_H__ */
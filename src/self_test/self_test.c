@@ -90,23 +90,44 @@ static int g_shutdown_flag;
 
 static int is_singleton;
 
+static int progress_cond_cb(void *arg)
+{
+	return g_shutdown_flag;
+}
+
 static void *progress_fn(void *arg)
 {
-	int		 ret;
-	crt_context_t	*crt_ctx = NULL;
+	crt_progress_set_t	 ps;
+	int			 ret;
+	crt_context_t		*crt_ctx = NULL;
 
 	crt_ctx = (crt_context_t *)arg;
 	D_ASSERT(crt_ctx != NULL);
 	D_ASSERT(*crt_ctx != NULL);
 
+	ret = crt_progress_set_create(&ps);
+	if (ret != 0) {
+		D_ERROR("crt_progress_set_create failed; ret = %d\n", ret);
+		pthread_exit(NULL);
+	}
+	ret = crt_progress_set_add(ps, *crt_ctx);
+	if (ret != 0) {
+		D_ERROR("crt_progress_set_add failed; ret = %d\n", ret);
+		goto out;
+	}
+
+	/* sleep on the wait fd until there is work or a shutdown */
 	while (!g_shutdown_flag) {
-		ret = crt_progress(*crt_ctx, 1, NULL, NULL);
+		ret = crt_progress_set(ps, 1000, progress_cond_cb, NULL);
 		if (ret != 0 && ret != -DER_TIMEDOUT) {
-			D_ERROR("crt_progress failed; ret = %d\n", ret);
+			D_ERROR("crt_progress_set failed; ret = %d\n", ret);
 			break;
 		}
 	};
 
+	crt_progress_set_del(ps, *crt_ctx);
+out:
+	crt_progress_set_destroy(ps);
 	pthread_exit(NULL);
 }
 
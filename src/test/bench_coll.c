@@ -0,0 +1,537 @@
+/* Copyright (C) 2018 Intel Corporation
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted for any purpose (including commercial purposes)
+ * provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions, and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions, and the following disclaimer in the
+ *    documentation and/or materials provided with the distribution.
+ *
+ * 3. In addition, redistributions of modified forms of the source or binary
+ *    code must carry prominent notices stating that the original code was
+ *    changed and the date of the change.
+ *
+ *  4. All publications or advertising materials mentioning features or use of
+ *     this software are asked, but not required, to acknowledge that it was
+ *     developed by Intel Corporation and credit the contributors.
+ *
+ * 5. Neither the name of Intel Corporation, nor the name of any Contributor
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+/**
+ * Benchmark of the data movement collectives. For each payload size all
+ * ranks run crt_allgather(), crt_allreduce() and crt_reduce_scatter() with
+ * each algorithm, and rank 0 reports the latency.
+ *
+ * They are compared with the emulation of allgather and allreduce by a
+ * broadcast and point-to-point replies: rank 0 broadcasts a request, every
+ * other rank sends its contribution to rank 0, which gathers (or reduces)
+ * them and broadcasts the result by bulk.
+ *
+ * The size is the bytes contributed by each rank to allgather, and the bytes
+ * of the array of allreduce and of each block of reduce-scatter (as double).
+ *
+ * Usage: orterun -np N bench_coll [-s size1,size2,...] [-i iters]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <assert.h>
+
+#include <gurt/common.h>
+#include <cart/api.h>
+#include "bench_common.h"
+
+#define BENCH_COLL_REQ		(0xC7)
+#define BENCH_COLL_PUT		(0xC8)
+#define BENCH_COLL_RESULT	(0xC9)
+
+#define CRT_ISEQ_BENCH_COLL	/* input fields */		 \
+	((uint32_t)		(bc_reduce)		CRT_VAR)
+
+#define CRT_OSEQ_BENCH_COLL	/* output fields */		 \
+	((int32_t)		(bc_rc)			CRT_VAR)
+
+CRT_RPC_DECLARE(bench_coll, CRT_ISEQ_BENCH_COLL, CRT_OSEQ_BENCH_COLL)
+CRT_RPC_DEFINE(bench_coll, CRT_ISEQ_BENCH_COLL, CRT_OSEQ_BENCH_COLL)
+
+#define CRT_ISEQ_BENCH_PUT	/* input fields */		 \
+	((d_rank_t)		(bp_rank)		CRT_VAR) \
+	((uint32_t)		(bp_reduce)		CRT_VAR) \
+	((crt_iov_auto_t)	(bp_data)		CRT_VAR)
+
+#define CRT_OSEQ_BENCH_PUT	/* output fields */		 \
+	((int32_t)		(bp_rc)			CRT_VAR)
+
+CRT_RPC_DECLARE(bench_put, CRT_ISEQ_BENCH_PUT, CRT_OSEQ_BENCH_PUT)
+CRT_RPC_DEFINE(bench_put, CRT_ISEQ_BENCH_PUT, CRT_OSEQ_BENCH_PUT)
+
+enum bench_kind {
+	BENCH_ALLGATHER,
+	BENCH_ALLREDUCE,
+	BENCH_REDUCE_SCATTER,
+};
+
+static const char *bench_kind_names[] = {
+	[BENCH_ALLGATHER]	= "allgather",
+	[BENCH_ALLREDUCE]	= "allreduce",
+	[BENCH_REDUCE_SCATTER]	= "reduce_scatter",
+};
+
+/* -1 stands for the emulation */
+static const struct {
+	const char	*ba_name;
+	int		 ba_alg;
+} bench_algs[] = {
+	{"emulated",	-1},
+	{"auto",	CRT_COLL_AUTO},
+	{"tree",	CRT_COLL_TREE},
+	{"rd",		CRT_COLL_RD},
+	{"ring",	CRT_COLL_RING},
+};
+
+static crt_context_t	 g_ctx;
+static d_rank_t		 g_rank;
+static uint32_t		 g_size;
+static size_t		 g_bytes;	/* current payload size */
+static char		*g_send;
+static char		*g_recv;
+static int		 g_done;
+static int		 g_rc;
+/* contributions received by rank 0 */
+static uint32_t		 g_puts;
+/* requests and results of the emulation received by the other ranks */
+static uint32_t		 g_reqs;
+static uint32_t		 g_results;
+static uint32_t		 g_emulations;
+
+static int
+bench_coll_aggregate(crt_rpc_t *source, crt_rpc_t *result, void *priv)
+{
+	struct bench_coll_out	*out_source = crt_reply_get(source);
+	struct bench_coll_out	*out_result = crt_reply_get(result);
+
+	if (out_result->bc_rc == 0)
+		out_result->bc_rc = out_source->bc_rc;
+	return 0;
+}
+
+static struct crt_corpc_ops bench_coll_ops = {
+	.co_aggregate = bench_coll_aggregate,
+};
+
+/*
+ * Count the request, the rank sends its contribution once it is done with
+ * the previous runs, see bench_emulate().
+ */
+static void
+bench_req_hdlr(crt_rpc_t *rpc)
+{
+	struct bench_coll_out	*out = crt_reply_get(rpc);
+	int			 rc;
+
+	out->bc_rc = 0;
+	rc = crt_reply_send(rpc);
+	assert(rc == 0);
+
+	g_reqs++;
+}
+
+/* gather or reduce a contribution on rank 0 */
+static void
+bench_put_hdlr(crt_rpc_t *rpc)
+{
+	struct bench_put_in	*in = crt_req_get(rpc);
+	struct bench_put_out	*out = crt_reply_get(rpc);
+	d_iov_t			*data = &in->bp_data.ia_iov;
+	int			 rc = 0;
+
+	if (data->iov_len != g_bytes || in->bp_rank >= g_size)
+		rc = -DER_PROTO;
+	else if (in->bp_reduce)
+		rc = crt_reduce(CRT_REDUCE_SUM, CRT_REDUCE_DOUBLE, g_recv,
+				data->iov_buf, g_bytes / sizeof(double));
+	else
+		memcpy(g_recv + in->bp_rank * g_bytes, data->iov_buf,
+		       g_bytes);
+	if (rc != 0)
+		D_ERROR("put from rank %u failed, rc: %d.\n", in->bp_rank, rc);
+
+	out->bp_rc = rc;
+	rc = crt_reply_send(rpc);
+	assert(rc == 0);
+
+	g_puts++;
+}
+
+/* copy the result broadcast by rank 0 */
+static void
+bench_result_hdlr(crt_rpc_t *rpc)
+{
+	struct bench_coll_out	*out = crt_reply_get(rpc);
+	d_sg_list_t		 sgl;
+	d_iov_t			 iov;
+	int			 rc;
+
+	sgl.sg_nr = 1;
+	sgl.sg_iovs = &iov;
+	out->bc_rc = crt_bulk_access(rpc->cr_co_bulk_hdl, &sgl);
+	if (out->bc_rc == 0)
+		memcpy(g_recv, iov.iov_buf, iov.iov_buf_len);
+
+	rc = crt_reply_send(rpc);
+	assert(rc == 0);
+
+	g_results++;
+}
+
+static void
+bench_corpc_cb(const struct crt_cb_info *info)
+{
+	struct bench_coll_out	*out;
+
+	g_rc = info->cci_rc;
+	if (g_rc == 0) {
+		out = crt_reply_get(info->cci_rpc);
+		g_rc = out->bc_rc;
+	}
+	g_done = 1;
+}
+
+static int
+bench_corpc_send(crt_opcode_t opc, crt_bulk_t bulk_hdl, bool reduce)
+{
+	d_rank_t		 excluded_rank = 0;
+	d_rank_list_t		 excluded = {&excluded_rank, 1};
+	struct bench_coll_in	*in;
+	crt_rpc_t		*rpc;
+	int			 rc;
+
+	rc = crt_corpc_req_create(g_ctx, NULL, &excluded, opc, bulk_hdl, NULL,
+				  0, crt_tree_topo(CRT_TREE_KNOMIAL, 4), &rpc);
+	if (rc != 0)
+		return rc;
+
+	in = crt_req_get(rpc);
+	in->bc_reduce = reduce;
+
+	g_done = 0;
+	rc = crt_req_send(rpc, bench_corpc_cb, NULL);
+	if (rc != 0)
+		return rc;
+
+	while (!g_done)
+		crt_progress(g_ctx, 1000, NULL, NULL);
+
+	return g_rc;
+}
+
+static void
+bench_put_cb(const struct crt_cb_info *info)
+{
+	struct bench_put_out	*out;
+
+	g_rc = info->cci_rc;
+	if (g_rc == 0) {
+		out = crt_reply_get(info->cci_rpc);
+		g_rc = out->bp_rc;
+	}
+	g_done = 1;
+}
+
+/* the part of the emulation on the ranks other than 0 */
+static int
+bench_emulate_put(bool reduce)
+{
+	struct bench_put_in	*in;
+	crt_endpoint_t		 ep = {0};
+	crt_rpc_t		*rpc;
+	int			 rc;
+
+	g_emulations++;
+	while (g_reqs < g_emulations)
+		crt_progress(g_ctx, 1000, NULL, NULL);
+
+	ep.ep_rank = 0;
+	rc = crt_req_create(g_ctx, &ep, BENCH_COLL_PUT, &rpc);
+	if (rc != 0)
+		return rc;
+
+	in = crt_req_get(rpc);
+	in->bp_rank = g_rank;
+	in->bp_reduce = reduce;
+	d_iov_set(&in->bp_data.ia_iov, g_send, g_bytes);
+
+	g_done = 0;
+	rc = crt_req_send(rpc, bench_put_cb, NULL);
+	if (rc != 0)
+		return rc;
+	while (!g_done || g_results < g_emulations)
+		crt_progress(g_ctx, 1000, NULL, NULL);
+
+	return g_rc;
+}
+
+/* allgather or allreduce by a broadcast and point-to-point replies */
+static int
+bench_emulate(bool reduce)
+{
+	size_t		 len = reduce ? g_bytes : g_bytes * g_size;
+	d_sg_list_t	 sgl;
+	d_iov_t		 iov;
+	crt_bulk_t	 bulk_hdl;
+	int		 rc;
+
+	if (g_rank != 0)
+		return bench_emulate_put(reduce);
+
+	/* rank 0 contributes the first block, or the initial array */
+	memcpy(g_recv, g_send, g_bytes);
+
+	g_puts = 0;
+	rc = bench_corpc_send(BENCH_COLL_REQ, CRT_BULK_NULL, reduce);
+	if (rc != 0)
+		return rc;
+	while (g_puts < g_size - 1)
+		crt_progress(g_ctx, 1000, NULL, NULL);
+
+	d_iov_set(&iov, g_recv, len);
+	sgl.sg_nr = 1;
+	sgl.sg_iovs = &iov;
+	rc = crt_bulk_create(g_ctx, &sgl, CRT_BULK_RO, &bulk_hdl);
+	if (rc != 0)
+		return rc;
+	rc = bench_corpc_send(BENCH_COLL_RESULT, bulk_hdl, reduce);
+	crt_bulk_free(bulk_hdl);
+
+	return rc;
+}
+
+static void
+bench_coll_cb(struct crt_coll_cb_info *info)
+{
+	g_rc = info->ccb_rc;
+	g_done = 1;
+}
+
+static int
+bench_native(enum bench_kind kind, enum crt_coll_alg alg)
+{
+	size_t	nr = g_bytes / sizeof(double);
+	int	rc;
+
+	g_done = 0;
+	switch (kind) {
+	case BENCH_ALLGATHER:
+		rc = crt_allgather(NULL, alg, g_send, g_recv, g_bytes,
+				   bench_coll_cb, NULL);
+		break;
+	case BENCH_ALLREDUCE:
+		rc = crt_allreduce(NULL, alg, CRT_REDUCE_SUM,
+				   CRT_REDUCE_DOUBLE, g_send, g_recv, nr,
+				   bench_coll_cb, NULL);
+		break;
+	default:
+		rc = crt_reduce_scatter(NULL, alg, CRT_REDUCE_SUM,
+					CRT_REDUCE_DOUBLE, g_send, g_recv, nr,
+					bench_coll_cb, NULL);
+		break;
+	}
+	if (rc != 0)
+		return rc;
+
+	while (!g_done)
+		crt_progress(g_ctx, 1000, NULL, NULL);
+
+	return g_rc;
+}
+
+/* check the result of the last run */
+static int
+bench_check(enum bench_kind kind)
+{
+	double		*vec = (double *)g_recv;
+	size_t		 nr = g_bytes / sizeof(double);
+	size_t		 i, off;
+	uint32_t	 r;
+
+	if (kind == BENCH_ALLGATHER) {
+		for (r = 0; r < g_size; r++)
+			for (off = 0; off < g_bytes; off++)
+				if (g_recv[r * g_bytes + off] !=
+				    (char)(r + off))
+					return -DER_PROTO;
+		return 0;
+	}
+
+	/* rank r contributes r + 1 to each element */
+	for (i = 0; i < nr; i++)
+		if (vec[i] != (double)g_size * (g_size + 1) / 2)
+			return -DER_PROTO;
+	return 0;
+}
+
+static int
+bench_run(enum bench_kind kind, int a, size_t bytes, uint32_t iters)
+{
+	struct timespec	 start, end;
+	double		*vec;
+	double		 usecs;
+	size_t		 len, off;
+	uint32_t	 i;
+	int		 rc;
+
+	if (bench_algs[a].ba_alg < 0 &&
+	    (kind == BENCH_REDUCE_SCATTER || g_size == 1))
+		return 0;
+	if (bench_algs[a].ba_alg == CRT_COLL_RD && (g_size & (g_size - 1)))
+		return 0;
+	if (kind != BENCH_ALLGATHER && bytes < sizeof(double))
+		return 0;
+
+	g_bytes = bytes;
+	len = kind == BENCH_REDUCE_SCATTER ? bytes * g_size : bytes;
+	D_ALLOC(g_send, len);
+	D_ALLOC(g_recv, bytes * g_size);
+	if (g_send == NULL || g_recv == NULL)
+		D_GOTO(out, rc = -DER_NOMEM);
+
+	if (kind == BENCH_ALLGATHER) {
+		for (off = 0; off < bytes; off++)
+			g_send[off] = (char)(g_rank + off);
+	} else {
+		vec = (double *)g_send;
+		for (off = 0; off < len / sizeof(double); off++)
+			vec[off] = g_rank + 1;
+	}
+
+	/* the first run warms up the connections */
+	usecs = 0;
+	for (i = 0; i <= iters; i++) {
+		d_gettime(&start);
+		if (bench_algs[a].ba_alg < 0)
+			rc = bench_emulate(kind == BENCH_ALLREDUCE);
+		else
+			rc = bench_native(kind, bench_algs[a].ba_alg);
+		d_gettime(&end);
+		if (rc != 0)
+			D_GOTO(out, rc);
+		if (i > 0)
+			usecs += d_time2us(d_timediff(start, end));
+	}
+
+	rc = bench_check(kind);
+	if (rc != 0) {
+		fprintf(stderr, "%s %s, bad result on rank %u.\n",
+			bench_kind_names[kind], bench_algs[a].ba_name, g_rank);
+		D_GOTO(out, rc);
+	}
+
+	usecs /= iters;
+	if (g_rank == 0)
+		printf("%-15s %-9s %12zu %12.1f\n", bench_kind_names[kind],
+		       bench_algs[a].ba_name, bytes, usecs);
+
+out:
+	D_FREE(g_send);
+	D_FREE(g_recv);
+	return rc;
+}
+
+int
+main(int argc, char **argv)
+{
+	size_t		 sizes[BENCH_MAX_RUNS] = {64, 1 << 12, 1 << 16,
+						  1 << 20};
+	int		 sizes_cnt = 4;
+	uint32_t	 iters = 20;
+	uint64_t	 vals[BENCH_MAX_RUNS];
+	int		 i, a, k, c;
+	int		 rc = 0;
+
+	while ((c = getopt(argc, argv, "s:i:")) != -1) {
+		switch (c) {
+		case 's':
+			sizes_cnt = bench_list_parse(optarg, vals);
+			for (i = 0; i < sizes_cnt; i++)
+				sizes[i] = vals[i];
+			break;
+		case 'i':
+			iters = atoi(optarg);
+			break;
+		default:
+			fprintf(stderr, "Usage: %s [-s size1,size2,...] "
+				"[-i iters]\n", argv[0]);
+			return -1;
+		}
+	}
+	if (iters == 0)
+		iters = 1;
+
+	rc = crt_init(NULL, CRT_FLAG_BIT_SERVER);
+	assert(rc == 0);
+
+	rc = CRT_RPC_CORPC_REGISTER(BENCH_COLL_REQ, bench_coll,
+				    bench_req_hdlr, &bench_coll_ops);
+	assert(rc == 0);
+	rc = CRT_RPC_CORPC_REGISTER(BENCH_COLL_RESULT, bench_coll,
+				    bench_result_hdlr, &bench_coll_ops);
+	assert(rc == 0);
+	rc = CRT_RPC_SRV_REGISTER(BENCH_COLL_PUT, 0, bench_put,
+				  bench_put_hdlr);
+	assert(rc == 0);
+
+	rc = crt_context_create(&g_ctx);
+	assert(rc == 0);
+
+	rc = crt_group_rank(NULL, &g_rank);
+	assert(rc == 0);
+	rc = crt_group_size(NULL, &g_size);
+	assert(rc == 0);
+
+	if (g_rank == 0)
+		printf("%-15s %-9s %12s %12s\n", "collective", "alg",
+		       "bytes", "usec");
+
+	/* all ranks run the same sequence of collectives */
+	for (i = 0; i < sizes_cnt; i++) {
+		for (k = BENCH_ALLGATHER; k <= BENCH_REDUCE_SCATTER; k++) {
+			for (a = 0; a < ARRAY_SIZE(bench_algs); a++) {
+				rc = bench_run(k, a, sizes[i], iters);
+				if (rc != 0) {
+					fprintf(stderr, "bench_run failed, "
+						"rc: %d.\n", rc);
+					D_GOTO(out, rc);
+				}
+			}
+		}
+	}
+
+out:
+	/* Progress for a while to make sure the peers get our replies */
+	for (i = 0; i < 1000; i++)
+		crt_progress(g_ctx, 1000, NULL, NULL);
+
+	crt_context_destroy(g_ctx, true);
+	crt_finalize();
+
+	return rc;
+}
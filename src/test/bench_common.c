@@ -0,0 +1,119 @@
+/* Copyright (C) 2018 Intel Corporation
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted for any purpose (including commercial purposes)
+ * provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions, and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions, and the following disclaimer in the
+ *    documentation and/or materials provided with the distribution.
+ *
+ * 3. In addition, redistributions of modified forms of the source or binary
+ *    code must carry prominent notices stating that the original code was
+ *    changed and the date of the change.
+ *
+ *  4. All publications or advertising materials mentioning features or use of
+ *     this software are asked, but not required, to acknowledge that it was
+ *     developed by Intel Corporation and credit the contributors.
+ *
+ * 5. Neither the name of Intel Corporation, nor the name of any Contributor
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+/**
+ * Common code of the micro benchmarks, see bench_common.h.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+
+#include <gurt/common.h>
+#include "bench_common.h"
+
+int
+bench_list_parse(char *str, uint64_t *vals)
+{
+	char	*tok, *saveptr;
+	int	 cnt = 0;
+
+	for (tok = strtok_r(str, ",", &saveptr);
+	     tok != NULL && cnt < BENCH_MAX_RUNS;
+	     tok = strtok_r(NULL, ",", &saveptr))
+		vals[cnt++] = strtoull(tok, NULL, 0);
+
+	return cnt;
+}
+
+double
+bench_ns_per_op(struct timespec *start, uint64_t ops)
+{
+	struct timespec	now;
+
+	d_gettime(&now);
+	return (double)d_timediff_ns(start, &now) / (ops == 0 ? 1 : ops);
+}
+
+int
+bench_main(int argc, char **argv, struct bench_desc *desc)
+{
+	uint64_t	vals[BENCH_MAX_RUNS];
+	uint32_t	iters = desc->bd_iters;
+	int		i, c;
+	int		rc = 0;
+
+	while ((c = getopt(argc, argv, "n:i:")) != -1) {
+		switch (c) {
+		case 'n':
+			desc->bd_nums_cnt = bench_list_parse(optarg, vals);
+			for (i = 0; i < desc->bd_nums_cnt; i++)
+				desc->bd_nums[i] = vals[i];
+			break;
+		case 'i':
+			iters = atoi(optarg);
+			break;
+		default:
+			fprintf(stderr, "Usage: %s [-n num1,num2,...] "
+				"[-i iterations]\n", argv[0]);
+			return -1;
+		}
+	}
+
+	rc = d_log_init();
+	if (rc != 0) {
+		fprintf(stderr, "d_log_init failed, rc: %d.\n", rc);
+		return rc;
+	}
+
+	srand(1);
+	printf("%s   (ns/op)\n", desc->bd_header);
+	for (i = 0; i < desc->bd_nums_cnt; i++) {
+		if (desc->bd_nums[i] == 0 ||
+		    desc->bd_nums[i] < desc->bd_num_min)
+			continue;
+		rc = desc->bd_run(desc->bd_nums[i], iters);
+		if (rc != 0) {
+			fprintf(stderr, "bench_run(%u) failed, rc: %d.\n",
+				desc->bd_nums[i], rc);
+			break;
+		}
+	}
+
+	d_log_fini();
+	return rc;
+}
@@ -0,0 +1,84 @@
+/* Copyright (C) 2018 Intel Corporation
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted for any purpose (including commercial purposes)
+ * provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions, and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions, and the following disclaimer in the
+ *    documentation and/or materials provided with the distribution.
+ *
+ * 3. In addition, redistributions of modified forms of the source or binary
+ *    code must carry prominent notices stating that the original code was
+ *    changed and the date of the change.
+ *
+ *  4. All publications or advertising materials mentioning features or use of
+ *     this software are asked, but not required, to acknowledge that it was
+ *     developed by Intel Corporation and credit the contributors.
+ *
+ * 5. Neither the name of Intel Corporation, nor the name of any Contributor
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+/**
+ * Common code of the micro benchmarks (bench_*.c): the parsing of the lists of
+ * sizes to run and the main loop of the benchmarks taking
+ * [-n num1,num2,...] [-i iterations].
+ */
+#ifndef __BENCH_COMMON_H__
+#define __BENCH_COMMON_H__
+
+#include <stdint.h>
+#include <time.h>
+
+/* max number of sizes run by a benchmark */
+#define BENCH_MAX_RUNS		(16)
+
+/* one run of a benchmark over num elements, see bench_main() */
+typedef int (*bench_run_t)(uint32_t num, uint32_t iters);
+
+struct bench_desc {
+	/* header of the columns printed by bd_run */
+	const char	*bd_header;
+	/* default sizes, up to BENCH_MAX_RUNS */
+	uint32_t	 bd_nums[BENCH_MAX_RUNS];
+	int		 bd_nums_cnt;
+	/* default iterations */
+	uint32_t	 bd_iters;
+	/* sizes below it are skipped */
+	uint32_t	 bd_num_min;
+	bench_run_t	 bd_run;
+};
+
+/*
+ * Parse the comma separated list of values str, which is modified, into vals
+ * of BENCH_MAX_RUNS entries. Returns the number of values, extra ones are
+ * ignored.
+ */
+int bench_list_parse(char *str, uint64_t *vals);
+
+/* average time in ns of ops operations started at start */
+double bench_ns_per_op(struct timespec *start, uint64_t ops);
+
+/*
+ * main() of a benchmark taking [-n num1,num2,...] [-i iterations], it calls
+ * bd_run for each size.
+ */
+int bench_main(int argc, char **argv, struct bench_desc *desc);
+
+#endif /* __BENCH_COMMON_H__ */
@@ -0,0 +1,343 @@
+/* Copyright (C) 2018 Intel Corporation
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted for any purpose (including commercial purposes)
+ * provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions, and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions, and the following disclaimer in the
+ *    documentation and/or materials provided with the distribution.
+ *
+ * 3. In addition, redistributions of modified forms of the source or binary
+ *    code must carry prominent notices stating that the original code was
+ *    changed and the date of the change.
+ *
+ *  4. All publications or advertising materials mentioning features or use of
+ *     this software are asked, but not required, to acknowledge that it was
+ *     developed by Intel Corporation and credit the contributors.
+ *
+ * 5. Neither the name of Intel Corporation, nor the name of any Contributor
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+/**
+ * Benchmark of collective RPCs with a bulk payload. Rank 0 broadcasts a
+ * payload of each size through each tree topology to all the other ranks,
+ * which check the payload before replying, and reports the latency.
+ *
+ * Run it once with and once without CRT_CORPC_BULK_SEG set to compare the
+ * pipelined chained bulk with the whole-bulk forwarding.
+ *
+ * Usage: orterun -np N bench_corpc_bulk [-s size1,size2,...] [-i iters]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <assert.h>
+
+#include <gurt/common.h>
+#include <cart/api.h>
+#include "bench_common.h"
+
+#define BENCH_CORPC_BULK	(0xC5)
+#define BENCH_CORPC_SHUTDOWN	(0xC6)
+
+#define CRT_ISEQ_BENCH_CORPC	/* input fields */		 \
+	((uint32_t)		(bc_seq)		CRT_VAR)
+
+#define CRT_OSEQ_BENCH_CORPC	/* output fields */		 \
+	((int32_t)		(bc_rc)			CRT_VAR)
+
+CRT_RPC_DECLARE(bench_corpc, CRT_ISEQ_BENCH_CORPC, CRT_OSEQ_BENCH_CORPC)
+CRT_RPC_DEFINE(bench_corpc, CRT_ISEQ_BENCH_CORPC, CRT_OSEQ_BENCH_CORPC)
+
+static const struct {
+	const char	*bt_name;
+	int		 bt_type;
+	uint32_t	 bt_ratio;
+} bench_topos[] = {
+	{"flat",	CRT_TREE_FLAT,		0},
+	{"kary:4",	CRT_TREE_KARY,		4},
+	{"knomial:2",	CRT_TREE_KNOMIAL,	2},
+	{"knomial:4",	CRT_TREE_KNOMIAL,	4},
+	{"locality:4",	CRT_TREE_LOCALITY,	4},
+};
+
+static int	g_shutdown;
+static int	g_done;
+static int	g_rc;
+
+static uint8_t
+bench_pattern(uint32_t seq, size_t off)
+{
+	return (uint8_t)(seq * 31 + off);
+}
+
+static int
+bench_corpc_aggregate(crt_rpc_t *source, crt_rpc_t *result, void *priv)
+{
+	struct bench_corpc_out	*out_source = crt_reply_get(source);
+	struct bench_corpc_out	*out_result = crt_reply_get(result);
+
+	if (out_result->bc_rc == 0)
+		out_result->bc_rc = out_source->bc_rc;
+	return 0;
+}
+
+static struct crt_corpc_ops bench_corpc_ops = {
+	.co_aggregate = bench_corpc_aggregate,
+};
+
+/* check the first and last byte of each page of the payload */
+static int
+bench_corpc_check(crt_rpc_t *rpc, uint32_t seq)
+{
+	d_sg_list_t	 sgl;
+	d_iov_t		 iov;
+	uint8_t		*buf;
+	size_t		 off;
+	int		 rc;
+
+	sgl.sg_nr = 1;
+	sgl.sg_iovs = &iov;
+	rc = crt_bulk_access(rpc->cr_co_bulk_hdl, &sgl);
+	if (rc != 0)
+		return rc;
+
+	buf = iov.iov_buf;
+	for (off = 0; off < iov.iov_buf_len; off += 4096) {
+		if (buf[off] != bench_pattern(seq, off))
+			return -DER_PROTO;
+	}
+	off = iov.iov_buf_len - 1;
+	if (buf[off] != bench_pattern(seq, off))
+		return -DER_PROTO;
+
+	return 0;
+}
+
+static void
+bench_corpc_hdlr(crt_rpc_t *rpc)
+{
+	struct bench_corpc_in	*in = crt_req_get(rpc);
+	struct bench_corpc_out	*out = crt_reply_get(rpc);
+	int			 rc;
+
+	out->bc_rc = bench_corpc_check(rpc, in->bc_seq);
+	if (out->bc_rc != 0)
+		D_ERROR("payload %u mismatch, rc: %d.\n", in->bc_seq,
+			out->bc_rc);
+
+	rc = crt_reply_send(rpc);
+	assert(rc == 0);
+}
+
+static void
+bench_shutdown_hdlr(crt_rpc_t *rpc)
+{
+	int	rc;
+
+	rc = crt_reply_send(rpc);
+	assert(rc == 0);
+
+	g_shutdown = 1;
+}
+
+static void
+bench_corpc_cb(const struct crt_cb_info *info)
+{
+	struct bench_corpc_out	*out;
+
+	g_rc = info->cci_rc;
+	if (g_rc == 0 && info->cci_rpc->cr_opc == BENCH_CORPC_BULK) {
+		out = crt_reply_get(info->cci_rpc);
+		g_rc = out->bc_rc;
+	}
+	g_done = 1;
+}
+
+static int
+bench_corpc_send(crt_context_t ctx, crt_opcode_t opc, crt_bulk_t bulk_hdl,
+		 uint32_t seq, int topo)
+{
+	d_rank_t		 excluded_rank = 0;
+	d_rank_list_t		 excluded = {&excluded_rank, 1};
+	struct bench_corpc_in	*in;
+	crt_rpc_t		*rpc;
+	int			 rc;
+
+	rc = crt_corpc_req_create(ctx, NULL, &excluded, opc, bulk_hdl, NULL,
+				  0, topo, &rpc);
+	if (rc != 0)
+		return rc;
+
+	in = crt_req_get(rpc);
+	in->bc_seq = seq;
+
+	g_done = 0;
+	rc = crt_req_send(rpc, bench_corpc_cb, NULL);
+	if (rc != 0)
+		return rc;
+
+	while (!g_done)
+		crt_progress(ctx, 1000, NULL, NULL);
+
+	return g_rc;
+}
+
+static int
+bench_run(crt_context_t ctx, int t, size_t size, uint32_t iters)
+{
+	static uint32_t	 seq;
+	struct timespec	 start, end;
+	d_sg_list_t	 sgl;
+	d_iov_t		 iov;
+	crt_bulk_t	 bulk_hdl;
+	uint8_t		*buf;
+	double		 usecs;
+	size_t		 off;
+	uint32_t	 i;
+	int		 topo;
+	int		 rc;
+
+	D_ALLOC(buf, size);
+	if (buf == NULL)
+		return -DER_NOMEM;
+
+	d_iov_set(&iov, buf, size);
+	sgl.sg_nr = 1;
+	sgl.sg_iovs = &iov;
+	rc = crt_bulk_create(ctx, &sgl, CRT_BULK_RO, &bulk_hdl);
+	if (rc != 0)
+		D_GOTO(out_free, rc);
+
+	topo = crt_tree_topo(bench_topos[t].bt_type, bench_topos[t].bt_ratio);
+
+	/* warm up the connections and the tree */
+	for (off = 0; off < size; off++)
+		buf[off] = bench_pattern(seq, off);
+	rc = bench_corpc_send(ctx, BENCH_CORPC_BULK, bulk_hdl, seq++, topo);
+	if (rc != 0)
+		D_GOTO(out_bulk, rc);
+
+	usecs = 0;
+	for (i = 0; i < iters; i++) {
+		for (off = 0; off < size; off++)
+			buf[off] = bench_pattern(seq, off);
+
+		d_gettime(&start);
+		rc = bench_corpc_send(ctx, BENCH_CORPC_BULK, bulk_hdl, seq++,
+				      topo);
+		d_gettime(&end);
+		if (rc != 0)
+			D_GOTO(out_bulk, rc);
+		usecs += d_time2us(d_timediff(start, end));
+	}
+
+	usecs /= iters;
+	printf("%-11s %12zu %12.1f %10.1f\n", bench_topos[t].bt_name, size,
+	       usecs, (double)size / usecs);
+
+out_bulk:
+	crt_bulk_free(bulk_hdl);
+out_free:
+	D_FREE(buf);
+	return rc;
+}
+
+int
+main(int argc, char **argv)
+{
+	size_t		 sizes[BENCH_MAX_RUNS] = {1 << 12, 1 << 16, 1 << 20,
+						  1 << 24};
+	int		 sizes_cnt = 4;
+	uint32_t	 iters = 20;
+	crt_context_t	 ctx;
+	d_rank_t	 my_rank;
+	uint64_t	 vals[BENCH_MAX_RUNS];
+	int		 i, t, c;
+	int		 rc;
+
+	while ((c = getopt(argc, argv, "s:i:")) != -1) {
+		switch (c) {
+		case 's':
+			sizes_cnt = bench_list_parse(optarg, vals);
+			for (i = 0; i < sizes_cnt; i++)
+				sizes[i] = vals[i];
+			break;
+		case 'i':
+			iters = atoi(optarg);
+			break;
+		default:
+			fprintf(stderr, "Usage: %s [-s size1,size2,...] "
+				"[-i iters]\n", argv[0]);
+			return -1;
+		}
+	}
+	if (iters == 0)
+		iters = 1;
+
+	rc = crt_init(NULL, CRT_FLAG_BIT_SERVER);
+	assert(rc == 0);
+
+	rc = CRT_RPC_CORPC_REGISTER(BENCH_CORPC_BULK, bench_corpc,
+				    bench_corpc_hdlr, &bench_corpc_ops);
+	assert(rc == 0);
+	rc = CRT_RPC_CORPC_REGISTER(BENCH_CORPC_SHUTDOWN, bench_corpc,
+				    bench_shutdown_hdlr, &bench_corpc_ops);
+	assert(rc == 0);
+
+	rc = crt_context_create(&ctx);
+	assert(rc == 0);
+
+	rc = crt_group_rank(NULL, &my_rank);
+	assert(rc == 0);
+
+	if (my_rank == 0) {
+		printf("%-11s %12s %12s %10s\n", "topo", "bytes",
+		       "usec/bcast", "MB/s");
+		for (i = 0; i < sizes_cnt; i++) {
+			if (sizes[i] == 0)
+				continue;
+			for (t = 0; t < ARRAY_SIZE(bench_topos); t++) {
+				rc = bench_run(ctx, t, sizes[i], iters);
+				if (rc != 0) {
+					fprintf(stderr, "bench_run failed, "
+						"rc: %d.\n", rc);
+					D_GOTO(out, rc);
+				}
+			}
+		}
+out:
+		bench_corpc_send(ctx, BENCH_CORPC_SHUTDOWN, CRT_BULK_NULL, 0,
+				 crt_tree_topo(CRT_TREE_KNOMIAL, 4));
+	} else {
+		while (!g_shutdown)
+			crt_progress(ctx, 1000, NULL, NULL);
+	}
+
+	/* Progress for a while to make sure we forward to all children */
+	for (i = 0; i < 1000; i++)
+		crt_progress(ctx, 1000, NULL, NULL);
+
+	crt_context_destroy(ctx, true);
+	crt_finalize();
+
+	return rc;
+}
@@ -0,0 +1,303 @@
+/* Copyright (C) 2018 Intel Corporation
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted for any purpose (including commercial purposes)
+ * provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions, and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions, and the following disclaimer in the
+ *    documentation and/or materials provided with the distribution.
+ *
+ * 3. In addition, redistributions of modified forms of the source or binary
+ *    code must carry prominent notices stating that the original code was
+ *    changed and the date of the change.
+ *
+ *  4. All publications or advertising materials mentioning features or use of
+ *     this software are asked, but not required, to acknowledge that it was
+ *     developed by Intel Corporation and credit the contributors.
+ *
+ * 5. Neither the name of Intel Corporation, nor the name of any Contributor
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+/**
+ * Micro benchmark of the per-endpoint in-flight (epi) lookup of crt_context.
+ *
+ * It compares the lookup of the epi by rank through a d_hash_table protected
+ * by a mutex, as crt_context_req_track() used to do with 8 buckets, and
+ * through the lockless d_rank_map, across peer counts and threads.
+ *
+ * Usage: bench_epi [-n peers1,peers2,...] [-t threads] [-i lookups]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <stdint.h>
+#include <string.h>
+#include <pthread.h>
+
+#include <gurt/common.h>
+#include <gurt/hash.h>
+#include <gurt/rankmap.h>
+#include "bench_common.h"
+
+#define BENCH_MAX_THREADS	(64)
+
+struct bench_epi {
+	d_list_t		be_link;
+	d_rank_t		be_rank;
+	unsigned int		be_ref;
+	uint64_t		be_hits;
+};
+
+enum bench_type {
+	BENCH_HASH_8,
+	BENCH_HASH_256,
+	BENCH_RANK_MAP,
+	BENCH_TYPE_NUM,
+};
+
+static const char *bench_type_str[BENCH_TYPE_NUM] = {
+	"hash(8)", "hash(256)", "rank_map"
+};
+
+struct bench_arg {
+	enum bench_type		 ba_type;
+	struct d_hash_table	*ba_htable;
+	pthread_mutex_t		*ba_mutex;
+	struct d_rank_map	*ba_map;
+	uint32_t		 ba_peers;
+	uint32_t		 ba_iters;
+	unsigned int		 ba_seed;
+};
+
+static struct bench_epi *
+bench_link2epi(d_list_t *rlink)
+{
+	return container_of(rlink, struct bench_epi, be_link);
+}
+
+static uint32_t
+bench_key_hash(struct d_hash_table *htable, const void *key,
+	       unsigned int ksize)
+{
+	return *(const uint32_t *)key % (1U << htable->ht_bits);
+}
+
+static bool
+bench_key_cmp(struct d_hash_table *htable, d_list_t *rlink,
+	      const void *key, unsigned int ksize)
+{
+	return bench_link2epi(rlink)->be_rank == *(const d_rank_t *)key;
+}
+
+static void
+bench_rec_addref(struct d_hash_table *htable, d_list_t *rlink)
+{
+	bench_link2epi(rlink)->be_ref++;
+}
+
+static bool
+bench_rec_decref(struct d_hash_table *htable, d_list_t *rlink)
+{
+	return --bench_link2epi(rlink)->be_ref == 0;
+}
+
+static d_hash_table_ops_t bench_table_ops = {
+	.hop_key_hash		= bench_key_hash,
+	.hop_key_cmp		= bench_key_cmp,
+	.hop_rec_addref		= bench_rec_addref,
+	.hop_rec_decref		= bench_rec_decref,
+};
+
+static void *
+bench_thread(void *data)
+{
+	struct bench_arg	*arg = data;
+	struct bench_epi	*epi;
+	d_list_t		*rlink;
+	d_rank_t		 rank;
+	uint32_t		 i;
+
+	for (i = 0; i < arg->ba_iters; i++) {
+		rank = rand_r(&arg->ba_seed) % arg->ba_peers;
+		if (arg->ba_type == BENCH_RANK_MAP) {
+			epi = d_rank_map_lookup(arg->ba_map, rank);
+			D_ASSERT(epi != NULL);
+			continue;
+		}
+
+		/* find + decref under the context mutex */
+		D_MUTEX_LOCK(arg->ba_mutex);
+		rlink = d_hash_rec_find(arg->ba_htable, &rank, sizeof(rank));
+		D_ASSERT(rlink != NULL);
+		d_hash_rec_decref(arg->ba_htable, rlink);
+		D_MUTEX_UNLOCK(arg->ba_mutex);
+	}
+
+	return NULL;
+}
+
+static int
+bench_run(enum bench_type type, uint32_t peers, int threads, uint32_t iters)
+{
+	struct d_hash_table	 htable;
+	struct d_rank_map	 map;
+	pthread_mutex_t		 mutex;
+	struct bench_epi	*epis;
+	struct bench_arg	 args[BENCH_MAX_THREADS];
+	pthread_t		 tids[BENCH_MAX_THREADS];
+	struct timespec		 start, end;
+	double			 secs;
+	uint32_t		 i;
+	int			 rc;
+
+	D_ALLOC_ARRAY(epis, peers);
+	if (epis == NULL)
+		return -DER_NOMEM;
+
+	rc = D_MUTEX_INIT(&mutex, NULL);
+	if (rc != 0)
+		D_GOTO(out_free, rc);
+	rc = d_hash_table_create_inplace(D_HASH_FT_NOLOCK,
+					 type == BENCH_HASH_8 ? 3 : 8,
+					 NULL, &bench_table_ops, &htable);
+	if (rc != 0)
+		D_GOTO(out_mutex, rc);
+	rc = d_rank_map_init(&map, peers);
+	if (rc != 0)
+		D_GOTO(out_htable, rc);
+
+	for (i = 0; i < peers; i++) {
+		epis[i].be_rank = i;
+		rc = d_hash_rec_insert(&htable, &i, sizeof(i),
+				       &epis[i].be_link, true);
+		if (rc == 0)
+			rc = d_rank_map_set(&map, i, &epis[i]);
+		if (rc != 0)
+			D_GOTO(out_map, rc);
+	}
+
+	d_gettime(&start);
+	for (i = 0; i < threads; i++) {
+		args[i].ba_type = type;
+		args[i].ba_htable = &htable;
+		args[i].ba_mutex = &mutex;
+		args[i].ba_map = &map;
+		args[i].ba_peers = peers;
+		args[i].ba_iters = iters;
+		args[i].ba_seed = i + 1;
+		rc = pthread_create(&tids[i], NULL, bench_thread, &args[i]);
+		if (rc != 0) {
+			threads = i;
+			rc = d_errno2der(rc);
+			break;
+		}
+	}
+	for (i = 0; i < threads; i++)
+		pthread_join(tids[i], NULL);
+	d_gettime(&end);
+
+	if (rc == 0) {
+		secs = d_time2s(d_timediff(start, end));
+		printf("%-9u %-8d %-10s %12.2f %10.1f\n", peers, threads,
+		       bench_type_str[type],
+		       (double)iters * threads / secs / 1e6,
+		       secs * 1e9 / iters);
+	}
+
+out_map:
+	d_rank_map_fini(&map);
+out_htable:
+	d_hash_table_destroy_inplace(&htable, true /* force */);
+out_mutex:
+	D_MUTEX_DESTROY(&mutex);
+out_free:
+	D_FREE(epis);
+	return rc;
+}
+
+int
+main(int argc, char **argv)
+{
+	uint32_t	peers[BENCH_MAX_RUNS] = {16, 256, 1000, 10000, 100000};
+	int		peers_cnt = 5;
+	int		threads[] = {1, 4};
+	int		thread_max = 4;
+	uint32_t	iters = 1000000;
+	uint64_t	vals[BENCH_MAX_RUNS];
+	int		i, j, c;
+	int		type;
+	int		rc = 0;
+
+	while ((c = getopt(argc, argv, "n:t:i:")) != -1) {
+		switch (c) {
+		case 'n':
+			peers_cnt = bench_list_parse(optarg, vals);
+			for (i = 0; i < peers_cnt; i++)
+				peers[i] = vals[i];
+			break;
+		case 't':
+			thread_max = atoi(optarg);
+			break;
+		case 'i':
+			iters = atoi(optarg);
+			break;
+		default:
+			fprintf(stderr, "Usage: %s [-n peers1,peers2,...] "
+				"[-t threads] [-i lookups]\n", argv[0]);
+			return -1;
+		}
+	}
+	if (thread_max < 1 || thread_max > BENCH_MAX_THREADS) {
+		fprintf(stderr, "threads should be in [1, %d].\n",
+			BENCH_MAX_THREADS);
+		return -1;
+	}
+	threads[1] = thread_max;
+
+	rc = d_log_init();
+	if (rc != 0) {
+		fprintf(stderr, "d_log_init failed, rc: %d.\n", rc);
+		return rc;
+	}
+
+	printf("%-9s %-8s %-10s %12s %10s\n", "peers", "threads", "type",
+	       "Mlookup/s", "ns/lookup");
+	for (i = 0; i < peers_cnt; i++) {
+		if (peers[i] == 0)
+			continue;
+		for (j = 0; j < 2; j++) {
+			if (j == 1 && threads[1] == threads[0])
+				break;
+			for (type = 0; type < BENCH_TYPE_NUM; type++) {
+				rc = bench_run(type, peers[i], threads[j],
+					       iters);
+				if (rc != 0) {
+					fprintf(stderr, "bench_run failed, "
+						"rc: %d.\n", rc);
+					D_GOTO(out, rc);
+				}
+			}
+		}
+	}
+
+out:
+	d_log_fini();
+	return rc;
+}
@@ -0,0 +1,206 @@
+/* Copyright (C) 2018 Intel Corporation
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted for any purpose (including commercial purposes)
+ * provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions, and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions, and the following disclaimer in the
+ *    documentation and/or materials provided with the distribution.
+ *
+ * 3. In addition, redistributions of modified forms of the source or binary
+ *    code must carry prominent notices stating that the original code was
+ *    changed and the date of the change.
+ *
+ *  4. All publications or advertising materials mentioning features or use of
+ *     this software are asked, but not required, to acknowledge that it was
+ *     developed by Intel Corporation and credit the contributors.
+ *
+ * 5. Neither the name of Intel Corporation, nor the name of any Contributor
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+/**
+ * Micro benchmark of the rank list (d_rank_list_t) and rank set (d_rank_set)
+ * operations used for the group membership, for a group of num ranks out of
+ * which 10% are excluded:
+ *  - has:    membership test of a random rank
+ *  - idx:    rank to index of a random member
+ *  - filter: removal of the excluded ranks from the members
+ *  - uniq:   sorted and unique copy of the members given in random order
+ *
+ * Usage: bench_rankset [-n num1,num2,...] [-i iterations]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <gurt/common.h>
+#include <gurt/rankset.h>
+#include "bench_common.h"
+
+/* 1 out of BENCH_EXCLUDE_RATIO ranks excluded */
+#define BENCH_EXCLUDE_RATIO	(10)
+
+static int
+bench_run(uint32_t num, uint32_t iters)
+{
+	d_rank_list_t		*membs = NULL;
+	d_rank_list_t		*shuffled = NULL;
+	d_rank_list_t		*excluded = NULL;
+	d_rank_list_t		*tmp = NULL;
+	struct d_rank_set	 membs_set;
+	struct d_rank_set	 excluded_set;
+	struct d_rank_set	 tmp_set;
+	struct timespec		 start;
+	double			 rl_ns[4], rs_ns[4];
+	uint64_t		 found = 0;
+	uint32_t		 idx;
+	uint32_t		 i, j;
+	d_rank_t		 rank;
+	int			 rc;
+
+	membs = d_rank_list_alloc(num);
+	shuffled = d_rank_list_alloc(num);
+	excluded = d_rank_list_alloc(num / BENCH_EXCLUDE_RATIO);
+	if (membs == NULL || shuffled == NULL || excluded == NULL)
+		D_GOTO(out, rc = -DER_NOMEM);
+	for (i = 0; i < excluded->rl_nr; i++)
+		excluded->rl_ranks[i] = i * BENCH_EXCLUDE_RATIO;
+	for (i = num - 1; i > 0; i--) {
+		j = rand() % (i + 1);
+		rank = shuffled->rl_ranks[i];
+		shuffled->rl_ranks[i] = shuffled->rl_ranks[j];
+		shuffled->rl_ranks[j] = rank;
+	}
+
+	rc = d_rank_set_init(&membs_set, num);
+	if (rc != 0)
+		D_GOTO(out, rc);
+	rc = d_rank_set_init(&excluded_set, num);
+	if (rc != 0)
+		D_GOTO(fini_membs, rc);
+	rc = d_rank_set_add_list(&membs_set, membs);
+	if (rc != 0)
+		D_GOTO(fini_excluded, rc);
+	rc = d_rank_set_add_list(&excluded_set, excluded);
+	if (rc != 0)
+		D_GOTO(fini_excluded, rc);
+
+	/* rank list */
+	d_gettime(&start);
+	for (i = 0; i < iters; i++)
+		found += d_rank_in_rank_list(membs, rand() % (num * 2));
+	rl_ns[0] = bench_ns_per_op(&start, iters);
+
+	d_gettime(&start);
+	for (i = 0; i < iters; i++)
+		found += d_idx_in_rank_list(membs, rand() % num, &idx) == 0;
+	rl_ns[1] = bench_ns_per_op(&start, iters);
+
+	rc = d_rank_list_dup(&tmp, membs);
+	if (rc != 0)
+		D_GOTO(fini_excluded, rc);
+	d_gettime(&start);
+	d_rank_list_filter(excluded, tmp, true /* exclude */);
+	rl_ns[2] = bench_ns_per_op(&start, 1);
+	d_rank_list_free(tmp);
+	tmp = NULL;
+
+	d_gettime(&start);
+	rc = d_rank_list_dup_sort_uniq(&tmp, shuffled);
+	rl_ns[3] = bench_ns_per_op(&start, 1);
+	d_rank_list_free(tmp);
+	tmp = NULL;
+	if (rc != 0)
+		D_GOTO(fini_excluded, rc);
+
+	/* rank set */
+	d_gettime(&start);
+	for (i = 0; i < iters; i++)
+		found += d_rank_set_has(&membs_set, rand() % (num * 2));
+	rs_ns[0] = bench_ns_per_op(&start, iters);
+
+	d_gettime(&start);
+	for (i = 0; i < iters; i++)
+		found += d_rank_set_idx(&membs_set, rand() % num, &idx) == 0;
+	rs_ns[1] = bench_ns_per_op(&start, iters);
+
+	rc = d_rank_set_init(&tmp_set, num);
+	if (rc != 0)
+		D_GOTO(fini_excluded, rc);
+	rc = d_rank_set_union(&tmp_set, &membs_set);
+	if (rc != 0)
+		D_GOTO(fini_tmp, rc);
+	d_gettime(&start);
+	d_rank_set_diff(&tmp_set, &excluded_set);
+	rs_ns[2] = bench_ns_per_op(&start, 1);
+	d_rank_set_fini(&tmp_set);
+
+	rc = d_rank_set_init(&tmp_set, 0);
+	if (rc != 0)
+		D_GOTO(fini_excluded, rc);
+	d_gettime(&start);
+	rc = d_rank_set_add_list(&tmp_set, shuffled);
+	if (rc == 0)
+		rc = d_rank_set_to_list(&tmp_set, &tmp);
+	rs_ns[3] = bench_ns_per_op(&start, 1);
+	d_rank_list_free(tmp);
+	if (rc != 0)
+		D_GOTO(fini_tmp, rc);
+
+	printf("%-9u %-9s %10.1f %10.1f %12.0f %12.0f\n", num, "list",
+	       rl_ns[0], rl_ns[1], rl_ns[2], rl_ns[3]);
+	printf("%-9u %-9s %10.1f %10.1f %12.0f %12.0f\n", num, "set",
+	       rs_ns[0], rs_ns[1], rs_ns[2], rs_ns[3]);
+	/* keep the lookups from being optimized out */
+	D_DEBUG(DB_TRACE, "found "DF_U64"\n", found);
+
+fini_tmp:
+	d_rank_set_fini(&tmp_set);
+fini_excluded:
+	d_rank_set_fini(&excluded_set);
+fini_membs:
+	d_rank_set_fini(&membs_set);
+out:
+	d_rank_list_free(excluded);
+	d_rank_list_free(shuffled);
+	d_rank_list_free(membs);
+	return rc;
+}
+
+int
+main(int argc, char **argv)
+{
+	struct bench_desc	desc = {
+		.bd_nums	= {1000, 100000},
+		.bd_nums_cnt	= 2,
+		.bd_iters	= 10000,
+		.bd_num_min	= BENCH_EXCLUDE_RATIO,
+		.bd_run		= bench_run,
+	};
+	char			header[128];
+
+	snprintf(header, sizeof(header), "%-9s %-9s %10s %10s %12s %12s",
+		 "num", "type", "has", "idx", "filter", "uniq");
+	desc.bd_header = header;
+
+	return bench_main(argc, argv, &desc);
+}
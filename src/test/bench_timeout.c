@@ -0,0 +1,230 @@
+/* Copyright (C) 2018 Intel Corporation
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted for any purpose (including commercial purposes)
+ * provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions, and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions, and the following disclaimer in the
+ *    documentation and/or materials provided with the distribution.
+ *
+ * 3. In addition, redistributions of modified forms of the source or binary
+ *    code must carry prominent notices stating that the original code was
+ *    changed and the date of the change.
+ *
+ *  4. All publications or advertising materials mentioning features or use of
+ *     this software are asked, but not required, to acknowledge that it was
+ *     developed by Intel Corporation and credit the contributors.
+ *
+ * 5. Neither the name of Intel Corporation, nor the name of any Contributor
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+/**
+ * Micro benchmark of the RPC timeout tracking structures, it compares the
+ * binary heap (d_binheap) with the timing wheel (d_timewheel) used by
+ * crt_context for the outstanding RPCs.
+ *
+ * For each number of outstanding requests it measures:
+ *  - track:   insert of all requests
+ *  - retrack: untrack + track of a random request (a reply followed by a new
+ *             request) with all other requests outstanding
+ *  - check:   the per-progress timeout check when nothing expires
+ *  - untrack: remove all requests in random order
+ *
+ * Usage: bench_timeout [-n num1,num2,...] [-i iterations]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <gurt/common.h>
+#include <gurt/heap.h>
+#include <gurt/timewheel.h>
+#include "bench_common.h"
+
+#define BENCH_TICK_US		(1000)
+
+struct bench_req {
+	struct d_binheap_node	br_bh_node;
+	struct d_tw_node	br_tw_node;
+	uint64_t		br_timeout_ts;
+};
+
+static bool
+bench_bh_cmp(struct d_binheap_node *a, struct d_binheap_node *b)
+{
+	struct bench_req	*ra, *rb;
+
+	ra = container_of(a, struct bench_req, br_bh_node);
+	rb = container_of(b, struct bench_req, br_bh_node);
+
+	return ra->br_timeout_ts < rb->br_timeout_ts;
+}
+
+static struct d_binheap_ops bench_bh_ops = {
+	.hop_compare	= bench_bh_cmp,
+};
+
+/* timeout between 1 and 60 seconds from now, like CRT_TIMEOUT */
+static inline uint64_t
+bench_timeout_ts(uint64_t now)
+{
+	return now + 1000000ULL + (uint64_t)(rand() % 59000) * 1000;
+}
+
+static int
+bench_run(uint32_t num, uint32_t iters)
+{
+	struct bench_req	*reqs;
+	uint32_t		*order;
+	struct d_binheap	 bh;
+	struct d_timewheel	 tw;
+	struct d_binheap_node	*bh_node;
+	struct bench_req	*req;
+	d_list_t		 expired;
+	struct timespec		 start;
+	double			 bh_ns[4], tw_ns[4];
+	uint64_t		 now;
+	uint32_t		 i, j, tmp;
+	int			 rc;
+
+	D_ALLOC_ARRAY(reqs, num);
+	D_ALLOC_ARRAY(order, num);
+	if (reqs == NULL || order == NULL)
+		D_GOTO(out, rc = -DER_NOMEM);
+
+	now = d_timeus_secdiff(0);
+	for (i = 0; i < num; i++) {
+		reqs[i].br_timeout_ts = bench_timeout_ts(now);
+		order[i] = i;
+	}
+	/* random untrack order */
+	for (i = num - 1; i > 0; i--) {
+		j = rand() % (i + 1);
+		tmp = order[i];
+		order[i] = order[j];
+		order[j] = tmp;
+	}
+
+	rc = d_binheap_create_inplace(DBH_FT_NOLOCK, 0, NULL, &bench_bh_ops,
+				      &bh);
+	if (rc != 0)
+		D_GOTO(out, rc);
+	rc = d_timewheel_create_inplace(BENCH_TICK_US, now, &tw);
+	if (rc != 0) {
+		d_binheap_destroy_inplace(&bh);
+		D_GOTO(out, rc);
+	}
+	D_INIT_LIST_HEAD(&expired);
+
+	/* binary heap */
+	d_gettime(&start);
+	for (i = 0; i < num; i++) {
+		rc = d_binheap_insert(&bh, &reqs[i].br_bh_node);
+		if (rc != 0)
+			D_GOTO(destroy, rc);
+	}
+	bh_ns[0] = bench_ns_per_op(&start, num);
+
+	d_gettime(&start);
+	for (i = 0; i < iters; i++) {
+		req = &reqs[order[i % num]];
+		d_binheap_remove(&bh, &req->br_bh_node);
+		req->br_timeout_ts = bench_timeout_ts(now);
+		rc = d_binheap_insert(&bh, &req->br_bh_node);
+		if (rc != 0)
+			D_GOTO(destroy, rc);
+	}
+	bh_ns[1] = bench_ns_per_op(&start, iters);
+
+	d_gettime(&start);
+	for (i = 0; i < iters; i++) {
+		bh_node = d_binheap_root(&bh);
+		req = container_of(bh_node, struct bench_req, br_bh_node);
+		if (req->br_timeout_ts <= now)
+			break;
+	}
+	bh_ns[2] = bench_ns_per_op(&start, iters);
+
+	d_gettime(&start);
+	for (i = 0; i < num; i++)
+		d_binheap_remove(&bh, &reqs[order[i]].br_bh_node);
+	bh_ns[3] = bench_ns_per_op(&start, num);
+
+	/* timing wheel */
+	d_gettime(&start);
+	for (i = 0; i < num; i++)
+		d_timewheel_insert(&tw, &reqs[i].br_tw_node,
+				   reqs[i].br_timeout_ts);
+	tw_ns[0] = bench_ns_per_op(&start, num);
+
+	d_gettime(&start);
+	for (i = 0; i < iters; i++) {
+		req = &reqs[order[i % num]];
+		d_timewheel_remove(&tw, &req->br_tw_node);
+		req->br_timeout_ts = bench_timeout_ts(now);
+		d_timewheel_insert(&tw, &req->br_tw_node, req->br_timeout_ts);
+	}
+	tw_ns[1] = bench_ns_per_op(&start, iters);
+
+	d_gettime(&start);
+	for (i = 0; i < iters; i++) {
+		if (d_timewheel_pending(&tw, now))
+			d_timewheel_expire(&tw, now, &expired);
+	}
+	tw_ns[2] = bench_ns_per_op(&start, iters);
+
+	d_gettime(&start);
+	for (i = 0; i < num; i++)
+		d_timewheel_remove(&tw, &reqs[order[i]].br_tw_node);
+	tw_ns[3] = bench_ns_per_op(&start, num);
+
+	printf("%-9u %-9s %10.1f %10.1f %10.1f %10.1f\n", num, "binheap",
+	       bh_ns[0], bh_ns[1], bh_ns[2], bh_ns[3]);
+	printf("%-9u %-9s %10.1f %10.1f %10.1f %10.1f\n", num, "timewheel",
+	       tw_ns[0], tw_ns[1], tw_ns[2], tw_ns[3]);
+
+destroy:
+	d_timewheel_destroy_inplace(&tw);
+	d_binheap_destroy_inplace(&bh);
+out:
+	D_FREE(order);
+	D_FREE(reqs);
+	return rc;
+}
+
+int
+main(int argc, char **argv)
+{
+	struct bench_desc	desc = {
+		.bd_nums	= {1000, 100000, 1000000},
+		.bd_nums_cnt	= 3,
+		.bd_iters	= 1000000,
+		.bd_run		= bench_run,
+	};
+	char			header[128];
+
+	snprintf(header, sizeof(header), "%-9s %-9s %10s %10s %10s %10s",
+		 "num", "type", "track", "retrack", "check", "untrack");
+	desc.bd_header = header;
+
+	return bench_main(argc, argv, &desc);
+}
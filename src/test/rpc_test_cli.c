@@ -60,6 +60,8 @@ crt_client_cb(const struct crt_cb_info *cb_info)
 				crt_req_get(cb_info->cci_rpc);
 	struct crt_rpc_io_out	*rpc_srv_ouput =
 				crt_reply_get(cb_info->cci_rpc);
+	struct crt_test_iov_auto_in	*iov_auto_input;
+	struct crt_test_iov_auto_out	*iov_auto_output;
 
 	dbg("---%s--->", __func__);
 	dbg("opc:%x\tcci_rc: %d\t-DER_TIMEDOUT:=%i\n",
@@ -106,6 +108,28 @@ crt_client_cb(const struct crt_cb_info *cb_info)
 			((cb_info->cci_rc == 0) ? ("Passed") :
 			("Failed")), cb_info->cci_rc);
 		break;
+	case CRT_RPC_TEST_IOV_AUTO:
+		dbg("CRT_RPC_TEST_IOV_AUTO\n");
+		iov_auto_input = crt_req_get(cb_info->cci_rpc);
+		iov_auto_output = crt_reply_get(cb_info->cci_rpc);
+		D_ASSERTF(cb_info->cci_rc == 0, "auto iov rpc failed %d\n",
+			  cb_info->cci_rc);
+		D_ASSERTF(iov_auto_output->rc == 0 &&
+			  iov_auto_output->len ==
+			  iov_auto_input->data.ia_iov.iov_len,
+			  "payload of "DF_U64" bytes received as "DF_U64
+			  " bytes, rc:=%d\n",
+			  iov_auto_input->data.ia_iov.iov_len,
+			  iov_auto_output->len, iov_auto_output->rc);
+		/* only the small payload fits in the eager message */
+		D_ASSERTF(iov_auto_output->bulk ==
+			  (iov_auto_output->len > RPC_TEST_IOV_AUTO_SMALL),
+			  "payload of "DF_U64" bytes sent %s\n",
+			  iov_auto_output->len,
+			  iov_auto_output->bulk ? "by bulk" : "inline");
+		printf("\nRPC auto iov test of "DF_U64" bytes Passed\n\n",
+			iov_auto_output->len);
+		break;
 	case CRT_RPC_TEST_TIMEOUT:
 		dbg("CRT_RPC_TEST_TIMEOUT");
 		printf("\nRPC timeout test %s with rc:=%d\n\n",
@@ -332,6 +356,40 @@ rpc_io_test(void)
 	dbg("---%s--->", __func__);
 }
 
+void
+rpc_iov_auto_test(void)
+{
+	size_t				 sizes[] = {RPC_TEST_IOV_AUTO_SMALL,
+						    RPC_TEST_IOV_AUTO_LARGE};
+	struct crt_test_iov_auto_in	*cli_rpc_input;
+	crt_rpc_t			*rpc_req = NULL;
+	uint8_t				*buf;
+	size_t				 off;
+	int				 i;
+
+	dbg("---%s--->", __func__);
+
+	for (i = 0; i < ARRAY_SIZE(sizes); i++) {
+		D_ALLOC(buf, sizes[i]);
+		D_ASSERT(buf != NULL);
+		for (off = 0; off < sizes[i]; off++)
+			buf[off] = rpc_test_iov_auto_pattern(i, off);
+
+		create_rpc(rpc_cli.target_group[0], 0, CRT_RPC_TEST_IOV_AUTO,
+			   &rpc_req);
+		cli_rpc_input = crt_req_get(rpc_req);
+		D_ASSERT(cli_rpc_input != NULL);
+		cli_rpc_input->seq = i;
+		d_iov_set(&cli_rpc_input->data.ia_iov, buf, sizes[i]);
+
+		send_rpc_req(rpc_req, crt_client_cb);
+
+		D_FREE(buf);
+	}
+
+	dbg("<---%s---", __func__);
+}
+
 void
 rpc_timeout_test(void)
 {
@@ -456,6 +514,10 @@ single_rpc_test(void)
 
 	rpc_io_test();
 
+	/* AUTO IOV */
+
+	rpc_iov_auto_test();
+
 	/* TIMEOUT */
 
 	rpc_timeout_test();
@@ -503,6 +565,9 @@ cli_rpc_init(void)
 	rc = CRT_RPC_REGISTER(CRT_RPC_TEST_TIMEOUT, 0, crt_test_timeout);
 	D_ASSERTF(rc == 0, "crt_rpc_register failed %d\n", rc);
 
+	rc = CRT_RPC_REGISTER(CRT_RPC_TEST_IOV_AUTO, 0, crt_test_iov_auto);
+	D_ASSERTF(rc == 0, "crt_rpc_register failed %d\n", rc);
+
 	rc = CRT_RPC_REGISTER(CRT_RPC_TEST_SHUTDOWN,
 			      CRT_RPC_FEAT_NO_REPLY, crt_test_shutdown);
 	D_ASSERTF(rc == 0, "crt_rpc_register failed %d\n", rc);
@@ -60,6 +60,9 @@ CRT_RPC_TEST_ERR =		(0x54312e32),
 /* T1.3:-Test TIMEOUT */
 CRT_RPC_TEST_TIMEOUT =		(0x54312e33),
 
+/* T1.4:-Test auto iov, inlined and sent by bulk */
+CRT_RPC_TEST_IOV_AUTO =		(0x54312e34),
+
 /* T0:-shutdown server without sending reply */
 CRT_RPC_TEST_SHUTDOWN =		(0x5430),
 
@@ -92,6 +95,22 @@ CRT_RPC_MULTITIER_TEST_NO_IO =	(0x54312e71)
 
 #define CRT_OSEQ_TEST_TIMEOUT	/* output fields */
 
+/*
+ * Payloads of the auto iov test, below and well above the eager size of the
+ * transports. bulk tells whether the server got the payload through a bulk.
+ */
+#define RPC_TEST_IOV_AUTO_SMALL	(64)
+#define RPC_TEST_IOV_AUTO_LARGE	(1 << 20)
+
+#define CRT_ISEQ_TEST_IOV_AUTO	/* input fields */		 \
+	((uint32_t)		(seq)			CRT_VAR) \
+	((crt_iov_auto_t)	(data)			CRT_VAR)
+
+#define CRT_OSEQ_TEST_IOV_AUTO	/* output fields */		 \
+	((int32_t)		(rc)			CRT_VAR) \
+	((uint64_t)		(len)			CRT_VAR) \
+	((uint32_t)		(bulk)			CRT_VAR)
+
 CRT_RPC_DECLARE(crt_rpc_io, CRT_ISEQ_TEST_IO, CRT_OSEQ_TEST_IO)
 CRT_RPC_DEFINE(crt_rpc_io, CRT_ISEQ_TEST_IO, CRT_OSEQ_TEST_IO)
 
@@ -104,6 +123,11 @@ CRT_RPC_DEFINE(crt_test_timeout, CRT_ISEQ_TEST_IO, CRT_OSEQ_TEST_TIMEOUT)
 CRT_RPC_DECLARE(crt_multitier_test_io, CRT_ISEQ_TEST_IO, CRT_OSEQ_TEST_IO)
 CRT_RPC_DEFINE(crt_multitier_test_io, CRT_ISEQ_TEST_IO, CRT_OSEQ_TEST_IO)
 
+CRT_RPC_DECLARE(crt_test_iov_auto, CRT_ISEQ_TEST_IOV_AUTO,
+		CRT_OSEQ_TEST_IOV_AUTO)
+CRT_RPC_DEFINE(crt_test_iov_auto, CRT_ISEQ_TEST_IOV_AUTO,
+	       CRT_OSEQ_TEST_IOV_AUTO)
+
 #define CRT_ISEQ_NULL		/* input fields */
 
 #define CRT_OSEQ_NULL		/* output fields */
@@ -164,6 +188,12 @@ struct rpc_test_srv {
 
 void crt_lm_fake_event_notify_fn(d_rank_t pmix_rank, bool *dead);
 
+static inline uint8_t
+rpc_test_iov_auto_pattern(uint32_t seq, size_t off)
+{
+	return (uint8_t)(seq * 31 + off);
+}
+
 #define DBG(fmt, ...)				\
 	printf("%s[%d]\t[%d]"fmt"\n",	\
 	(strrchr(__FILE__, '/')+1), __LINE__, getpid(), ##__VA_ARGS__)
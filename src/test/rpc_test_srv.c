@@ -90,6 +90,44 @@ crt_srv_io_op_cb(crt_rpc_t *rpc_req)
 	dbg("<---%s---", __func__);
 }
 
+void
+crt_srv_iov_auto_cb(crt_rpc_t *rpc_req)
+{
+	struct crt_test_iov_auto_in	*rpc_cli_input;
+	struct crt_test_iov_auto_out	*rpc_srv_output;
+	uint8_t				*buf;
+	size_t				 off;
+
+	dbg("---%s--->", __func__);
+
+	rpc_cli_input = crt_req_get(rpc_req);
+	D_ASSERT(rpc_cli_input != NULL);
+	rpc_srv_output = crt_reply_get(rpc_req);
+	D_ASSERT(rpc_srv_output != NULL);
+
+	/* the remote handle is kept in the input when the payload was pulled */
+	rpc_srv_output->rc = 0;
+	rpc_srv_output->len = rpc_cli_input->data.ia_iov.iov_len;
+	rpc_srv_output->bulk = rpc_cli_input->data.ia_bulk != CRT_BULK_NULL;
+
+	buf = rpc_cli_input->data.ia_iov.iov_buf;
+	for (off = 0; off < rpc_srv_output->len; off++) {
+		if (buf[off] != rpc_test_iov_auto_pattern(rpc_cli_input->seq,
+							  off)) {
+			D_ERROR("payload %u differs at offset %zu\n",
+				rpc_cli_input->seq, off);
+			rpc_srv_output->rc = -DER_MISMATCH;
+			break;
+		}
+	}
+
+	dbg("seq:=%u\tlen:="DF_U64"\tbulk:=%u\trc:=%d\n",
+	rpc_cli_input->seq, rpc_srv_output->len, rpc_srv_output->bulk,
+	rpc_srv_output->rc);
+
+	dbg("<---%s---", __func__);
+}
+
 void
 crt_srv_err_noop(crt_rpc_t *rpc_req)
 {
@@ -183,6 +221,10 @@ srv_common_cb(crt_rpc_t *rpc_req)
 	case CRT_RPC_TEST_NO_IO:
 		dbg("CRT_RPC_TEST_NO_IO\n");
 		break;
+	case CRT_RPC_TEST_IOV_AUTO:
+		dbg("CRT_RPC_TEST_IOV_AUTO\n");
+		crt_srv_iov_auto_cb(rpc_req);
+		break;
 	case CRT_RPC_TEST_GRP_IO:
 		dbg("CRT_RPC_TEST_GRP_IO\n");
 		srv_corpc_io(rpc_req);
@@ -540,6 +582,10 @@ srv_rpc_init(void)
 				  crt_test_timeout, srv_common_cb);
 	D_ASSERTF(rc == 0, " crt_rpc_srv_register failed %d\n", rc);
 
+	rc = CRT_RPC_SRV_REGISTER(CRT_RPC_TEST_IOV_AUTO, 0,
+				  crt_test_iov_auto, srv_common_cb);
+	D_ASSERTF(rc == 0, " crt_rpc_srv_register failed %d\n", rc);
+
 	rc = crt_rpc_srv_register(CRT_RPC_TEST_SHUTDOWN,
 				  CRT_RPC_FEAT_NO_REPLY, NULL,
 				  srv_common_cb);
@@ -44,6 +44,8 @@
 #include <assert.h>
 #include <getopt.h>
 #include <semaphore.h>
+#include <fcntl.h>
+#include <sys/stat.h>
 
 #include <gurt/common.h>
 #include <gurt/fault_inject.h>
@@ -67,6 +69,15 @@ struct test_t {
 	int		 t_infinite_loop;
 	int		 t_hold;
 	uint32_t	 t_hold_time;
+	/* attach info of the PSR only, prefetch the other URIs */
+	int		 t_prefetch;
+	/* reattach with the binary attach info missing or damaged */
+	int		 t_attach_info;
+	/* have the servers broadcast a bulk and check it */
+	int		 t_corpc_bulk;
+	/* progress all the contexts from one thread */
+	int		 t_progress_set;
+	crt_progress_set_t t_ps;
 	unsigned int	 t_ctx_num;
 	crt_context_t	 t_crt_ctx[TEST_CTX_MAX_NUM];
 	int		 t_thread_id[TEST_CTX_MAX_NUM]; /* logical tid */
@@ -93,6 +104,50 @@ CRT_RPC_DECLARE(test_ping_check,
 CRT_RPC_DEFINE(test_ping_check,
 		CRT_ISEQ_TEST_PING_CHECK, CRT_OSEQ_TEST_PING_CHECK)
 
+/*
+ * The client asks rank 0 to broadcast a payload over a knomial tree, every
+ * server checks all of it. With CRT_CORPC_BULK_SEG set below the size, the
+ * bulk is forwarded in segments and the last one is short.
+ */
+#define TEST_OPC_CORPC_BULK		0xA3
+#define TEST_OPC_CORPC_BULK_CHECK	0xA4
+#define TEST_CORPC_BULK_SIZE		((1 << 20) + 1)
+
+#define CRT_ISEQ_TEST_CORPC_BULK /* input fields */		 \
+	((uint64_t)		(size)			CRT_VAR) \
+	((uint32_t)		(seq)			CRT_VAR)
+
+#define CRT_OSEQ_TEST_CORPC_BULK /* output fields */		 \
+	((int32_t)		(rc)			CRT_VAR) \
+	((uint32_t)		(nr)			CRT_VAR)
+
+CRT_RPC_DECLARE(test_corpc_bulk,
+		CRT_ISEQ_TEST_CORPC_BULK, CRT_OSEQ_TEST_CORPC_BULK)
+CRT_RPC_DEFINE(test_corpc_bulk,
+		CRT_ISEQ_TEST_CORPC_BULK, CRT_OSEQ_TEST_CORPC_BULK)
+
+#define CRT_ISEQ_TEST_CORPC_BULK_CHECK /* input fields */	 \
+	((uint32_t)		(seq)			CRT_VAR)
+
+/* nr is the number of ranks that checked the payload */
+#define CRT_OSEQ_TEST_CORPC_BULK_CHECK /* output fields */	 \
+	((int32_t)		(rc)			CRT_VAR) \
+	((uint32_t)		(nr)			CRT_VAR)
+
+CRT_RPC_DECLARE(test_corpc_bulk_check,
+		CRT_ISEQ_TEST_CORPC_BULK_CHECK, CRT_OSEQ_TEST_CORPC_BULK_CHECK)
+CRT_RPC_DEFINE(test_corpc_bulk_check,
+		CRT_ISEQ_TEST_CORPC_BULK_CHECK, CRT_OSEQ_TEST_CORPC_BULK_CHECK)
+
+/* the broadcast of a TEST_OPC_CORPC_BULK request on rank 0 */
+struct test_corpc_bulk_arg {
+	crt_rpc_t	*cba_rpc;
+	crt_bulk_t	 cba_bulk;
+	uint8_t		*cba_buf;
+	/* corpc stats of the context before the broadcast */
+	struct crt_corpc_stats cba_stats;
+};
+
 static inline void
 test_sem_timedwait(sem_t *sem, int sec, int line_number)
 {
@@ -177,12 +232,196 @@ test_ping_delay_handler(crt_rpc_t *rpc_req)
 	       p_reply->ret, p_reply->room_no);
 }
 
+static inline uint8_t
+test_corpc_bulk_pattern(uint32_t seq, size_t off)
+{
+	return (uint8_t)(seq * 31 + off);
+}
+
+void
+test_corpc_bulk_check_handler(crt_rpc_t *rpc_req)
+{
+	struct test_corpc_bulk_check_in		*c_req;
+	struct test_corpc_bulk_check_out	*c_reply;
+	d_sg_list_t				 sgl;
+	d_iov_t					 iov;
+	uint8_t					*buf;
+	size_t					 off;
+	int					 rc;
+
+	c_req = crt_req_get(rpc_req);
+	c_reply = crt_reply_get(rpc_req);
+	D_ASSERTF(c_req != NULL && c_reply != NULL,
+		  "crt_req_get() or crt_reply_get() failed.\n");
+
+	sgl.sg_nr = 1;
+	sgl.sg_iovs = &iov;
+	rc = crt_bulk_access(rpc_req->cr_co_bulk_hdl, &sgl);
+	if (rc == 0 && iov.iov_buf_len != TEST_CORPC_BULK_SIZE)
+		rc = -DER_MISMATCH;
+	buf = iov.iov_buf;
+	for (off = 0; rc == 0 && off < iov.iov_buf_len; off++) {
+		if (buf[off] != test_corpc_bulk_pattern(c_req->seq, off)) {
+			D_ERROR("payload %u differs at offset %zu.\n",
+				c_req->seq, off);
+			rc = -DER_MISMATCH;
+		}
+	}
+
+	c_reply->rc = rc;
+	c_reply->nr = 1;
+	rc = crt_reply_send(rpc_req);
+	D_ASSERTF(rc == 0, "crt_reply_send() failed. rc: %d\n", rc);
+
+	printf("rank %d checked corpc payload %u, rc: %d.\n",
+	       test_g.t_my_rank, c_req->seq, c_reply->rc);
+}
+
+static int
+test_corpc_bulk_check_aggregate(crt_rpc_t *source, crt_rpc_t *result,
+				void *priv)
+{
+	struct test_corpc_bulk_check_out	*reply_source;
+	struct test_corpc_bulk_check_out	*reply_result;
+
+	reply_source = crt_reply_get(source);
+	reply_result = crt_reply_get(result);
+	if (reply_result->rc == 0)
+		reply_result->rc = reply_source->rc;
+	reply_result->nr += reply_source->nr;
+
+	return 0;
+}
+
+static struct crt_corpc_ops test_corpc_bulk_check_ops = {
+	.co_aggregate = test_corpc_bulk_check_aggregate,
+};
+
+/*
+ * The broadcast is accounted before its completion callback runs: one corpc
+ * more, with the local reply and one from each child of the root.
+ */
+static void
+test_corpc_stats_check(crt_context_t ctx, struct crt_corpc_stats *before)
+{
+	struct crt_corpc_stats	stats;
+	uint64_t		replies;
+	uint32_t		grp_size;
+	int			rc;
+
+	rc = crt_context_corpc_stats(NULL, &stats);
+	D_ASSERTF(rc == -DER_INVAL, "crt_context_corpc_stats() with no "
+		  "context returned %d\n", rc);
+	rc = crt_context_corpc_stats(ctx, &stats);
+	D_ASSERTF(rc == 0, "crt_context_corpc_stats() failed. rc: %d\n", rc);
+	rc = crt_group_size(NULL, &grp_size);
+	D_ASSERTF(rc == 0, "crt_group_size() failed. rc: %d\n", rc);
+
+	D_ASSERTF(stats.cs_corpc_num == before->cs_corpc_num + 1,
+		  "corpc_num "DF_U64" after "DF_U64"\n", stats.cs_corpc_num,
+		  before->cs_corpc_num);
+	replies = stats.cs_reply_num - before->cs_reply_num;
+	D_ASSERTF(replies >= min(grp_size, 2) && replies <= grp_size,
+		  DF_U64" replies aggregated in a group of %u\n", replies,
+		  grp_size);
+	D_ASSERTF(stats.cs_combined - before->cs_combined <= replies,
+		  "combined "DF_U64" after "DF_U64"\n", stats.cs_combined,
+		  before->cs_combined);
+	D_ASSERTF(stats.cs_agg_ns >= before->cs_agg_ns &&
+		  stats.cs_agg_max_ns >= before->cs_agg_max_ns &&
+		  stats.cs_agg_max_ns <= stats.cs_agg_ns,
+		  "agg_ns "DF_U64" max "DF_U64"\n", stats.cs_agg_ns,
+		  stats.cs_agg_max_ns);
+
+	printf("rank %d aggregated "DF_U64" replies of "DF_U64" corpcs in "
+	       DF_U64" ns.\n", test_g.t_my_rank, stats.cs_reply_num,
+	       stats.cs_corpc_num, stats.cs_agg_ns);
+}
+
+static void
+test_corpc_bulk_cb(const struct crt_cb_info *cb_info)
+{
+	struct test_corpc_bulk_arg		*cb_arg = cb_info->cci_arg;
+	struct test_corpc_bulk_check_out	*c_reply;
+	struct test_corpc_bulk_out		*b_reply;
+	int					 rc;
+
+	c_reply = crt_reply_get(cb_info->cci_rpc);
+	b_reply = crt_reply_get(cb_arg->cba_rpc);
+	b_reply->rc = cb_info->cci_rc != 0 ? cb_info->cci_rc : c_reply->rc;
+	b_reply->nr = c_reply->nr;
+	if (cb_info->cci_rc == 0)
+		test_corpc_stats_check(cb_info->cci_rpc->cr_ctx,
+				       &cb_arg->cba_stats);
+
+	crt_bulk_free(cb_arg->cba_bulk);
+	D_FREE(cb_arg->cba_buf);
+
+	rc = crt_reply_send(cb_arg->cba_rpc);
+	D_ASSERTF(rc == 0, "crt_reply_send() failed. rc: %d\n", rc);
+	crt_req_decref(cb_arg->cba_rpc);
+	D_FREE_PTR(cb_arg);
+}
+
+/* rank 0 broadcasts the payload, the reply is sent once all checked it */
+void
+test_corpc_bulk_handler(crt_rpc_t *rpc_req)
+{
+	struct test_corpc_bulk_in		*b_req;
+	struct test_corpc_bulk_check_in		*c_req;
+	struct test_corpc_bulk_arg		*cb_arg;
+	crt_rpc_t				*corpc_req = NULL;
+	d_sg_list_t				 sgl;
+	d_iov_t					 iov;
+	size_t					 off;
+	int					 rc;
+
+	b_req = crt_req_get(rpc_req);
+	D_ASSERTF(b_req != NULL, "crt_req_get() failed. b_req: %p\n", b_req);
+	printf("rank %d broadcasting corpc payload %u of "DF_U64" bytes.\n",
+	       test_g.t_my_rank, b_req->seq, b_req->size);
+
+	D_ALLOC_PTR(cb_arg);
+	D_ASSERTF(cb_arg != NULL, "Cannot allocate memory.\n");
+	D_ALLOC(cb_arg->cba_buf, b_req->size);
+	D_ASSERTF(cb_arg->cba_buf != NULL, "Cannot allocate memory.\n");
+	for (off = 0; off < b_req->size; off++)
+		cb_arg->cba_buf[off] = test_corpc_bulk_pattern(b_req->seq,
+							       off);
+
+	d_iov_set(&iov, cb_arg->cba_buf, b_req->size);
+	sgl.sg_nr = 1;
+	sgl.sg_iovs = &iov;
+	rc = crt_bulk_create(rpc_req->cr_ctx, &sgl, CRT_BULK_RO,
+			     &cb_arg->cba_bulk);
+	D_ASSERTF(rc == 0, "crt_bulk_create() failed. rc: %d\n", rc);
+
+	/* two children per rank, so that some ranks forward the segments */
+	rc = crt_corpc_req_create(rpc_req->cr_ctx, NULL, NULL,
+				  TEST_OPC_CORPC_BULK_CHECK, cb_arg->cba_bulk,
+				  NULL, 0, crt_tree_topo(CRT_TREE_KNOMIAL, 2),
+				  &corpc_req);
+	D_ASSERTF(rc == 0 && corpc_req != NULL, "crt_corpc_req_create() "
+		  "failed, rc: %d corpc_req: %p\n", rc, corpc_req);
+	c_req = crt_req_get(corpc_req);
+	c_req->seq = b_req->seq;
+
+	rc = crt_context_corpc_stats(rpc_req->cr_ctx, &cb_arg->cba_stats);
+	D_ASSERTF(rc == 0, "crt_context_corpc_stats() failed. rc: %d\n", rc);
+
+	crt_req_addref(rpc_req);
+	cb_arg->cba_rpc = rpc_req;
+	rc = crt_req_send(corpc_req, test_corpc_bulk_cb, cb_arg);
+	D_ASSERTF(rc == 0, "crt_req_send() failed. rc: %d\n", rc);
+}
+
 void
 client_cb_common(const struct crt_cb_info *cb_info)
 {
 	crt_rpc_t			*rpc_req;
 	struct test_ping_check_in	*rpc_req_input;
 	struct test_ping_check_out	*rpc_req_output;
+	struct test_corpc_bulk_out	*b_reply;
 
 	rpc_req = cb_info->cci_rpc;
 
@@ -211,6 +450,17 @@ client_cb_common(const struct crt_cb_info *cb_info)
 		sem_post(&test_g.t_token_to_proceed);
 		D_ASSERT(rpc_req_output->bool_val == true);
 		break;
+	case TEST_OPC_CORPC_BULK:
+		D_ASSERTF(cb_info->cci_rc == 0, "corpc bulk rpc failed, "
+			  "rc: %d.\n", cb_info->cci_rc);
+		b_reply = crt_reply_get(rpc_req);
+		D_ASSERTF(b_reply->rc == 0, "corpc payload mismatch, rc: %d.\n",
+			  b_reply->rc);
+		D_ASSERTF(b_reply->nr == test_g.t_remote_group_size,
+			  "corpc payload checked by %d of %d ranks.\n",
+			  b_reply->nr, test_g.t_remote_group_size);
+		sem_post(&test_g.t_token_to_proceed);
+		break;
 	case TEST_OPC_SHUTDOWN:
 		test_g.t_complete = 1;
 		sem_post(&test_g.t_token_to_proceed);
@@ -255,6 +505,30 @@ static void *progress_thread(void *arg)
 	pthread_exit(NULL);
 }
 
+static void *progress_set_thread(void *arg)
+{
+	int	rc;
+
+	fprintf(stderr, "progress set thread running over %d contexts...\n",
+		test_g.t_ctx_num);
+
+	/* progress loop */
+	do {
+		rc = crt_progress_set(test_g.t_ps, 1000, NULL, NULL);
+		if (rc != 0 && rc != -DER_TIMEDOUT) {
+			D_ERROR("crt_progress_set failed rc: %d.\n", rc);
+		}
+		if (test_g.t_shutdown == 1 && test_g.t_complete == 1)
+			break;
+	} while (!dead);
+
+	printf("progress_set_thread: rc: %d, test_srv.do_shutdown: %d.\n",
+	       rc, test_g.t_shutdown);
+	printf("progress_set_thread: progress thread exit ...\n");
+
+	pthread_exit(NULL);
+}
+
 void test_shutdown_handler(crt_rpc_t *rpc_req)
 {
 	printf("tier1 test_srver received shutdown request, opc: %#x.\n",
@@ -287,7 +561,8 @@ test_init(void)
 	rc = crt_group_rank(NULL, &test_g.t_my_rank);
 	D_ASSERTF(rc == 0, "crt_group_rank() failed. rc: %d\n", rc);
 	if (test_g.t_is_service) {
-		rc = crt_group_config_save(NULL, true);
+		/* only the PSR with --prefetch, the client fetches the rest */
+		rc = crt_group_config_save(NULL, !test_g.t_prefetch);
 		D_ASSERTF(rc == 0, "crt_group_config_save() failed. rc: %d\n",
 			rc);
 		crt_fake_event_init(test_g.t_my_rank);
@@ -313,22 +588,53 @@ test_init(void)
 					  test_ping_delay_handler);
 		D_ASSERTF(rc == 0, "crt_rpc_srv_register() failed. rc: %d\n",
 			  rc);
+
+		rc = CRT_RPC_SRV_REGISTER(TEST_OPC_CORPC_BULK, 0,
+					  test_corpc_bulk,
+					  test_corpc_bulk_handler);
+		D_ASSERTF(rc == 0, "crt_rpc_srv_register() failed. rc: %d\n",
+			  rc);
+		rc = CRT_RPC_CORPC_REGISTER(TEST_OPC_CORPC_BULK_CHECK,
+					    test_corpc_bulk_check,
+					    test_corpc_bulk_check_handler,
+					    &test_corpc_bulk_check_ops);
+		D_ASSERTF(rc == 0, "crt_corpc_register() failed. rc: %d\n",
+			  rc);
 	} else {
 		rc = CRT_RPC_REGISTER(TEST_OPC_CHECKIN, 0, test_ping_check);
 		D_ASSERTF(rc == 0, "crt_rpc_register() failed. rc: %d\n", rc);
+		rc = CRT_RPC_REGISTER(TEST_OPC_CORPC_BULK, 0, test_corpc_bulk);
+		D_ASSERTF(rc == 0, "crt_rpc_register() failed. rc: %d\n", rc);
 		rc = crt_rpc_register(TEST_OPC_SHUTDOWN, CRT_RPC_FEAT_NO_REPLY,
 				      NULL);
 		D_ASSERTF(rc == 0, "crt_rpc_register() failed. rc: %d\n", rc);
 	}
 
+	if (test_g.t_progress_set) {
+		rc = crt_progress_set_create(&test_g.t_ps);
+		D_ASSERTF(rc == 0, "crt_progress_set_create() failed. rc: %d\n",
+			  rc);
+	}
 	for (i = 0; i < test_g.t_ctx_num; i++) {
 		test_g.t_thread_id[i] = i;
 		rc = crt_context_create(&test_g.t_crt_ctx[i]);
 		D_ASSERTF(rc == 0, "crt_context_create() failed. rc: %d\n", rc);
+		if (test_g.t_progress_set) {
+			rc = crt_progress_set_add(test_g.t_ps,
+						  test_g.t_crt_ctx[i]);
+			D_ASSERTF(rc == 0, "crt_progress_set_add() failed. "
+				  "rc: %d\n", rc);
+			continue;
+		}
 		rc = pthread_create(&test_g.t_tid[i], NULL, progress_thread,
 				    &test_g.t_thread_id[i]);
 		D_ASSERTF(rc == 0, "pthread_create() failed. rc: %d\n", rc);
 	}
+	if (test_g.t_progress_set) {
+		rc = pthread_create(&test_g.t_tid[0], NULL, progress_set_thread,
+				    NULL);
+		D_ASSERTF(rc == 0, "pthread_create() failed. rc: %d\n", rc);
+	}
 	test_g.t_complete = 1;
 }
 
@@ -381,6 +687,179 @@ check_in(crt_group_t *remote_group, int rank)
 	D_ASSERTF(rc == 0, "crt_req_send() failed. rc: %d\n", rc);
 }
 
+static void
+prefetch_cb(const struct crt_cb_info *cb_info)
+{
+	D_ASSERTF(cb_info->cci_rpc == NULL, "prefetch callback with an RPC\n");
+	*(int *)cb_info->cci_arg = cb_info->cci_rc;
+	sem_post(&test_g.t_token_to_proceed);
+}
+
+/*
+ * crt_rank_uri_get() only reads the lookup cache, so once it returns the URI
+ * of every rank the check-ins below are sent without a URI_LOOKUP.
+ */
+static void
+check_prefetch(crt_group_t *remote_group)
+{
+	char	*uri;
+	int	 cached;
+	int	 prefetch_rc = -DER_INVAL;
+	int	 ii, jj;
+	int	 rc;
+
+	/* started by crt_group_attach(), nothing to wait for but the cache */
+	for (jj = 0; jj < 60; jj++) {
+		cached = 0;
+		for (ii = 0; ii < test_g.t_remote_group_size; ii++) {
+			rc = crt_rank_uri_get(remote_group, ii, 0, &uri);
+			if (rc == -DER_OOG)
+				continue;
+			D_ASSERTF(rc == 0, "crt_rank_uri_get() failed. "
+				  "rc: %d\n", rc);
+			D_FREE(uri);
+			cached++;
+		}
+		if (cached == test_g.t_remote_group_size)
+			break;
+		sleep(1);
+	}
+	D_ASSERTF(cached == test_g.t_remote_group_size,
+		  "%d of %d URIs prefetched\n", cached,
+		  test_g.t_remote_group_size);
+
+	/* again through the API, over URIs that are all cached already */
+	rc = crt_group_uri_prefetch(test_g.t_crt_ctx[0], remote_group, 0,
+				    prefetch_cb, &prefetch_rc);
+	D_ASSERTF(rc == 0, "crt_group_uri_prefetch() failed. rc: %d\n", rc);
+	test_sem_timedwait(&test_g.t_token_to_proceed, 61, __LINE__);
+	D_ASSERTF(prefetch_rc == 0, "prefetch failed. rc: %d\n", prefetch_rc);
+
+	fprintf(stderr, "URIs of all %d ranks prefetched\n",
+		test_g.t_remote_group_size);
+}
+
+static void
+check_corpc_bulk(crt_group_t *remote_group)
+{
+	crt_rpc_t			*rpc_req = NULL;
+	struct test_corpc_bulk_in	*b_req;
+	crt_endpoint_t			 server_ep = {0};
+	int				 rc;
+
+	server_ep.ep_grp = remote_group;
+	server_ep.ep_rank = 0;
+	rc = crt_req_create(test_g.t_crt_ctx[0], &server_ep,
+			    TEST_OPC_CORPC_BULK, &rpc_req);
+	D_ASSERTF(rc == 0 && rpc_req != NULL, "crt_req_create() failed,"
+		  " rc: %d rpc_req: %p\n", rc, rpc_req);
+
+	b_req = crt_req_get(rpc_req);
+	b_req->size = TEST_CORPC_BULK_SIZE;
+	b_req->seq = test_g.t_my_rank + 1;
+
+	rc = crt_req_send(rpc_req, client_cb_common, NULL);
+	D_ASSERTF(rc == 0, "crt_req_send() failed. rc: %d\n", rc);
+	test_sem_timedwait(&test_g.t_token_to_proceed, 61, __LINE__);
+
+	fprintf(stderr, "corpc payload checked by all %d ranks\n",
+		test_g.t_remote_group_size);
+}
+
+/* reattach to the remote group, returns the number of URIs it has cached */
+static uint32_t
+reattach(void)
+{
+	char		*uri;
+	uint32_t	 cached = 0;
+	int		 ii;
+	int		 rc;
+
+	rc = crt_group_detach(test_g.t_remote_group);
+	D_ASSERTF(rc == 0, "crt_group_detach failed, rc: %d\n", rc);
+	rc = crt_group_attach(test_g.t_remote_group_name,
+			      &test_g.t_remote_group);
+	D_ASSERTF(rc == 0, "crt_group_attach failed, rc: %d\n", rc);
+
+	for (ii = 0; ii < test_g.t_remote_group_size; ii++) {
+		rc = crt_rank_uri_get(test_g.t_remote_group, ii, 0, &uri);
+		if (rc == -DER_OOG)
+			continue;
+		D_ASSERTF(rc == 0, "crt_rank_uri_get() failed. rc: %d\n", rc);
+		D_FREE(uri);
+		cached++;
+	}
+
+	return cached;
+}
+
+static void
+write_attach_info(const char *path, const char *buf, size_t size)
+{
+	int	fd;
+
+	fd = open(path, O_CREAT | O_TRUNC | O_WRONLY, 0644);
+	D_ASSERTF(fd >= 0, "open(%s) failed\n", path);
+	D_ASSERTF(write(fd, buf, size) == size, "write(%s) failed\n", path);
+	close(fd);
+}
+
+/*
+ * The binary attach info of the servers holds all their URIs and fills the
+ * lookup cache on attach. The text file only gives the PSR, so attaching
+ * through it when the binary file is missing or damaged caches one URI.
+ */
+static void
+check_attach_info(void)
+{
+	struct stat	 st;
+	char		 path[256];
+	char		*buf;
+	size_t		 size;
+	uint32_t	 all = test_g.t_remote_group_size;
+	uint32_t	 cached;
+	int		 fd;
+
+	snprintf(path, sizeof(path), "/tmp/%s.attach_info_bin",
+		 test_g.t_remote_group_name);
+	fd = open(path, O_RDONLY);
+	D_ASSERTF(fd >= 0, "open(%s) failed\n", path);
+	D_ASSERTF(fstat(fd, &st) == 0, "fstat(%s) failed\n", path);
+	size = st.st_size;
+	D_ALLOC(buf, size);
+	D_ASSERTF(buf != NULL, "Cannot allocate memory.\n");
+	D_ASSERTF(read(fd, buf, size) == size, "read(%s) failed\n", path);
+	close(fd);
+
+	cached = reattach();
+	D_ASSERTF(cached == all, "%d of %d URIs from the binary file\n",
+		  cached, all);
+
+	unlink(path);
+	cached = reattach();
+	D_ASSERTF(cached == 1, "%d URIs without the binary file\n", cached);
+
+	write_attach_info(path, buf, size / 2);
+	cached = reattach();
+	D_ASSERTF(cached == 1, "%d URIs from a truncated file\n", cached);
+
+	/* the magic comes first */
+	buf[0] ^= 0xff;
+	write_attach_info(path, buf, size);
+	cached = reattach();
+	D_ASSERTF(cached == 1, "%d URIs from a bad header\n", cached);
+
+	buf[0] ^= 0xff;
+	write_attach_info(path, buf, size);
+	cached = reattach();
+	D_ASSERTF(cached == all, "%d of %d URIs from the restored file\n",
+		  cached, all);
+
+	D_FREE(buf);
+	fprintf(stderr, "attach info of %s checked\n",
+		test_g.t_remote_group_name);
+}
+
 void
 test_run(void)
 {
@@ -413,12 +892,20 @@ test_run(void)
 	fprintf(stderr, "size of %s is %d\n", test_g.t_remote_group_name,
 		test_g.t_remote_group_size);
 
+	if (test_g.t_attach_info)
+		check_attach_info();
+	if (test_g.t_prefetch)
+		check_prefetch(test_g.t_remote_group);
+
 	for (ii = 0; ii < test_g.t_remote_group_size; ii++)
 		check_in(test_g.t_remote_group, ii);
 
 	for (ii = 0; ii < test_g.t_remote_group_size; ii++)
 		test_sem_timedwait(&test_g.t_token_to_proceed, 61, __LINE__);
 
+	if (test_g.t_corpc_bulk)
+		check_corpc_bulk(test_g.t_remote_group);
+
 	while (test_g.t_infinite_loop) {
 		check_in(test_g.t_remote_group, 1);
 		test_sem_timedwait(&test_g.t_token_to_proceed, 61, __LINE__);
@@ -459,10 +946,20 @@ test_fini()
 		test_g.t_shutdown = 1;
 
 	for (ii = 0; ii < test_g.t_ctx_num; ii++) {
-		rc = pthread_join(test_g.t_tid[ii], NULL);
-		if (rc != 0)
-			fprintf(stderr, "pthread_join failed. rc: %d\n", rc);
-		D_DEBUG(DB_TEST, "joined progress thread.\n");
+		/* a progress set has one thread for all the contexts */
+		if (!test_g.t_progress_set || ii == 0) {
+			rc = pthread_join(test_g.t_tid[ii], NULL);
+			if (rc != 0)
+				fprintf(stderr, "pthread_join failed. "
+					"rc: %d\n", rc);
+			D_DEBUG(DB_TEST, "joined progress thread.\n");
+		}
+		if (test_g.t_progress_set) {
+			rc = crt_progress_set_del(test_g.t_ps,
+						  test_g.t_crt_ctx[ii]);
+			D_ASSERTF(rc == 0, "crt_progress_set_del() failed. "
+				  "rc: %d\n", rc);
+		}
 
 		/* try to flush indefinitely */
 		rc = crt_context_flush(test_g.t_crt_ctx[ii], 0);
@@ -474,6 +971,11 @@ test_fini()
 			  rc);
 		D_DEBUG(DB_TEST, "destroyed crt_ctx.\n");
 	}
+	if (test_g.t_progress_set) {
+		rc = crt_progress_set_destroy(test_g.t_ps);
+		D_ASSERTF(rc == 0, "crt_progress_set_destroy() failed. "
+			  "rc: %d\n", rc);
+	}
 
 	if (test_g.t_is_service)
 		crt_fake_event_fini(test_g.t_my_rank);
@@ -506,7 +1008,11 @@ test_parse_args(int argc, char **argv)
 		{"hold", no_argument, &test_g.t_hold, 1},
 		{"is_service", no_argument, &test_g.t_is_service, 1},
 		{"ctx_num", required_argument, 0, 'c'},
+		{"progress_set", no_argument, &test_g.t_progress_set, 1},
 		{"loop", no_argument, &test_g.t_infinite_loop, 1},
+		{"prefetch", no_argument, &test_g.t_prefetch, 1},
+		{"attach_info", no_argument, &test_g.t_attach_info, 1},
+		{"corpc_bulk", no_argument, &test_g.t_corpc_bulk, 1},
 		{0, 0, 0, 0}
 	};
 
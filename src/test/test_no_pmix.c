@@ -55,6 +55,8 @@ struct test_options {
 	bool		is_master;
 	d_rank_list_t	group_ranks;
 	char		*uri_file_prefix;
+	/* port of the first rank of the URI template test, 0 if not run */
+	uint32_t	uri_tmpl_port;
 };
 
 static struct test_options opts;
@@ -86,6 +88,8 @@ static int issue_test_ping(d_rank_t target_rank, int target_tag);
 enum {
 	RPC_TEST_PING = 0xB1,
 	RPC_TEST_INDIRECT_PING = 0xB2,
+	RPC_TEST_COLL = 0xB3,
+	RPC_TEST_GRP_DELTA = 0xB4,
 	CORPC_TEST_PING = 0xC1,
 	RPC_SET_GRP_INFO = 0xC2,
 	RPC_SHUTDOWN = 0xE0,
@@ -115,6 +119,22 @@ enum {
 #define CRT_OSEQ_RPC_TEST_INDIRECT_PING	/* output fields */	 \
 	((uint64_t)		(field)			CRT_VAR)
 
+#define CRT_ISEQ_RPC_TEST_COLL	/* input fields */		 \
+	((uint32_t)		(alg)			CRT_VAR)
+
+#define CRT_OSEQ_RPC_TEST_COLL	/* output fields */		 \
+	((int32_t)		(rc)			CRT_VAR)
+
+#define CRT_ISEQ_RPC_TEST_GRP_DELTA /* input fields */		 \
+	((d_iov_t)		(grp_info)		CRT_VAR) \
+	((uint64_t)		(ver)			CRT_VAR) \
+	((d_rank_t)		(present)		CRT_VAR) \
+	((d_string_t)		(uri)			CRT_VAR) \
+	((d_rank_t)		(absent)		CRT_VAR)
+
+#define CRT_OSEQ_RPC_TEST_GRP_DELTA /* output fields */		 \
+	((int32_t)		(rc)			CRT_VAR)
+
 #define CRT_ISEQ_RPC_SHUTDOWN	/* input fields */		 \
 	((uint64_t)		(field)			CRT_VAR)
 
@@ -126,6 +146,8 @@ static void corpc_test_ping_hdlr(crt_rpc_t *rpc);
 static int set_grp_info_hdlr(crt_rpc_t *rpc);
 static int test_ping_indirect_hdlr(crt_rpc_t *rpc);
 static int shutdown_hdlr(crt_rpc_t *rpc);
+static int test_coll_hdlr(crt_rpc_t *rpc);
+static int test_grp_delta_hdlr(crt_rpc_t *rpc);
 
 RPC_DECLARE(RPC_TEST_PING, test_ping_hdlr);
 RPC_DECLARE(CORPC_TEST_PING, corpc_test_ping_hdlr);
@@ -136,6 +158,50 @@ RPC_DECLARE(RPC_TEST_INDIRECT_PING, test_ping_indirect_hdlr);
 
 RPC_DECLARE(RPC_SHUTDOWN, shutdown_hdlr);
 
+RPC_DECLARE(RPC_TEST_COLL, test_coll_hdlr);
+
+RPC_DECLARE(RPC_TEST_GRP_DELTA, test_grp_delta_hdlr);
+
+/*
+ * URI template of the test: the OFI_PORT of each rank is set so that the
+ * ports of its two contexts follow it, see test_uri_tmpl_set().
+ */
+#define URI_TMPL_RANKS_PER_HOST	(16)
+#define URI_TMPL_PORTS_PER_RANK	(2)
+
+/* fake ranks of the group info delta test, never contacted */
+#define DELTA_TEST_RANK		(100)
+#define DELTA_NO_RANK		((d_rank_t)-1)
+
+/*
+ * Elements of the allreduce arrays, the medium one is above the eager size
+ * and below CRT_COLL_SMALL (whole exchanges by bulk), the large one above
+ * both (halving and ring by bulk). Also the elements of each block of the
+ * reduce-scatter, above the eager size.
+ */
+#define COLL_TEST_MEDIUM	(768)
+#define COLL_TEST_LARGE		(16384)
+#define COLL_TEST_BLOCK		(1024)
+
+/* collectives test on one rank, see test_coll_start() */
+struct coll_test {
+	crt_rpc_t	*ct_rpc;	/* NULL on the master */
+	uint32_t	 ct_size;	/* group size */
+	d_rank_t	 ct_rank;
+	d_rank_t	*ct_gather;
+	uint64_t	 ct_sum_in;
+	uint64_t	 ct_sum;
+	/* allreduced in place */
+	uint64_t	*ct_medium;
+	uint64_t	*ct_large;
+	/* ct_size blocks reduce-scattered to ct_block */
+	uint64_t	*ct_blocks;
+	uint64_t	*ct_block;
+	int		 ct_pending;
+	int		 ct_rc;
+	int		 ct_done;
+};
+
 static int
 shutdown_hdlr(crt_rpc_t *rpc)
 {
@@ -222,6 +288,245 @@ issue_set_grp_info(d_rank_t target_rank, int target_tag,
 	return 0;
 }
 
+/*
+ * Check the group after a group info delta: at version @ver, with @present
+ * at @uri for tag 0 and without @absent.
+ */
+static int
+test_grp_delta_check(uint64_t ver, d_rank_t present, const char *uri,
+		     d_rank_t absent)
+{
+	d_rank_list_t	*rank_list;
+	uint64_t	 cur_ver;
+	char		*ret_uri;
+	int		 rc;
+
+	rc = crt_group_info_ver_get(g_group, &cur_ver);
+	if (rc != 0)
+		return rc;
+	if (cur_ver != ver) {
+		D_ERROR("group info version "DF_U64", expected "DF_U64"\n",
+			cur_ver, ver);
+		return -DER_MISMATCH;
+	}
+
+	rc = crt_group_ranks_get(g_group, &rank_list);
+	if (rc != 0)
+		return rc;
+	if ((present != DELTA_NO_RANK &&
+	     !d_rank_in_rank_list(rank_list, present)) ||
+	    d_rank_in_rank_list(rank_list, absent)) {
+		D_ERROR("rank %d should be a member, rank %d not\n",
+			present, absent);
+		rc = -DER_MISMATCH;
+	}
+	d_rank_list_free(rank_list);
+	if (rc != 0 || present == DELTA_NO_RANK)
+		return rc;
+
+	rc = crt_rank_uri_get(g_group, present, 0, &ret_uri);
+	if (rc != 0)
+		return rc;
+	if (strcmp(ret_uri, uri) != 0) {
+		D_ERROR("rank %d uri %s, expected %s\n", present, ret_uri,
+			uri);
+		rc = -DER_MISMATCH;
+	}
+	D_FREE(ret_uri);
+
+	return rc;
+}
+
+static int
+test_grp_delta_hdlr(crt_rpc_t *rpc)
+{
+	struct RPC_TEST_GRP_DELTA_in	*input;
+	struct RPC_TEST_GRP_DELTA_out	*output;
+	int				 rc;
+
+	input = crt_req_get(rpc);
+	output = crt_reply_get(rpc);
+
+	rc = crt_group_info_set(&input->grp_info);
+	if (rc == 0)
+		rc = test_grp_delta_check(input->ver, input->present,
+					  input->uri, input->absent);
+
+	/* applied, so the group is past the base version of the delta */
+	if (rc == 0) {
+		rc = crt_group_info_set(&input->grp_info);
+		if (rc == -DER_MISMATCH) {
+			rc = 0;
+		} else {
+			D_ERROR("delta applied twice; rc=%d\n", rc);
+			rc = -DER_INVAL;
+		}
+	}
+
+	DBG_PRINT("Group info delta to "DF_U64" applied; rc=%d\n",
+		  input->ver, rc);
+	output->rc = rc;
+	crt_reply_send(rpc);
+
+	return 0;
+}
+
+/*
+ * Send the changes since *@ver to all ranks, and check the group they result
+ * in there and on the master. *@ver is set to the new version.
+ */
+static void
+issue_grp_delta(uint64_t *ver, d_rank_t present, const char *uri,
+		d_rank_t absent)
+{
+	struct RPC_TEST_GRP_DELTA_in	*input;
+	struct RPC_TEST_GRP_DELTA_out	*output;
+	crt_endpoint_t			 server_ep;
+	crt_rpc_t			*rpc_req;
+	d_iov_t				 delta;
+	d_rank_t			 rank;
+	int				 done;
+	int				 i, rc;
+
+	rc = crt_group_info_delta_get(g_group, *ver, &delta);
+	if (rc != 0) {
+		D_ERROR("crt_group_info_delta_get() failed; rc=%d\n", rc);
+		assert(0);
+	}
+	rc = crt_group_info_ver_get(g_group, ver);
+	if (rc != 0) {
+		D_ERROR("crt_group_info_ver_get() failed; rc=%d\n", rc);
+		assert(0);
+	}
+
+	/* the master is at the new version already */
+	rc = crt_group_info_set(&delta);
+	if (rc != -DER_MISMATCH) {
+		D_ERROR("delta applied on its source; rc=%d\n", rc);
+		assert(0);
+	}
+	rc = test_grp_delta_check(*ver, present, uri, absent);
+	if (rc != 0) {
+		D_ERROR("group info delta check failed; rc=%d\n", rc);
+		assert(0);
+	}
+
+	for (i = 0; i < opts.group_ranks.rl_nr; i++) {
+		rank = opts.group_ranks.rl_ranks[i];
+		if (rank == opts.self_rank)
+			continue;
+
+		server_ep.ep_rank = rank;
+		server_ep.ep_tag = 0;
+		server_ep.ep_grp = NULL;
+		rc = crt_req_create(crt_ctx, &server_ep, RPC_TEST_GRP_DELTA,
+				    &rpc_req);
+		if (rc != 0) {
+			D_ERROR("crt_req_create() failed; rc=%d\n", rc);
+			assert(0);
+		}
+
+		input = crt_req_get(rpc_req);
+		input->grp_info = delta;
+		input->ver = *ver;
+		input->present = present;
+		input->uri = (d_string_t)uri;
+		input->absent = absent;
+
+		done = 0;
+		rc = crt_req_send(rpc_req, generic_response_hdlr, &done);
+		if (rc != 0) {
+			D_ERROR("crt_req_send() failed; rc=%d\n", rc);
+			assert(0);
+		}
+		while (!done) {
+			crt_progress(crt_ctx, 1000, 0, 0);
+			sched_yield();
+		}
+
+		output = crt_reply_get(rpc_req);
+		if (output->rc != 0) {
+			D_ERROR("Group info delta failed on rank %d; rc=%d\n",
+				rank, output->rc);
+			assert(0);
+		}
+		crt_req_decref(rpc_req);
+	}
+
+	D_FREE(delta.iov_buf);
+}
+
+/*
+ * Add and remove fake ranks, and check that the delta of each change applies
+ * on all ranks.
+ */
+static void
+test_grp_delta(void)
+{
+	crt_node_info_t	 node_info;
+	d_iov_t		 grp_info;
+	uint64_t	 ver;
+	d_rank_t	 rank = DELTA_TEST_RANK;
+	char		 uri[2][64];
+	int		 i, rc;
+
+	DBG_PRINT("Testing group info deltas\n");
+	for (i = 0; i < 2; i++)
+		snprintf(uri[i], sizeof(uri[i]), "ofi+sockets://127.0.0.1:%d",
+			 30000 + i);
+
+	/* bring all ranks to the current version first */
+	rc = crt_group_info_get(g_group, &grp_info);
+	if (rc != 0) {
+		D_ERROR("crt_group_info_get() failed; rc=%d\n", rc);
+		assert(0);
+	}
+	rc = crt_group_info_ver_get(g_group, &ver);
+	if (rc != 0) {
+		D_ERROR("crt_group_info_ver_get() failed; rc=%d\n", rc);
+		assert(0);
+	}
+	for (i = 0; i < opts.group_ranks.rl_nr; i++) {
+		if (opts.group_ranks.rl_ranks[i] != opts.self_rank)
+			issue_set_grp_info(opts.group_ranks.rl_ranks[i], 0,
+					   &grp_info);
+	}
+	D_FREE(grp_info.iov_buf);
+
+	/* two ranks added, one removed again */
+	node_info.uri = uri[0];
+	rc = crt_group_node_add(g_group, rank, 0, node_info);
+	if (rc == 0)
+		rc = crt_group_node_add(g_group, rank + 1, 0, node_info);
+	if (rc == 0)
+		rc = crt_group_rank_remove(g_group, rank + 1);
+	if (rc != 0) {
+		D_ERROR("Group change failed; rc=%d\n", rc);
+		assert(0);
+	}
+	issue_grp_delta(&ver, rank, uri[0], rank + 1);
+
+	/* the rank is back at another address */
+	node_info.uri = uri[1];
+	rc = crt_group_rank_remove(g_group, rank);
+	if (rc == 0)
+		rc = crt_group_node_add(g_group, rank, 0, node_info);
+	if (rc != 0) {
+		D_ERROR("Group change failed; rc=%d\n", rc);
+		assert(0);
+	}
+	issue_grp_delta(&ver, rank, uri[1], rank + 1);
+
+	rc = crt_group_rank_remove(g_group, rank);
+	if (rc != 0) {
+		D_ERROR("crt_group_rank_remove() failed; rc=%d\n", rc);
+		assert(0);
+	}
+	issue_grp_delta(&ver, DELTA_NO_RANK, "", rank);
+
+	DBG_PRINT("Group info deltas passed\n");
+}
+
 static void corpc_test_ping_hdlr(crt_rpc_t *rpc)
 {
 	struct RPC_TEST_PING_in		*input;
@@ -362,6 +667,293 @@ static int test_ping_hdlr(crt_rpc_t *rpc)
 }
 
 
+/* fill @arr with the elements rank + i, see test_coll_check_arr() */
+static void
+test_coll_fill(uint64_t *arr, size_t nr)
+{
+	size_t	i;
+
+	for (i = 0; i < nr; i++)
+		arr[i] = opts.self_rank + i;
+}
+
+/*
+ * Each rank contributes rank + i as element i, so the reduced element i of
+ * @arr, which starts at element @base, is the sum of the ranks + size * i.
+ */
+static int
+test_coll_check_arr(const char *name, uint64_t *arr, size_t nr, size_t base,
+		    uint64_t sum, uint32_t size)
+{
+	size_t	i;
+
+	for (i = 0; i < nr; i++) {
+		if (arr[i] == sum + size * (base + i))
+			continue;
+		D_ERROR("%s element %zu: got "DF_U64" expected "DF_U64"\n",
+			name, base + i, arr[i], sum + size * (base + i));
+		return -DER_MISMATCH;
+	}
+
+	return 0;
+}
+
+/*
+ * Check the results against the group membership: the allgather of the self
+ * ranks gives the sorted ranks, which are sparse in this test.
+ */
+static int
+test_coll_check(struct coll_test *ct)
+{
+	d_rank_list_t	*rank_list;
+	uint64_t	 sum = 0;
+	int		 idx = -1;
+	int		 i, rc;
+
+	rc = crt_group_ranks_get(g_group, &rank_list);
+	if (rc != 0)
+		return rc;
+
+	d_rank_list_sort(rank_list);
+	for (i = 0; i < rank_list->rl_nr; i++) {
+		if (ct->ct_gather[i] != rank_list->rl_ranks[i]) {
+			D_ERROR("allgather block %d: got %u expected %u\n",
+				i, ct->ct_gather[i], rank_list->rl_ranks[i]);
+			rc = -DER_MISMATCH;
+		}
+		if (rank_list->rl_ranks[i] == opts.self_rank)
+			idx = i;
+		sum += rank_list->rl_ranks[i];
+	}
+	if (ct->ct_sum != sum) {
+		D_ERROR("allreduce: got "DF_U64" expected "DF_U64"\n",
+			ct->ct_sum, sum);
+		rc = -DER_MISMATCH;
+	}
+	if (test_coll_check_arr("allreduce medium", ct->ct_medium,
+				COLL_TEST_MEDIUM, 0, sum, ct->ct_size) != 0 ||
+	    test_coll_check_arr("allreduce large", ct->ct_large,
+				COLL_TEST_LARGE, 0, sum, ct->ct_size) != 0)
+		rc = -DER_MISMATCH;
+
+	/* the self rank gets the block of its index in the sorted ranks */
+	assert(idx >= 0);
+	if (test_coll_check_arr("reduce-scatter", ct->ct_block,
+				COLL_TEST_BLOCK, idx * COLL_TEST_BLOCK, sum,
+				ct->ct_size) != 0)
+		rc = -DER_MISMATCH;
+
+	d_rank_list_free(rank_list);
+	return rc;
+}
+
+static void
+test_coll_free(struct coll_test *ct)
+{
+	D_FREE(ct->ct_gather);
+	D_FREE(ct->ct_medium);
+	D_FREE(ct->ct_large);
+	D_FREE(ct->ct_blocks);
+	D_FREE(ct->ct_block);
+}
+
+static void
+test_coll_done(struct coll_test *ct, int rc)
+{
+	struct RPC_TEST_COLL_out	*output;
+
+	if (rc != 0)
+		ct->ct_rc = rc;
+	if (__atomic_sub_fetch(&ct->ct_pending, 1, __ATOMIC_ACQ_REL) != 0)
+		return;
+
+	if (ct->ct_rc == 0)
+		ct->ct_rc = test_coll_check(ct);
+	DBG_PRINT("Collectives done, rc=%d\n", ct->ct_rc);
+
+	if (ct->ct_rpc == NULL) {
+		__atomic_store_n(&ct->ct_done, 1, __ATOMIC_RELEASE);
+		return;
+	}
+
+	output = crt_reply_get(ct->ct_rpc);
+	output->rc = ct->ct_rc;
+	rc = crt_reply_send(ct->ct_rpc);
+	if (rc != 0)
+		D_ERROR("Failed to send response back; rc=%d\n", rc);
+	crt_req_decref(ct->ct_rpc);
+	test_coll_free(ct);
+	D_FREE(ct);
+}
+
+static void
+test_coll_cb(struct crt_coll_cb_info *info)
+{
+	test_coll_done(info->ccb_arg, info->ccb_rc);
+}
+
+/*
+ * Run an allgather and an allreduce of the self rank, allreduces of a medium
+ * and a large array and a reduce-scatter.
+ */
+static void
+test_coll_start(struct coll_test *ct, enum crt_coll_alg alg)
+{
+	int	rc;
+
+	rc = crt_group_size(NULL, &ct->ct_size);
+	if (rc != 0) {
+		D_ERROR("crt_group_size() failed; rc=%d\n", rc);
+		assert(0);
+	}
+
+	D_ALLOC_ARRAY(ct->ct_gather, ct->ct_size);
+	D_ALLOC_ARRAY(ct->ct_medium, COLL_TEST_MEDIUM);
+	D_ALLOC_ARRAY(ct->ct_large, COLL_TEST_LARGE);
+	D_ALLOC_ARRAY(ct->ct_blocks, ct->ct_size * COLL_TEST_BLOCK);
+	D_ALLOC_ARRAY(ct->ct_block, COLL_TEST_BLOCK);
+	if (ct->ct_gather == NULL || ct->ct_medium == NULL ||
+	    ct->ct_large == NULL || ct->ct_blocks == NULL ||
+	    ct->ct_block == NULL) {
+		D_ERROR("Failed to allocate mem for collectives\n");
+		assert(0);
+	}
+
+	ct->ct_rank = opts.self_rank;
+	ct->ct_sum_in = opts.self_rank;
+	test_coll_fill(ct->ct_medium, COLL_TEST_MEDIUM);
+	test_coll_fill(ct->ct_large, COLL_TEST_LARGE);
+	test_coll_fill(ct->ct_blocks, ct->ct_size * COLL_TEST_BLOCK);
+	ct->ct_pending = 5;
+
+	rc = crt_allgather(NULL, alg, &ct->ct_rank, ct->ct_gather,
+			   sizeof(ct->ct_rank), test_coll_cb, ct);
+	if (rc != 0)
+		test_coll_done(ct, rc);
+
+	rc = crt_allreduce(NULL, alg, CRT_REDUCE_SUM, CRT_REDUCE_UINT64,
+			   &ct->ct_sum_in, &ct->ct_sum, 1, test_coll_cb, ct);
+	if (rc != 0)
+		test_coll_done(ct, rc);
+
+	rc = crt_allreduce(NULL, alg, CRT_REDUCE_SUM, CRT_REDUCE_UINT64,
+			   ct->ct_medium, ct->ct_medium, COLL_TEST_MEDIUM,
+			   test_coll_cb, ct);
+	if (rc != 0)
+		test_coll_done(ct, rc);
+
+	rc = crt_allreduce(NULL, alg, CRT_REDUCE_SUM, CRT_REDUCE_UINT64,
+			   ct->ct_large, ct->ct_large, COLL_TEST_LARGE,
+			   test_coll_cb, ct);
+	if (rc != 0)
+		test_coll_done(ct, rc);
+
+	rc = crt_reduce_scatter(NULL, alg, CRT_REDUCE_SUM, CRT_REDUCE_UINT64,
+				ct->ct_blocks, ct->ct_block, COLL_TEST_BLOCK,
+				test_coll_cb, ct);
+	if (rc != 0)
+		test_coll_done(ct, rc);
+}
+
+static int
+test_coll_hdlr(crt_rpc_t *rpc)
+{
+	struct RPC_TEST_COLL_in	*input;
+	struct coll_test	*ct;
+
+	input = crt_req_get(rpc);
+	DBG_PRINT("Collectives test with alg %u\n", input->alg);
+
+	D_ALLOC_PTR(ct);
+	if (ct == NULL) {
+		D_ERROR("Failed to allocate mem for coll test\n");
+		assert(0);
+	}
+
+	/* decref in test_coll_done() */
+	crt_req_addref(rpc);
+	ct->ct_rpc = rpc;
+	test_coll_start(ct, input->alg);
+
+	return 0;
+}
+
+/* run the collectives on all ranks, whose ranks are sparse */
+static void
+issue_test_coll(enum crt_coll_alg alg)
+{
+	struct RPC_TEST_COLL_in		*input;
+	struct RPC_TEST_COLL_out	*output;
+	struct coll_test		 ct = {0};
+	crt_endpoint_t			 server_ep;
+	crt_rpc_t			**rpcs;
+	int				*done;
+	int				 nr = opts.group_ranks.rl_nr;
+	int				 i, rc;
+
+	D_ALLOC_ARRAY(rpcs, nr);
+	D_ALLOC_ARRAY(done, nr);
+	if (rpcs == NULL || done == NULL) {
+		D_ERROR("Failed to allocate mem for rpcs\n");
+		assert(0);
+	}
+
+	DBG_PRINT("Issuing collectives test with alg %d\n", alg);
+	for (i = 0; i < nr; i++) {
+		if (opts.group_ranks.rl_ranks[i] == opts.self_rank) {
+			done[i] = 1;
+			continue;
+		}
+
+		server_ep.ep_rank = opts.group_ranks.rl_ranks[i];
+		server_ep.ep_grp = NULL;
+		server_ep.ep_tag = 0;
+		rc = crt_req_create(crt_ctx, &server_ep, RPC_TEST_COLL,
+				    &rpcs[i]);
+		if (rc != 0) {
+			D_ERROR("crt_req_create() failed; rc=%d\n", rc);
+			assert(0);
+		}
+
+		input = crt_req_get(rpcs[i]);
+		input->alg = alg;
+
+		rc = crt_req_send(rpcs[i], generic_response_hdlr, &done[i]);
+		if (rc != 0) {
+			D_ERROR("crt_req_send() failed; rc=%d\n", rc);
+			assert(0);
+		}
+	}
+
+	test_coll_start(&ct, alg);
+	while (!__atomic_load_n(&ct.ct_done, __ATOMIC_ACQUIRE))
+		sched_yield();
+	if (ct.ct_rc != 0) {
+		D_ERROR("Collectives failed; rc=%d\n", ct.ct_rc);
+		assert(0);
+	}
+	test_coll_free(&ct);
+
+	for (i = 0; i < nr; i++) {
+		while (!done[i])
+			sched_yield();
+		if (rpcs[i] == NULL)
+			continue;
+
+		output = crt_reply_get(rpcs[i]);
+		if (output->rc != 0) {
+			D_ERROR("Collectives failed on rank %d; rc=%d\n",
+				opts.group_ranks.rl_ranks[i], output->rc);
+			assert(0);
+		}
+		crt_req_decref(rpcs[i]);
+	}
+
+	D_FREE(rpcs);
+	D_FREE(done);
+	DBG_PRINT("Collectives test with alg %d passed\n", alg);
+}
+
 static void
 show_usage(void)
 {
@@ -370,6 +962,8 @@ show_usage(void)
 	DBG_PRINT("-m <ranks>: Master application is proivded coma "
 		"separated list of ranks\n");
 	DBG_PRINT("-u <uri_file_prefix>\n");
+	DBG_PRINT("-t <port>: Master tests the URI template of the ranks "
+		"listening from port on\n");
 }
 
 
@@ -422,6 +1016,85 @@ issue_test_ping(d_rank_t target_rank, int target_tag)
 	return 0;
 }
 
+#define LOOKUP_BURST_NUM	(8)
+
+static void
+lookup_burst_response_hdlr(const struct crt_cb_info *info)
+{
+	int	*rc = info->cci_arg;
+
+	*rc = info->cci_rc;
+}
+
+/*
+ * Ping a rank whose address is not looked up yet several times at once. One
+ * RPC looks the address up while the others wait for it, one of them is
+ * aborted while it waits.
+ */
+static void
+issue_lookup_burst(d_rank_t target_rank)
+{
+	struct RPC_TEST_PING_in		*input;
+	struct RPC_TEST_PING_out	*output;
+	crt_endpoint_t			 server_ep;
+	crt_rpc_t			*rpc_req[LOOKUP_BURST_NUM];
+	int				 rcs[LOOKUP_BURST_NUM];
+	int				 i, rc;
+
+	server_ep.ep_rank = target_rank;
+	server_ep.ep_grp = NULL;
+	server_ep.ep_tag = 0;
+
+	DBG_PRINT("Issuing %d pings to rank=%d\n", LOOKUP_BURST_NUM,
+		  target_rank);
+	for (i = 0; i < LOOKUP_BURST_NUM; i++) {
+		rc = crt_req_create(crt_ctx, &server_ep, RPC_TEST_PING,
+				    &rpc_req[i]);
+		if (rc != 0) {
+			D_ERROR("crt_req_create() failed; rc=%d\n", rc);
+			assert(0);
+		}
+
+		input = crt_req_get(rpc_req[i]);
+		input->field = i;
+
+		/* released in the loop below */
+		crt_req_addref(rpc_req[i]);
+		rcs[i] = 1;
+		rc = crt_req_send(rpc_req[i], lookup_burst_response_hdlr,
+				  &rcs[i]);
+		if (rc != 0) {
+			D_ERROR("crt_req_send() failed; rc=%d\n", rc);
+			assert(0);
+		}
+	}
+
+	/* most likely waiting for the lookup of rpc_req[0] */
+	rc = crt_req_abort(rpc_req[1]);
+	DBG_PRINT("Aborted ping 1; rc=%d\n", rc);
+
+	for (i = 0; i < LOOKUP_BURST_NUM; i++) {
+		while (rcs[i] == 1)
+			sched_yield();
+
+		if (i == 1 && rcs[i] == -DER_CANCELED) {
+			DBG_PRINT("Ping %d aborted\n", i);
+		} else if (rcs[i] != 0) {
+			D_ERROR("Ping %d failed; rc=%d\n", i, rcs[i]);
+			assert(0);
+		} else {
+			output = crt_reply_get(rpc_req[i]);
+			if (output->field != i * 2) {
+				D_ERROR("Ping %d expected %d got %lu\n",
+					i, i * 2, output->field);
+				assert(0);
+			}
+		}
+		crt_req_decref(rpc_req[i]);
+	}
+
+	DBG_PRINT("Pings to rank=%d done\n", target_rank);
+}
 
 int
 issue_shutdown(d_rank_t target_rank)
@@ -515,7 +1188,7 @@ parse_options(int argc, char **argv)
 	int indx = 0;
 
 	while (1) {
-		ch = getopt(argc, argv, "m:u:");
+		ch = getopt(argc, argv, "m:u:t:");
 
 		if (ch == -1)
 			break;
@@ -525,6 +1198,10 @@ parse_options(int argc, char **argv)
 			opts.uri_file_prefix = optarg;
 			break;
 
+		case 't':
+			opts.uri_tmpl_port = atoi(optarg);
+			break;
+
 		case 'm':
 			opts.is_master = true;
 
@@ -639,6 +1316,136 @@ add_rank_uris(char *rank_uris)
 
 }
 
+/*
+ * Set the URI template of the group from the URI of this rank, the others
+ * run on the same host. Invalid templates are refused first.
+ */
+static void
+test_uri_tmpl_set(void)
+{
+	crt_uri_template_t	 tmpl;
+	const char		*hosts[1];
+	char			 fmt[256];
+	char			*my_uri;
+	char			*host;
+	char			*port;
+	int			 rc;
+
+	rc = crt_rank_uri_get(g_group, opts.self_rank, 0, &my_uri);
+	if (rc != 0) {
+		D_ERROR("crt_rank_uri_get() failed; rc=%d\n", rc);
+		assert(0);
+	}
+
+	/* "<prefix>://<host>:<port>" to "<prefix>://%h:%p" and <host> */
+	host = strstr(my_uri, "://");
+	port = strrchr(my_uri, ':');
+	if (host == NULL || port == NULL || port < host + 3) {
+		D_ERROR("Unexpected URI %s\n", my_uri);
+		assert(0);
+	}
+	host += 3;
+	*port = '\0';
+	snprintf(fmt, sizeof(fmt), "%.*s%%h:%%p", (int)(host - my_uri),
+		 my_uri);
+	hosts[0] = host;
+
+	tmpl.ut_fmt = "ofi+sockets://%h:%d";
+	tmpl.ut_hosts = hosts;
+	tmpl.ut_host_num = 1;
+	tmpl.ut_ranks_per_host = URI_TMPL_RANKS_PER_HOST;
+	tmpl.ut_port_base = opts.uri_tmpl_port;
+	tmpl.ut_ports_per_rank = URI_TMPL_PORTS_PER_RANK;
+	rc = crt_group_uri_template_set(g_group, &tmpl);
+	if (rc != -DER_INVAL) {
+		D_ERROR("Bad conversion accepted; rc=%d\n", rc);
+		assert(0);
+	}
+
+	tmpl.ut_fmt = fmt;
+	tmpl.ut_ranks_per_host = 0;
+	rc = crt_group_uri_template_set(g_group, &tmpl);
+	if (rc != -DER_INVAL) {
+		D_ERROR("No ranks per host accepted; rc=%d\n", rc);
+		assert(0);
+	}
+
+	tmpl.ut_ranks_per_host = URI_TMPL_RANKS_PER_HOST;
+	tmpl.ut_port_base = UINT16_MAX - 1;
+	rc = crt_group_uri_template_set(g_group, &tmpl);
+	if (rc != -DER_INVAL) {
+		D_ERROR("Port range overflow accepted; rc=%d\n", rc);
+		assert(0);
+	}
+
+	tmpl.ut_port_base = opts.uri_tmpl_port;
+	rc = crt_group_uri_template_set(g_group, &tmpl);
+	if (rc != 0) {
+		D_ERROR("crt_group_uri_template_set() failed; rc=%d\n", rc);
+		assert(0);
+	}
+	rc = crt_group_uri_template_set(g_group, &tmpl);
+	if (rc != -DER_EXIST) {
+		D_ERROR("Template set twice; rc=%d\n", rc);
+		assert(0);
+	}
+
+	DBG_PRINT("URI template %s on host %s from port %u set\n", fmt, host,
+		  opts.uri_tmpl_port);
+	D_FREE(my_uri);
+}
+
+/*
+ * Ping a rank whose URIs are not added yet, through the URI the template
+ * gives its tag 0. A rank launched off the template ports is added first,
+ * its URI overrides the template one that nobody listens on.
+ */
+static void
+test_uri_tmpl_rank(d_rank_t rank, char *rank_uris)
+{
+	char		 uri[256];
+	char		*ret_uri;
+	char		*p;
+	uint32_t	 port;
+	uint32_t	 tmpl_port;
+	bool		 override;
+	int		 rc;
+
+	/* the first line is "<rank>-0:<uri>" */
+	p = strchr(rank_uris, ':');
+	if (p == NULL) {
+		D_ERROR("Unexpected URI data %s\n", rank_uris);
+		assert(0);
+	}
+	snprintf(uri, sizeof(uri), "%.*s", (int)strcspn(p + 1, "\n"), p + 1);
+	port = atoi(strrchr(uri, ':') + 1);
+	tmpl_port = opts.uri_tmpl_port +
+		    (rank % URI_TMPL_RANKS_PER_HOST) * URI_TMPL_PORTS_PER_RANK;
+	override = port != tmpl_port;
+
+	if (override)
+		add_rank_uris(rank_uris);
+
+	issue_test_ping(rank, 0);
+
+	rc = crt_rank_uri_get(g_group, rank, 0, &ret_uri);
+	if (rc != 0) {
+		D_ERROR("crt_rank_uri_get() failed; rc=%d\n", rc);
+		assert(0);
+	}
+	if (strcmp(ret_uri, uri) != 0) {
+		D_ERROR("Rank %d URI %s, expected %s\n", rank, ret_uri, uri);
+		assert(0);
+	}
+	D_FREE(ret_uri);
+
+	if (!override)
+		add_rank_uris(rank_uris);
+
+	DBG_PRINT("Rank %d reached through the %s URI\n", rank,
+		  override ? "added" : "template");
+}
+
 static int
 corpc_aggregate(crt_rpc_t *src, crt_rpc_t *result, void *priv)
 {
@@ -811,6 +1618,18 @@ int main(int argc, char **argv)
 		assert(0);
 	}
 
+	rc = RPC_REGISTER(RPC_TEST_COLL);
+	if (rc != 0) {
+		D_ERROR("RPC_REGISTER() failed; rc=%d\n", rc);
+		assert(0);
+	}
+
+	rc = RPC_REGISTER(RPC_TEST_GRP_DELTA);
+	if (rc != 0) {
+		D_ERROR("RPC_REGISTER() failed; rc=%d\n", rc);
+		assert(0);
+	}
+
 	rc = RPC_REGISTER(RPC_SET_GRP_INFO);
 	if (rc != 0) {
 		D_ERROR("RPC_REGISTER() failed; rc=%d\n", rc);
@@ -877,6 +1696,9 @@ int main(int argc, char **argv)
 		if (opts.uri_file_prefix != NULL)
 			uri_file_path = opts.uri_file_prefix;
 
+		if (opts.uri_tmpl_port != 0)
+			test_uri_tmpl_set();
+
 		/* Wait for all uri files to be populated by other ranks */
 		for (i = 0; i < opts.group_ranks.rl_nr; i++) {
 			if (opts.group_ranks.rl_ranks[i] == opts.self_rank)
@@ -908,7 +1730,11 @@ int main(int argc, char **argv)
 			close(fd);
 
 			/* Parse uri data and add rank:tag:uri to group */
-			add_rank_uris(tmp_data);
+			if (opts.uri_tmpl_port != 0)
+				test_uri_tmpl_rank(opts.group_ranks.rl_ranks[i],
+						   tmp_data);
+			else
+				add_rank_uris(tmp_data);
 		}
 
 		/* Retrieve group info as one iov */
@@ -953,6 +1779,13 @@ int main(int argc, char **argv)
 
 		/* Test subgroup */
 
+		/* Test the coalesced address lookups, nothing is cached yet */
+		for (i = 0; i < opts.group_ranks.rl_nr; i++) {
+			rank = opts.group_ranks.rl_ranks[i];
+			if (rank != opts.self_rank)
+				issue_lookup_burst(rank);
+		}
+
 		/* Send group info to all ranks */
 		for (i = 0; i < opts.group_ranks.rl_nr; i++) {
 			rank = opts.group_ranks.rl_ranks[i];
@@ -969,6 +1802,20 @@ int main(int argc, char **argv)
 
 		DBG_PRINT("---------------------------------\n");
 
+		/* Test the collectives on the sparse ranks */
+		issue_test_coll(CRT_COLL_TREE);
+		issue_test_coll(CRT_COLL_RING);
+		issue_test_coll(CRT_COLL_AUTO);
+		/* only on a power of two ranks, see test_no_pmix_rd */
+		if ((rank_list->rl_nr & (rank_list->rl_nr - 1)) == 0)
+			issue_test_coll(CRT_COLL_RD);
+
+		DBG_PRINT("---------------------------------\n");
+
+		test_grp_delta();
+
+		DBG_PRINT("---------------------------------\n");
+
 		/* Create subgroup with 1 less member */
 		DBG_PRINT("---------------------------------\n");
 		DBG_PRINT("Attempting to create subgroup\n");
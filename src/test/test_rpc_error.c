@@ -37,7 +37,11 @@
  */
 /**
  * This is a test for the RPC error case in which the RPC handler doesn't call
- * crt_reply_send().
+ * crt_reply_send(). It also sends a burst of failing and successful RPCs to
+ * each rank, which are packed into the same messages if CRT_BATCH_MAX is set.
+ * With --credits the client instead starts from a window of one credit per
+ * endpoint and checks that timely replies grow it, see rpc_err_credit_issue().
+ * With --hpool the server runs the handlers in a pool of worker threads.
  */
 
 #include <stdio.h>
@@ -52,23 +56,42 @@
 
 #define RPC_ERR_OPC_NOREPLY		(0xA1)
 #define RPC_ERR_OPC_NORPC		(0xA2)
+#define RPC_ERR_OPC_ECHO		(0xA3)
+#define RPC_ERR_OPC_HOLD		(0xA4)
 #define RPC_ERR_OPC_SHUTDOWN		(0x100)
 
+/* number of RPCs sent at once to each rank by rpc_err_burst_issue() */
+#define RPC_ERR_BURST_NUM		(32)
+/*
+ * echo RPCs sent one by one by rpc_err_credit_issue(), enough to grow a window
+ * of one credit past RPC_ERR_HOLD_NUM
+ */
+#define RPC_ERR_CREDIT_WARMUP		(16)
+/* RPC_ERR_OPC_HOLD requests held by the server until they are all received */
+#define RPC_ERR_HOLD_NUM		(4)
+#define RPC_ERR_HPOOL_MAX		(16)
+
 struct rpc_err_t {
 	crt_group_t		*re_local_group;
 	crt_group_t		*re_target_group;
 	char			*re_local_group_name;
 	char			*re_target_group_name;
 	int			 re_is_service;
+	int			 re_credits;
 	uint32_t		 re_is_client,
 				 re_hold:1,
 				 re_shutdown:1;
 	uint32_t		 re_holdtime;
+	/* workers of the handler pool of the server, 0 for none */
+	uint32_t		 re_hpool;
 	uint32_t		 re_my_rank;
 	uint32_t		 re_target_group_size;
 	crt_context_t		 re_crt_ctx;
 	pthread_t		 re_tid;
 	sem_t			 re_all_done;
+	/* held by rpc_err_hold_hdlr(), only accessed by the progress thread */
+	crt_rpc_t		*re_held[RPC_ERR_HOLD_NUM];
+	int			 re_held_num;
 };
 
 struct rpc_err_t rpc_err;
@@ -95,6 +118,8 @@ rpc_err_parse_args(int argc, char **argv)
 		{"attach_to", required_argument, 0, 'a'},
 		{"holdtime", required_argument, 0, 'h'},
 		{"is_service", no_argument, &rpc_err.re_is_service, 1},
+		{"credits", no_argument, &rpc_err.re_credits, 1},
+		{"hpool", required_argument, 0, 'p'},
 		{0, 0, 0, 0}
 	};
 
@@ -117,6 +142,14 @@ rpc_err_parse_args(int argc, char **argv)
 		case 'h':
 			rpc_err.re_holdtime = atoi(optarg);
 			break;
+		case 'p':
+			rpc_err.re_hpool = atoi(optarg);
+			if (rpc_err.re_hpool > RPC_ERR_HPOOL_MAX) {
+				fprintf(stderr, "hpool %u exceeds %d.\n",
+					rpc_err.re_hpool, RPC_ERR_HPOOL_MAX);
+				return 1;
+			}
+			break;
 		case '?':
 			return 1;
 		default:
@@ -168,6 +201,52 @@ rpc_err_noreply_hdlr(crt_rpc_t *rpc_req)
 	fprintf(stderr, "received magic number %d\n", rpc_req_input->magic);
 }
 
+static void
+rpc_err_echo_hdlr(crt_rpc_t *rpc_req)
+{
+	struct rpc_err_noreply_in	*rpc_req_input;
+	struct rpc_err_noreply_out	*rpc_req_output;
+	int				 rc;
+
+	rpc_req_input = crt_req_get(rpc_req);
+	rpc_req_output = crt_reply_get(rpc_req);
+	rpc_req_output->magic = rpc_req_input->magic;
+
+	rc = crt_reply_send(rpc_req);
+	D_ASSERTF(rc == 0, "crt_reply_send() failed, rc: %d\n", rc);
+}
+
+/*
+ * reply once RPC_ERR_HOLD_NUM requests are inflight at the same time, not
+ * used with --hpool
+ */
+static void
+rpc_err_hold_hdlr(crt_rpc_t *rpc_req)
+{
+	struct rpc_err_noreply_in	*rpc_req_input;
+	struct rpc_err_noreply_out	*rpc_req_output;
+	int				 i;
+	int				 rc;
+
+	rc = crt_req_addref(rpc_req);
+	D_ASSERTF(rc == 0, "crt_req_addref() failed, rc: %d\n", rc);
+	rpc_err.re_held[rpc_err.re_held_num++] = rpc_req;
+	if (rpc_err.re_held_num < RPC_ERR_HOLD_NUM)
+		return;
+
+	for (i = 0; i < RPC_ERR_HOLD_NUM; i++) {
+		rpc_req = rpc_err.re_held[i];
+		rpc_req_input = crt_req_get(rpc_req);
+		rpc_req_output = crt_reply_get(rpc_req);
+		rpc_req_output->magic = rpc_req_input->magic;
+
+		rc = crt_reply_send(rpc_req);
+		D_ASSERTF(rc == 0, "crt_reply_send() failed, rc: %d\n", rc);
+		crt_req_decref(rpc_req);
+	}
+	rpc_err.re_held_num = 0;
+}
+
 static void
 rpc_err_shutdown_hdlr(crt_rpc_t *rpc_req)
 {
@@ -195,6 +274,13 @@ rpc_err_init(void)
 		rpc_err.re_local_group_name,
 		rpc_err.re_target_group_name);
 
+	if (rpc_err.re_credits) {
+		/* no packing, each request takes a credit of its own */
+		setenv("CRT_CREDIT_EP_CTX", "1", 1);
+		setenv("CRT_CREDIT_ADAPTIVE", "1", 1);
+		setenv("CRT_BATCH_MAX", "0", 1);
+	}
+
 	flag = rpc_err.re_is_service ? CRT_FLAG_BIT_SERVER : 0;
 	rc = crt_init(rpc_err.re_local_group_name, flag);
 	D_ASSERTF(rc == 0, "crt_init() failed, rc: %d\n", rc);
@@ -205,10 +291,25 @@ rpc_err_init(void)
 	rc = crt_context_create(&rpc_err.re_crt_ctx);
 	D_ASSERTF(rc == 0, "crt_context_create() failed. rc: %d\n", rc);
 
+	if (rpc_err.re_is_service && rpc_err.re_hpool > 0) {
+		rc = crt_context_handler_pool_create(rpc_err.re_crt_ctx,
+						     rpc_err.re_hpool);
+		D_ASSERTF(rc == 0, "crt_context_handler_pool_create() failed, "
+			  "rc: %d\n", rc);
+	}
+
 	rc = CRT_RPC_SRV_REGISTER(RPC_ERR_OPC_NOREPLY, 0, rpc_err_noreply,
 				  rpc_err_noreply_hdlr);
 	D_ASSERTF(rc == 0, "crt_rpc_srv_register() failed, rc: %d\n", rc);
 
+	rc = CRT_RPC_SRV_REGISTER(RPC_ERR_OPC_ECHO, 0, rpc_err_noreply,
+				  rpc_err_echo_hdlr);
+	D_ASSERTF(rc == 0, "crt_rpc_srv_register() failed, rc: %d\n", rc);
+
+	rc = CRT_RPC_SRV_REGISTER(RPC_ERR_OPC_HOLD, 0, rpc_err_noreply,
+				  rpc_err_hold_hdlr);
+	D_ASSERTF(rc == 0, "crt_rpc_srv_register() failed, rc: %d\n", rc);
+
 	rc = crt_rpc_srv_register(RPC_ERR_OPC_SHUTDOWN, 0, NULL,
 				  rpc_err_shutdown_hdlr);
 	D_ASSERTF(rc == 0, "crt_rpc_srv_register() failed, rc: %d\n", rc);
@@ -226,6 +327,53 @@ rpc_err_init(void)
 	D_ASSERTF(rc == 0, "pthread_create() failed. rc: %d\n", rc);
 }
 
+/*
+ * Wait for the workers to finish the last handlers, then check that each RPC
+ * queued to the pool was handled once. Called once the progress thread is
+ * gone, so progress here to send the replies of the last handlers.
+ */
+static void
+rpc_err_hpool_check(void)
+{
+	struct crt_handler_pool_stats	stats[RPC_ERR_HPOOL_MAX];
+	unsigned int			nr;
+	uint64_t			queued;
+	uint64_t			executed;
+	int				retry;
+	int				i;
+	int				rc;
+
+	for (retry = 0; retry < 100; retry++) {
+		nr = RPC_ERR_HPOOL_MAX;
+		rc = crt_context_handler_pool_stats(rpc_err.re_crt_ctx, stats,
+						    &nr);
+		D_ASSERTF(rc == 0, "crt_context_handler_pool_stats() failed, "
+			  "rc: %d\n", rc);
+		D_ASSERTF(nr == rpc_err.re_hpool, "%u workers, expecting %u\n",
+			  nr, rpc_err.re_hpool);
+
+		queued = 0;
+		executed = 0;
+		for (i = 0; i < nr; i++) {
+			queued += stats[i].hps_queued;
+			executed += stats[i].hps_executed;
+			D_ASSERT(stats[i].hps_queue_len <=
+				 stats[i].hps_queue_hwm);
+		}
+		D_ASSERTF(executed <= queued, "executed "DF_U64", queued "
+			  DF_U64"\n", executed, queued);
+
+		rc = crt_progress(rpc_err.re_crt_ctx, 100000, NULL, NULL);
+		D_ASSERTF(rc == 0 || rc == -DER_TIMEDOUT,
+			  "crt_progress() failed, rc: %d\n", rc);
+		if (executed == queued)
+			break;
+	}
+	D_ASSERTF(queued > 0 && executed == queued, "executed "DF_U64
+		  ", queued "DF_U64"\n", executed, queued);
+	fprintf(stderr, "handler pool ran "DF_U64" handlers.\n", executed);
+}
+
 void
 rpc_err_fini()
 {
@@ -233,6 +381,8 @@ rpc_err_fini()
 
 	rc = pthread_join(rpc_err.re_tid, NULL);
 	D_ASSERTF(rc == 0, "pthread_join() failed, rc: %d\n", rc);
+	if (rpc_err.re_is_service && rpc_err.re_hpool > 0)
+		rpc_err_hpool_check();
 
 	rc = crt_context_destroy(rpc_err.re_crt_ctx, 0);
 	D_ASSERTF(rc == 0, "crt_context_destroy() failed. rc: %d\n", rc);
@@ -272,6 +422,15 @@ client_cb(const struct crt_cb_info *cb_info)
 		D_ASSERT(cb_info->cci_rc == -DER_UNREG);
 		sem_post(&re->re_all_done);
 		break;
+	case RPC_ERR_OPC_ECHO:
+	case RPC_ERR_OPC_HOLD:
+		D_ASSERTF(cb_info->cci_rc == 0, "echo failed, rc: %d\n",
+			  cb_info->cci_rc);
+		rpc_req_input = crt_req_get(rpc_req);
+		rpc_req_output = crt_reply_get(rpc_req);
+		D_ASSERT(rpc_req_output->magic == rpc_req_input->magic);
+		sem_post(&re->re_all_done);
+		break;
 	case RPC_ERR_OPC_SHUTDOWN:
 		sem_post(&re->re_all_done);
 		break;
@@ -340,6 +499,97 @@ rpc_err_rpc_issue()
 	}
 }
 
+/*
+ * Interleave the RPCs which succeed with both kinds which fail, the replies of
+ * the packed ones must not be affected by the errors of the others.
+ */
+static void
+rpc_err_burst_issue()
+{
+	crt_endpoint_t			 server_ep;
+	crt_rpc_t			*rpc_req = NULL;
+	struct rpc_err_noreply_in	*rpc_req_input;
+	crt_opcode_t			 opc;
+	int				 i, j;
+	int				 rc = 0;
+
+	for (i = 0; i < rpc_err.re_target_group_size; i++) {
+		server_ep.ep_grp = rpc_err.re_target_group;
+		server_ep.ep_rank = i;
+		server_ep.ep_tag = 0;
+
+		for (j = 0; j < RPC_ERR_BURST_NUM; j++) {
+			if (j % 4 == 1)
+				opc = RPC_ERR_OPC_NOREPLY;
+			else if (j % 4 == 3)
+				opc = RPC_ERR_OPC_NORPC;
+			else
+				opc = RPC_ERR_OPC_ECHO;
+
+			rc = crt_req_create(rpc_err.re_crt_ctx, &server_ep,
+					    opc, &rpc_req);
+			D_ASSERTF(rc == 0 && rpc_req != NULL,
+				  "crt_req_create() failed, rc: %d "
+				  "rpc_req: %p\n", rc, rpc_req);
+
+			if (opc != RPC_ERR_OPC_NORPC) {
+				rpc_req_input = crt_req_get(rpc_req);
+				rpc_req_input->magic = j;
+			}
+
+			rc = crt_req_send(rpc_req, client_cb, &rpc_err);
+			D_ASSERTF(rc == 0, "crt_req_send() failed, rc %d\n",
+				  rc);
+		}
+	}
+
+	for (i = 0; i < rpc_err.re_target_group_size * RPC_ERR_BURST_NUM; i++)
+		sem_wait(&rpc_err.re_all_done);
+}
+
+/*
+ * Starting from one credit, the timely replies to the echo RPCs grow the
+ * window of each rank. The held RPCs are only replied once all of them are
+ * inflight together, which times out unless the window has grown.
+ */
+static void
+rpc_err_credit_issue()
+{
+	crt_endpoint_t			 server_ep;
+	crt_rpc_t			*rpc_req = NULL;
+	struct rpc_err_noreply_in	*rpc_req_input;
+	int				 i, j;
+	int				 rc = 0;
+
+	for (i = 0; i < rpc_err.re_target_group_size; i++) {
+		server_ep.ep_grp = rpc_err.re_target_group;
+		server_ep.ep_rank = i;
+		server_ep.ep_tag = 0;
+
+		for (j = 0; j < RPC_ERR_CREDIT_WARMUP + RPC_ERR_HOLD_NUM;
+		     j++) {
+			rc = crt_req_create(rpc_err.re_crt_ctx, &server_ep,
+					    j < RPC_ERR_CREDIT_WARMUP ?
+					    RPC_ERR_OPC_ECHO : RPC_ERR_OPC_HOLD,
+					    &rpc_req);
+			D_ASSERTF(rc == 0 && rpc_req != NULL,
+				  "crt_req_create() failed, rc: %d "
+				  "rpc_req: %p\n", rc, rpc_req);
+
+			rpc_req_input = crt_req_get(rpc_req);
+			rpc_req_input->magic = j;
+
+			rc = crt_req_send(rpc_req, client_cb, &rpc_err);
+			D_ASSERTF(rc == 0, "crt_req_send() failed, rc %d\n",
+				  rc);
+			if (j < RPC_ERR_CREDIT_WARMUP)
+				sem_wait(&rpc_err.re_all_done);
+		}
+		for (j = 0; j < RPC_ERR_HOLD_NUM; j++)
+			sem_wait(&rpc_err.re_all_done);
+	}
+}
+
 void
 shutdown_cmd_issue()
 {
@@ -389,8 +639,12 @@ rpc_err_test_run(void)
 			rpc_err.re_target_group_size);
 	}
 
-	if (rpc_err.re_is_client)
+	if (rpc_err.re_is_client && rpc_err.re_credits) {
+		rpc_err_credit_issue();
+	} else if (rpc_err.re_is_client) {
 		rpc_err_rpc_issue();
+		rpc_err_burst_issue();
+	}
 
 	if (rpc_err.re_holdtime != 0)
 		sleep(rpc_err.re_holdtime);
@@ -45,6 +45,9 @@
 #include "gurt/common.h"
 #include "gurt/list.h"
 #include "gurt/heap.h"
+#include "gurt/timewheel.h"
+#include "gurt/rankmap.h"
+#include "gurt/rankset.h"
 #include "gurt/dlog.h"
 #include "gurt/hash.h"
 
@@ -554,6 +557,219 @@ test_binheap(void **state)
 	d_binheap_destroy(h);
 }
 
+static void
+test_timewheel(void **state)
+{
+	struct d_timewheel	 tw;
+	struct d_tw_node	 n1, n2, n3, n4;
+	struct d_tw_node	*n_tmp;
+	d_list_t		 expired;
+	uint64_t		 now = 1000000;
+	int			 rc;
+
+	(void)state;
+
+	/* 1 ms tick */
+	rc = d_timewheel_create_inplace(1000, now, &tw);
+	assert_int_equal(rc, 0);
+
+	/* level 0, upper levels, and already expired */
+	d_timewheel_insert(&tw, &n1, now + 10);
+	d_timewheel_insert(&tw, &n2, now + 500000);
+	d_timewheel_insert(&tw, &n3, now + 3600 * 1000000ULL);
+	d_timewheel_insert(&tw, &n4, 0);
+	assert_int_equal(d_timewheel_size(&tw), 4);
+
+	D_INIT_LIST_HEAD(&expired);
+	rc = d_timewheel_expire(&tw, now, &expired);
+	assert_int_equal(rc, 1);
+	n_tmp = d_list_pop_entry(&expired, struct d_tw_node, tn_link);
+	assert_true(n_tmp == &n4);
+
+	/* the next expiry is exact on level 0 */
+	assert_true(d_timewheel_next(&tw) == now + 1000);
+
+	/* never expires before the expiry time */
+	rc = d_timewheel_expire(&tw, now + 9, &expired);
+	assert_int_equal(rc, 0);
+	rc = d_timewheel_expire(&tw, now + 1000, &expired);
+	assert_int_equal(rc, 1);
+	n_tmp = d_list_pop_entry(&expired, struct d_tw_node, tn_link);
+	assert_true(n_tmp == &n1);
+
+	/* a lower bound on the upper levels */
+	assert_true(d_timewheel_next(&tw) <= now + 500000);
+	assert_true(d_timewheel_next(&tw) > now + 1000);
+
+	d_timewheel_remove(&tw, &n2);
+	assert_int_equal(d_timewheel_size(&tw), 1);
+	assert_true(d_timewheel_next(&tw) <= now + 3600 * 1000000ULL);
+	rc = d_timewheel_expire(&tw, now + 600000, &expired);
+	assert_int_equal(rc, 0);
+
+	/* cascaded down from the upper level */
+	rc = d_timewheel_expire(&tw, now + 3600 * 1000000ULL - 1, &expired);
+	assert_int_equal(rc, 0);
+	rc = d_timewheel_expire(&tw, now + 3600 * 1000000ULL, &expired);
+	assert_int_equal(rc, 1);
+	n_tmp = d_list_pop_entry(&expired, struct d_tw_node, tn_link);
+	assert_true(n_tmp == &n3);
+	assert_int_equal(d_timewheel_size(&tw), 0);
+	assert_true(d_timewheel_next(&tw) == UINT64_MAX);
+
+	d_timewheel_destroy_inplace(&tw);
+}
+
+static void
+test_rank_map(void **state)
+{
+	struct d_rank_map	map;
+	int			v1, v2;
+	int			rc;
+
+	(void)state;
+
+	rc = d_rank_map_init(&map, 1000);
+	assert_int_equal(rc, 0);
+	assert_null(d_rank_map_lookup(&map, 0));
+
+	rc = d_rank_map_set(&map, 5, &v1);
+	assert_int_equal(rc, 0);
+	assert_ptr_equal(d_rank_map_lookup(&map, 5), &v1);
+	assert_null(d_rank_map_lookup(&map, 6));
+
+	/* grow, the slots set before are kept */
+	rc = d_rank_map_set(&map, 999, &v2);
+	assert_int_equal(rc, 0);
+	assert_ptr_equal(d_rank_map_lookup(&map, 999), &v2);
+	assert_ptr_equal(d_rank_map_lookup(&map, 5), &v1);
+
+	rc = d_rank_map_set(&map, 1000, &v2);
+	assert_int_equal(rc, -DER_OVERFLOW);
+	assert_null(d_rank_map_lookup(&map, 1000));
+
+	rc = d_rank_map_set(&map, 5, NULL);
+	assert_int_equal(rc, 0);
+	assert_null(d_rank_map_lookup(&map, 5));
+
+	d_rank_map_fini(&map);
+}
+
+static void
+test_rank_set(void **state)
+{
+	struct d_rank_set	a, b;
+	d_rank_list_t		*list;
+	d_rank_list_t		in;
+	d_rank_t		ranks[] = {70, 3, 200, 3, 64};
+	d_rank_t		rank;
+	uint32_t		idx;
+	int			rc;
+
+	(void)state;
+
+	rc = d_rank_set_init(&a, 0);
+	assert_int_equal(rc, 0);
+	rc = d_rank_set_init(&b, 128);
+	assert_int_equal(rc, 0);
+
+	/* from an unsorted list with duplicates */
+	in.rl_ranks = ranks;
+	in.rl_nr = ARRAY_SIZE(ranks);
+	rc = d_rank_set_add_list(&a, &in);
+	assert_int_equal(rc, 0);
+	assert_int_equal(d_rank_set_nr(&a), 4);
+	assert_true(d_rank_set_has(&a, 200));
+	assert_false(d_rank_set_has(&a, 4));
+	assert_false(d_rank_set_has(&a, 100000));
+
+	rc = d_rank_set_idx(&a, 3, &idx);
+	assert_int_equal(rc, 0);
+	assert_int_equal(idx, 0);
+	rc = d_rank_set_idx(&a, 70, &idx);
+	assert_int_equal(rc, 0);
+	assert_int_equal(idx, 2);
+	rc = d_rank_set_idx(&a, 71, &idx);
+	assert_int_equal(rc, -DER_NONEXIST);
+	rc = d_rank_set_nth(&a, 3, &rank);
+	assert_int_equal(rc, 0);
+	assert_int_equal(rank, 200);
+	rc = d_rank_set_nth(&a, 4, &rank);
+	assert_int_equal(rc, -DER_NONEXIST);
+
+	rc = d_rank_set_add(&a, D_RANK_SET_MAX);
+	assert_int_equal(rc, -DER_OVERFLOW);
+
+	/* a = {3, 64, 70, 200}, b = {4, 64} */
+	rc = d_rank_set_add(&b, 4);
+	assert_int_equal(rc, 0);
+	rc = d_rank_set_add(&b, 64);
+	assert_int_equal(rc, 0);
+
+	d_rank_set_diff(&a, &b);
+	assert_int_equal(d_rank_set_nr(&a), 3);
+	assert_false(d_rank_set_has(&a, 64));
+	/* the index follows the changes */
+	rc = d_rank_set_idx(&a, 70, &idx);
+	assert_int_equal(rc, 0);
+	assert_int_equal(idx, 1);
+
+	rc = d_rank_set_union(&a, &b);
+	assert_int_equal(rc, 0);
+	assert_int_equal(d_rank_set_nr(&a), 5);
+
+	d_rank_set_intersect(&a, &b);
+	assert_int_equal(d_rank_set_nr(&a), 2);
+
+	rc = d_rank_set_to_list(&a, &list);
+	assert_int_equal(rc, 0);
+	assert_int_equal(list->rl_nr, 2);
+	assert_int_equal(list->rl_ranks[0], 4);
+	assert_int_equal(list->rl_ranks[1], 64);
+	d_rank_list_free(list);
+
+	d_rank_set_del(&a, 4);
+	d_rank_set_del(&a, 5);
+	assert_int_equal(d_rank_set_nr(&a), 1);
+
+	d_rank_set_fini(&b);
+	d_rank_set_fini(&a);
+}
+
+static void
+test_rank_list_filter(void **state)
+{
+	d_rank_list_t	*src;
+	d_rank_list_t	*dst;
+	int		 i;
+
+	(void)state;
+
+	/* src above the scan limit goes through a rank set */
+	src = d_rank_list_alloc(100);
+	assert_non_null(src);
+	for (i = 0; i < 100; i++)
+		src->rl_ranks[i] = i * 2;
+	dst = d_rank_list_alloc(50);
+	assert_non_null(dst);
+
+	d_rank_list_filter(src, dst, true /* exclude */);
+	assert_int_equal(dst->rl_nr, 25);
+	for (i = 0; i < dst->rl_nr; i++)
+		assert_int_equal(dst->rl_ranks[i], i * 2 + 1);
+	d_rank_list_free(dst);
+
+	dst = d_rank_list_alloc(50);
+	assert_non_null(dst);
+	d_rank_list_filter(src, dst, false /* exclude */);
+	assert_int_equal(dst->rl_nr, 25);
+	for (i = 0; i < dst->rl_nr; i++)
+		assert_int_equal(dst->rl_ranks[i], i * 2);
+	d_rank_list_free(dst);
+
+	d_rank_list_free(src);
+}
+
 #define LOG_DEBUG(fac, ...) \
 	do {								\
 		if (d_log_check((fac) | DLOG_DBG))			\
@@ -1654,6 +1870,10 @@ main(int argc, char **argv)
 		cmocka_unit_test(test_gurt_list),
 		cmocka_unit_test(test_gurt_hlist),
 		cmocka_unit_test(test_binheap),
+		cmocka_unit_test(test_timewheel),
+		cmocka_unit_test(test_rank_map),
+		cmocka_unit_test(test_rank_set),
+		cmocka_unit_test(test_rank_list_filter),
 		cmocka_unit_test(test_log),
 		cmocka_unit_test(test_gurt_hash_empty),
 		cmocka_unit_test(test_gurt_hash_insert_lookup_delete),
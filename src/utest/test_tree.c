@@ -0,0 +1,202 @@
+/* Copyright (C) 2018 Intel Corporation
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted for any purpose (including commercial purposes)
+ * provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions, and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions, and the following disclaimer in the
+ *    documentation and/or materials provided with the distribution.
+ *
+ * 3. In addition, redistributions of modified forms of the source or binary
+ *    code must carry prominent notices stating that the original code was
+ *    changed and the date of the change.
+ *
+ *  4. All publications or advertising materials mentioning features or use of
+ *     this software are asked, but not required, to acknowledge that it was
+ *     developed by Intel Corporation and credit the contributors.
+ *
+ * 5. Neither the name of Intel Corporation, nor the name of any Contributor
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * This file tests the tree topologies of CaRT, the trees of the collective
+ * RPCs and their segment waits must agree on every rank.
+ */
+#include <stdio.h>
+#include "utest_cmocka.h"
+#include "../cart/crt_internal.h"
+
+/* nodes of the locality maps, the ranks of each map are spread over them */
+#define TEST_TREE_NODES		(3)
+
+static const uint32_t test_tree_sizes[] = {1, 2, 3, 5, 8, 13, 32, 33};
+static const uint32_t test_tree_ratios[] = {2, 3, 4};
+
+/* locality map i of a group of grp_size ranks */
+static void
+test_tree_loc_fill(int map, uint32_t grp_size, uint32_t *grp_loc)
+{
+	uint32_t	i;
+
+	for (i = 0; i < grp_size; i++) {
+		switch (map) {
+		case 0:
+			/* all on one node */
+			grp_loc[i] = 7;
+			break;
+		case 1:
+			/* one rank per node */
+			grp_loc[i] = grp_size - i;
+			break;
+		case 2:
+			/* round robin over the nodes */
+			grp_loc[i] = i % TEST_TREE_NODES;
+			break;
+		case 3:
+			/* blocks of consecutive ranks */
+			grp_loc[i] = i / TEST_TREE_NODES;
+			break;
+		default:
+			/* uneven nodes, rank 0 alone on the last one */
+			grp_loc[i] = i == 0 ? 100 : (i * i) % 5;
+			break;
+		}
+	}
+}
+
+/*
+ * Walk the tree from @grp_root through get_children and check that every
+ * rank is reached exactly once, from the parent get_parent gives.
+ */
+static void
+test_tree_check(struct crt_topo_ops *ops, uint32_t grp_size, uint32_t ratio,
+		uint32_t grp_root, const uint32_t *grp_loc)
+{
+	uint32_t	*seen;
+	uint32_t	*queue;
+	uint32_t	*children;
+	uint32_t	 head = 0, tail = 0;
+	uint32_t	 nchildren;
+	uint32_t	 parent;
+	uint32_t	 self;
+	uint32_t	 i;
+	int		 rc;
+
+	D_ALLOC_ARRAY(seen, grp_size);
+	D_ALLOC_ARRAY(queue, grp_size);
+	D_ALLOC_ARRAY(children, grp_size);
+	assert_non_null(seen);
+	assert_non_null(queue);
+	assert_non_null(children);
+
+	rc = ops->to_get_parent(grp_size, ratio, grp_root, grp_root, &parent,
+				grp_loc);
+	assert_int_equal(rc, -DER_INVAL);
+
+	seen[grp_root] = 1;
+	queue[tail++] = grp_root;
+	while (head < tail) {
+		self = queue[head++];
+
+		rc = ops->to_get_children_cnt(grp_size, ratio, grp_root, self,
+					      &nchildren, grp_loc);
+		assert_int_equal(rc, 0);
+		assert_true(nchildren < grp_size);
+		if (nchildren == 0)
+			continue;
+
+		rc = ops->to_get_children(grp_size, ratio, grp_root, self,
+					  children, grp_loc);
+		assert_int_equal(rc, 0);
+		for (i = 0; i < nchildren; i++) {
+			assert_true(children[i] < grp_size);
+			assert_int_equal(seen[children[i]], 0);
+			seen[children[i]] = 1;
+			queue[tail++] = children[i];
+
+			rc = ops->to_get_parent(grp_size, ratio, grp_root,
+						children[i], &parent, grp_loc);
+			assert_int_equal(rc, 0);
+			assert_int_equal(parent, self);
+		}
+	}
+	assert_int_equal(tail, grp_size);
+
+	D_FREE(children);
+	D_FREE(queue);
+	D_FREE(seen);
+}
+
+static void
+test_tree_locality(void **state)
+{
+	uint32_t	*grp_loc;
+	uint32_t	 grp_size;
+	uint32_t	 grp_root;
+	int		 s, r, map;
+
+	for (s = 0; s < ARRAY_SIZE(test_tree_sizes); s++) {
+		grp_size = test_tree_sizes[s];
+		D_ALLOC_ARRAY(grp_loc, grp_size);
+		assert_non_null(grp_loc);
+
+		for (r = 0; r < ARRAY_SIZE(test_tree_ratios); r++) {
+			for (grp_root = 0; grp_root < grp_size; grp_root++) {
+				/* plain knomial without the locality */
+				test_tree_check(&crt_locality_ops, grp_size,
+						test_tree_ratios[r], grp_root,
+						NULL);
+				for (map = 0; map < 5; map++) {
+					test_tree_loc_fill(map, grp_size,
+							   grp_loc);
+					test_tree_check(&crt_locality_ops,
+							grp_size,
+							test_tree_ratios[r],
+							grp_root, grp_loc);
+				}
+			}
+		}
+
+		D_FREE(grp_loc);
+	}
+}
+
+static int
+init_tests(void **state)
+{
+	return d_log_init();
+}
+
+static int
+fini_tests(void **state)
+{
+	d_log_fini();
+
+	return 0;
+}
+
+int
+main(int argc, char **argv)
+{
+	const struct CMUnitTest tests[] = {
+		cmocka_unit_test(test_tree_locality),
+	};
+
+	return cmocka_run_group_tests(tests, init_tests, fini_tests);
+}
@@ -122,6 +122,14 @@ class TestCartCtl(commontestsuite.CommonTestSuite):
                                    cli_arg='../bin/cart_ctl list_ctx' + \
                                            ' --group-name service-group' + \
                                            ' --rank 0,2-3,4')
+        if not procrtn:
+            procrtn = self.launch_test(testmsg, '1', self.pass_env, \
+                                       cli=client, \
+                                       cli_arg='../bin/cart_ctl' + \
+                                               ' rpc_cache' + \
+                                               ' --group-name' + \
+                                               ' service-group' + \
+                                               ' --rank 0-4')
 
         self.stop_process(testmsg, server_proc)
         if procrtn:
@@ -116,6 +116,91 @@ class TestGroup(commontestsuite.CommonTestSuite):
         if procrtn:
             self.fail("Failed, return code %d" % procrtn)
 
+    def test_group_progress_set(self):
+        """Process group test with all contexts in one progress set"""
+        testmsg = self.shortDescription()
+        clients = self.get_client_list()
+        if clients:
+            self.skipTest('Client list is not empty.')
+
+        # Launch both the client and target instances on the
+        # same node, each progressing its contexts from one thread.
+        procrtn = self.launch_test(testmsg, '1', self.pass_env, \
+                                   cli_arg='tests/test_group' + \
+                                             ' --name client_group' + \
+                                             ' --attach_to service_group' + \
+                                             ' --ctx_num 4 --progress_set',
+                                   srv_arg='tests/test_group' + \
+                                             ' --name service_group' + \
+                                             ' --is_service' + \
+                                             ' --ctx_num 4 --progress_set')
+        if procrtn:
+            self.fail("Failed, return code %d" % procrtn)
+
+    def test_group_prefetch(self):
+        """Process group test with the URIs prefetched on attach"""
+        testmsg = self.shortDescription()
+        clients = self.get_client_list()
+        if clients:
+            self.skipTest('Client list is not empty.')
+
+        # The servers save only the PSR in the attach info, the client
+        # checks that the URIs of all four are cached before its first RPC
+        # to them.
+        env = self.pass_env + ' -x CRT_ATTACH_PREFETCH=1'
+        (cmd, prefix) = self.add_prefix_logdir()
+        cmdstr = "{!s} -N 4 {!s}{!s} {!s} : -N 1 {!s}{!s} {!s}".format(
+            cmd, env, prefix,
+            'tests/test_group --name service_group --is_service --prefetch',
+            env, prefix,
+            'tests/test_group --name client_group' + \
+            ' --attach_to service_group --prefetch')
+        procrtn = self.execute_cmd(testmsg, cmdstr)
+        if procrtn:
+            self.fail("Failed, return code %d" % procrtn)
+
+    def test_group_attach_info(self):
+        """Process group test attaching without a valid binary attach info"""
+        testmsg = self.shortDescription()
+        clients = self.get_client_list()
+        if clients:
+            self.skipTest('Client list is not empty.')
+
+        # The client reattaches with the binary attach info of the four
+        # servers removed, truncated and with a bad header, and checks that
+        # the text file is used instead.
+        (cmd, prefix) = self.add_prefix_logdir()
+        cmdstr = "{!s} -N 4 {!s}{!s} {!s} : -N 1 {!s}{!s} {!s}".format(
+            cmd, self.pass_env, prefix,
+            'tests/test_group --name service_group --is_service',
+            self.pass_env, prefix,
+            'tests/test_group --name client_group' + \
+            ' --attach_to service_group --attach_info')
+        procrtn = self.execute_cmd(testmsg, cmdstr)
+        if procrtn:
+            self.fail("Failed, return code %d" % procrtn)
+
+    def test_group_corpc_bulk(self):
+        """Process group test broadcasting a bulk in segments"""
+        testmsg = self.shortDescription()
+        clients = self.get_client_list()
+        if clients:
+            self.skipTest('Client list is not empty.')
+
+        # The client has the four servers broadcast a 1 MiB + 1 payload in
+        # 64 KiB segments down a knomial tree, each of them checks it.
+        env = self.pass_env + ' -x CRT_CORPC_BULK_SEG=65536'
+        (cmd, prefix) = self.add_prefix_logdir()
+        cmdstr = "{!s} -N 4 {!s}{!s} {!s} : -N 1 {!s}{!s} {!s}".format(
+            cmd, env, prefix,
+            'tests/test_group --name service_group --is_service',
+            env, prefix,
+            'tests/test_group --name client_group' + \
+            ' --attach_to service_group --corpc_bulk')
+        procrtn = self.execute_cmd(testmsg, cmdstr)
+        if procrtn:
+            self.fail("Failed, return code %d" % procrtn)
+
     def test_group_two_nodes(self):
         """Simple process group test two node"""
 
@@ -91,12 +91,13 @@ class TestNoPmix(commontestsuite.CommonTestSuite):
         os.environ.pop("CRT_TEST_SERVER", "")
         self.logger.info("tearDown end")
 
-    def test_no_pmix(self):
-        """test_no_pmix test case"""
+    def run_no_pmix(self, ranks, master_rank, ports=None, master_args=None):
+        """run test_no_pmix on ranks, master_rank issuing the tests
+
+        ports optionally maps ranks to the OFI_PORT they listen on.
+        """
 
         test_bin = 'tests/test_no_pmix'
-        ranks = [1, 2, 3, 10, 4]
-        master_rank = 10
 
         for x in ranks:
             tmp_file = "/tmp/no_pmix_rank{}.uri_info".format(x)
@@ -106,9 +107,17 @@ class TestNoPmix(commontestsuite.CommonTestSuite):
         process_other = []
         arg_master = ",".join(map(str, ranks))
 
-        test_env = self.pass_env
+        def rank_env(rank):
+            """environment of rank"""
+            test_env = dict(self.pass_env)
+            if ports and rank in ports:
+                test_env["OFI_PORT"] = str(ports[rank])
+            return test_env
+
         p1 = subprocess.Popen([test_bin, '{}'.format(master_rank),
-                               '-m {}'.format(arg_master)], env=test_env,
+                               '-m {}'.format(arg_master)] + \
+                              (master_args or []),
+                              env=rank_env(master_rank),
                               stdout=subprocess.PIPE)
 
         for rank in ranks:
@@ -116,7 +125,7 @@ class TestNoPmix(commontestsuite.CommonTestSuite):
                 continue
 
             p = subprocess.Popen([test_bin, '{}'.format(rank)],
-                                 env=test_env, stdout=subprocess.PIPE)
+                                 env=rank_env(rank), stdout=subprocess.PIPE)
             process_other.append(p)
 
 
@@ -136,3 +145,26 @@ class TestNoPmix(commontestsuite.CommonTestSuite):
 
         print("everything finished successfully")
         return 0
+
+    def test_no_pmix(self):
+        """test_no_pmix test case"""
+
+        return self.run_no_pmix([1, 2, 3, 10, 4], 10)
+
+    def test_no_pmix_rd(self):
+        """test_no_pmix on a power of two ranks, to run the RD collectives"""
+
+        return self.run_no_pmix([1, 2, 10, 4], 10)
+
+    def test_no_pmix_uri_tmpl(self):
+        """test_no_pmix with the URIs of the ranks from a URI template"""
+
+        # Each rank has two contexts, listening on OFI_PORT and the next
+        # port. Rank 4 is off the template ports, its URIs override the
+        # template ones.
+        port_base = 31400
+        ports = {1: port_base + 2, 2: port_base + 4, 10: port_base + 20,
+                 4: port_base + 40}
+
+        return self.run_no_pmix([1, 2, 10, 4], 10, ports,
+                                ['-t {}'.format(port_base)])
@@ -109,6 +109,44 @@ class TestRpcError(commontestsuite.CommonTestSuite):
         if procrtn:
             self.fail("Failed, return code %d" % procrtn)
 
+    def test_rpc_error_credits(self):
+        """Credit window growth test one node"""
+        testmsg = self.shortDescription()
+        clients = self.get_client_list()
+        if clients:
+            self.skipTest('Client list is not empty.')
+
+        # The client starts from one credit per endpoint, the server only
+        # replies once several requests are inflight together.
+        procrtn = self.launch_test(testmsg, '1', self.pass_env, \
+                                   cli_arg='tests/test_rpc_error' + \
+                                             ' --name client_group' + \
+                                             ' --attach_to service_group' + \
+                                             ' --credits', \
+                                   srv_arg='tests/test_rpc_error' + \
+                                             ' --name service_group' + \
+                                             ' --is_service ')
+        if procrtn:
+            self.fail("Failed, return code %d" % procrtn)
+
+    def test_rpc_error_hpool(self):
+        """RPC error test one node with a server handler pool"""
+        testmsg = self.shortDescription()
+        clients = self.get_client_list()
+        if clients:
+            self.skipTest('Client list is not empty.')
+
+        # The server runs the RPC handlers in a pool of worker threads.
+        procrtn = self.launch_test(testmsg, '1', self.pass_env, \
+                                   cli_arg='tests/test_rpc_error' + \
+                                             ' --name client_group' + \
+                                             ' --attach_to service_group', \
+                                   srv_arg='tests/test_rpc_error' + \
+                                             ' --name service_group' + \
+                                             ' --is_service --hpool 4')
+        if procrtn:
+            self.fail("Failed, return code %d" % procrtn)
+
     def test_rpc_error_two_nodes(self):
         """Simple process group test two node"""
 